@@ -0,0 +1,281 @@
+/* compile with
+  -- Windows --
+  cl /I../../ /O2 benchmark.c /link /out:benchmark.exe kernel32.lib user32.lib gdi32.lib shell32.lib
+  -- Linux --
+  gcc -I../../ -O2 benchmark.c -o benchmark -lX11 -lm
+  gcc -I../../ -O2 -DWUHOO_XCB_ENABLE benchmark.c -o benchmark_xcb -lX11 -lX11-xcb -lxcb -lm
+  -- Mac OS X --
+  gcc -I../../ -O2 benchmark.c -o benchmark -framework Cocoa -framework Quartz -framework Carbon
+
+  Run both Linux builds on the same (virtual) server to compare backends, e.g.
+  xvfb-run -s "-screen 0 1920x1080x24" ./benchmark 1280 720 1000
+
+  A fourth argument selects window modes, "vsync" presents every frame on
+  the vertical retrace (with WUHOO_XPRESENT_ENABLE on X11), "blend" blends
+  blits over the window and "transparent" asks for a window the compositing
+  manager blends with the desktop (both with WUHOO_XRENDER_ENABLE on X11)
+  gcc -I../../ -O2 -DWUHOO_XPRESENT_ENABLE benchmark.c -o benchmark_present -lX11 -lXpresent -lm
+  xvfb-run -s "-screen 0 1920x1080x24" ./benchmark_present 640 480 200 vsync
+  gcc -I../../ -O2 -DWUHOO_XRENDER_ENABLE benchmark.c -o benchmark_render -lX11 -lXrender -lm
+  xvfb-run -s "-screen 0 1920x1080x24" ./benchmark_render 640 480 200 transparent,blend
+
+  Without any display the headless backend measures the conversion alone,
+  checks the last frame bit for bit and the throughput of injected events
+  gcc -I../../ -O2 -DWUHOO_HEADLESS_ENABLE benchmark.c -o benchmark_headless -lm
+
+  With WUHOO_EXPORT_ENABLE the frames are exported for ../export/consumer.c
+  gcc -I../../ -O2 -DWUHOO_EXPORT_ENABLE benchmark.c -o benchmark_export -lX11 -lm
+
+  With WUHOO_THREADS_ENABLE frames of 512K pixels and more are converted on
+  the worker pool, compare with the plain build at e.g. 7680x4320
+  gcc -I../../ -O2 -DWUHOO_THREADS_ENABLE benchmark.c -o benchmark_threads -lX11 -lpthread -lm
+*/
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+/* Counts the round trips of the X11 backend, see WuhooWindowRoundTripsGet */
+#define WUHOO_DEBUG
+#define WUHOO_IMPLEMENTATION
+#include "wuhoo.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WUHOO_EXPORT_ENABLE
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+static double
+benchmark_seconds(void)
+{
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (double)counter.QuadPart / (double)frequency.QuadPart;
+}
+#else
+#include <time.h>
+
+static double
+benchmark_seconds(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+#endif
+
+static void
+benchmark_draw(WuhooRGBA* pixels, int width, int height, int frame)
+{
+  int x, y;
+  for (y = 0; y < height; y++) {
+    for (x = 0; x < width; x++) {
+      WuhooRGBA* pixel = &pixels[x + y * width];
+      pixel->r = (unsigned char)(x + frame);
+      pixel->g = (unsigned char)(y + frame);
+      pixel->b = (unsigned char)(x ^ y);
+      pixel->a = 255;
+    }
+  }
+}
+
+#ifdef WUHOO_HEADLESS_ENABLE
+/* Compares the surface with what the conversion of pixels has to produce,
+ * returns the number of mismatching pixels */
+static int
+benchmark_verify(WuhooWindow* window, const WuhooRGBA* pixels, int width, int height)
+{
+  WuhooFramebuffer framebuffer;
+  int x, y, mismatches = 0;
+
+  WuhooWindowFramebufferAcquire(window, &framebuffer);
+  for (y = 0; y < height; y++) {
+    const unsigned char* row = (const unsigned char*)framebuffer.pixels + y * framebuffer.pitch;
+    for (x = 0; x < width; x++) {
+      const WuhooRGBA* pixel = &pixels[x + y * width];
+      unsigned int value    = row[4 * x] | (row[4 * x + 1] << 8) | (row[4 * x + 2] << 16);
+      unsigned int expected = (pixel->r << 16) | (pixel->g << 8) | pixel->b;
+      if (value != expected)
+        mismatches++;
+    }
+  }
+  WuhooWindowFramebufferRelease(window, WuhooNull, 0);
+
+  return mismatches;
+}
+
+/* Round trips of events through the injection queue */
+static double
+benchmark_events(WuhooWindow* window, int count)
+{
+  WuhooEvent event;
+  double start = benchmark_seconds();
+  int i, j;
+
+  for (i = 0; i < count; i += 256) {
+    for (j = 0; j < 256; j++) {
+      memset(&event, 0, sizeof(event));
+      event.type = WUHOO_EVT_MOUSE_MOVE;
+      event.data.mouse_move.x = j;
+      WuhooWindowEventInject(window, &event);
+    }
+    for (j = 0; j < 256; j++)
+      WuhooWindowEventNext(window, &event);
+  }
+
+  return benchmark_seconds() - start;
+}
+#endif
+
+int main(int argc, const char * argv[]) {
+  WuhooWindow window;
+  WuhooEvent event;
+
+  int width  = (argc > 1) ? atoi(argv[1]) : 1280;
+  int height = (argc > 2) ? atoi(argv[2]) : 720;
+  int frames = (argc > 3) ? atoi(argv[3]) : 1000;
+  const char* modes = (argc > 4) ? argv[4] : "";
+  int frame;
+
+  WuhooWindowFlags flags = WUHOO_FLAG_CANVAS | WUHOO_FLAG_TITLED |
+                           WUHOO_FLAG_CLIENT_REGION | WUHOO_FLAG_CLOSEABLE;
+  if (strstr(modes, "vsync"))
+    flags |= WUHOO_FLAG_VSYNC;
+  if (strstr(modes, "transparent"))
+    flags |= WUHOO_FLAG_TRANSPARENT;
+
+  WuhooRGBA* pixels = (WuhooRGBA*)malloc(width * height * sizeof(*pixels));
+
+  WuhooWindowInit(&window);
+  WuhooResult result = WuhooWindowCreate(&window, 0, 0, width, height, "Wuhoo Benchmark",
+		    flags, WuhooNull);
+  if (WuhooSuccess != result) {
+    printf("|Wuhoo Benchmark| %s\n", (const char*)result);
+    return 1;
+  }
+  WuhooWindowShow(&window);
+
+  WuhooBoolean blend = WuhooFalse;
+  if (strstr(modes, "blend")) {
+    result = WuhooWindowBlitBlendSet(&window, WUHOO_BLIT_BLEND_OVER);
+    if (WuhooSuccess != result)
+      printf("|Wuhoo Benchmark| %s\n", (const char*)result);
+    blend = (WuhooSuccess == result);
+  }
+
+#ifdef WUHOO_EXPORT_ENABLE
+  int export_fd = -1;
+  result = WuhooWindowExportStart(&window, 3, &export_fd);
+  if (WuhooSuccess != result) {
+    printf("|Wuhoo Benchmark| %s\n", (const char*)result);
+    return 1;
+  }
+  printf("|Wuhoo Benchmark| exporting frames through /proc/%d/fd/%d\n", (int)getpid(), export_fd);
+  fflush(stdout);
+#endif
+
+  /* Let the window get mapped before measuring */
+  benchmark_draw(pixels, width, height, 0);
+  for (frame = 0; frame < 10; frame++) {
+    WuhooWindowEventNext(&window, &event);
+    WuhooWindowBlit(&window, pixels, 0, 0, width, height, 0, 0, width, height);
+  }
+
+  double draw_time = 0.0;
+  double blit_time = 0.0;
+  double blit_max  = 0.0;
+  double start     = benchmark_seconds();
+  WuhooSize round_trips = 0;
+  WuhooSize round_trips_end = 0;
+  WuhooWindowRoundTripsGet(&window, &round_trips);
+
+  for (frame = 0; frame < frames; frame++) {
+    WuhooWindowEventNext(&window, &event);
+    if (WUHOO_EVT_WINDOW == event.type && WUHOO_WSTATE_CLOSED == event.data.window.state)
+      break;
+
+    double draw_start = benchmark_seconds();
+    benchmark_draw(pixels, width, height, frame);
+    double blit_start = benchmark_seconds();
+    WuhooWindowBlit(&window, pixels, 0, 0, width, height, 0, 0, width, height);
+    double blit_end = benchmark_seconds();
+
+    draw_time += blit_start - draw_start;
+    blit_time += blit_end - blit_start;
+    if (blit_end - blit_start > blit_max)
+      blit_max = blit_end - blit_start;
+  }
+
+  double total = benchmark_seconds() - start;
+  WuhooWindowRoundTripsGet(&window, &round_trips_end);
+  round_trips  = round_trips_end - round_trips;
+
+  /* The same frames presented as the damage of the four quadrants */
+  WuhooRect rects[4] = {
+    { 0, 0, width / 2, height / 2 },
+    { width / 2, 0, width - width / 2, height / 2 },
+    { 0, height / 2, width / 2, height - height / 2 },
+    { width / 2, height / 2, width - width / 2, height - height / 2 }
+  };
+  double rects_time = 0.0;
+  int rects_frames = 0;
+  WuhooSize rects_round_trips = 0;
+  WuhooWindowRoundTripsGet(&window, &rects_round_trips);
+
+  for (rects_frames = 0; frame > 0 && rects_frames < frames; rects_frames++) {
+    WuhooWindowEventNext(&window, &event);
+    if (WUHOO_EVT_WINDOW == event.type && WUHOO_WSTATE_CLOSED == event.data.window.state)
+      break;
+
+    benchmark_draw(pixels, width, height, rects_frames);
+    double rects_start = benchmark_seconds();
+    WuhooWindowBlitRects(&window, pixels, width, rects, 4);
+    rects_time += benchmark_seconds() - rects_start;
+  }
+
+  WuhooWindowRoundTripsGet(&window, &round_trips_end);
+  rects_round_trips = round_trips_end - rects_round_trips;
+
+  printf("|Wuhoo Benchmark| backend %s, %dx%d, %d frames%s%s%s\n",
+#ifdef WUHOO_XCB_ENABLE
+         WUHOO_PLATFORM_API_STRING " (xcb)",
+#else
+         WUHOO_PLATFORM_API_STRING,
+#endif
+         width, height, frame,
+         (WUHOO_FLAG_VSYNC & window.flags) ? ", vsync" : "",
+         (WUHOO_FLAG_TRANSPARENT & window.flags) ? ", transparent" : "",
+         blend ? ", blend" : "");
+  if (frame > 0) {
+    printf("|Wuhoo Benchmark| %.1f frames/s, blit %.3f ms avg / %.3f ms max, draw %.3f ms avg\n",
+           frame / total, 1000.0 * blit_time / frame, 1000.0 * blit_max, 1000.0 * draw_time / frame);
+    printf("|Wuhoo Benchmark| %lu round trips while measuring\n", (unsigned long)round_trips);
+  }
+  if (rects_frames > 0) {
+    printf("|Wuhoo Benchmark| blit rects %.3f ms avg, %lu round trips over %d frames\n",
+           1000.0 * rects_time / rects_frames, (unsigned long)rects_round_trips, rects_frames);
+  }
+
+#ifdef WUHOO_HEADLESS_ENABLE
+  /* The default headless surface is 32 bit XRGB */
+  int mismatches = (frame > 0) ? benchmark_verify(&window, pixels, width, height) : 0;
+  double event_time = benchmark_events(&window, 256 * 4096);
+  printf("|Wuhoo Benchmark| last frame %s (%d mismatching pixels)\n",
+         mismatches ? "differs" : "is bit-exact", mismatches);
+  printf("|Wuhoo Benchmark| %.1f million injected events/s\n", 256 * 4096 / event_time * 1e-6);
+#endif
+
+  WuhooWindowDestroy(&window);
+  free(pixels);
+
+#ifdef WUHOO_HEADLESS_ENABLE
+  return mismatches ? 1 : 0;
+#else
+  return 0;
+#endif
+}
@@ -0,0 +1,524 @@
+/* compile with
+  -- Windows --
+  cl /I../../ /O2 kernels.c /link /out:kernels.exe kernel32.lib user32.lib gdi32.lib shell32.lib
+  -- Linux --
+  gcc -I../../ -O2 kernels.c -o kernels -lX11 -lm
+  -- Mac OS X --
+  gcc -I../../ -O2 kernels.c -o kernels -framework Cocoa -framework Quartz -framework Carbon
+
+  Times every conversion kernel the CPU can run against the scalar one and
+  checks that they produce the same bytes, the scalar R5G6B5 kernels are
+  checked against a plain per pixel reference. The compositing rows behind
+  WuhooBlendOver are checked the same way, and WuhooBlendOverPattern is
+  timed against the floating point loop the viewer used to composite images
+  over its checkerboard. The rows that expose and tonemap the floats of
+  WuhooWindowBlitFloat are checked against the scalar one for each tonemap,
+  and the YUV rows of WuhooWindowBlitYUV for each layout and matrix.
+  No window is opened, e.g.
+  ./kernels 1920 1080 200
+*/
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#define WUHOO_IMPLEMENTATION
+#include "wuhoo.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+static double
+kernels_seconds(void)
+{
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (double)counter.QuadPart / (double)frequency.QuadPart;
+}
+#else
+#include <time.h>
+
+static double
+kernels_seconds(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+#endif
+
+typedef struct {
+  const char*      name;
+  WuhooConvertRGBA scalar;
+  WuhooConvertRGBA kernel;
+  unsigned int     features;
+  int              bytes_per_pixel;
+} KernelsEntry;
+
+static const KernelsEntry kernels_entries[] = {
+  { "RGBA to BGRA   scalar", WuhooConvertRGBAtoBGRA, WuhooConvertRGBAtoBGRA, 0, 4 },
+  { "RGBA to RGB    scalar", WuhooConvertRGBAtoRGB, WuhooConvertRGBAtoRGB, 0, 4 },
+  { "RGBA to 565    scalar", WuhooConvertRGBAtoR5G6B5, WuhooConvertRGBAtoR5G6B5, 0, 2 },
+  { "RGBA to 565 d. scalar", WuhooConvertRGBAtoR5G6B5Dither, WuhooConvertRGBAtoR5G6B5Dither, 0, 2 },
+#ifdef WUHOO_X86
+  { "RGBA to BGRA   SSSE3 ", WuhooConvertRGBAtoBGRA, WuhooConvertRGBAtoBGRASSSE3, WUHOO_CPU_SSSE3, 4 },
+  { "RGBA to RGB    SSSE3 ", WuhooConvertRGBAtoRGB, WuhooConvertRGBAtoRGBSSSE3, WUHOO_CPU_SSSE3, 4 },
+  { "RGBA to 565    SSE2  ", WuhooConvertRGBAtoR5G6B5, WuhooConvertRGBAtoR5G6B5SSE2, WUHOO_CPU_SSE2, 2 },
+  { "RGBA to 565 d. SSE2  ", WuhooConvertRGBAtoR5G6B5Dither, WuhooConvertRGBAtoR5G6B5DitherSSE2, WUHOO_CPU_SSE2, 2 },
+  { "RGBA to BGRA   AVX2  ", WuhooConvertRGBAtoBGRA, WuhooConvertRGBAtoBGRAAVX2, WUHOO_CPU_AVX2, 4 },
+  { "RGBA to RGB    AVX2  ", WuhooConvertRGBAtoRGB, WuhooConvertRGBAtoRGBAVX2, WUHOO_CPU_AVX2, 4 },
+  { "RGBA to 565    AVX2  ", WuhooConvertRGBAtoR5G6B5, WuhooConvertRGBAtoR5G6B5AVX2, WUHOO_CPU_AVX2, 2 },
+  { "RGBA to 565 d. AVX2  ", WuhooConvertRGBAtoR5G6B5Dither, WuhooConvertRGBAtoR5G6B5DitherAVX2, WUHOO_CPU_AVX2, 2 },
+#endif
+#ifdef WUHOO_NEON
+  { "RGBA to BGRA   NEON  ", WuhooConvertRGBAtoBGRA, WuhooConvertRGBAtoBGRANEON, WUHOO_CPU_NEON, 4 },
+  { "RGBA to RGB    NEON  ", WuhooConvertRGBAtoRGB, WuhooConvertRGBAtoRGBNEON, WUHOO_CPU_NEON, 4 },
+  { "RGBA to 565    NEON  ", WuhooConvertRGBAtoR5G6B5, WuhooConvertRGBAtoR5G6B5NEON, WUHOO_CPU_NEON, 2 },
+  { "RGBA to 565 d. NEON  ", WuhooConvertRGBAtoR5G6B5Dither, WuhooConvertRGBAtoR5G6B5DitherNEON, WUHOO_CPU_NEON, 2 },
+#endif
+};
+
+typedef struct {
+  const char*   name;
+  WuhooBlendRow row;
+  unsigned int  features;
+} KernelsBlendEntry;
+
+static const KernelsBlendEntry kernels_blend_entries[] = {
+  { "RGBA over RGBA scalar", WuhooBlendRowScalar, 0 },
+#ifdef WUHOO_X86
+  { "RGBA over RGBA SSE2  ", WuhooBlendRowSSE2, WUHOO_CPU_SSE2 },
+  { "RGBA over RGBA AVX2  ", WuhooBlendRowAVX2, WUHOO_CPU_AVX2 },
+#endif
+#ifdef WUHOO_NEON
+  { "RGBA over RGBA NEON  ", WuhooBlendRowNEON, WUHOO_CPU_NEON },
+#endif
+};
+
+typedef struct {
+  const char*   name;
+  WuhooFloatRow row;
+  unsigned int  features;
+} KernelsFloatEntry;
+
+static const KernelsFloatEntry kernels_float_entries[] = {
+  { "float encode scalar  ", WuhooFloatRowScalar, 0 },
+#ifdef WUHOO_X86
+  { "float encode SSE2    ", WuhooFloatRowSSE2, WUHOO_CPU_SSE2 },
+#endif
+#ifdef WUHOO_FLOAT_NEON
+  { "float encode NEON    ", WuhooFloatRowNEON, WUHOO_CPU_NEON },
+#endif
+};
+
+typedef struct {
+  const char*  name;
+  WuhooYUVRow  row;
+  unsigned int features;
+} KernelsYUVEntry;
+
+static const KernelsYUVEntry kernels_yuv_entries[] = {
+  { "yuv convert scalar   ", WuhooYUVRowScalar, 0 },
+#ifdef WUHOO_X86
+  { "yuv convert SSE2     ", WuhooYUVRowSSE2, WUHOO_CPU_SSE2 },
+#endif
+#ifdef WUHOO_NEON
+  { "yuv convert NEON     ", WuhooYUVRowNEON, WUHOO_CPU_NEON },
+#endif
+};
+
+/* The compositing of examples/viewer before WuhooBlendOverPattern */
+static unsigned char
+kernels_checker(int i, int j, int dim)
+{
+  return (((i / dim) + (j / dim)) % 2) ? 64 : 128;
+}
+
+static void
+kernels_blend_float(WuhooRGBA* dst, const WuhooRGBA* src, int width, int height)
+{
+  int i, j;
+  for (i = 0; i < height; i++) {
+    for (j = 0; j < width; j++) {
+      int index = j + i * width;
+      float blend = 1.0f - (float)src[index].a / 255.0f;
+
+      dst[index].r = (unsigned char)(kernels_checker(i, j, 10) * blend + src[index].r * (1.0f - blend));
+      dst[index].g = (unsigned char)(kernels_checker(i, j, 10) * blend + src[index].g * (1.0f - blend));
+      dst[index].b = (unsigned char)(kernels_checker(i, j, 10) * blend + src[index].b * (1.0f - blend));
+    }
+  }
+}
+
+static void
+kernels_blend_pattern(WuhooRGBA* dst, const WuhooRGBA* src, int width, int height)
+{
+  WuhooRGBA light = { 128, 128, 128, 255 };
+  WuhooRGBA dark  = { 64, 64, 64, 255 };
+
+  WuhooBlendOverPattern(dst, width, src, width, width, height, light, dark, 10);
+}
+
+/* Times both, the float loop truncates where the integer one rounds so the
+ * color channels may differ by one, returns the number of pixels that differ
+ * by more */
+static int
+kernels_blend_checkerboard(const WuhooRGBA* src, int width, int height, int iterations)
+{
+  static const struct {
+    const char* name;
+    void (*blend)(WuhooRGBA*, const WuhooRGBA*, int, int);
+  } variants[] = { { "checkerboard float   ", kernels_blend_float },
+                   { "checkerboard pattern ", kernels_blend_pattern } };
+  WuhooRGBA* expected   = (WuhooRGBA*)malloc(sizeof(WuhooRGBA) * width * height);
+  WuhooRGBA* actual     = (WuhooRGBA*)malloc(sizeof(WuhooRGBA) * width * height);
+  int        mismatches = 0;
+  int        i, pixel;
+
+  if (!expected || !actual) {
+    free(expected);
+    free(actual);
+    return 1;
+  }
+
+  for (i = 0; i < 2; i++) {
+    double start, elapsed;
+    int    iteration;
+
+    start = kernels_seconds();
+    for (iteration = 0; iteration < iterations; iteration++)
+      variants[i].blend(i ? actual : expected, src, width, height);
+    elapsed = kernels_seconds() - start;
+
+    printf("%s  %8.3f ms  %6.2f GB/s\n", variants[i].name, elapsed * 1000.0 / iterations,
+           8.0 * width * height * iterations / elapsed * 1e-9);
+  }
+
+  for (pixel = 0; pixel < width * height; pixel++) {
+    mismatches += (abs(expected[pixel].r - actual[pixel].r) > 1 ||
+                   abs(expected[pixel].g - actual[pixel].g) > 1 ||
+                   abs(expected[pixel].b - actual[pixel].b) > 1);
+  }
+  if (mismatches)
+    printf("checkerboard pattern   MISMATCH with the float loop\n");
+
+  free(expected);
+  free(actual);
+
+  return mismatches;
+}
+
+/* Times the float rows over linear values up to 4, with a negative one and a
+ * NaN in the mix. Vectors round to nearest even where the scalar row rounds
+ * half up, returns the number of table indices that differ by more than one
+ */
+static int
+kernels_float(int count, int iterations)
+{
+  static const char* tonemaps[WUHOO_TONEMAP_MAX] = { "clamp", "reinhard", "aces" };
+  float*          src        = (float*)malloc(sizeof(float) * count);
+  unsigned short* expected   = (unsigned short*)malloc(sizeof(unsigned short) * count);
+  unsigned short* actual     = (unsigned short*)malloc(sizeof(unsigned short) * count);
+  int             mismatches = 0;
+  int             i, tonemap, index;
+
+  if (!src || !expected || !actual || count < 2) {
+    free(src);
+    free(expected);
+    free(actual);
+    return 1;
+  }
+
+  for (index = 0; index < count; index++)
+    src[index] = (float)((index * 2654435761u) % 65536) / 16384.0f;
+  src[0] = -1.0f;
+  src[1] = 0.0f / (src[0] + 1.0f);
+
+  for (tonemap = 0; tonemap < WUHOO_TONEMAP_MAX; tonemap++) {
+    WuhooFloatRowScalar(expected, src, count, 1.5f, (WuhooTonemap)tonemap);
+
+    for (i = 0; i < (int)(sizeof(kernels_float_entries) / sizeof(kernels_float_entries[0])); i++) {
+      const KernelsFloatEntry* entry = &kernels_float_entries[i];
+      double                   start, elapsed;
+      int                      iteration, differ = 0;
+
+      if ((WuhooCpuFeatures() & entry->features) != entry->features) {
+        printf("%s  unsupported by this CPU\n", entry->name);
+        continue;
+      }
+
+      entry->row(actual, src, count, 1.5f, (WuhooTonemap)tonemap);
+      for (index = 0; index < count; index++)
+        differ += (abs(expected[index] - actual[index]) > 1);
+      if (differ) {
+        printf("%s  MISMATCH (%s)\n", entry->name, tonemaps[tonemap]);
+        mismatches += differ;
+        continue;
+      }
+
+      start = kernels_seconds();
+      for (iteration = 0; iteration < iterations; iteration++)
+        entry->row(actual, src, count, 1.5f, (WuhooTonemap)tonemap);
+      elapsed = kernels_seconds() - start;
+
+      /* A float is read and a table index written */
+      printf("%s  %8.3f ms  %6.2f GB/s  %s\n", entry->name, elapsed * 1000.0 / iterations,
+             6.0 * count * iterations / elapsed * 1e-9, tonemaps[tonemap]);
+    }
+  }
+
+  free(src);
+  free(expected);
+  free(actual);
+
+  return mismatches;
+}
+
+/* Times the YUV rows over rows of count pixels, starting at an odd pixel so
+ * the chroma of the first one is shared with its left neighbour. Every row
+ * works in the same fixed point, returns the number of differing pixels */
+static int
+kernels_yuv(int count, int rows, int iterations)
+{
+  static const char* layouts[WUHOO_YUV_LAYOUT_MAX]  = { "I420", "NV12" };
+  static const char* matrices[WUHOO_YUV_MATRIX_MAX] = { "BT.601", "BT.709" };
+  int        chroma_count = count / 2 + 1;
+  WuhooByte* luma         = (WuhooByte*)malloc(count + 1);
+  WuhooByte* chroma       = (WuhooByte*)malloc(2 * chroma_count);
+  WuhooRGBA* expected     = (WuhooRGBA*)malloc(sizeof(WuhooRGBA) * count);
+  WuhooRGBA* actual       = (WuhooRGBA*)malloc(sizeof(WuhooRGBA) * count);
+  int        mismatches   = 0;
+  int        i, layout, matrix, full, index;
+
+  if (!luma || !chroma || !expected || !actual || count < 1 || rows < 1) {
+    free(luma);
+    free(chroma);
+    free(expected);
+    free(actual);
+    return 1;
+  }
+
+  for (index = 0; index < count + 1; index++)
+    luma[index] = (WuhooByte)((index * 2654435761u) >> 24);
+  for (index = 0; index < 2 * chroma_count; index++)
+    chroma[index] = (WuhooByte)((index * 40503u) >> 8);
+
+  for (layout = 0; layout < WUHOO_YUV_LAYOUT_MAX; layout++) {
+    /* I420 reads the halves of chroma as two planes, NV12 as one interleaved */
+    WuhooSize        uv_step = (WUHOO_YUV_NV12 == layout) ? 2 : 1;
+    WuhooByte const* u_row   = chroma;
+    WuhooByte const* v_row   = (WUHOO_YUV_NV12 == layout) ? chroma + 1 : chroma + chroma_count;
+
+    for (matrix = 0; matrix < WUHOO_YUV_MATRIX_MAX; matrix++) {
+      for (full = 0; full < 2; full++) {
+        WuhooYUVCoefficients const* k = &wuhoo_yuv_coefficients[matrix][full];
+
+        WuhooYUVRowScalar(expected, luma, u_row, v_row, uv_step, 1, count, k);
+
+        for (i = 0; i < (int)(sizeof(kernels_yuv_entries) / sizeof(kernels_yuv_entries[0])); i++) {
+          const KernelsYUVEntry* entry = &kernels_yuv_entries[i];
+          double                 start, elapsed;
+          int                    iteration, row, differ = 0;
+
+          if ((WuhooCpuFeatures() & entry->features) != entry->features) {
+            printf("%s  unsupported by this CPU\n", entry->name);
+            continue;
+          }
+
+          memset(actual, 0, sizeof(WuhooRGBA) * count);
+          entry->row(actual, luma, u_row, v_row, uv_step, 1, count, k);
+          for (index = 0; index < count; index++)
+            differ += (0 != memcmp(&expected[index], &actual[index], sizeof(WuhooRGBA)));
+          if (differ) {
+            printf("%s  MISMATCH (%s %s %s range)\n", entry->name, layouts[layout],
+                   matrices[matrix], full ? "full" : "video");
+            mismatches += differ;
+            continue;
+          }
+
+          start = kernels_seconds();
+          for (iteration = 0; iteration < iterations; iteration++) {
+            for (row = 0; row < rows; row++)
+              entry->row(actual, luma, u_row, v_row, uv_step, 1, count, k);
+          }
+          elapsed = kernels_seconds() - start;
+
+          /* A luma byte and half a chroma pair are read and a pixel written */
+          printf("%s  %8.3f ms  %6.2f GB/s  %s %s %s range\n", entry->name,
+                 elapsed * 1000.0 / iterations, 6.0 * count * rows * iterations / elapsed * 1e-9,
+                 layouts[layout], matrices[matrix], full ? "full" : "video");
+        }
+      }
+    }
+  }
+
+  free(luma);
+  free(chroma);
+  free(expected);
+  free(actual);
+
+  return mismatches;
+}
+
+/* Straightforward R5G6B5 packing, dithered with the thresholds of a 4x4
+ * Bayer matrix at the source position of each pixel, returns the number of
+ * mismatching pixels */
+static int
+kernels_reference_r5g6b5(const WuhooRGBA* src, int src_x, int src_pitch, int width, int height,
+                         const unsigned char* dst, WuhooSize dst_pitch, int dither)
+{
+  static const int bayer[4][4] = { { 0, 8, 2, 10 }, { 12, 4, 14, 6 }, { 3, 11, 1, 9 }, { 15, 7, 13, 5 } };
+  int x, y, mismatches = 0;
+
+  for (y = 0; y < height; y++) {
+    const unsigned short* row = (const unsigned short*)(dst + y * dst_pitch);
+    for (x = 0; x < width; x++) {
+      const WuhooRGBA* pixel = &src[src_x + x + y * src_pitch];
+      int threshold = dither ? bayer[y & 3][(src_x + x) & 3] : 0;
+      int r = pixel->r + threshold / 2, g = pixel->g + threshold / 4, b = pixel->b + threshold / 2;
+      unsigned short expected;
+
+      r = (r > 255) ? 255 : r;
+      g = (g > 255) ? 255 : g;
+      b = (b > 255) ? 255 : b;
+      expected = (unsigned short)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+      mismatches += (row[x] != expected);
+    }
+  }
+
+  return mismatches;
+}
+
+int
+main(int argc, char* argv[])
+{
+  int width      = (argc > 1) ? atoi(argv[1]) : 1920;
+  int height     = (argc > 2) ? atoi(argv[2]) : 1080;
+  int iterations = (argc > 3) ? atoi(argv[3]) : 200;
+  int failures   = 0;
+  int i, x, y;
+
+  /* An odd source offset and a destination one or two bytes past an aligned
+   * address make every row start unaligned and end with a partial vector */
+  int            src_x     = 1;
+  int            src_pitch = width + 3;
+  WuhooSize      dst_pitch = (WuhooSize)width * 4 + 4;
+  WuhooRGBA*     src       = (WuhooRGBA*)malloc(sizeof(WuhooRGBA) * src_pitch * height);
+  unsigned char* expected  = (unsigned char*)malloc(dst_pitch * height + 2);
+  unsigned char* actual    = (unsigned char*)malloc(dst_pitch * height + 2);
+  WuhooRGBA*     reference = (WuhooRGBA*)calloc(width * height, sizeof(WuhooRGBA));
+  WuhooRGBA*     blended   = (WuhooRGBA*)calloc(width * height, sizeof(WuhooRGBA));
+
+  if (!src || !expected || !actual || !reference || !blended || width <= 1 || height <= 0 || iterations <= 0) {
+    printf("usage: %s [width > 1] [height] [iterations]\n", argv[0]);
+    return 1;
+  }
+
+  for (y = 0; y < height; y++) {
+    for (x = 0; x < src_pitch; x++) {
+      WuhooRGBA* pixel = &src[x + y * src_pitch];
+      pixel->r = (unsigned char)(x * 7 + y);
+      pixel->g = (unsigned char)(x ^ y);
+      pixel->b = (unsigned char)(y * 3 - x);
+      pixel->a = (unsigned char)(x + y * 5);
+    }
+  }
+
+  printf("%dx%d, %d iterations, selected kernels %s\n", width - src_x, height,
+         iterations,
+         (WuhooConvertSelect(WuhooConvertRGBAtoBGRA, 0) != WuhooConvertRGBAtoBGRA) ? "vectorized"
+                                                                                     : "scalar");
+
+  for (i = 0; i < (int)(sizeof(kernels_entries) / sizeof(kernels_entries[0])); i++) {
+    const KernelsEntry* entry = &kernels_entries[i];
+    double              start, elapsed;
+    int                 iteration;
+    /* 16 bit pixels are kept aligned to their own size */
+    int                 offset = (2 == entry->bytes_per_pixel) ? 2 : 1;
+
+    if ((WuhooCpuFeatures() & entry->features) != entry->features) {
+      printf("%s  unsupported by this CPU\n", entry->name);
+      continue;
+    }
+
+    memset(expected, 0xAB, dst_pitch * height + 2);
+    memset(actual, 0xAB, dst_pitch * height + 2);
+    entry->scalar(expected + offset, dst_pitch, src, src_x, 0, src_pitch, width - src_x, height);
+    entry->kernel(actual + offset, dst_pitch, src, src_x, 0, src_pitch, width - src_x, height);
+    if (memcmp(expected, actual, dst_pitch * height + 2)) {
+      printf("%s  MISMATCH\n", entry->name);
+      failures++;
+      continue;
+    }
+    if (2 == entry->bytes_per_pixel &&
+        kernels_reference_r5g6b5(src, src_x, src_pitch, width - src_x, height, expected + offset,
+                                 dst_pitch, entry->scalar == WuhooConvertRGBAtoR5G6B5Dither)) {
+      printf("%s  MISMATCH with the reference\n", entry->name);
+      failures++;
+      continue;
+    }
+
+    start = kernels_seconds();
+    for (iteration = 0; iteration < iterations; iteration++)
+      entry->kernel(actual + offset, dst_pitch, src, src_x, 0, src_pitch, width - src_x, height);
+    elapsed = kernels_seconds() - start;
+
+    /* Every pixel is read and written once */
+    printf("%s  %8.3f ms  %6.2f GB/s\n", entry->name, elapsed * 1000.0 / iterations,
+           (4.0 + entry->bytes_per_pixel) * (width - src_x) * height * iterations / elapsed * 1e-9);
+  }
+
+  /* The destination of the conversions becomes the background, its alpha
+   * varies as much as the one of the source */
+  for (i = 0; i < (int)(sizeof(kernels_blend_entries) / sizeof(kernels_blend_entries[0])); i++) {
+    const KernelsBlendEntry* entry      = &kernels_blend_entries[i];
+    const WuhooRGBA*         background = (const WuhooRGBA*)expected;
+    double                   start, elapsed;
+    int                      iteration;
+
+    if ((WuhooCpuFeatures() & entry->features) != entry->features) {
+      printf("%s  unsupported by this CPU\n", entry->name);
+      continue;
+    }
+
+    for (y = 0; y < height; y++) {
+      WuhooBlendRowScalar(reference + y * width, src + src_x + y * src_pitch,
+                          background + y * width, width - src_x);
+      entry->row(blended + y * width, src + src_x + y * src_pitch, background + y * width,
+                 width - src_x);
+    }
+    if (memcmp(reference, blended, sizeof(WuhooRGBA) * width * height)) {
+      printf("%s  MISMATCH\n", entry->name);
+      failures++;
+      continue;
+    }
+
+    start = kernels_seconds();
+    for (iteration = 0; iteration < iterations; iteration++) {
+      for (y = 0; y < height; y++)
+        entry->row(blended + y * width, src + src_x + y * src_pitch, background + y * width,
+                   width - src_x);
+    }
+    elapsed = kernels_seconds() - start;
+
+    /* Two pixels are read and one written */
+    printf("%s  %8.3f ms  %6.2f GB/s\n", entry->name, elapsed * 1000.0 / iterations,
+           12.0 * (width - src_x) * height * iterations / elapsed * 1e-9);
+  }
+
+  failures += (kernels_blend_checkerboard(src, src_pitch, height, iterations) != 0);
+  /* Three channels a pixel, as the frames of examples/rtiow */
+  failures += (kernels_float(3 * (width - src_x) * height, iterations) != 0);
+  failures += (kernels_yuv(width - src_x, height, iterations) != 0);
+
+  free(src);
+  free(expected);
+  free(actual);
+  free(reference);
+  free(blended);
+
+  return failures ? 1 : 0;
+}
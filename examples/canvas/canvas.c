@@ -19,6 +19,7 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 typedef double scalar_t;
@@ -35,7 +36,11 @@ int clampi(int x, int minVal, int maxVal) {
   return (x < minVal) ? minVal : ((x > maxVal) ? maxVal : x);
 }
 
-void point_draw(WuhooRGBA* pixels, int width, int height, int x, int y, int brush_size) {
+/* Returns the region touched by the brush in damage */
+void point_draw(WuhooRGBA* pixels, int width, int height, int x, int y, int brush_size, WuhooRect* damage) {
+  damage->width = 0;
+  damage->height = 0;
+
   if (x < 0 || x >= width || y < 0 || y >= height)
     return;
 
@@ -46,6 +51,13 @@ void point_draw(WuhooRGBA* pixels, int width, int height, int x, int y, int brus
   int end_x = -start_x;
   int end_y = -start_y;
 
+  int damage_x = clampi(x + start_x, 0, width);
+  int damage_y = clampi(y + start_y, 0, height);
+  damage->x = damage_x;
+  damage->y = damage_y;
+  damage->width = clampi(x + end_x, 0, width) - damage_x;
+  damage->height = clampi(y + end_y, 0, height) - damage_y;
+
   int i = 0;
   int j = 0;
   for (i = start_x; i < end_x; i++) {
@@ -98,6 +110,7 @@ int main(int argc, const char * argv[]) {
 
   int draw = 0;
   int brush_size = 10;
+  WuhooRect damage;
   while(running) {
     WuhooWindowEventNext(&window, &event);
 
@@ -135,8 +148,9 @@ int main(int argc, const char * argv[]) {
     case WUHOO_EVT_MOUSE_MOVE:
       if (0 == draw || WUHOO_MSTATE_LPRESSED != event.data.mouse_move.state )
 	break;
-      point_draw(pixels, width, height, event.data.mouse_move.x, event.data.mouse_move.y, brush_size);
-      WuhooWindowBlit(&window, pixels, 0, 0, width, height, 0, 0, width, height);
+      point_draw(pixels, width, height, event.data.mouse_move.x, event.data.mouse_move.y, brush_size, &damage);
+      /* Only present what the brush touched */
+      WuhooWindowBlitRects(&window, pixels, width, &damage, 1);
 
       break;
     case WUHOO_EVT_KEY:
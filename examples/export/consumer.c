@@ -0,0 +1,192 @@
+/* compile with
+  -- Linux --
+  gcc -I../../ -O2 consumer.c -o export_consumer
+
+  Reads the frames a Wuhoo window built with WUHOO_EXPORT_ENABLE exports and
+  reports how late they arrive and how many were missed, e.g. against the
+  benchmark
+  gcc -I../../ -O2 -DWUHOO_EXPORT_ENABLE ../benchmark/benchmark.c -o benchmark_export -lX11 -lm
+  ./benchmark_export 1280 720 100000 &
+  ./export_consumer $! 10
+*/
+
+#define _GNU_SOURCE
+#define WUHOO_EXPORT_ENABLE
+#include "wuhoo.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+static unsigned long long
+consumer_now(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+/* Maps fd if it is a Wuhoo export, the header has to be read to know the size */
+static const WuhooExportHeader*
+consumer_map(int fd, size_t* size)
+{
+  WuhooExportHeader header;
+
+  if (sizeof(header) != pread(fd, &header, sizeof(header), 0) ||
+      WUHOO_EXPORT_MAGIC != header.magic || WUHOO_EXPORT_VERSION != header.version)
+    return NULL;
+
+  *size = header.pixel_offset + (size_t)header.slot_count * header.slot_size;
+  void* memory = mmap(NULL, *size, PROT_READ, MAP_SHARED, fd, 0);
+
+  return (MAP_FAILED == memory) ? NULL : (const WuhooExportHeader*)memory;
+}
+
+/* Accepts /proc/<pid>/fd/<fd> or a pid, whose memfds are searched */
+static const WuhooExportHeader*
+consumer_open(const char* target, size_t* size)
+{
+  const WuhooExportHeader* header = NULL;
+  char path[512], link[256];
+  struct dirent* entry;
+  DIR* directory;
+  int fd;
+
+  if (strchr(target, '/')) {
+    fd = open(target, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return NULL;
+    header = consumer_map(fd, size);
+    close(fd);
+    return header;
+  }
+
+  snprintf(path, sizeof(path), "/proc/%s/fd", target);
+  directory = opendir(path);
+  if (NULL == directory)
+    return NULL;
+
+  while (NULL == header && NULL != (entry = readdir(directory))) {
+    ssize_t length;
+
+    snprintf(path, sizeof(path), "/proc/%s/fd/%s", target, entry->d_name);
+    length = readlink(path, link, sizeof(link) - 1);
+    if (length <= 0)
+      continue;
+    link[length] = '\0';
+    if (strncmp(link, "/memfd:" WUHOO_STRING, sizeof("/memfd:" WUHOO_STRING) - 1))
+      continue;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      continue;
+    header = consumer_map(fd, size);
+    close(fd);
+  }
+
+  closedir(directory);
+
+  return header;
+}
+
+int main(int argc, const char * argv[]) {
+  const WuhooExportHeader* header;
+  size_t size = 0;
+
+  if (argc < 2) {
+    printf("usage: %s <pid | /proc/<pid>/fd/<fd>> [seconds]\n", argv[0]);
+    return 1;
+  }
+
+  double duration = (argc > 2) ? atof(argv[2]) : 0.0;
+
+  header = consumer_open(argv[1], &size);
+  if (NULL == header) {
+    printf("|Wuhoo Export| no exported frames found for %s\n", argv[1]);
+    return 1;
+  }
+
+  printf("|Wuhoo Export| %ux%u, %u slots\n", header->width, header->height, header->slot_count);
+
+  unsigned long long start   = consumer_now();
+  unsigned long long report  = start;
+  unsigned int       last    = __atomic_load_n(&header->frame, __ATOMIC_ACQUIRE);
+  unsigned long      received = 0, missed = 0, lapped = 0;
+  unsigned long      total_received = 0, total_missed = 0, total_lapped = 0;
+  double             latency_sum = 0.0, latency_max = 0.0;
+  unsigned int       checksum = 0;
+
+  while (!__atomic_load_n(&header->closed, __ATOMIC_ACQUIRE)) {
+    struct timespec timeout = { 0, 100000000 };
+    unsigned long long now;
+
+    /* The futex lives in another process, no FUTEX_PRIVATE_FLAG */
+    syscall(SYS_futex, &header->frame, FUTEX_WAIT, last, &timeout, NULL, 0);
+
+    unsigned int frame = __atomic_load_n(&header->frame, __ATOMIC_ACQUIRE);
+    now = consumer_now();
+
+    if (frame != last) {
+      const WuhooExportSlot* slot = &header->slots[frame % header->slot_count];
+      const unsigned char* pixels = (const unsigned char*)header + header->pixel_offset +
+                                    (size_t)(frame % header->slot_count) * header->slot_size;
+      unsigned int y;
+
+      if (0 != last && frame - last > 1)
+        missed += frame - last - 1;
+      last = frame;
+
+      if (frame == __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE)) {
+        double latency = (double)(now - slot->ust) * 1e-6;
+
+        /* Touch every row like a real consumer would */
+        for (y = 0; y < header->height; y++)
+          checksum += pixels[(size_t)y * header->pitch];
+
+        /* The window may have lapped the slot while it was being read */
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (frame == __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED)) {
+          received++;
+          latency_sum += latency;
+          if (latency > latency_max)
+            latency_max = latency;
+        } else {
+          lapped++;
+        }
+      } else {
+        lapped++;
+      }
+    }
+
+    if (now - report >= 1000000000ull) {
+      printf("|Wuhoo Export| %lu frames, latency %.3f ms avg / %.3f ms max, %lu missed, %lu lapped\n",
+             received, received ? latency_sum / received : 0.0, latency_max, missed, lapped);
+      total_received += received;
+      total_missed   += missed;
+      total_lapped   += lapped;
+      received = missed = lapped = 0;
+      latency_sum = latency_max = 0.0;
+      report = now;
+    }
+
+    if (duration > 0.0 && (now - start) * 1e-9 >= duration)
+      break;
+  }
+
+  total_received += received;
+  total_missed   += missed;
+  total_lapped   += lapped;
+  printf("|Wuhoo Export| %lu frames read, %lu missed, %lu lapped (checksum %u)\n",
+         total_received, total_missed, total_lapped, checksum);
+
+  munmap((void*)header, size);
+
+  return 0;
+}
@@ -98,8 +98,13 @@ struct tile {
 struct rtiow {
   camera* cam { WuhooNull };
   hitable* world { WuhooNull };
-  std::unique_ptr<WuhooRGBA[]> front_buffer { WuhooNull };
-  std::unique_ptr<WuhooRGBA[]> back_buffer { WuhooNull };
+  /* Linear RGB, encoding for the display happens while blitting */
+  std::unique_ptr<float[]> front_buffer { WuhooNull };
+  std::unique_ptr<float[]> back_buffer { WuhooNull };
+#ifdef __APPLE__
+  /* Quartz reads RGBA in place, float frames are encoded here first */
+  std::unique_ptr<WuhooRGBA[]> display_buffer { WuhooNull };
+#endif
 
   /* regions TO render */
   std::vector<tile> render_tile_queue;
@@ -130,11 +135,37 @@ struct rtiow {
 void
 init_scene(rtiow* scene)
 {
-  scene->back_buffer = std::make_unique<WuhooRGBA[]>(scene->nx * scene->ny);
-  scene->front_buffer = std::make_unique<WuhooRGBA[]>(scene->nx * scene->ny);
+  scene->back_buffer = std::make_unique<float[]>(scene->nx * scene->ny * 3);
+  scene->front_buffer = std::make_unique<float[]>(scene->nx * scene->ny * 3);
+
+  std::memset(scene->back_buffer.get(), 0, scene->nx * scene->ny * 3 * sizeof(scene->back_buffer[0]));
+  std::memset(scene->front_buffer.get(), 0, scene->nx * scene->ny * 3 * sizeof(scene->front_buffer[0]));
 
-  std::memset(scene->back_buffer.get(), 0, scene->nx * scene->ny * sizeof(scene->back_buffer[0]));
-  std::memset(scene->front_buffer.get(), 0, scene->nx * scene->ny * sizeof(scene->front_buffer[0]));
+#ifdef __APPLE__
+  scene->display_buffer = std::make_unique<WuhooRGBA[]>(scene->nx * scene->ny);
+#endif
+}
+
+/* The tracer averages linear radiance, a gamma of 2 is the square root it
+ * has always been displayed with */
+WuhooResult
+present_scene(WuhooWindow* window, rtiow* scene, const float* buffer)
+{
+#ifdef __APPLE__
+  for (int pixel_index = 0; pixel_index < scene->nx * scene->ny; pixel_index++) {
+    const float* col = &buffer[pixel_index * 3];
+    scene->display_buffer[pixel_index].r = (unsigned char)(255.99f * sqrtf(std::min(col[0], 1.0f)));
+    scene->display_buffer[pixel_index].g = (unsigned char)(255.99f * sqrtf(std::min(col[1], 1.0f)));
+    scene->display_buffer[pixel_index].b = (unsigned char)(255.99f * sqrtf(std::min(col[2], 1.0f)));
+    scene->display_buffer[pixel_index].a = 255;
+  }
+
+  return WuhooWindowBlitAsync(window, scene->display_buffer.get(), 0, 0, scene->nx, scene->ny, 0, 0, scene->nx, scene->ny);
+#else
+  const WuhooFloatFormat format = { 3, 1.0f, WUHOO_TONEMAP_CLAMP, 2.0f };
+
+  return WuhooWindowBlitFloat(window, buffer, &format, 0, 0, scene->nx, scene->ny, 0, 0, scene->nx, scene->ny);
+#endif
 }
 
 bool
@@ -155,17 +186,12 @@ render_scene_region(rtiow* scene, int x, int y, int width, int height)
         col += color(r, scene->world,0);
       }
       col /= float(scene->ns);
-      col = vec3( sqrt(col[0]), sqrt(col[1]), sqrt(col[2]) );
-      int ir = int(255.99*col[0]);
-      int ig = int(255.99*col[1]);
-      int ib = int(255.99*col[2]);
 
       size_t pixel_index = i + (scene->ny - 1 - j) * scene->nx;
 
-      scene->back_buffer[pixel_index].r = (unsigned char)(ib);
-      scene->back_buffer[pixel_index].g = (unsigned char)(ir);
-      scene->back_buffer[pixel_index].b = (unsigned char)(ig);
-      scene->back_buffer[pixel_index].a = 255;
+      scene->back_buffer[pixel_index * 3 + 0] = col[0];
+      scene->back_buffer[pixel_index * 3 + 1] = col[1];
+      scene->back_buffer[pixel_index * 3 + 2] = col[2];
     }
   }
 
@@ -214,6 +240,7 @@ int main(int argc, const char * argv[]) {
                     WUHOO_FLAG_TITLED        |
                     WUHOO_FLAG_MOUSE_CAPTURE |
                     WUHOO_FLAG_CLIENT_REGION |
+                    WUHOO_FLAG_VSYNC         |
                     WUHOO_FLAG_CLOSEABLE, WuhooNull);
   result = WuhooWindowShow(&window);
 
@@ -264,10 +291,16 @@ int main(int argc, const char * argv[]) {
 
   printf("[RTIOW] : Rendering with %d worker threads\n", scene.worker_count);
 
+  /* With vsync a new frame is only submitted once the last one is on screen */
+  bool frame_pending = false;
+
   while(running) {
     WuhooWindowEventNext(&window, &event);
 
     switch (event.type) {
+    case WUHOO_EVT_FRAME:
+      frame_pending = false;
+      break;
     case WUHOO_EVT_WINDOW:
       switch (event.data.window.state) {
       case WUHOO_WSTATE_CLOSED:
@@ -313,22 +346,28 @@ int main(int argc, const char * argv[]) {
     progress_report_at += progrees_report_next;
     printf("%s", progress_report);
 
+    if (frame_pending) {
+      continue;
+    }
+
     if (scene.g_rendering_done) {
-      WuhooWindowBlit(&window, scene.back_buffer.get(), 0, 0, scene.nx, scene.ny, 0, 0, scene.nx, scene.ny);
+      result = present_scene(&window, &scene, scene.back_buffer.get());
     } else {
       for (int tile_index = 0; tile_index < max_tile_count; tile_index++) {
         tile t = scene.finished_tile_queue[tile_index];
         for (int j = t.y; j < t.height; j++) {
           for (int i = t.x; i < t.width; i++) {
             size_t pixel_index = i + (scene.ny - 1 - j) * scene.nx;
-            scene.front_buffer[pixel_index] = scene.back_buffer[pixel_index];
+            std::memcpy(&scene.front_buffer[pixel_index * 3], &scene.back_buffer[pixel_index * 3], 3 * sizeof(float));
           }
         }
       }
 
-      WuhooWindowBlit(&window, scene.front_buffer.get(), 0, 0, scene.nx, scene.ny, 0, 0, scene.nx, scene.ny);
+      result = present_scene(&window, &scene, scene.front_buffer.get());
     }
 
+    frame_pending = (WuhooSuccess == result) && (0 != (window.flags & WUHOO_FLAG_VSYNC));
+
   }
 
   printf("\n[RTIOW] : Done!\n");
@@ -110,6 +110,10 @@ editor_clear_font(Editor* editor)
   if (editor->font_bitmap) free(editor->font_bitmap);
 }
 
+int clampi(int x, int minVal, int maxVal) {
+  return (x < minVal) ? minVal : ((x > maxVal) ? maxVal : x);
+}
+
 int main(int argc, const char * argv[]) {
   WuhooUnused(argc);
   WuhooUnused(argv);
@@ -262,7 +266,19 @@ if (pixel_index < 0 || pixel_index >= width * height) continue;
 	ix2++;
 	iy2 = iy + advance_y;
       }
-      WuhooWindowBlit(&window, image_data, 0, 0, width, height, 0, 0, width, height);
+
+      /* Only present the glyph that was just drawn, clipped to the image as
+       * glyphs can wrap past the right or bottom edge */
+      int glyph_x = (int)q.x0;
+      int glyph_y = iy + advance_y + (int)q.y0;
+      int damage_x = clampi(glyph_x, 0, (int)width);
+      int damage_y = clampi(glyph_y, 0, (int)height);
+      WuhooRect damage;
+      damage.x = damage_x;
+      damage.y = damage_y;
+      damage.width = clampi(glyph_x + bx - tx, damage_x, (int)width) - damage_x;
+      damage.height = clampi(glyph_y + range, damage_y, (int)height) - damage_y;
+      WuhooWindowBlitRects(&window, image_data, width, &damage, 1);
     }
   }
 
@@ -14,8 +14,6 @@
 #include "wuhoo.h"
 
 #define STBI_WINDOWS_UTF8
-#define STB_IMAGE_RESIZE_IMPLEMENTATION
-#include "stb/stb_image_resize.h"
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION #include "stb/stb_image_write.h"
 
@@ -32,21 +30,83 @@ get_bg_color(int i, int j, int dim) {
     return 128;
 }
 
+/* The same checkerboard as get_bg_color, composited by the library */
 void
 blit_image(WuhooRGBA* dst, const WuhooRGBA* src, int width, int height) {
+  WuhooRGBA light = { 128, 128, 128, 255 };
+  WuhooRGBA dark  = { 64, 64, 64, 255 };
+
+  WuhooBlendOverPattern(dst, width, src, width, width, height, light, dark, 10);
+}
+
+void
+fill_background(WuhooRGBA* dst, int width, int height) {
   int i, j;
   for (i = 0; i < height; i++) {
     for (j = 0; j < width; j++) {
       int index = j + i * width;
-      float blend = 1.0f - (float)src[index].a / 255.0f;
+      unsigned char color = get_bg_color(i, j, 10);
 
-      dst[index].r = (unsigned char)(get_bg_color(i, j, 10) * blend + src[index].r * (1.0f - blend));
-      dst[index].g = (unsigned char)(get_bg_color(i, j, 10) * blend + src[index].g * (1.0f - blend));
-      dst[index].b = (unsigned char)(get_bg_color(i, j, 10) * blend + src[index].b * (1.0f - blend));
+      dst[index].r = color;
+      dst[index].g = color;
+      dst[index].b = color;
+      dst[index].a = 255;
     }
   }
 }
 
+/* With server side blending only the checkerboard is prepared here,
+ * returns the (re)allocated background or WuhooNull */
+WuhooRGBA*
+compose_image(WuhooRGBA* background, WuhooRGBA* dst, const WuhooRGBA* src, int width, int height, WuhooBoolean server_blend) {
+  if (!server_blend) {
+    blit_image(dst, src, width, height);
+    return WuhooNull;
+  }
+
+  background = realloc(background, width * height * sizeof(*background));
+  fill_background(background, width, height);
+  if (dst != src)
+    memcpy(dst, src, width * height * sizeof(*dst));
+
+  return background;
+}
+
+/* Without server side blending the composed image does not change until the
+ * next drop, convert it to the layout of the window once instead of on every
+ * present, returns the (re)allocated native image or WuhooNull */
+void*
+convert_image(WuhooWindow* window, void* native, const WuhooRGBA* pixels, int width, int height, WuhooBoolean server_blend) {
+  WuhooPixelFormat format;
+
+  if (server_blend || WuhooSuccess != WuhooWindowPixelFormatGet(window, &format)) {
+    free(native);
+    return WuhooNull;
+  }
+
+  native = realloc(native, width * height * (format.bits_per_pixel / 8));
+  WuhooWindowConvertNative(window, native, width * (format.bits_per_pixel / 8), pixels, width, width, height);
+
+  return native;
+}
+
+void
+present_image(WuhooWindow* window, WuhooRGBA* background, WuhooRGBA* pixels, void* native, int image_width, int image_height, WuhooSize width, WuhooSize height) {
+  /* Native pixels are only copied, but they can not be scaled */
+  if (WuhooNull != native && (WuhooSize)image_width == width && (WuhooSize)image_height == height) {
+    WuhooWindowBlitNative(window, native, 0, 0, image_width, image_height, 0, 0, width, height);
+    return;
+  }
+
+  if (WuhooNull != background) {
+    WuhooWindowBlitBlendSet(window, WUHOO_BLIT_BLEND_NONE);
+    WuhooWindowBlit(window, background, 0, 0, image_width, image_height, 0, 0, width, height);
+    WuhooWindowBlitBlendSet(window, WUHOO_BLIT_BLEND_OVER);
+  }
+
+  WuhooWindowBlit(window, pixels, 0, 0, image_width, image_height, 0, 0, width, height);
+}
+
 int main(int argc, const char * argv[]) {
   WuhooUnused(argc);
   WuhooUnused(argv);
@@ -101,7 +161,13 @@ int main(int argc, const char * argv[]) {
 
   WuhooWindowSetTitle(&window, filename);
 
-  blit_image(pixels, pixels, width, height);
+  /* The window scales the composed image itself, no need to resize it here */
+  WuhooWindowBlitFilterSet(&window, WUHOO_BLIT_FILTER_BILINEAR);
+
+  /* Let the window system blend the image over the checkerboard if it can */
+  WuhooBoolean server_blend = (WuhooSuccess == WuhooWindowBlitBlendSet(&window, WUHOO_BLIT_BLEND_OVER));
+  WuhooRGBA* background = compose_image(WuhooNull, pixels, pixels, width, height, server_blend);
+  void* native = convert_image(&window, WuhooNull, pixels, width, height, server_blend);
 
   int posx, posy;
   char image_file[256];
@@ -115,7 +181,7 @@ int main(int argc, const char * argv[]) {
     case WUHOO_EVT_WINDOW: {
       switch (event.data.window.state) {
       case WUHOO_WSTATE_INVALIDATED:
-	WuhooWindowBlit(&window, pixels, 0, 0, width, height, 0, 0, width, height);
+	present_image(&window, background, pixels, native, image_width, image_height, width, height);
 	break;
       case WUHOO_WSTATE_CLOSED:
 	running = 0;
@@ -126,12 +192,7 @@ int main(int argc, const char * argv[]) {
 	width = event.data.window.data1;
 	height = event.data.window.data2;
 
-	pixels = realloc(pixels, width * height * sizeof(*pixels));
-       	stbir_resize_uint8((unsigned char *)image_data, image_width, image_height, 0,
-	  (unsigned char *)pixels, width, height, 0, 4);
-	blit_image(pixels, pixels, width, height);
-
-	WuhooWindowBlit(&window, pixels, 0, 0, width, height, 0, 0, width, height);
+	present_image(&window, background, pixels, native, image_width, image_height, width, height);
 
 	break;
       default:
@@ -166,7 +227,8 @@ int main(int argc, const char * argv[]) {
 
 	  pixels = realloc(pixels, image_width * image_height * sizeof(*pixels));
 
-      blit_image(pixels, image_data, image_width, image_height);
+      background = compose_image(background, pixels, image_data, image_width, image_height, server_blend);
+      native = convert_image(&window, native, pixels, image_width, image_height, server_blend);
 
       WuhooWindowClientRegionSet(&window, posx, posy, image_width, image_height);
     } break;
@@ -184,6 +246,8 @@ int main(int argc, const char * argv[]) {
   }
 
   if (pixels) free(pixels);
+  if (background) free(background);
+  if (native) free(native);
   WuhooWindowDestroy(&window);
 
   return 0;
@@ -64,11 +64,24 @@ typedef unsigned int   WuhooSize;
 #define WUHOO_PLATFORM_API_STRING "Win32"
 #endif
 #ifdef __linux__
+#if defined(WUHOO_WAYLAND_ENABLE)
+#define WUHOO_PLATFORM_API_STRING "Wayland"
+#elif defined(WUHOO_FBDEV_ENABLE)
+#define WUHOO_PLATFORM_API_STRING "FBDev"
+#elif defined(WUHOO_HEADLESS_ENABLE)
+#define WUHOO_PLATFORM_API_STRING "Headless"
+#else
 #define WUHOO_PLATFORM_API_STRING "X11"
 #endif
+#endif
 
 /* Constraints */
 #define WUHOO_MAX_TITLE_LENGTH 256
+#define WUHOO_PLATFORM_MEMORY_SIZE 1024 /* Storage for the backend specific window state */
+#define WUHOO_SCALE_CHUNK_SIZE 256 /* Pixels resampled per conversion call when scaling */
+#ifndef WUHOO_UPLOAD_BAND_SIZE
+#define WUHOO_UPLOAD_BAND_SIZE (256 * 1024) /* Bytes per band of an X11 upload that goes over the socket */
+#endif
 
 typedef enum
 {
@@ -86,7 +99,10 @@ typedef enum
   WUHOO_FLAG_FILE_DROP     = WuhooFlag(7),
   WUHOO_FLAG_CLOSEABLE     = WuhooFlag(8),
   WUHOO_FLAG_CLIENT_REGION = WuhooFlag(9),
-  WUHOO_FLAG_WINDOW_REGION = WuhooFlag(10)
+  WUHOO_FLAG_WINDOW_REGION = WuhooFlag(10),
+  WUHOO_FLAG_VSYNC         = WuhooFlag(11), /* X11 with WUHOO_XPRESENT_ENABLE, Wayland and fbdev for now, cleared from WuhooWindow::flags if unavailable */
+  WUHOO_FLAG_TRANSPARENT   = WuhooFlag(12), /* X11 with WUHOO_XRENDER_ENABLE for now, cleared from WuhooWindow::flags if unavailable */
+  WUHOO_FLAG_DITHER        = WuhooFlag(13) /* Ordered dithering of blits to 16 bit (R5G6B5) surfaces, no effect on other formats */
 } WuhooFlagsEnum;
 typedef unsigned int   WuhooFlags;
 
@@ -291,6 +307,54 @@ typedef enum {
 
 typedef int WuhooWindowFlags;
 
+/** \enum WuhooBlitFilter
+ * Resampling filter used when a blit's source and destination sizes differ.
+ */
+typedef enum {
+  WUHOO_BLIT_FILTER_NONE,     ///< Crop the source region, the default
+  WUHOO_BLIT_FILTER_NEAREST,  ///< Nearest neighbor
+  WUHOO_BLIT_FILTER_BILINEAR, ///< Bilinear interpolation of the 4 closest pixels
+  WUHOO_BLIT_FILTER_MAX
+} WuhooBlitFilter;
+
+/** \enum WuhooBlitBlend
+ * How \ref WuhooWindowBlit combines pixels with the current window contents.
+ */
+typedef enum {
+  WUHOO_BLIT_BLEND_NONE, ///< Replace the destination, the default
+  WUHOO_BLIT_BLEND_OVER, ///< Composite over the destination using the alpha channel
+  WUHOO_BLIT_BLEND_MAX
+} WuhooBlitBlend;
+
+/** \enum WuhooTonemap
+ * How \ref WuhooWindowBlitFloat brings linear values above 1 into range.
+ */
+typedef enum {
+  WUHOO_TONEMAP_CLAMP,    ///< Clip at 1, the default
+  WUHOO_TONEMAP_REINHARD, ///< x / (1 + x)
+  WUHOO_TONEMAP_ACES,     ///< Fit of the ACES filmic curve
+  WUHOO_TONEMAP_MAX
+} WuhooTonemap;
+
+/** \enum WuhooYUVLayout
+ * Planes of a 4:2:0 frame of \ref WuhooWindowBlitYUV, chroma has half the
+ * width and height of luma.
+ */
+typedef enum {
+  WUHOO_YUV_I420, ///< Y, U and V planes
+  WUHOO_YUV_NV12, ///< Y plane and a plane of interleaved U and V
+  WUHOO_YUV_LAYOUT_MAX
+} WuhooYUVLayout;
+
+/** \enum WuhooYUVMatrix
+ * Coefficients that turn the YUV of \ref WuhooWindowBlitYUV into RGB.
+ */
+typedef enum {
+  WUHOO_YUV_BT601, ///< SD video and most cameras
+  WUHOO_YUV_BT709, ///< HD video
+  WUHOO_YUV_MATRIX_MAX
+} WuhooYUVMatrix;
+
 /** \enum WuhooWindowState
  * State of the window that triggered the WuhooEventWindow.
  */
@@ -321,6 +385,7 @@ typedef enum {
   WUHOO_EVT_MOUSE_MOVE, ///< WuhooEventMouseMove
   WUHOO_EVT_MOUSE_WHEEL, ///< WuhooEventMouseWheel
   WUHOO_EVT_DROP, ///< WuhooEventDrop
+  WUHOO_EVT_FRAME, ///< WuhooEventFrame
   WUHOO_EVT_MAX
 } WuhooEventType;
 
@@ -364,7 +429,8 @@ typedef enum {
 
 /**
  * @brief Helper struct to work with RGBA system backed buffers.
- * The alpha channel is currently not respected in any backend
+ * The alpha channel is only respected by the X11 backend with
+ * WUHOO_XRENDER_ENABLE, see WuhooWindowBlitBlendSet and WUHOO_FLAG_TRANSPARENT
  */
 
 typedef struct
@@ -372,9 +438,133 @@ typedef struct
   unsigned char r; /*!< 'red' channel */
   unsigned char g; /*!< 'green' channel */
   unsigned char b; /*!< 'blue' channel */
-  unsigned char a; /*!< 'alpha' channel (no use for now) */
+  unsigned char a; /*!< 'alpha' channel, not premultiplied */
 } WuhooRGBA;
 
+/**
+ * @brief A rectangular region of a window or of a pixel buffer
+ */
+typedef struct
+{
+  WuhooSize x;      /*!< Horizontal offset of the upper left corner */
+  WuhooSize y;      /*!< Vertical offset of the upper left corner */
+  WuhooSize width;  /*!< Width of the region */
+  WuhooSize height; /*!< Height of the region */
+} WuhooRect;
+
+/**
+ * @brief Memory layout of the pixels of a backend's presentation buffer
+ */
+typedef struct
+{
+  WuhooSize    bits_per_pixel; /*!< Size of a pixel, 16 or 32 for now */
+  WuhooSize    red_mask;       /*!< Bits of a pixel that hold the red channel */
+  WuhooSize    green_mask;     /*!< Bits of a pixel that hold the green channel */
+  WuhooSize    blue_mask;      /*!< Bits of a pixel that hold the blue channel */
+  WuhooBoolean msb_first;      /*!< Pixels are stored most significant byte first */
+  WuhooSize    alpha_mask;     /*!< Bits of a pixel that hold premultiplied alpha, 0 if opaque */
+} WuhooPixelFormat;
+
+/**
+ * @brief Layout and encoding of the pixels of WuhooWindowBlitFloat
+ */
+typedef struct
+{
+  WuhooSize    channels; /*!< 3 for RGB pixels, 4 for RGBA with straight alpha */
+  float        exposure; /*!< Scale of the linear values before tonemapping */
+  WuhooTonemap tonemap;  /*!< Curve that brings them into [0, 1] */
+  float        gamma;    /*!< Encode with the power 1 / gamma, 0 for sRGB */
+} WuhooFloatFormat;
+
+/**
+ * @brief A video frame for WuhooWindowBlitYUV, read in place
+ */
+typedef struct
+{
+  WuhooByte const* planes[3];  /*!< Y, then U and V or the interleaved UV */
+  WuhooSize        pitches[3]; /*!< Bytes from a row of each plane to the next */
+  WuhooSize        width;      /*!< Size of the luma plane in pixels */
+  WuhooSize        height;
+  WuhooYUVLayout   layout;
+  WuhooYUVMatrix   matrix;
+  WuhooBoolean     full_range; /*!< Values use 0-255 instead of 16-235/240 */
+} WuhooYUVFrame;
+
+/**
+ * @brief A backend's presentation buffer, see WuhooWindowFramebufferAcquire
+ */
+typedef struct
+{
+  void*            pixels; /*!< First pixel of the top row */
+  WuhooSize        pitch;  /*!< Number of bytes between two rows */
+  WuhooSize        width;  /*!< Width in pixels, matches the client area */
+  WuhooSize        height; /*!< Height in pixels, matches the client area */
+  WuhooPixelFormat format; /*!< Layout of each pixel */
+} WuhooFramebuffer;
+
+#ifdef WUHOO_RECORDER_ENABLE
+/** \enum WuhooRecordFormat
+ * File format written by \ref WuhooWindowRecordStart.
+ */
+typedef enum
+{
+  WUHOO_RECORD_Y4M,  /*!< YUV4MPEG2 with 4:2:0 full range BT.601 frames */
+  WUHOO_RECORD_RGBA, /*!< Headerless WuhooRGBA frames, one after the other */
+  WUHOO_RECORD_MAX
+} WuhooRecordFormat;
+
+/**
+ * @brief Progress of a recording, see WuhooWindowRecordStatsGet
+ */
+typedef struct
+{
+  WuhooSize captured;      /*!< Frames copied into the ring buffer */
+  WuhooSize dropped;       /*!< Frames skipped because the ring buffer was full */
+  WuhooSize written;       /*!< Frames the recording thread has written to disk */
+  WuhooSize write_failed;  /*!< Frames lost to failed writes */
+} WuhooRecordStats;
+#endif
+
+#ifdef WUHOO_EXPORT_ENABLE
+#define WUHOO_EXPORT_MAGIC 0x57554858 /* "WUHX" */
+#define WUHOO_EXPORT_VERSION 1
+#define WUHOO_EXPORT_MAX_SLOTS 16
+
+/**
+ * @brief State of one frame slot of an exported window, see WuhooExportHeader
+ */
+typedef struct
+{
+  volatile unsigned int sequence; /*!< Frame held by the slot, 0 while it is being written */
+  unsigned int          reserved;
+  unsigned long long    ust;      /*!< CLOCK_MONOTONIC time the frame was published, in nanoseconds */
+} WuhooExportSlot;
+
+/**
+ * @brief Start of the memfd shared by \ref WuhooWindowExportStart.
+ *
+ * Slot i holds a height x width WuhooRGBA image, pitch bytes per row,
+ * starting pixel_offset + i * slot_size bytes into the file. Frame n goes
+ * to slot n % slot_count. A reader waits on frame with FUTEX_WAIT, then
+ * checks that the slot's sequence is still n after it is done with the
+ * pixels, otherwise the writer lapped it and the frame has to be dropped.
+ */
+typedef struct
+{
+  unsigned int          magic;        /*!< WUHOO_EXPORT_MAGIC */
+  unsigned int          version;      /*!< WUHOO_EXPORT_VERSION */
+  unsigned int          width;        /*!< Client width when the export started */
+  unsigned int          height;       /*!< Client height when the export started */
+  unsigned int          pitch;        /*!< Bytes between two rows of a slot */
+  unsigned int          slot_count;   /*!< Slots in use, up to WUHOO_EXPORT_MAX_SLOTS */
+  unsigned int          slot_size;    /*!< Bytes between two slots */
+  unsigned int          pixel_offset; /*!< Offset of the first slot, page aligned */
+  volatile unsigned int frame;        /*!< Last published frame, starting at 1, a futex */
+  volatile unsigned int closed;       /*!< Set once the window stops exporting */
+  WuhooExportSlot       slots[WUHOO_EXPORT_MAX_SLOTS];
+} WuhooExportHeader;
+#endif
+
 typedef struct
 {
   WuhooMouseModifiers mods;
@@ -416,6 +606,17 @@ typedef struct
   WuhooSize   size;
 } WuhooEventDrop;
 
+/**
+ * @brief Reports that a frame submitted with WUHOO_FLAG_VSYNC reached the
+ * screen
+ */
+typedef struct
+{
+  unsigned long long ust;    /*!< System time of the presentation in microseconds */
+  unsigned long long msc;    /*!< Vertical retrace count at the presentation */
+  WuhooSize          serial; /*!< Serial of the presented frame, one per blit */
+} WuhooEventFrame;
+
 typedef union
 {
   WuhooEventKey        key;
@@ -424,6 +625,7 @@ typedef union
   WuhooEventMouseWheel mouse_wheel;
   WuhooEventWindow     window;
   WuhooEventDrop       drop;
+  WuhooEventFrame      frame;
 } WuhooEventData;
 
 /**
@@ -435,11 +637,16 @@ typedef struct
   WuhooEventData data;
 } WuhooEvent;
 
-typedef WuhooResult (*WuhooConvertRGBA)(void* dst, WuhooRGBA const* const src,
-                                        WuhooSize x, WuhooSize y,
-                                        WuhooSize width, WuhooSize height,
-                                        WuhooSize src_width,
-                                        WuhooSize src_height);
+/* Converts a width x height region of src starting at (src_x, src_y) into
+ * the native pixel layout. src_pitch is the number of pixels in a source row,
+ * dst points at the first destination pixel and dst_pitch is the number of
+ * bytes in a destination row.
+ */
+typedef WuhooResult (*WuhooConvertRGBA)(void* dst, WuhooSize dst_pitch,
+                                        WuhooRGBA const* const src,
+                                        WuhooSize src_x, WuhooSize src_y,
+                                        WuhooSize src_pitch, WuhooSize width,
+                                        WuhooSize height);
 
 #ifdef WUHOO_OPENGL_ENABLE
 typedef struct
@@ -476,10 +683,21 @@ typedef struct
   WuhooGLFramebuffer gl_framebuffer;
 #endif
   WuhooHandle      platform_window;
-  WuhooConvertRGBA convert_rgba;
+  /* The backend state, right after a pointer so its casts are aligned */
+  WuhooByte        memory[WUHOO_PLATFORM_MEMORY_SIZE];
+  WuhooConvertRGBA convert_rgba; /* WuhooNull runs the generic kernel on convert_format */
+  WuhooPixelFormat convert_format; /* Layout of the pixels convert_rgba writes */
   int              window_flags;
   WuhooFlags       flags;
   int              global_mods;
+  WuhooBlitFilter  blit_filter; /* see WuhooWindowBlitFilterSet */
+  WuhooBlitBlend   blit_blend;  /* see WuhooWindowBlitBlendSet */
+#ifdef WUHOO_RECORDER_ENABLE
+  WuhooHandle      recorder; /* see WuhooWindowRecordStart */
+#endif
+#ifdef WUHOO_EXPORT_ENABLE
+  WuhooHandle      exporter; /* see WuhooWindowExportStart */
+#endif
   int              width;   /* window width */
   int              height;  /* window height */
   int              cwidth;  /* client width  */
@@ -488,7 +706,6 @@ typedef struct
   int              y;
   WuhooBoolean     is_initialized;
   WuhooBoolean     is_alive;
-  WuhooByte        memory[256];
 } WuhooWindow;
 
 /* Public API */
@@ -516,7 +733,9 @@ WuhooWindowDestroy(WuhooWindow* window);
  * \param height height of the window.
  * \param title Title of the created window.
  * \param flags Flags to customize the created window.
- * \param data Additional data (Currently unused).
+ * \param data Path of the framebuffer device or stand-in file with WUHOO_FBDEV_ENABLE,
+ *             WuhooPixelFormat of the surface with WUHOO_HEADLESS_ENABLE (WuhooNull for
+ *             32 bit XRGB), unused otherwise.
  * \return WuhooResult
  * \sa WuhooWindow, WuhooResult
  */
@@ -532,6 +751,18 @@ WuhooWindowCreate(WuhooWindow* window, int posx, int posy, WuhooSize width,
  */
 WuhooResult
 WuhooWindowEventNext(WuhooWindow* window, WuhooEvent* event);
+#ifdef WUHOO_HEADLESS_ENABLE
+/** Queue an event for \ref WuhooWindowEventNext to return, after any pending
+ *  window state changes. Events come out in the order they were injected.
+ *
+ * \param window The \ref WuhooWindow struct handle.
+ * \param event The \ref WuhooEvent to deliver, copied into the queue.
+ * \return WuhooResult, an error once WUHOO_HEADLESS_EVENT_COUNT events are queued
+ * \sa WuhooWindow, WuhooEvent, WuhooWindowEventNext
+ */
+WuhooResult
+WuhooWindowEventInject(WuhooWindow* window, WuhooEvent const* event);
+#endif
 /** Allocate all the resources required for a \ref WuhooWindow struct and
  *  prepare for a native Window to show.
  *
@@ -603,26 +834,363 @@ WuhooWindowClientRegionSet(WuhooWindow* window, int posx, int posy,
  * simply blits the contents of the API buffer to the screen by calling the appropriate
  * API calss (e.g. SwapBuffer, flush e.t.c.).
  *
- * **The current implementation does not properly handle regional drawing.**
+ * pixels is treated as a src_width x src_height image. The region starting at
+ * (src_x, src_y) is read in place, so a viewport of a larger image can be
+ * presented without copying it into a packed buffer first.
+ *
+ * By default, and with \ref WUHOO_BLIT_FILTER_NONE, the region is cropped
+ * to the destination. Once another filter is selected by
+ * \ref WuhooWindowBlitFilterSet, a region that differs in size from the
+ * destination is stretched to dst_width x dst_height, resampling and
+ * conversion to the native pixel format happen in a single pass. The region
+ * is always the rest of the source, src_width - src_x by src_height - src_y
+ * pixels.
  *
  * \param window The \ref WuhooWindow struct handle.
  * \param pixels RGBA unsigned char pixel buffer.
- * \param src_x Read from source starting at x (<b>Not Implemented Yet</b>).
- * \param src_y Read from source starting at y (<b>Not Implemented Yet</b>).
- * \param src_width width of the source region.
- * \param src_height height of the source region.
+ * \param src_x Read from source starting at x.
+ * \param src_y Read from source starting at y.
+ * \param src_width width (row length in pixels) of the source buffer.
+ * \param src_height height of the source buffer.
  * \param dst_x Write to destination starting at x.
  * \param dst_y Write to destination starting at y.
  * \param dst_width width of the destination region.
  * \param dst_height height of the destination region.
  * \return WuhooResult
- * \sa WuhooWindow, WuhooResult
+ * \sa WuhooWindow, WuhooResult, WuhooWindowBlitFilterSet
  */
 WuhooResult
 WuhooWindowBlit(WuhooWindow* window, WuhooRGBA* pixels, WuhooSize src_x,
     WuhooSize src_y, WuhooSize src_width, WuhooSize src_height,
     WuhooSize dst_x, WuhooSize dst_y, WuhooSize dst_width,
     WuhooSize dst_height);
+/**
+ * Blit only the listed regions of pixels to the framebuffer. Each rectangle
+ * refers to the same region in both the source buffer and the client area
+ * of the window, so the cost of a call scales with the damaged area instead
+ * of the window size.
+ *
+ * \param window The \ref WuhooWindow struct handle.
+ * \param pixels RGBA unsigned char pixel buffer covering the client area.
+ * \param stride Number of pixels in a row of the pixels buffer.
+ * \param rects The damaged regions that need to be presented.
+ * \param count Number of entries in rects.
+ * \return WuhooResult
+ * \sa WuhooWindow, WuhooRect, WuhooWindowBlit
+ */
+WuhooResult
+WuhooWindowBlitRects(WuhooWindow* window, WuhooRGBA* pixels, WuhooSize stride,
+                     WuhooRect const* rects, WuhooSize count);
+/**
+ * Get direct access to the buffer the window presents from, so a renderer
+ * can write pixels in the native format and skip the RGBA conversion of
+ * \ref WuhooWindowBlit. Nothing is presented until
+ * \ref WuhooWindowFramebufferRelease. The contents are undefined after
+ * acquiring and the buffer is only valid until it is released.
+ *
+ * \param window The \ref WuhooWindow struct handle.
+ * \param framebuffer Receives the pointer, pitch, size and pixel format.
+ * \return WuhooResult
+ * \sa WuhooFramebuffer, WuhooWindowFramebufferRelease
+ */
+WuhooResult
+WuhooWindowFramebufferAcquire(WuhooWindow* window, WuhooFramebuffer* framebuffer);
+/**
+ * Present the framebuffer returned by \ref WuhooWindowFramebufferAcquire
+ * and give it back to the window.
+ *
+ * \param window The \ref WuhooWindow struct handle.
+ * \param rects The regions that were written, WuhooNull for all of it.
+ * \param count Number of entries in rects.
+ * \return WuhooResult
+ * \sa WuhooFramebuffer, WuhooWindowFramebufferAcquire
+ */
+WuhooResult
+WuhooWindowFramebufferRelease(WuhooWindow* window, WuhooRect const* rects,
+                              WuhooSize count);
+/**
+ * Get the layout of the pixels the window presents, so images and frames
+ * can be produced in it once and shown with \ref WuhooWindowBlitNative
+ * instead of being converted on every \ref WuhooWindowBlit. On windows that
+ * blend with WUHOO_FLAG_TRANSPARENT alpha_mask covers the bits that hold
+ * the premultiplied alpha of a pixel.
+ *
+ * \param window The \ref WuhooWindow struct handle.
+ * \param format Receives the bits per pixel, channel masks and byte order.
+ * \return WuhooResult
+ * \sa WuhooPixelFormat, WuhooWindowConvertNative, WuhooWindowBlitNative
+ */
+WuhooResult
+WuhooWindowPixelFormatGet(WuhooWindow* window, WuhooPixelFormat* format);
+/**
+ * Convert RGBA pixels to the layout returned by
+ * \ref WuhooWindowPixelFormatGet with the same kernels blits use.
+ *
+ * \param window The \ref WuhooWindow struct handle.
+ * \param dst Receives width x height pixels in the native layout.
+ * \param dst_pitch Number of bytes between two rows of dst.
+ * \param src RGBA unsigned char pixel buffer.
+ * \param src_pitch Number of pixels in a row of src.
+ * \param width Width of the converted region.
+ * \param height Height of the converted region.
+ * \return WuhooResult
+ * \sa WuhooWindowPixelFormatGet, WuhooWindowBlitNative
+ */
+WuhooResult
+WuhooWindowConvertNative(WuhooWindow* window, void* dst, WuhooSize dst_pitch,
+                         WuhooRGBA const* src, WuhooSize src_pitch,
+                         WuhooSize width, WuhooSize height);
+/**
+ * Same as \ref WuhooWindowBlit for pixels that are already in the layout
+ * returned by \ref WuhooWindowPixelFormatGet, which are only copied. Rows
+ * are src_width pixels long without padding. Native pixels are never
+ * resampled, the region is cropped to the destination as with
+ * WUHOO_BLIT_FILTER_NONE, and they are not recorded or exported.
+ *
+ * \param window The \ref WuhooWindow struct handle.
+ * \param pixels Pixel buffer in the native layout.
+ * \param src_x Read from source starting at x.
+ * \param src_y Read from source starting at y.
+ * \param src_width width (row length in pixels) of the source buffer.
+ * \param src_height height of the source buffer.
+ * \param dst_x Write to destination starting at x.
+ * \param dst_y Write to destination starting at y.
+ * \param dst_width width of the destination region.
+ * \param dst_height height of the destination region.
+ * \return WuhooResult
+ * \sa WuhooWindowPixelFormatGet, WuhooWindowConvertNative, WuhooWindowBlit
+ */
+WuhooResult
+WuhooWindowBlitNative(WuhooWindow* window, void const* pixels, WuhooSize src_x,
+                      WuhooSize src_y, WuhooSize src_width,
+                      WuhooSize src_height, WuhooSize dst_x, WuhooSize dst_y,
+                      WuhooSize dst_width, WuhooSize dst_height);
+/**
+ * Present linear floating point pixels, e.g. the accumulation buffer of a
+ * progressive renderer. Exposure, tonemapping, sRGB or gamma encoding and
+ * the conversion to the native layout are done in one pass over cache
+ * sized chunks, with SSE2 or NEON when the CPU has them and on the worker
+ * pool with WUHOO_THREADS_ENABLE. Like \ref WuhooWindowBlitNative the
+ * pixels are presented one to one and not recorded or exported. Not
+ * supported on Cocoa.
+ *
+ * \param window The \ref WuhooWindow struct handle.
+ * \param pixels Floats, format->channels of them per pixel.
+ * \param format Channels and encoding of pixels.
+ * \param src_x Read from source starting at x.
+ * \param src_y Read from source starting at y.
+ * \param src_width width (row length in pixels) of the source buffer.
+ * \param src_height height of the source buffer.
+ * \param dst_x Write to destination starting at x.
+ * \param dst_y Write to destination starting at y.
+ * \param dst_width width of the destination region.
+ * \param dst_height height of the destination region.
+ * \return WuhooResult
+ * \sa WuhooFloatFormat, WuhooTonemap, WuhooWindowBlit
+ */
+WuhooResult
+WuhooWindowBlitFloat(WuhooWindow* window, float const* pixels,
+                     WuhooFloatFormat const* format, WuhooSize src_x,
+                     WuhooSize src_y, WuhooSize src_width,
+                     WuhooSize src_height, WuhooSize dst_x, WuhooSize dst_y,
+                     WuhooSize dst_width, WuhooSize dst_height);
+/**
+ * Present a decoded video or camera frame without converting it to RGBA
+ * first. The frame is stretched to dst_width x dst_height with the filter
+ * of \ref WuhooWindowBlitFilterSet, or cropped with
+ * \ref WUHOO_BLIT_FILTER_NONE. Color conversion, resampling and packing to
+ * the native layout are done in one pass over cache sized chunks, with
+ * SSE2 or NEON when the CPU has them and on the worker pool with
+ * WUHOO_THREADS_ENABLE.
+ * Like \ref WuhooWindowBlitNative the frame is not recorded or exported.
+ * Not supported on Cocoa.
+ *
+ * \param window The \ref WuhooWindow struct handle.
+ * \param frame Planes and encoding of the frame.
+ * \param dst_x Write to destination starting at x.
+ * \param dst_y Write to destination starting at y.
+ * \param dst_width width of the destination region.
+ * \param dst_height height of the destination region.
+ * \return WuhooResult
+ * \sa WuhooYUVFrame, WuhooWindowBlit
+ */
+WuhooResult
+WuhooWindowBlitYUV(WuhooWindow* window, WuhooYUVFrame const* frame,
+                   WuhooSize dst_x, WuhooSize dst_y, WuhooSize dst_width,
+                   WuhooSize dst_height);
+/**
+ * Same as \ref WuhooWindowBlit, but returns as soon as the frame has been
+ * converted and submitted instead of waiting for the window system to read
+ * it. pixels can be reused right away, the window keeps up to
+ * WUHOO_XSHM_BUFFER_COUNT converted frames in flight so rendering the next
+ * frame overlaps with the server side copy. If all of them are still in
+ * flight nothing is presented and an error is returned, see
+ * \ref WuhooWindowFramesInFlightGet. Backends without asynchronous
+ * presentation complete the blit before returning.
+ *
+ * \return WuhooResult
+ * \sa WuhooWindowBlit, WuhooWindowFramesInFlightGet
+ */
+WuhooResult
+WuhooWindowBlitAsync(WuhooWindow* window, WuhooRGBA* pixels, WuhooSize src_x,
+                     WuhooSize src_y, WuhooSize src_width,
+                     WuhooSize src_height, WuhooSize dst_x, WuhooSize dst_y,
+                     WuhooSize dst_width, WuhooSize dst_height);
+/** Get the number of frames submitted with \ref WuhooWindowBlitAsync that
+ *  the window system has not finished reading yet.
+ *
+ * \param window The \ref WuhooWindow struct handle.
+ * \param count Receives the number of frames in flight.
+ * \return WuhooResult
+ * \sa WuhooWindowBlitAsync
+ */
+WuhooResult
+WuhooWindowFramesInFlightGet(WuhooWindow* window, WuhooSize* count);
+/** Get the number of synchronous round trips to the window system so far.
+ *  They are only counted by the X11 backend when the implementation is
+ *  compiled with WUHOO_DEBUG, count is 0 otherwise.
+ *
+ * \param window The \ref WuhooWindow struct handle.
+ * \param count Receives the number of round trips.
+ * \return WuhooResult
+ */
+WuhooResult
+WuhooWindowRoundTripsGet(WuhooWindow* window, WuhooSize* count);
+/** Select how \ref WuhooWindowBlit resamples when source and destination
+ *  sizes differ. Windows start with \ref WUHOO_BLIT_FILTER_NONE, which crops,
+ *  so scaling has to be asked for.
+ *
+ * \param window The \ref WuhooWindow struct handle.
+ * \param filter One of the \ref WuhooBlitFilter values.
+ * \return WuhooResult
+ * \sa WuhooWindow, WuhooBlitFilter, WuhooWindowBlit
+ */
+WuhooResult
+WuhooWindowBlitFilterSet(WuhooWindow* window, WuhooBlitFilter filter);
+/** Select how \ref WuhooWindowBlit combines pixels with what is already in
+ *  the window. Blending is done by the window system, an error is returned
+ *  if it cannot blend.
+ *
+ * \param window The \ref WuhooWindow struct handle.
+ * \param blend One of the \ref WuhooBlitBlend values.
+ * \return WuhooResult
+ * \sa WuhooWindow, WuhooBlitBlend, WuhooWindowBlit
+ */
+WuhooResult
+WuhooWindowBlitBlendSet(WuhooWindow* window, WuhooBlitBlend blend);
+/** Composite src over background into dst, for alpha content that has to
+ *  be flattened before \ref WuhooWindowBlit. The alpha of src is straight,
+ *  the background is taken as premultiplied (any opaque image is) and so
+ *  is the result, whose alpha is the coverage of both. Done in integers
+ *  with SSE2/AVX2 or NEON when the CPU has them. Strides are in pixels and
+ *  dst may be the same buffer as src or background.
+ *
+ * \param dst Receives the width x height composited pixels.
+ * \param dst_stride Pixels between two rows of dst.
+ * \param src The pixels composited on top.
+ * \param src_stride Pixels between two rows of src.
+ * \param background The pixels underneath.
+ * \param background_stride Pixels between two rows of background.
+ * \param width Width of the composited region.
+ * \param height Height of the composited region.
+ * \return WuhooResult
+ * \sa WuhooBlendOverPattern
+ */
+WuhooResult
+WuhooBlendOver(WuhooRGBA* dst, WuhooSize dst_stride, WuhooRGBA const* src,
+               WuhooSize src_stride, WuhooRGBA const* background,
+               WuhooSize background_stride, WuhooSize width, WuhooSize height);
+/** Composite src over a solid color or a checkerboard, like the ones
+ *  image viewers show behind transparent images. Cells at even positions
+ *  (the top left one included) take color0, the others color1. Same math
+ *  as \ref WuhooBlendOver.
+ *
+ * \param dst Receives the width x height composited pixels.
+ * \param dst_stride Pixels between two rows of dst.
+ * \param src The pixels composited on top.
+ * \param src_stride Pixels between two rows of src.
+ * \param width Width of the composited region.
+ * \param height Height of the composited region.
+ * \param color0 Color of the top left cell.
+ * \param color1 Color of the cells next to it.
+ * \param cell_size Width and height of a cell in pixels, 0 for a solid color0.
+ * \return WuhooResult
+ * \sa WuhooBlendOver
+ */
+WuhooResult
+WuhooBlendOverPattern(WuhooRGBA* dst, WuhooSize dst_stride,
+                      WuhooRGBA const* src, WuhooSize src_stride,
+                      WuhooSize width, WuhooSize height, WuhooRGBA color0,
+                      WuhooRGBA color1, WuhooSize cell_size);
+#ifdef WUHOO_RECORDER_ENABLE
+/** Start recording what is blitted to the window. After every
+ *  \ref WuhooWindowBlit or \ref WuhooWindowBlitRects the client area is
+ *  copied into a ring of WUHOO_RECORDER_FRAME_COUNT frames and a background
+ *  thread writes it to path. When the ring is full the frame is dropped
+ *  and counted instead of waiting for the disk. The recording keeps the
+ *  client size the window had when it started, frames written through
+ *  \ref WuhooWindowFramebufferAcquire are not recorded.
+ *
+ * \param window The \ref WuhooWindow struct handle.
+ * \param path File to create or truncate.
+ * \param format One of the \ref WuhooRecordFormat values.
+ * \param fps Frame rate stored in the Y4M header, 0 for 60.
+ * \return WuhooResult
+ * \sa WuhooWindowRecordStop, WuhooWindowRecordStatsGet
+ */
+WuhooResult
+WuhooWindowRecordStart(WuhooWindow* window, const char* path,
+                       WuhooRecordFormat format, WuhooSize fps);
+/** Stop the recording started with \ref WuhooWindowRecordStart. Frames
+ *  still in the ring are written before the file is closed.
+ *  \ref WuhooWindowDestroy stops it as well.
+ *
+ * \param window The \ref WuhooWindow struct handle.
+ * \param stats Receives the final counters, may be WuhooNull.
+ * \return WuhooResult
+ * \sa WuhooWindowRecordStart, WuhooRecordStats
+ */
+WuhooResult
+WuhooWindowRecordStop(WuhooWindow* window, WuhooRecordStats* stats);
+/** Get the counters of a running recording.
+ *
+ * \param window The \ref WuhooWindow struct handle.
+ * \param stats Receives the counters.
+ * \return WuhooResult
+ * \sa WuhooWindowRecordStart, WuhooRecordStats
+ */
+WuhooResult
+WuhooWindowRecordStatsGet(WuhooWindow* window, WuhooRecordStats* stats);
+#endif
+#ifdef WUHOO_EXPORT_ENABLE
+/** Start mirroring what is blitted to the window into a memfd that other
+ *  local processes can map, see \ref WuhooExportHeader for its layout.
+ *  Every \ref WuhooWindowBlit and \ref WuhooWindowBlitRects that reaches
+ *  the window is converted straight into the next slot and published with
+ *  a futex wake, the window never waits for readers. Readers open the
+ *  descriptor through /proc/<pid>/fd/<fd> or receive it over a socket.
+ *  The export keeps the client size the window had when it started.
+ *  Linux only.
+ *
+ * \param window The \ref WuhooWindow struct handle.
+ * \param slot_count Number of frame slots, 2 to WUHOO_EXPORT_MAX_SLOTS.
+ * \param fd Receives the memfd, owned by the window.
+ * \return WuhooResult
+ * \sa WuhooWindowExportStop, WuhooExportHeader
+ */
+WuhooResult
+WuhooWindowExportStart(WuhooWindow* window, WuhooSize slot_count, int* fd);
+/** Stop the export started with \ref WuhooWindowExportStart. Readers are
+ *  woken and see WuhooExportHeader::closed, their mappings stay valid.
+ *  \ref WuhooWindowDestroy stops it as well.
+ *
+ * \param window The \ref WuhooWindow struct handle.
+ * \return WuhooResult
+ * \sa WuhooWindowExportStart
+ */
+WuhooResult
+WuhooWindowExportStop(WuhooWindow* window);
+#endif
 /**
  * Present the previously inited and created WuhooWindow
  * The window should be visible on the screen after this call
@@ -649,31 +1217,152 @@ WuhooResultString(WuhooResult result);
 
 #ifdef WUHOO_IMPLEMENTATION
 
+#include <math.h> /* powf and sqrtf of the float blit encoding */
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WUHOO_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define WUHOO_NEON
+#include <arm_neon.h>
+#endif
+
+/* Wider kernels are compiled for their own target and only picked at runtime
+ * when the CPU has them, see WuhooConvertSelect */
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) ||           \
+  defined(_M_IX86)
+#define WUHOO_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define WuhooTarget(isa)
+#else
+#define WuhooTarget(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+#define WUHOO_CPU_SSSE3 WuhooFlag(0)
+#define WUHOO_CPU_AVX2 WuhooFlag(1)
+#define WUHOO_CPU_NEON WuhooFlag(2)
+#define WUHOO_CPU_SSE2 WuhooFlag(3)
+
 WuhooInternal void
 WuhooCopy(void* const to, void const* const from, WuhooSize count);
 WuhooInternal WuhooBoolean
 WuhooStringCmp(const char* to, const char* from, WuhooSize max_count);
 /* Color conversion kernels */
 WuhooInternal WuhooResult
-WuhooConvertRGBANoOp(void* dst, WuhooRGBA const* const src, WuhooSize x,
-                     WuhooSize y, WuhooSize width, WuhooSize height,
-                     WuhooSize src_width, WuhooSize src_height);
+WuhooConvertRGBANoOp(void* dst, WuhooSize dst_pitch, WuhooRGBA const* const src,
+                     WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                     WuhooSize width, WuhooSize height);
+WuhooInternal WuhooResult
+WuhooConvertRGBAtoRGBA(void* dst, WuhooSize dst_pitch, WuhooRGBA const* const src,
+                       WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                       WuhooSize width, WuhooSize height);
+WuhooInternal WuhooResult
+WuhooConvertRGBAtoRGB(void* dst, WuhooSize dst_pitch, WuhooRGBA const* const src,
+                      WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                      WuhooSize width, WuhooSize height);
 WuhooInternal WuhooResult
-WuhooConvertRGBAtoRGBA(void* dst, WuhooRGBA const* const src, WuhooSize x,
-                       WuhooSize y, WuhooSize width, WuhooSize height,
-                       WuhooSize src_width, WuhooSize src_height);
+WuhooConvertRGBAtoBGRA(void* dst, WuhooSize dst_pitch, WuhooRGBA const* const src,
+                       WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                       WuhooSize width, WuhooSize height);
 WuhooInternal WuhooResult
-WuhooConvertRGBAtoRGB(void* dst, WuhooRGBA const* const src, WuhooSize x,
-                      WuhooSize y, WuhooSize width, WuhooSize height,
-                      WuhooSize src_width, WuhooSize src_height);
+WuhooConvertRGBAtoR5G6B5(void* dst, WuhooSize dst_pitch, WuhooRGBA const* const src,
+                         WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                         WuhooSize width, WuhooSize height);
 WuhooInternal WuhooResult
-WuhooConvertRGBAtoBGRA(void* dst, WuhooRGBA const* const src, WuhooSize x,
-                       WuhooSize y, WuhooSize width, WuhooSize height,
-                       WuhooSize src_width, WuhooSize src_height);
+WuhooConvertRGBAtoR5G5B5(void* dst, WuhooSize dst_pitch, WuhooRGBA const* const src,
+                         WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                         WuhooSize width, WuhooSize height);
 WuhooInternal WuhooResult
-WuhooConvertRGBAtoR5G6B5(void* dst, WuhooRGBA const* const src, WuhooSize x,
-                         WuhooSize y, WuhooSize width, WuhooSize height,
-                         WuhooSize src_width, WuhooSize src_height);
+WuhooConvertRGBAtoR8G8B8(void* dst, WuhooSize dst_pitch, WuhooRGBA const* const src,
+                         WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                         WuhooSize width, WuhooSize height);
+WuhooInternal WuhooResult
+WuhooConvertRGBAtoB8G8R8(void* dst, WuhooSize dst_pitch, WuhooRGBA const* const src,
+                         WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                         WuhooSize width, WuhooSize height);
+WuhooInternal WuhooResult
+WuhooConvertRGBAtoR10G10B10(void* dst, WuhooSize dst_pitch,
+                            WuhooRGBA const* const src, WuhooSize src_x,
+                            WuhooSize src_y, WuhooSize src_pitch,
+                            WuhooSize width, WuhooSize height);
+WuhooInternal WuhooResult
+WuhooConvertRGBAtoPremultipliedBGRA(void* dst, WuhooSize dst_pitch,
+                                    WuhooRGBA const* const src,
+                                    WuhooSize src_x, WuhooSize src_y,
+                                    WuhooSize src_pitch, WuhooSize width,
+                                    WuhooSize height);
+WuhooInternal WuhooResult
+WuhooConvertRGBAtoFormat(WuhooPixelFormat const* format, void* dst,
+                         WuhooSize dst_pitch, WuhooRGBA const* const src,
+                         WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                         WuhooSize width, WuhooSize height);
+WuhooInternal WuhooResult
+WuhooConvertFormatSelect(WuhooWindow* window, WuhooPixelFormat const* format);
+typedef struct WuhooConvertStage WuhooConvertStage;
+/* Writes destination pixels from a source that is not RGBA, the coordinates
+ * are in that source */
+typedef WuhooResult (*WuhooConvertSource)(WuhooConvertStage const* stage,
+                                          void* dst, WuhooSize dst_pitch,
+                                          WuhooSize src_x, WuhooSize src_y,
+                                          WuhooSize src_pitch, WuhooSize width,
+                                          WuhooSize height);
+/* The conversion a blit runs, handed to the backends along with the pixels
+ * so that blitting other sources leaves the window alone */
+struct WuhooConvertStage
+{
+  WuhooConvertRGBA        convert; /* WuhooNull runs the generic kernel on format */
+  WuhooPixelFormat const* format;
+  WuhooConvertSource      source;  /* Reads context instead of the pixels, WuhooNull for RGBA */
+  void const*             context;
+};
+WuhooInternal WuhooConvertStage
+WuhooConvertStageWindow(WuhooWindow* window);
+WuhooInternal WuhooResult
+WuhooConvertStageRGBA(WuhooConvertStage const* stage, void* dst,
+                      WuhooSize dst_pitch, WuhooRGBA const* const src,
+                      WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                      WuhooSize width, WuhooSize height);
+WuhooInternal WuhooResult
+WuhooConvertStageRun(WuhooConvertStage const* stage, void* dst,
+                     WuhooSize dst_pitch, WuhooRGBA const* const src,
+                     WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                     WuhooSize width, WuhooSize height);
+WuhooInternal WuhooResult
+WuhooConvertNative(WuhooConvertStage const* stage, void* dst,
+                   WuhooSize dst_pitch, WuhooSize src_x, WuhooSize src_y,
+                   WuhooSize src_pitch, WuhooSize width, WuhooSize height);
+WuhooInternal WuhooResult
+WuhooConvertScaled(WuhooWindow* window, WuhooConvertStage const* stage,
+                   void* dst, WuhooSize dst_pitch,
+                   WuhooSize dst_bytes_per_pixel, WuhooRGBA const* src,
+                   WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                   WuhooSize src_width, WuhooSize src_height,
+                   WuhooSize dst_width, WuhooSize dst_height,
+                   WuhooSize clip_width, WuhooSize band_y,
+                   WuhooSize band_height);
+/* 16.16 fixed point source position, 64 bit so that any source size can be
+ * stretched without overflowing */
+typedef long long WuhooFixed;
+WuhooInternal void
+WuhooResampleRowNearest(WuhooRGBA* dst, WuhooRGBA const* src_row,
+                        WuhooFixed fx, WuhooFixed step, WuhooSize count);
+WuhooInternal void
+WuhooResampleRowBilinear(WuhooRGBA* dst, WuhooRGBA const* row0,
+                         WuhooRGBA const* row1, int wy, WuhooFixed fx,
+                         WuhooFixed step, WuhooFixed fx_max, WuhooSize count);
+WuhooInternal unsigned int
+WuhooCpuFeatures(void);
+WuhooInternal WuhooConvertRGBA
+WuhooConvertSelect(WuhooConvertRGBA kernel, WuhooFlags flags);
+#ifdef WUHOO_THREADS_ENABLE
+WuhooInternal void
+WuhooConvertPoolRetain(void);
+WuhooInternal void
+WuhooConvertPoolRelease(void);
+#endif
 
 /* Helpers and utilities */
 WuhooInternal void
@@ -684,6 +1373,8 @@ WuhooInternal WuhooSize
 WuhooStringCopy(char* to, const char* from, WuhooSize max_count);
 WuhooInternal int
 WuhooMini(int a, int b);
+WuhooInternal WuhooBoolean
+WuhooWindowFlagsEvent(WuhooWindow* window, WuhooEvent* event);
 WuhooInternal int
 WuhooMaxi(int a, int b);
 WuhooInternal void
@@ -1991,6 +2682,10 @@ void View_drawRect(id self, SEL _cmd, CGRect rect) {
   int width = window->cwidth;
   int height = window->cheight;
 
+  CGContextSetInterpolationQuality(
+    cgctxref, (WUHOO_BLIT_FILTER_BILINEAR == window->blit_filter)
+                ? kCGInterpolationLow
+                : kCGInterpolationNone);
   CGContextDrawImage(cgctxref, CGRectMake(0, 0, width, height),
                      cocoa_window->image);
 
@@ -2000,8 +2695,10 @@ void View_drawRect(id self, SEL _cmd, CGRect rect) {
 }
 
 WuhooResult
-_WuhooWindowBlitCocoa(WuhooWindow* window, WuhooRGBA* pixels, WuhooSize x,
-                      WuhooSize y, WuhooSize width, WuhooSize height)
+_WuhooWindowBlitCocoa(WuhooWindow* window, WuhooRGBA* pixels, WuhooSize src_x,
+                      WuhooSize src_y, WuhooSize src_pitch, WuhooSize src_width,
+                      WuhooSize src_height, WuhooSize x, WuhooSize y,
+                      WuhooSize width, WuhooSize height)
 {
   WuhooResult       result       = WuhooSuccess;
   WuhooWindowCocoa* cocoa_window = (WuhooWindowCocoa*)window->platform_window;
@@ -2035,12 +2732,17 @@ _WuhooWindowBlitCocoa(WuhooWindow* window, WuhooRGBA* pixels, WuhooSize x,
     return WuhooSuccess;
   }
 
+  /* Quartz reads the region in place, rows are src_pitch pixels apart */
+  WuhooRGBA const*  region     = pixels + src_x + src_y * src_pitch;
   CGColorSpaceRef   colorSpace = CGColorSpaceCreateDeviceRGB();
   CGDataProviderRef provider   = CGDataProviderCreateWithData(
-							      NULL, pixels, width * height * sizeof(*pixels), NULL);
+    NULL, region, ((src_height - 1) * src_pitch + src_width) * sizeof(*pixels),
+    NULL);
 
+  /* Quartz stretches the image over the client area when it is drawn */
   cocoa_window->image =
-    CGImageCreate(width, height, 8, 32, width * sizeof(*pixels), colorSpace,
+    CGImageCreate(src_width, src_height, 8, 32, src_pitch * sizeof(*pixels),
+                  colorSpace,
                   kCGBitmapByteOrder32Big | kCGImageAlphaNoneSkipLast, provider,
                   NULL, true, kCGRenderingIntentDefault);
 
@@ -2521,6 +3223,14 @@ _WuhooWindowCreateCocoa(WuhooWindow* window, int posx, int posy,
 
   cocoa_window = (WuhooWindowCocoa*)&window->memory[0];
 
+  /* Quartz reads the RGBA pixels of blits in place as RGBX */
+  window->convert_format.bits_per_pixel = 32;
+  window->convert_format.red_mask       = 0x000000FF;
+  window->convert_format.green_mask     = 0x0000FF00;
+  window->convert_format.blue_mask      = 0x00FF0000;
+  window->convert_format.msb_first      = WuhooFalse;
+  window->convert_format.alpha_mask     = 0;
+
   cocoa_window->WuhooNSView = objc_allocateClassPair((Class)objc_getClass("NSView"), "WuhooNSView", 0);
   cocoa_window->WuhooNSWindow = objc_allocateClassPair((Class)objc_getClass("NSWindow"), "WuhooNSWindow", 0);
   
@@ -2932,8 +3642,11 @@ _WuhooWindowClientRegionSetWin32(WuhooWindow* window, int posx, int posy,
 }
 
 WuhooResult
-_WuhooWindowBlitWin32(WuhooWindow* window, WuhooRGBA* pixels, WuhooSize x,
-                      WuhooSize y, WuhooSize width, WuhooSize height)
+_WuhooWindowBlitWin32(WuhooWindow* window, WuhooConvertStage const* stage,
+                      WuhooRGBA* pixels, WuhooSize src_x, WuhooSize src_y,
+                      WuhooSize src_pitch, WuhooSize src_width,
+                      WuhooSize src_height, WuhooSize x, WuhooSize y,
+                      WuhooSize width, WuhooSize height)
 {
   WuhooResult result = WuhooSuccess;
 
@@ -2986,42 +3699,166 @@ _WuhooWindowBlitWin32(WuhooWindow* window, WuhooRGBA* pixels, WuhooSize x,
           DIB_RGB_COLORS,
           SRCCOPY);*/
 
-  window->convert_rgba(win32_window->dib, pixels, x, y, window->cwidth,
-                       window->cheight, window->cwidth, window->cheight);
+  /* The DIB section mirrors the client area */
+  int valid_width  = WuhooMini(width, rect.right - (int)x);
+  int valid_height = WuhooMini(height, rect.bottom - (int)y);
+  if (valid_width <= 0 || valid_height <= 0)
+    return WuhooSuccess;
+
+  WuhooConvertScaled(window, stage,
+                     &win32_window->dib[x + y * window->cwidth],
+                     window->cwidth * sizeof(*win32_window->dib),
+                     sizeof(*win32_window->dib), pixels, src_x, src_y,
+                     src_pitch, src_width, src_height, width, height,
+                     valid_width, 0, valid_height);
 
   SelectObject(win32_window->mem_dc, win32_window->bitmap);
-  BitBlt(win32_window->dc, 0, 0, rect.right, rect.bottom, win32_window->mem_dc,
-         0, 0, SRCCOPY);
+  BitBlt(win32_window->dc, x, y, valid_width, valid_height,
+         win32_window->mem_dc, x, y, SRCCOPY);
   // SelectObject( hdcMem, hbmOld );
 
   return result;
 }
 
+
 WuhooResult
-_WuhooWindowDropContentsGetWin32(WuhooWindow* window, WuhooEvent* event,
-                                 char* buffer, int buffer_size)
+_WuhooWindowBlitRectsWin32(WuhooWindow* window,
+                           WuhooConvertStage const* stage, WuhooRGBA* pixels,
+                           WuhooSize stride, WuhooRect const* rects,
+                           WuhooSize count)
 {
-  WuhooChar scratch_buffer[WUHOO_MAX_FILE_NAME_LENGTH];
+  WuhooResult result = WuhooSuccess;
 
-  WuhooZeroInit(scratch_buffer, sizeof(scratch_buffer));
-  WuhooZeroInit(buffer, buffer_size);
+  WuhooWindowWin32* win32_window = (WuhooWindowWin32*)window->platform_window;
 
-  WuhooUTF8* data_ptr = (WuhooUTF8*)buffer;
-  for (WuhooSize drop_index = 0; drop_index < event->data.drop.count; drop_index++) {
-    const WuhooChar* buffer_ptr = &scratch_buffer[0];
-    UINT             written    = DragQueryFile(
-      (HDROP)event->data.drop.context, drop_index, (TCHAR*)buffer_ptr,
-      sizeof(scratch_buffer) / sizeof(scratch_buffer[0]));
-#ifdef WUHOO_UNICODE
-    WuhooConversionResult res =
-      WuhooConvertUTF16toUTF8(&buffer_ptr, buffer_ptr + written, &data_ptr,
-                              data_ptr + buffer_size, WuhooStrictConversion);
-	*data_ptr++ = '\n';
-#else
-    WuhooStringCopy((char*)data_ptr, (const char*)buffer_ptr, written);
-    data_ptr += written;
-	*data_ptr++ = '\n';
-#endif
+#ifdef WUHOO_OPENGL_ENABLE
+  if (WUHOO_FLAG_OPENGL & window->flags) {
+    SwapBuffers(win32_window->dc);
+    return WuhooSuccess;
+  }
+#endif /* WUHOO_OPENGL_ENABLE */
+
+  if (WUHOO_WINDOW_FLAG_CLOSED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_RESIZED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_REGION_UPDATED & window->window_flags) {
+    return WuhooSuccess;
+  }
+
+  SelectObject(win32_window->mem_dc, win32_window->bitmap);
+
+  WuhooSize index = 0;
+  for (index = 0; index < count; index++) {
+    int x      = rects[index].x;
+    int y      = rects[index].y;
+    int width  = WuhooMini(rects[index].width, window->cwidth - x);
+    int height = WuhooMini(rects[index].height, window->cheight - y);
+
+    if (width <= 0 || height <= 0)
+      continue;
+
+    /* The DIB section mirrors the client area */
+    WuhooConvertStageRun(stage, &win32_window->dib[x + y * window->cwidth],
+                         window->cwidth * sizeof(*win32_window->dib), pixels, x,
+                         y, stride, width, height);
+
+    BitBlt(win32_window->dc, x, y, width, height, win32_window->mem_dc, x, y,
+           SRCCOPY);
+  }
+
+  return result;
+}
+
+WuhooResult
+_WuhooWindowFramebufferAcquireWin32(WuhooWindow* window,
+                                    WuhooFramebuffer* framebuffer)
+{
+  WuhooWindowWin32* win32_window = (WuhooWindowWin32*)window->platform_window;
+
+#ifdef WUHOO_OPENGL_ENABLE
+  if (WUHOO_FLAG_OPENGL & window->flags) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : No framebuffer access for OpenGL windows";
+  }
+#endif
+
+  if (WuhooNull == win32_window->dib) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : No framebuffer access for this window";
+  }
+
+  /* Top-down 32bpp DIB section, see WM_SIZE */
+  framebuffer->pixels                = win32_window->dib;
+  framebuffer->pitch                 = window->cwidth * sizeof(*win32_window->dib);
+  framebuffer->width                 = window->cwidth;
+  framebuffer->height                = window->cheight;
+  framebuffer->format.bits_per_pixel = 32;
+  framebuffer->format.red_mask       = 0x00FF0000;
+  framebuffer->format.green_mask     = 0x0000FF00;
+  framebuffer->format.blue_mask      = 0x000000FF;
+  framebuffer->format.msb_first      = WuhooFalse;
+  framebuffer->format.alpha_mask     = 0;
+
+  return WuhooSuccess;
+}
+
+/* The DIB section already holds the pixels, only the regions are copied */
+WuhooResult
+_WuhooWindowFramebufferPresentWin32(WuhooWindow* window,
+                                    WuhooRect const* rects, WuhooSize count)
+{
+  WuhooWindowWin32* win32_window = (WuhooWindowWin32*)window->platform_window;
+
+  if (WUHOO_WINDOW_FLAG_CLOSED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_RESIZED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_REGION_UPDATED & window->window_flags ||
+      WuhooNull == win32_window->dib) {
+    return WuhooSuccess;
+  }
+
+  SelectObject(win32_window->mem_dc, win32_window->bitmap);
+
+  WuhooSize index = 0;
+  for (index = 0; index < count; index++) {
+    int x      = rects[index].x;
+    int y      = rects[index].y;
+    int width  = WuhooMini(rects[index].width, window->cwidth - x);
+    int height = WuhooMini(rects[index].height, window->cheight - y);
+
+    if (width <= 0 || height <= 0)
+      continue;
+
+    BitBlt(win32_window->dc, x, y, width, height, win32_window->mem_dc, x, y,
+           SRCCOPY);
+  }
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+_WuhooWindowDropContentsGetWin32(WuhooWindow* window, WuhooEvent* event,
+                                 char* buffer, int buffer_size)
+{
+  WuhooChar scratch_buffer[WUHOO_MAX_FILE_NAME_LENGTH];
+
+  WuhooZeroInit(scratch_buffer, sizeof(scratch_buffer));
+  WuhooZeroInit(buffer, buffer_size);
+
+  WuhooUTF8* data_ptr = (WuhooUTF8*)buffer;
+  for (WuhooSize drop_index = 0; drop_index < event->data.drop.count; drop_index++) {
+    const WuhooChar* buffer_ptr = &scratch_buffer[0];
+    UINT             written    = DragQueryFile(
+      (HDROP)event->data.drop.context, drop_index, (TCHAR*)buffer_ptr,
+      sizeof(scratch_buffer) / sizeof(scratch_buffer[0]));
+#ifdef WUHOO_UNICODE
+    WuhooConversionResult res =
+      WuhooConvertUTF16toUTF8(&buffer_ptr, buffer_ptr + written, &data_ptr,
+                              data_ptr + buffer_size, WuhooStrictConversion);
+	*data_ptr++ = '\n';
+#else
+    WuhooStringCopy((char*)data_ptr, (const char*)buffer_ptr, written);
+    data_ptr += written;
+	*data_ptr++ = '\n';
+#endif
   }
 
   *data_ptr = 0;
@@ -3609,7 +4446,11 @@ _WuhooWindowCreateWin32(WuhooWindow* window, int posx, int posy,
   win32_window = (WuhooWindowWin32*)&window->memory[0];
 
   window->platform_window = win32_window;
-  window->convert_rgba    = &WuhooConvertRGBAtoBGRA;
+
+  /* DIB sections hold 32 bit BGRX pixels */
+  WuhooPixelFormat format = { 32, 0x00FF0000, 0x0000FF00, 0x000000FF,
+                              WuhooFalse, 0 };
+  WuhooConvertFormatSelect(window, &format);
 
   HINSTANCE hInstance = GetModuleHandle((TCHAR*)WuhooNull);
   win32_window->app   = hInstance;
@@ -3823,9 +4664,9 @@ WuhooWindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 
 #ifdef __linux__
 
-/* For now, we only support X11 on linux systems */
-#define WUHOO_X11_ENABLE
-#ifdef WUHOO_X11_ENABLE
+/* X11 unless another backend is requested */
+#if !defined(WUHOO_WAYLAND_ENABLE) && !defined(WUHOO_FBDEV_ENABLE) &&     \
+  !defined(WUHOO_HEADLESS_ENABLE)
 #define WUHOO_X11_ENABLE
 #endif
 
@@ -3841,9 +4682,43 @@ WuhooWindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 #include <X11/Xatom.h>
 #include <X11/keysym.h>
 
-#include <sys/ioctl.h>
+#ifdef WUHOO_XSHM_ENABLE
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#ifndef WUHOO_XSHM_BUFFER_COUNT
+#define WUHOO_XSHM_BUFFER_COUNT 3 /* Shared images that can be in flight at once */
+#endif
+#endif
+
+#ifdef WUHOO_XPRESENT_ENABLE
+#include <X11/extensions/Xpresent.h>
+#include <poll.h>
+#include <time.h>
+
+#ifndef WUHOO_XPRESENT_PIXMAP_COUNT
+#define WUHOO_XPRESENT_PIXMAP_COUNT 2 /* Frames drawn while the last is shown */
+#endif
+
+#ifndef WUHOO_XPRESENT_IDLE_TIMEOUT
+#define WUHOO_XPRESENT_IDLE_TIMEOUT 100 /* Milliseconds a busy pixmap is waited for */
+#endif
+#endif
+
+
+#ifdef WUHOO_XRENDER_ENABLE
+#include <X11/extensions/Xrender.h>
+#endif
+
+#ifdef WUHOO_XCB_ENABLE
+#include <X11/Xlib-xcb.h>
+#include <stdlib.h> /* xcb replies are released with free */
+#else
+#include <X11/Xproto.h> /* xPutImageReq */
+#endif
+
 #include <sys/mman.h>
-#include <linux/fb.h>
 
 #include <locale.h>
 
@@ -3858,16 +4733,58 @@ typedef struct
   unsigned char* image_data;
   Visual*        visual;
   Display*       display;
+#ifdef WUHOO_XCB_ENABLE
+  xcb_connection_t* connection; /* Owned by display */
+#endif
+  WuhooSize max_request_bytes; /* Pixel payload that fits one PutImage */
 #ifdef WUHOO_OPENGL_ENABLE
   GLXContext glc;
+#endif
+#ifdef WUHOO_XSHM_ENABLE
+  XShmSegmentInfo shm_info[WUHOO_XSHM_BUFFER_COUNT];
+  XImage*         shm_images[WUHOO_XSHM_BUFFER_COUNT];
+  WuhooBoolean    shm_busy[WUHOO_XSHM_BUFFER_COUNT]; /* Still read by the server */
+  int             shm_count; /* Buffers allocated for the current size */
+  int             shm_index; /* The buffer x11_window->image points at */
+  int             shm_completion_type;
+  WuhooSize       frames_in_flight;
+  WuhooBoolean    has_shm;
+#endif
+#ifdef WUHOO_XPRESENT_ENABLE
+  /* Frames are staged here for PresentPixmap, each one is busy until its
+   * PresentIdleNotify */
+  Pixmap       present_pixmaps[WUHOO_XPRESENT_PIXMAP_COUNT];
+  WuhooBoolean present_busy[WUHOO_XPRESENT_PIXMAP_COUNT];
+  int          present_index; /* The pixmap the next frame is drawn into */
+  WuhooBoolean present_stale; /* It misses the frame presented last */
+  WuhooSize    present_serial;
+  int          present_opcode;
+  WuhooBoolean has_present;
+#endif
+#ifdef WUHOO_XRENDER_ENABLE
+  Picture         render_window; /* Destination of every composite */
+  Picture         render_frame;  /* ARGB32 staging picture of the last blit */
+#ifdef WUHOO_XPRESENT_ENABLE
+  Picture         render_present[WUHOO_XPRESENT_PIXMAP_COUNT]; /* Of present_pixmaps */
+#endif
+  Pixmap          render_pixmap;
+  XImage*         render_image;  /* Premultiplied copy uploaded into render_pixmap */
+  GC              render_gc;
+#ifdef WUHOO_XSHM_ENABLE
+  XShmSegmentInfo render_shm_info; /* Backs render_image when attached */
+  WuhooBoolean    render_busy;     /* Still read by the server */
+#endif
+  WuhooBoolean    has_render;
 #endif
   int prev_x;
   int prev_y;
   int title_extents;
   int screen;
-  int red_offset, red_length;
-  int green_offset, green_length;
-  int blue_offset, blue_length;
+  int screen_width;  /* Root window size, kept up to date from ConfigureNotify */
+  int screen_height;
+  int red_length;
+  int green_length;
+  int blue_length;
   int bytes_per_pixel;
   int depth;
 
@@ -3881,6 +4798,8 @@ typedef struct
   Atom wmStateMaxVert;
   Atom wmStateFull;
   Atom wmStateHidden;
+  Atom wmName;
+  Atom utf8String;
 
   Atom XA_text_uri_list;
   Atom XA_text_uri;
@@ -3899,8 +4818,21 @@ typedef struct
   Atom XA_XdndReq;
   int  XdndVersion;
 
+  WuhooSize round_trips; /* Synchronous server round trips, see WuhooWindowRoundTripsGet */
 } WuhooWindowX11;
 
+/* Fails to compile if the X11 state outgrows WuhooWindow::memory */
+typedef char WuhooWindowX11SizeCheck
+  [(sizeof(WuhooWindowX11) <= WUHOO_PLATFORM_MEMORY_SIZE) ? 1 : -1];
+
+/* Accounts for requests that block until the server replies */
+#ifdef WUHOO_DEBUG
+#define WuhooRoundTripX11(window, count)                                      \
+  (((WuhooWindowX11*)(window)->platform_window)->round_trips += (count))
+#else
+#define WuhooRoundTripX11(window, count)
+#endif
+
 void*
 WuhooMalloc(size_t count)
 {
@@ -3919,13 +4851,54 @@ WuhooFree(void* mem)
   return WuhooSuccess;
 }
 
-WuhooResult
-_WuhooWindowRegionGetX11(WuhooWindow* window, int* posx, int* posy,
-                         WuhooSize* width, WuhooSize* height)
+/* Queries the frame origin and client size of the window, plus the size of
+ * the root window when screen_width is not WuhooNull */
+WuhooInternal void
+_WuhooWindowGeometryGetX11(WuhooWindow* window, int* posx, int* posy,
+                           int* width, int* height, int* screen_width,
+                           int* screen_height)
 {
   WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
-  WuhooResult     result     = WuhooSuccess;
 
+#ifdef WUHOO_XCB_ENABLE
+  /* Every request is in flight before the first reply is awaited, so the
+   * whole query costs a single round trip */
+  xcb_connection_t*         connection = x11_window->connection;
+  xcb_get_geometry_cookie_t root_cookie;
+  xcb_get_geometry_cookie_t geometry_cookie =
+    xcb_get_geometry(connection, x11_window->window);
+  xcb_translate_coordinates_cookie_t translate_cookie =
+    xcb_translate_coordinates(connection, x11_window->window, x11_window->root,
+                              0, 0);
+  if (WuhooNull != screen_width)
+    root_cookie = xcb_get_geometry(connection, x11_window->root);
+
+  WuhooRoundTripX11(window, 1);
+
+  xcb_get_geometry_reply_t* geometry =
+    xcb_get_geometry_reply(connection, geometry_cookie, WuhooNull);
+  xcb_translate_coordinates_reply_t* translate =
+    xcb_translate_coordinates_reply(connection, translate_cookie, WuhooNull);
+
+  if (WuhooNull != geometry && WuhooNull != translate) {
+    *posx   = translate->dst_x - geometry->x;
+    *posy   = translate->dst_y - geometry->y;
+    *width  = geometry->width;
+    *height = geometry->height;
+  }
+  free(geometry);
+  free(translate);
+
+  if (WuhooNull != screen_width) {
+    xcb_get_geometry_reply_t* root_geometry =
+      xcb_get_geometry_reply(connection, root_cookie, WuhooNull);
+    if (WuhooNull != root_geometry) {
+      *screen_width  = root_geometry->width;
+      *screen_height = root_geometry->height;
+    }
+    free(root_geometry);
+  }
+#else
   int               window_posx, window_posy;
   Window            child;
   XWindowAttributes xwa;
@@ -3933,15 +4906,88 @@ _WuhooWindowRegionGetX11(WuhooWindow* window, int* posx, int* posy,
                         x11_window->root, 0, 0, &window_posx, &window_posy,
                         &child);
   XGetWindowAttributes(x11_window->display, x11_window->window, &xwa);
+  WuhooRoundTripX11(window, 2);
+  *posx   = window_posx - xwa.x;
+  *posy   = window_posy - xwa.y;
+  *width  = xwa.width;
+  *height = xwa.height;
+
+  if (WuhooNull != screen_width) {
+    Window       root;
+    int          root_x, root_y;
+    unsigned int root_width, root_height, root_border_width, root_depth;
+    WuhooRoundTripX11(window, 1);
+    if (XGetGeometry(x11_window->display, x11_window->root, &root, &root_x,
+                     &root_y, &root_width, &root_height, &root_border_width,
+                     &root_depth)) {
+      *screen_width  = root_width;
+      *screen_height = root_height;
+    }
+  }
+#endif
+}
+
+/* Interns every atom of the table, with WUHOO_XCB_ENABLE in one round trip */
+typedef struct
+{
+  const char* name;
+  Bool        only_if_exists;
+  Atom*       atom;
+} WuhooAtomRequestX11;
+
+WuhooInternal void
+_WuhooInternAtomsX11(WuhooWindow* window, WuhooAtomRequestX11 const* requests,
+                     int count)
+{
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+  int             i          = 0;
+
+#ifdef WUHOO_XCB_ENABLE
+  xcb_intern_atom_cookie_t cookies[32];
+
+  count = WuhooMini(count, (int)(sizeof(cookies) / sizeof(cookies[0])));
+
+  for (i = 0; i < count; i++) {
+    cookies[i] = xcb_intern_atom(
+      x11_window->connection, (True == requests[i].only_if_exists) ? 1 : 0,
+      (uint16_t)WuhooStringLength(requests[i].name, 256), requests[i].name);
+  }
+
+  WuhooRoundTripX11(window, 1);
+
+  for (i = 0; i < count; i++) {
+    xcb_intern_atom_reply_t* reply =
+      xcb_intern_atom_reply(x11_window->connection, cookies[i], WuhooNull);
+    *requests[i].atom = (WuhooNull != reply) ? reply->atom : None;
+    free(reply);
+  }
+#else
+  WuhooRoundTripX11(window, count);
+
+  for (i = 0; i < count; i++) {
+    *requests[i].atom = XInternAtom(x11_window->display, requests[i].name,
+                                    requests[i].only_if_exists);
+  }
+#endif
+}
+
+WuhooResult
+_WuhooWindowRegionGetX11(WuhooWindow* window, int* posx, int* posy,
+                         WuhooSize* width, WuhooSize* height)
+{
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+  WuhooResult     result     = WuhooSuccess;
+
+  /* Kept up to date from ConfigureNotify */
   if (WuhooNull != posx)
-    *posx = window_posx - xwa.x;
+    *posx = window->x;
   if (WuhooNull != posy)
-    *posy = window_posy - xwa.y;
+    *posy = window->y;
 
   if (WuhooNull != width)
-    *width = xwa.width;
+    *width = window->cwidth;
   if (WuhooNull != height)
-    *height = xwa.height + x11_window->title_extents;
+    *height = window->cheight + x11_window->title_extents;
 
   return result;
 }
@@ -3950,21 +4996,13 @@ WuhooResult
 _WuhooWindowClientRegionGetX11(WuhooWindow* window, int* posx, int* posy,
                                WuhooSize* width, WuhooSize* height)
 {
-  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
-  WuhooResult     result     = WuhooSuccess;
-
-  int               window_posx, window_posy;
-  Window            child;
-  XWindowAttributes xwa;
-  XTranslateCoordinates(x11_window->display, x11_window->window,
-                        x11_window->root, 0, 0, &window_posx, &window_posy,
-                        &child);
-  XGetWindowAttributes(x11_window->display, x11_window->window, &xwa);
-  *posx = window_posx - xwa.x;
-  *posy = window_posy - xwa.y;
+  WuhooResult result = WuhooSuccess;
 
-  *width  = xwa.width;
-  *height = xwa.height;
+  /* Kept up to date from ConfigureNotify */
+  *posx   = window->x;
+  *posy   = window->y;
+  *width  = window->cwidth;
+  *height = window->cheight;
 
   return result;
 }
@@ -4011,1563 +5049,8484 @@ _WuhooErrorHandleX11(Display* display, XErrorEvent* error)
   return 0;
 }
 
-WuhooInternal void
+WuhooMaybeUnused WuhooInternal void
 _WuhooTrapErrorsX11(void)
 {
   wuhoo_TrappedErrorCode = 0;
   wuhoo_OldErrorHandle   = XSetErrorHandler(_WuhooErrorHandleX11);
 }
 
-WuhooInternal int
+WuhooMaybeUnused WuhooInternal int
 _WuhooUntrapErrorsX11(void)
 {
   XSetErrorHandler(wuhoo_OldErrorHandle);
   return wuhoo_TrappedErrorCode;
 }
 
-WuhooResult
-_WuhooWindowBlitX11(WuhooWindow* window, WuhooRGBA* pixels, WuhooSize x,
-                    WuhooSize y, WuhooSize width, WuhooSize height)
+#ifdef WUHOO_XSHM_ENABLE
+/* Creates a MIT-SHM backed XImage. Returns WuhooNull if the server
+ * cannot attach the segment (e.g. a remote display that still
+ * advertises the extension)
+ */
+WuhooInternal XImage*
+_WuhooWindowImageCreateShmX11(WuhooWindow* window, XShmSegmentInfo* shm_info,
+                              int width, int height, int depth)
 {
   WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
-  WuhooResult     result     = WuhooSuccess;
-
-#ifdef WUHOO_OPENGL_ENABLE
-  if (WUHOO_FLAG_OPENGL & window->flags) {
-    glXSwapBuffers(x11_window->display, x11_window->window);
+  XImage*         image      = WuhooNull;
 
-    return WuhooSuccess;
+  image = XShmCreateImage(x11_window->display, x11_window->visual, depth,
+                          ZPixmap, WuhooNull, shm_info, width, height);
+  if (WuhooNull == image) {
+    return WuhooNull;
   }
-#endif
 
-  if (WUHOO_WINDOW_FLAG_CLOSED & window->window_flags ||
-      WUHOO_WINDOW_FLAG_RESIZED & window->window_flags ||
-      WUHOO_WINDOW_FLAG_REGION_UPDATED & window->window_flags) {
-    /* If important window states have not been handled yet
-     * don not proceed with blitting because this might
-     * cause inconcistent behaviors. **REVISIT**
-     */
-    return WuhooSuccess;
+  shm_info->shmid = shmget(IPC_PRIVATE, image->bytes_per_line * image->height,
+                           IPC_CREAT | 0600);
+  if (shm_info->shmid < 0) {
+    XDestroyImage(image);
+    return WuhooNull;
   }
 
-  Window       root;
-  unsigned int screen_depth;
-  int          screen_x;
-  int          screen_y;
-  unsigned int screen_width;
-  unsigned int screen_height;
-  unsigned int screen_border_width;
-
-  if (XGetGeometry(x11_window->display, x11_window->root, &root, &screen_x,
-                   &screen_y, &screen_width, &screen_height,
-                   &screen_border_width, &screen_depth) == False) {
+  shm_info->shmaddr = (char*)shmat(shm_info->shmid, WuhooNull, 0);
+  if ((char*)-1 == shm_info->shmaddr) {
+    shmctl(shm_info->shmid, IPC_RMID, WuhooNull);
+    shm_info->shmaddr = WuhooNull;
+    XDestroyImage(image);
+    return WuhooNull;
   }
-  int               ax, ay;
-  Window            child;
-  XWindowAttributes xwa;
-  XTranslateCoordinates(x11_window->display, x11_window->window,
-                        x11_window->root, 0, 0, &ax, &ay, &child);
-  XGetWindowAttributes(x11_window->display, x11_window->window, &xwa);
-  window->x = ax - xwa.x;
-  window->y = ay - xwa.y;
-
-  window->cwidth  = xwa.width;
-  window->cheight = xwa.height;
 
-  window->width  = window->cwidth;
-  window->height = window->cheight + x11_window->title_extents;
+  image->data        = shm_info->shmaddr;
+  shm_info->readOnly = False;
 
-  int valid_width  = screen_width - window->x;
-  int valid_height = screen_height - x11_window->title_extents - window->y;
-
-  valid_width  = WuhooMini(valid_width, width);
-  valid_height = WuhooMini(valid_height, height);
-  
-  /* https://stackoverflow.com/questions/43442675/how-to-use-xshmgetimage-and-xshmputimage
-   */
-  XImage* image = WuhooNull;
   _WuhooTrapErrorsX11();
-  image = XGetImage(x11_window->display, x11_window->window, x, y, valid_width,
-                    valid_height, AllPlanes, ZPixmap);
+  XShmAttach(x11_window->display, shm_info);
+  XSync(x11_window->display, False);
+  WuhooRoundTripX11(window, 1);
   int trapped_error = _WuhooUntrapErrorsX11();
 
-  if (trapped_error == BadMatch) {
-    return (WuhooResult) "Invalid Region";
-  }
+  /* The segment is released as soon as both sides detach */
+  shmctl(shm_info->shmid, IPC_RMID, WuhooNull);
 
-  if (WuhooNull == image) {
-    return (WuhooResult) "Failed to get a valid draw region";
+  if (0 != trapped_error) {
+    shmdt(shm_info->shmaddr);
+    shm_info->shmaddr = WuhooNull;
+    image->data       = WuhooNull;
+    XDestroyImage(image);
+    return WuhooNull;
   }
 
-  window->convert_rgba(image->data, pixels, x, y, valid_width, valid_height,
-                       width, height);
+  return image;
+}
 
-  XPutImage(x11_window->display, x11_window->window, x11_window->gc, image, 0,
-            0, x, y, valid_width, valid_height);
+/* Marks the buffer of a finished XShmPutImage as free */
+WuhooInternal void
+_WuhooWindowShmCompleteX11(WuhooWindow* window, XShmCompletionEvent* event)
+{
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
 
-  XDestroyImage(image);
+#ifdef WUHOO_XRENDER_ENABLE
+  if (x11_window->render_shm_info.shmseg == event->shmseg &&
+      WuhooTrue == x11_window->render_busy) {
+    x11_window->render_busy = WuhooFalse;
+    return;
+  }
+#endif
 
-  return result;
+  int index = 0;
+  for (index = 0; index < x11_window->shm_count; index++) {
+    if (x11_window->shm_info[index].shmseg == event->shmseg &&
+        WuhooTrue == x11_window->shm_busy[index]) {
+      x11_window->shm_busy[index] = WuhooFalse;
+      x11_window->frames_in_flight--;
+      return;
+    }
+  }
 }
 
-WuhooResult
-_WuhooWindowDestroyX11(WuhooWindow* window)
+/* Retires every completion that already reached the client, never blocks */
+WuhooInternal void
+_WuhooWindowShmRetireX11(WuhooWindow* window)
 {
   WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
-  WuhooResult     result     = WuhooSuccess;
+  XEvent          xevent;
 
-  if (None != x11_window->gc) {
-    XFreeGC(x11_window->display, x11_window->gc);
-    x11_window->gc = None;
-  }
+  if (0 == x11_window->frames_in_flight)
+    return;
 
-  if (None != x11_window->window) {
-    XUnmapWindow(x11_window->display, x11_window->window);
-    XDestroyWindow(x11_window->display, x11_window->window);
-    x11_window->window = None;
-  }
-  if (None != x11_window->display) {
-    XCloseDisplay(x11_window->display);
-    x11_window->display = None;
+  while (True == XCheckTypedEvent(x11_window->display,
+                                  x11_window->shm_completion_type, &xevent)) {
+    _WuhooWindowShmCompleteX11(window, (XShmCompletionEvent*)&xevent);
   }
-
-  return result;
 }
 
-WuhooResult
-_WuhooWindowSetTitleX11(WuhooWindow* window, const char* title)
+WuhooInternal Bool
+_WuhooShmCompletionPredicateX11(Display* display, XEvent* xevent, XPointer arg)
 {
-  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
-  WuhooResult     result     = WuhooSuccess;
-  XChangeProperty( x11_window->display, x11_window->window,
-                   XInternAtom(x11_window->display, "_NET_WM_NAME", False),
-                   XInternAtom(x11_window->display, "UTF8_STRING", False),
-                   8, PropModeReplace, (unsigned char *) title,
-                   WuhooStringLength(title, WUHOO_MAX_TITLE_LENGTH));
+  WuhooUnused(display);
 
-  return result;
+  return (xevent->type == ((WuhooWindowX11*)arg)->shm_completion_type) ? True
+                                                                       : False;
 }
+#endif
 
-WuhooInternal WuhooResult
-_WuhooWindowExtentsX11(WuhooWindow* window)
+/* Blocks until the server is done with one of the shared buffers. This
+ * waits for an event that is already on its way, not for a round trip */
+WuhooInternal void
+_WuhooWindowShmWaitX11(WuhooWindow* window)
 {
+#ifdef WUHOO_XSHM_ENABLE
   WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
-  WuhooResult     result     = WuhooSuccess;
-
-  Display* d;
-  Window   w;
-  int      s;
+  XEvent          xevent;
 
-  d = XOpenDisplay(NULL);
-  if (d == NULL) {
-    return WuhooSuccess;
-  }
+  if (0 == x11_window->frames_in_flight)
+    return;
 
-  s = DefaultScreen(d);
-  w = XCreateSimpleWindow(d, RootWindow(d, s), 0, 0, 1, 1, 1, BlackPixel(d, s),
-                          WhitePixel(d, s));
-  XSelectInput(d, w, ExposureMask | KeyPressMask);
-  XMapWindow(d, w);
+  XIfEvent(x11_window->display, &xevent, &_WuhooShmCompletionPredicateX11,
+           (XPointer)x11_window);
+  _WuhooWindowShmCompleteX11(window, (XShmCompletionEvent*)&xevent);
+#else
+  WuhooUnused(window);
+#endif
+}
 
-  /* Extended Window Manager Hints */
-  /* https://specifications.freedesktop.org/wm-spec/wm-spec-latest.html#idm140200472552416
-   */
+/* Points x11_window->image at a buffer that the server is not reading from.
+ * Shared buffers are added on demand up to WUHOO_XSHM_BUFFER_COUNT, returns
+ * WuhooFalse if all of them are still in flight
+ */
+WuhooInternal WuhooBoolean
+_WuhooWindowImageAcquireX11(WuhooWindow* window)
+{
+  WuhooMaybeUnused WuhooWindowX11* x11_window =
+    (WuhooWindowX11*)window->platform_window;
+
+#ifdef WUHOO_XSHM_ENABLE
+  if (0 == x11_window->shm_count)
+    return WuhooTrue;
+
+  _WuhooWindowShmRetireX11(window);
+
+  int offset = 0;
+  for (offset = 0; offset < x11_window->shm_count; offset++) {
+    int index = (x11_window->shm_index + offset) % x11_window->shm_count;
+    if (WuhooFalse == x11_window->shm_busy[index]) {
+      x11_window->shm_index = index;
+      x11_window->image     = x11_window->shm_images[index];
+      return WuhooTrue;
+    }
+  }
 
-  Atom a, t;
+  if (x11_window->shm_count < WUHOO_XSHM_BUFFER_COUNT) {
+    int     index = x11_window->shm_count;
+    XImage* image = _WuhooWindowImageCreateShmX11(
+      window, &x11_window->shm_info[index], x11_window->image->width,
+      x11_window->image->height, x11_window->depth);
+    if (WuhooNull != image) {
+      x11_window->shm_images[index] = image;
+      x11_window->shm_busy[index]   = WuhooFalse;
+      x11_window->shm_index         = index;
+      x11_window->shm_count++;
+      x11_window->image = image;
+      return WuhooTrue;
+    }
+  }
 
-  int            f;
-  unsigned char* data = 0;
-  long*          extents;
-  XEvent         e;
-  unsigned long  n, b;
+  return WuhooFalse;
+#else
+  return WuhooTrue;
+#endif
+}
 
-  a = XInternAtom(d, "_NET_FRAME_EXTENTS", True); /* Property to check */
+WuhooInternal void
+_WuhooWindowImageDestroyX11(WuhooWindow* window)
+{
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
 
-  /* Window manager doesn't set up the extents immediately */
-  /* Wait until they are set up and there are 4 of them */
-  while (XGetWindowProperty(d, w, a, 0, 4, False, AnyPropertyType, &t, &f, &n,
-                            &b, &data) != Success ||
-         n != 4 || b != 0) {
-    XNextEvent(d, &e);
+#ifdef WUHOO_XPRESENT_ENABLE
+  int present = 0;
+  for (present = 0; present < WUHOO_XPRESENT_PIXMAP_COUNT; present++) {
+#ifdef WUHOO_XRENDER_ENABLE
+    if (None != x11_window->render_present[present]) {
+      XRenderFreePicture(x11_window->display,
+                         x11_window->render_present[present]);
+      x11_window->render_present[present] = None;
+    }
+#endif
+
+    if (None != x11_window->present_pixmaps[present]) {
+      XFreePixmap(x11_window->display, x11_window->present_pixmaps[present]);
+      x11_window->present_pixmaps[present] = None;
+    }
+    x11_window->present_busy[present] = WuhooFalse;
   }
-  
-  /* OK got extents */
-  if(WuhooNull != data) {
-    extents = (long*)data;
-    x11_window->title_extents = extents[2];
-    XFree(data);
+  x11_window->present_index = 0;
+  x11_window->present_stale = WuhooFalse;
+#endif
+
+  if (WuhooNull == x11_window->image)
+    return;
+
+#ifdef WUHOO_XSHM_ENABLE
+  if (0 != x11_window->shm_count) {
+    /* Detaching is ordered after any upload that is still in flight */
+    int index = 0;
+    for (index = 0; index < x11_window->shm_count; index++) {
+      XShmSegmentInfo* shm_info = &x11_window->shm_info[index];
+      XShmDetach(x11_window->display, shm_info);
+      shmdt(shm_info->shmaddr);
+      shm_info->shmaddr = WuhooNull;
+      /* Keep XDestroyImage from free-ing the shared segment */
+      x11_window->shm_images[index]->data = WuhooNull;
+      XDestroyImage(x11_window->shm_images[index]);
+      x11_window->shm_images[index] = WuhooNull;
+      x11_window->shm_busy[index]   = WuhooFalse;
+    }
+    x11_window->shm_count        = 0;
+    x11_window->shm_index        = 0;
+    x11_window->frames_in_flight = 0;
+    x11_window->image            = WuhooNull;
+    return;
   }
-  XCloseDisplay(d);
+#endif
 
-  return result;
+  if (WuhooNull != x11_window->image_data) {
+    munmap(x11_window->image_data,
+           x11_window->image->bytes_per_line * x11_window->image->height);
+    x11_window->image_data = WuhooNull;
+    x11_window->image->data = WuhooNull;
+  }
+
+  XDestroyImage(x11_window->image);
+  x11_window->image = WuhooNull;
 }
 
-WuhooResult
-_WuhooWindowCreateX11(WuhooWindow* window, int posx, int posy, WuhooSize width,
-                      WuhooSize height, const char* title, WuhooFlags flags)
+/* (Re)creates the persistent presentation image so that it matches
+ * the client area of the window
+ */
+WuhooInternal WuhooResult
+_WuhooWindowImageCreateX11(WuhooWindow* window, int width, int height)
 {
-  WuhooWindowX11*      x11_window = (WuhooWindowX11*)WuhooNull;
-  WuhooResult          result     = WuhooSuccess;
-  Colormap             cmap;
-  XSetWindowAttributes swa;
-  XWindowAttributes    gwa;
-  int                  depth;
-
-  x11_window              = (WuhooWindowX11*)&window->memory[0];
-  window->platform_window = x11_window;
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+  XImage*         image      = WuhooNull;
+  void*           image_data = WuhooNull;
 
-  _WuhooWindowExtentsX11(window);
+  _WuhooWindowImageDestroyX11(window);
 
-  /* fallback to LC_CTYPE in env */
-  setlocale(LC_CTYPE, "");
-  /* implementation-dependent behavior, on my machine it defaults to
-   * XMODIFIERS in env */
+  if (width <= 0 || height <= 0) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING " : Invalid image size";
+  }
 
-  if (XSetLocaleModifiers("") == NULL) {
-    return (WuhooResult)WUHOO_PLATFORM_API_STRING
-      " : XSetLocaleModifiers failed";
+#ifdef WUHOO_XPRESENT_ENABLE
+  int present = 0;
+  for (present = 0; WuhooTrue == x11_window->has_present &&
+                    present < WUHOO_XPRESENT_PIXMAP_COUNT;
+       present++) {
+    x11_window->present_pixmaps[present] =
+      XCreatePixmap(x11_window->display, x11_window->window, width, height,
+                    x11_window->depth);
   }
+#endif
 
-  x11_window->display = XOpenDisplay(WuhooNull);
+#ifdef WUHOO_XSHM_ENABLE
+  if (WuhooTrue == x11_window->has_shm) {
+    x11_window->image = _WuhooWindowImageCreateShmX11(
+      window, &x11_window->shm_info[0], width, height, x11_window->depth);
+    if (WuhooNull != x11_window->image) {
+      /* More buffers are only added once frames are submitted asynchronously */
+      x11_window->shm_images[0] = x11_window->image;
+      x11_window->shm_count     = 1;
+      return WuhooSuccess;
+    }
 
-  if (WuhooNull == x11_window->display) { 
-    return (WuhooResult)WUHOO_PLATFORM_API_STRING
-      " : XOpenDisplay failed";
+    /* MIT-SHM is not usable on this display, stop trying */
+    x11_window->has_shm = WuhooFalse;
   }
+#endif
 
-  x11_window->root = DefaultRootWindow(x11_window->display);
-  if (0 == x11_window->root) { 
+  /* Client side image, reused by every blit until the next resize */
+  image = XCreateImage(x11_window->display, x11_window->visual,
+                       x11_window->depth, ZPixmap, 0, WuhooNull, width, height,
+                       32, 0);
+  if (WuhooNull == image) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING " : XCreateImage failed";
+  }
+
+  image_data = WuhooMalloc(image->bytes_per_line * image->height);
+  if (MAP_FAILED == image_data) {
+    XDestroyImage(image);
     return (WuhooResult)WUHOO_PLATFORM_API_STRING
-      " : DefaultRootWindow failed";
+      " : Failed to allocate the presentation image";
   }
 
-  /* By default, assume 24-bit RGB */
-  x11_window->red_offset = 0;
-  x11_window->red_length = 8;
+  image->data            = (char*)image_data;
+  x11_window->image_data = (unsigned char*)image_data;
+  x11_window->image      = image;
 
-  x11_window->green_offset = 8;
-  x11_window->green_length = 8;
+  return WuhooSuccess;
+}
 
-  x11_window->blue_offset = 16;
-  x11_window->blue_length = 8;
+/* Converts the src_width x src_height region of pixels at (src_x, src_y)
+ * into the dst_width x dst_height block of the image at (x, y), scaling if
+ * needed. Only the visible part, clip_width x clip_height, is written.
+ * pitch is the number of pixels in a source row.
+ */
+WuhooInternal void
+_WuhooWindowImageConvertX11(WuhooWindow* window, WuhooConvertStage const* stage,
+                            XImage* image, WuhooRGBA const* pixels,
+                            WuhooSize src_x, WuhooSize src_y, WuhooSize pitch,
+                            WuhooSize src_width, WuhooSize src_height, int x,
+                            int y, int dst_width, int dst_height,
+                            int clip_width, int band_y, int band_height)
+{
+  int   bytes_per_pixel = image->bits_per_pixel / 8;
+  char* dst = image->data + y * image->bytes_per_line + x * bytes_per_pixel;
 
-  x11_window->bytes_per_pixel = 24 / 8;
+  WuhooConvertScaled(window, stage, dst, image->bytes_per_line,
+                     bytes_per_pixel, pixels, src_x, src_y, pitch, src_width,
+                     src_height, dst_width, dst_height, clip_width, band_y,
+                     band_height);
+}
 
-  int fbfd = open("/dev/fb0", O_RDWR);
-  if (fbfd >= 0) {
-    struct fb_var_screeninfo vinfo;
-    ioctl(fbfd, FBIOGET_VSCREENINFO, &vinfo);
-    x11_window->red_offset = vinfo.red.offset;
-    x11_window->red_length = vinfo.red.length;
+/* Rows per band of an upload that goes over the socket. Bands stay below the
+ * maximum request size and WUHOO_UPLOAD_BAND_SIZE, so that the server reads
+ * band N while band N + 1 is converted. Shared images are sent whole */
+WuhooInternal int
+_WuhooWindowImageBandRowsX11(WuhooWindow* window, int width, int height)
+{
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
 
-    x11_window->green_offset = vinfo.green.offset;
-    x11_window->green_length = vinfo.green.length;
+#ifdef WUHOO_XSHM_ENABLE
+  if (0 != x11_window->shm_count)
+    return height;
+#endif
 
-    x11_window->blue_offset = vinfo.blue.offset;
-    x11_window->blue_length = vinfo.blue.length;
+  /* Rows are padded to 32 bits on the wire */
+  WuhooSize row_bytes =
+    ((WuhooSize)width * x11_window->image->bits_per_pixel + 31) / 32 * 4;
+  WuhooSize band_bytes = WUHOO_UPLOAD_BAND_SIZE;
+  if (band_bytes > x11_window->max_request_bytes)
+    band_bytes = x11_window->max_request_bytes;
 
-    x11_window->bytes_per_pixel = vinfo.bits_per_pixel / 8;
-    x11_window->depth           = vinfo.bits_per_pixel;
+  if (0 == row_bytes || band_bytes < row_bytes)
+    return 1;
 
-    close(fbfd);
-  }
+  return (int)WuhooMini(height, (int)(band_bytes / row_bytes));
+}
 
-#ifdef WUHOO_OPENGL_ENABLE
-  window->gl_framebuffer.depthBits;
-  window->gl_framebuffer.redBits        = x11_window->red_length;
-  window->gl_framebuffer.greenBits      = x11_window->green_length;
-  window->gl_framebuffer.blueBits       = x11_window->blue_length;
-  window->gl_framebuffer.accumRedBits   = x11_window->red_length;
-  window->gl_framebuffer.accumGreenBits = x11_window->green_length;
-  window->gl_framebuffer.accumBlueBits  = x11_window->blue_length;
+/* Clips a region against the presentation image, returns WuhooFalse
+ * if nothing is left to present
+ */
+WuhooInternal WuhooBoolean
+_WuhooWindowImageClipX11(XImage* image, int x, int y, int* width, int* height)
+{
+  *width  = WuhooMini(*width, image->width - x);
+  *height = WuhooMini(*height, image->height - y);
 
-  int gl_index = 0;
+  return (*width > 0 && *height > 0) ? WuhooTrue : WuhooFalse;
+}
 
-  GLint gl_attrs[32];
-  gl_attrs[gl_index++] = GLX_RGBA;
-  gl_attrs[gl_index++] = GLX_DEPTH_SIZE;
-  gl_attrs[gl_index++] = window->gl_framebuffer.depthBits;
-  gl_attrs[gl_index++] = GLX_STENCIL_SIZE;
-  gl_attrs[gl_index++] = window->gl_framebuffer.stencilBits;
-  gl_attrs[gl_index++] = GLX_RED_SIZE;
-  gl_attrs[gl_index++] = window->gl_framebuffer.redBits;
-  gl_attrs[gl_index++] = GLX_GREEN_SIZE;
-  gl_attrs[gl_index++] = window->gl_framebuffer.greenBits;
-  gl_attrs[gl_index++] = GLX_BLUE_SIZE;
-  gl_attrs[gl_index++] = window->gl_framebuffer.blueBits;
-  gl_attrs[gl_index++] = GLX_ALPHA_SIZE;
-  gl_attrs[gl_index++] = window->gl_framebuffer.alphaBits;
-  gl_attrs[gl_index++] = GLX_ACCUM_RED_SIZE;
-  gl_attrs[gl_index++] = window->gl_framebuffer.accumRedBits;
-  gl_attrs[gl_index++] = GLX_ACCUM_GREEN_SIZE;
-  gl_attrs[gl_index++] = window->gl_framebuffer.accumGreenBits;
-  gl_attrs[gl_index++] = GLX_ACCUM_BLUE_SIZE;
-  gl_attrs[gl_index++] = window->gl_framebuffer.accumBlueBits;
-  gl_attrs[gl_index++] = GLX_ACCUM_ALPHA_SIZE;
-  gl_attrs[gl_index++] = window->gl_framebuffer.accumAlphaBits;
-  if (WuhooTrue == window->gl_framebuffer.doublebuffer)
-    gl_attrs[gl_index++] = GLX_DOUBLEBUFFER;
-  if (WuhooTrue == window->gl_framebuffer.stereo)
-    gl_attrs[gl_index++] = GLX_STEREO;
-  gl_attrs[gl_index++] = None;
-#endif
+/* Returns the index of the last rect with something left to present after
+ * clipping, count if there is none. Its upload is the one that is fenced */
+WuhooInternal WuhooSize
+_WuhooWindowImageLastRectX11(XImage* image, WuhooRect const* rects,
+                             WuhooSize count)
+{
+  WuhooSize index = count;
+  while (index-- > 0) {
+    int width  = rects[index].width;
+    int height = rects[index].height;
+
+    if (WuhooTrue == _WuhooWindowImageClipX11(image, rects[index].x,
+                                              rects[index].y, &width,
+                                              &height)) {
+      return index;
+    }
+  }
 
-  int bytes_per_pixel = x11_window->bytes_per_pixel;
+  return count;
+}
 
-  int screen_num     = DefaultScreen(x11_window->display);
-  x11_window->screen = screen_num;
+#ifdef WUHOO_XPRESENT_ENABLE
+/* Returns WuhooTrue if one of the rects covers the whole image */
+WuhooInternal WuhooBoolean
+_WuhooWindowImageCoveredX11(XImage* image, WuhooRect const* rects,
+                            WuhooSize count)
+{
+  WuhooSize index = 0;
+  for (index = 0; index < count; index++) {
+    if (0 == rects[index].x && 0 == rects[index].y &&
+        rects[index].width >= (WuhooSize)image->width &&
+        rects[index].height >= (WuhooSize)image->height) {
+      return WuhooTrue;
+    }
+  }
 
-#ifdef WUHOO_OPENGL_ENABLE
-  XVisualInfo* vi;
+  return WuhooFalse;
+}
 
-  vi    = glXChooseVisual(x11_window->display, 0, gl_attrs);
-  cmap  = XCreateColormap(x11_window->display, x11_window->root, vi->visual,
-                         AllocNone);
-  depth = vi->depth;
-  x11_window->visual = vi->visual;
-#else
-  x11_window->visual = DefaultVisual(x11_window->display, x11_window->screen);
-  cmap               = XCreateColormap(x11_window->display, x11_window->root,
-                         x11_window->visual, AllocNone);
-  depth              = DefaultDepth(x11_window->display, x11_window->screen);
-#endif
+/* Marks the pixmap the server stopped reading as free */
+WuhooInternal void
+_WuhooWindowPresentIdleX11(WuhooWindow* window, XPresentIdleNotifyEvent* idle)
+{
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
 
-  if (WuhooNull == x11_window->visual) {
-    return (WuhooResult)WUHOO_PLATFORM_API_STRING
-      " : Failed to create appropriate visual";
+  int index = 0;
+  for (index = 0; index < WUHOO_XPRESENT_PIXMAP_COUNT; index++) {
+    if (x11_window->present_pixmaps[index] == idle->pixmap)
+      x11_window->present_busy[index] = WuhooFalse;
   }
+}
 
-  if (x11_window->red_offset == 11 && x11_window->green_offset == 5 &&
-      x11_window->blue_offset == 0) {
-    window->convert_rgba = &WuhooConvertRGBAtoR5G6B5;
-  } else if (x11_window->red_offset == 16 && x11_window->green_offset == 8 &&
-      x11_window->blue_offset == 0) {
-    window->convert_rgba = &WuhooConvertRGBAtoBGRA;
-  } else {
-    window->convert_rgba = &WuhooConvertRGBAtoRGBA;
-  }
+WuhooInternal Bool
+_WuhooPresentIdlePredicateX11(Display* display, XEvent* xevent, XPointer arg)
+{
+  WuhooUnused(display);
 
-  XSetWindowAttributes setwinattr;
-  setwinattr.override_redirect   = False;
-  setwinattr.border_pixel   = 0;
-  setwinattr.colormap   = cmap;
-  setwinattr.event_mask = StructureNotifyMask | FocusChangeMask | ExposureMask |
-                          KeyPressMask | KeyReleaseMask | ButtonPressMask |
-                          ButtonReleaseMask | PointerMotionMask;
+  return (GenericEvent == xevent->type &&
+          xevent->xcookie.extension == ((WuhooWindowX11*)arg)->present_opcode &&
+          PresentIdleNotify == xevent->xcookie.evtype)
+           ? True
+           : False;
+}
 
-  /* Get geometry information about root window */
-  Window       root;
-  int          screen_x, screen_y;
-  unsigned int screen_width, screen_height, border_width, root_depth;
-  if (XGetGeometry(x11_window->display, x11_window->root, &root, &screen_x,
-                   &screen_y, &screen_width, &screen_height, &border_width,
-                   &root_depth) == False) {
+/* Handles the PresentIdleNotify events that already reached the client,
+ * never blocks */
+WuhooInternal void
+_WuhooWindowPresentRetireX11(WuhooWindow* window)
+{
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+  XEvent          xevent;
+
+  while (True == XCheckIfEvent(x11_window->display, &xevent,
+                               &_WuhooPresentIdlePredicateX11,
+                               (XPointer)x11_window)) {
+    if (True == XGetEventData(x11_window->display, &xevent.xcookie)) {
+      _WuhooWindowPresentIdleX11(
+        window, (XPresentIdleNotifyEvent*)xevent.xcookie.data);
+      XFreeEventData(x11_window->display, &xevent.xcookie);
+    }
   }
+}
 
-  window->x =
-    (WuhooDefaultPosition != posx) ? posx : ((screen_width / 2) - (width / 2));
-  window->y = (WuhooDefaultPosition != posy)
-                ? posy
-                : ((screen_height / 2) - (height / 2));
+/* Returns the pixmap the next frame is drawn into, None if async is set
+ * and the server still reads it. Otherwise it is waited for, but at most
+ * WUHOO_XPRESENT_IDLE_TIMEOUT ms so that a lost PresentIdleNotify cannot
+ * hang the caller. Unless the frame covers the whole window the pixmap is
+ * brought up to date with the frame that was presented last */
+WuhooInternal Pixmap
+_WuhooWindowPresentAcquireX11(WuhooWindow* window, WuhooBoolean covered,
+                              WuhooBoolean async)
+{
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+  int             index      = x11_window->present_index;
+  struct pollfd   connection = { 0, POLLIN, 0 };
+  struct timespec start, now;
 
-  window->width  = width;
-  window->height = height;
-  window->height +=
-    (WUHOO_FLAG_CLIENT_REGION & flags) ? x11_window->title_extents : 0;
+  _WuhooWindowPresentRetireX11(window);
 
-  window->cwidth = window->width;
-  window->cheight =
-    window->height -
-    ((WUHOO_FLAG_CLIENT_REGION & flags) ? x11_window->title_extents : 0);
-  x11_window->window =
-    XCreateWindow(x11_window->display, x11_window->root, window->x, window->y,
-                  window->cwidth, window->cheight, 0, depth, InputOutput,
-                  x11_window->visual, CWBorderPixel | CWColormap | CWEventMask | CWOverrideRedirect, &setwinattr);
-  
-  if (0 == x11_window->window) {
-    return (WuhooResult)WUHOO_PLATFORM_API_STRING
-      " : XCreateWindow failed";
+  if (WuhooTrue == x11_window->present_busy[index]) {
+    if (WuhooTrue == async)
+      return None;
+
+    connection.fd = ConnectionNumber(x11_window->display);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while (WuhooTrue == x11_window->present_busy[index]) {
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      long elapsed = (now.tv_sec - start.tv_sec) * 1000 +
+                     (now.tv_nsec - start.tv_nsec) / 1000000;
+      if (elapsed >= WUHOO_XPRESENT_IDLE_TIMEOUT) {
+        x11_window->present_busy[index] = WuhooFalse;
+        break;
+      }
+
+      poll(&connection, 1, (int)(WUHOO_XPRESENT_IDLE_TIMEOUT - elapsed));
+      _WuhooWindowPresentRetireX11(window);
+    }
   }
 
-#ifdef WUHOO_OPENGL_ENABLE
-  x11_window->glc = glXCreateContext(x11_window->display, vi, NULL, GL_TRUE);
-  if (WuhooNull == x11_window->glc) {
-    return (WuhooResult)WUHOO_PLATFORM_API_STRING
-      " : glXCreateContext failed";
+  if (WuhooTrue == x11_window->present_stale) {
+    int last = (index + WUHOO_XPRESENT_PIXMAP_COUNT - 1) %
+               WUHOO_XPRESENT_PIXMAP_COUNT;
+    if (WuhooFalse == covered) {
+      XCopyArea(x11_window->display, x11_window->present_pixmaps[last],
+                x11_window->present_pixmaps[index], x11_window->gc, 0, 0,
+                x11_window->image->width, x11_window->image->height, 0, 0);
+    }
+    x11_window->present_stale = WuhooFalse;
   }
-  glXMakeCurrent(x11_window->display, x11_window->window, x11_window->glc);
+
+  return x11_window->present_pixmaps[index];
+}
 #endif
 
-  if (WUHOO_FLAG_TITLED & flags)
-    XSetStandardProperties(x11_window->display, x11_window->window, title, title,
-                           None, NULL, 0, NULL);
+/* Queues the upload of a region of the presentation image, the caller
+ * is responsible for flushing and for acquiring the Present pixmap first.
+ * With fence set the shared buffer stays busy until the server reports
+ * that it has read it.
+ */
+WuhooInternal void
+_WuhooWindowImagePutX11(WuhooWindow* window, int x, int y, int width,
+                        int height, WuhooBoolean fence)
+{
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+  Drawable        drawable   = x11_window->window;
 
-  XSelectInput(x11_window->display, x11_window->window,
-               StructureNotifyMask | FocusChangeMask | ExposureMask |
-                 KeyPressMask | KeyReleaseMask | ButtonPressMask |
-                 ButtonReleaseMask | PointerMotionMask);
-  XSetWindowBorder(x11_window->display, x11_window->window, 1);
+#ifdef WUHOO_XPRESENT_ENABLE
+  /* Frames are presented from the pixmap on the next vertical retrace */
+  if (None != x11_window->present_pixmaps[0])
+    drawable = x11_window->present_pixmaps[x11_window->present_index];
+#endif
 
-  x11_window->gc = XCreateGC(x11_window->display, x11_window->window, 0, NULL);
+#ifdef WUHOO_XSHM_ENABLE
+  if (0 != x11_window->shm_count) {
+    XShmPutImage(x11_window->display, drawable, x11_window->gc,
+                 x11_window->image, x, y, x, y, width, height,
+                 (WuhooTrue == fence) ? True : False);
+    if (WuhooTrue == fence) {
+      x11_window->shm_busy[x11_window->shm_index] = WuhooTrue;
+      x11_window->frames_in_flight++;
+    }
+    return;
+  }
+#endif
 
-  x11_window->wmDeleteMessage =
-    XInternAtom(x11_window->display, "WM_DELETE_WINDOW", 0);
-  x11_window->wmState = XInternAtom(x11_window->display, "_NET_WM_STATE", True);
-  x11_window->wmStateMaxHorz =
-    XInternAtom(x11_window->display, "_NET_WM_STATE_MAXIMIZED_HORZ", True);
-  x11_window->wmStateMaxVert =
-    XInternAtom(x11_window->display, "_NET_WM_STATE_MAXIMIZED_VERT", True);
-  x11_window->wmStateHidden =
-    XInternAtom(x11_window->display, "_NET_WM_STATE_HIDDEN", True);
-  x11_window->wmStateFull =
-    XInternAtom(x11_window->display, "_NET_WM_STATE_FULLSCREEN", True);
+#ifdef WUHOO_XCB_ENABLE
+  /* xcb does not split requests like XPutImage, full width rows are sent in
+   * bands that fit the maximum request size, anything narrower row by row */
+  XImage*   image      = x11_window->image;
+  xcb_gcontext_t gc    = XGContextFromGC(x11_window->gc);
+  WuhooSize row_bytes  = image->bytes_per_line;
+  int       band_rows  = height;
+  int       band_width = image->width;
+  int       band_x     = 0;
+
+  if (x != 0 || width != image->width) {
+    band_rows  = 1;
+    band_width = width;
+    band_x     = x;
+    row_bytes  = (WuhooSize)width * (image->bits_per_pixel / 8);
+  } else if ((WuhooSize)height * row_bytes > x11_window->max_request_bytes) {
+    band_rows = WuhooMaxi(1, (int)(x11_window->max_request_bytes / row_bytes));
+  }
 
-  XSetWMProtocols(x11_window->display, x11_window->window,
-                  &x11_window->wmDeleteMessage, 1);
+  int row = 0;
+  for (row = y; row < y + height; row += band_rows) {
+    int rows = WuhooMini(band_rows, y + height - row);
+    xcb_put_image(x11_window->connection, XCB_IMAGE_FORMAT_Z_PIXMAP, drawable,
+                  gc, band_width, rows, band_x, row, 0, image->depth,
+                  (uint32_t)(rows * row_bytes),
+                  (const uint8_t*)image->data + row * image->bytes_per_line +
+                    band_x * (image->bits_per_pixel / 8));
+  }
+#else
+  XPutImage(x11_window->display, drawable, x11_window->gc, x11_window->image,
+            x, y, x, y, width, height);
+#endif
+}
 
-  if (WUHOO_FLAG_BORDERLESS & window->flags) {
-    Atom wmMotifHints = XInternAtom(x11_window->display, "_MOTIF_WM_HINTS", True);
-    if (None != wmMotifHints) {
-      /* Hints used by Motif compliant window managers */
-      struct
-      {
-        unsigned long flags;
-        unsigned long functions;
-        unsigned long decorations;
-        long input_mode;
-        unsigned long status;
-      } MWMHints = {
-        (1L << 1), 0, 0, 0, 0
-      };
+/* Sends all queued uploads to the server. It never waits, shared buffers
+ * are retired through completion events instead of a round trip
+ */
+WuhooInternal void
+_WuhooWindowImageFlushX11(WuhooWindow* window)
+{
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
 
-      XChangeProperty(x11_window->display, x11_window->window, wmMotifHints, wmMotifHints, 32, PropModeReplace, (unsigned char *) &MWMHints, sizeof(MWMHints) / sizeof(long));
-    } else { 
-      /* set the transient hints instead, if necessary */
-      XSetTransientForHint(x11_window->display, x11_window->window, RootWindow(x11_window->display, x11_window->screen));
-    }
+#ifdef WUHOO_XPRESENT_ENABLE
+  if (None != x11_window->present_pixmaps[0]) {
+    int index = x11_window->present_index;
+
+    /* Completion is reported back as a WUHOO_EVT_FRAME, the next frame is
+     * drawn into another pixmap while the server still reads this one */
+    XPresentPixmap(x11_window->display, x11_window->window,
+                   x11_window->present_pixmaps[index],
+                   ++x11_window->present_serial, None, None, 0, 0, None, None,
+                   None, PresentOptionNone, 0, 0, 0, WuhooNull, 0);
+    x11_window->present_busy[index] = WuhooTrue;
+    x11_window->present_index = (index + 1) % WUHOO_XPRESENT_PIXMAP_COUNT;
+    x11_window->present_stale = WuhooTrue;
   }
-  
-  if (!(WUHOO_FLAG_RESIZEABLE & window->flags)) {
-    XSizeHints* size_hints = XAllocSizeHints();
-    size_hints->flags = PMinSize | PMaxSize;
-    size_hints->min_width = size_hints->max_width = window->cwidth;
-    size_hints->min_height = size_hints->max_height = window->cheight;
-    XSetNormalHints(x11_window->display, x11_window->window, size_hints);
-    XFree(size_hints);
+#endif
+
+  XFlush(x11_window->display);
+}
+
+#ifdef WUHOO_XRENDER_ENABLE
+WuhooInternal void
+_WuhooWindowRenderStagingDestroyX11(WuhooWindow* window)
+{
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+
+  if (None != x11_window->render_frame) {
+    XRenderFreePicture(x11_window->display, x11_window->render_frame);
+    x11_window->render_frame = None;
   }
- 
-  /* Set up useful Atoms */
-  if (WUHOO_FLAG_FILE_DROP & flags) {
-    x11_window->XA_text_uri_list =
-      XInternAtom(x11_window->display, "text/uri-list", False);
-    x11_window->XA_XdndSelection =
-      XInternAtom(x11_window->display, "XdndSelection", False);
-    x11_window->XA_XdndAware =
-      XInternAtom(x11_window->display, "XdndAware", False);
-    x11_window->XA_XdndEnter =
-      XInternAtom(x11_window->display, "XdndEnter", False);
-    x11_window->XA_XdndLeave =
-      XInternAtom(x11_window->display, "XdndLeave", False);
-    x11_window->XA_XdndTypeList =
-      XInternAtom(x11_window->display, "XdndTypeList", False);
-    x11_window->XA_XdndPosition =
-      XInternAtom(x11_window->display, "XdndPosition", False);
-    x11_window->XA_XdndActionCopy =
-      XInternAtom(x11_window->display, "XdndActionCopy", False);
-    x11_window->XA_XdndStatus =
-      XInternAtom(x11_window->display, "XdndStatus", False);
-    x11_window->XA_XdndDrop =
-      XInternAtom(x11_window->display, "XdndDrop", False);
-    x11_window->XA_XdndFinished =
-      XInternAtom(x11_window->display, "XdndFinished", False);
-    x11_window->XA_XdndReq = None;
 
-    x11_window->XdndVersion = 4;
-    XChangeProperty(x11_window->display, x11_window->window,
-                    x11_window->XA_XdndAware, XA_ATOM, 32, PropModeReplace,
-                    (unsigned char*)&x11_window->XdndVersion, 1);
+  if (None != x11_window->render_pixmap) {
+    XFreePixmap(x11_window->display, x11_window->render_pixmap);
+    x11_window->render_pixmap = None;
   }
 
-  return result;
+  if (WuhooNull != x11_window->render_image) {
+    XImage* image = x11_window->render_image;
+#ifdef WUHOO_XSHM_ENABLE
+    if (WuhooNull != x11_window->render_shm_info.shmaddr) {
+      /* Detaching is ordered after the last put that reads the segment */
+      XShmDetach(x11_window->display, &x11_window->render_shm_info);
+      shmdt(x11_window->render_shm_info.shmaddr);
+      x11_window->render_shm_info.shmaddr = WuhooNull;
+      x11_window->render_busy             = WuhooFalse;
+    } else
+#endif
+    {
+      munmap(image->data, image->bytes_per_line * image->height);
+    }
+    image->data = WuhooNull;
+    XDestroyImage(image);
+    x11_window->render_image = WuhooNull;
+  }
 }
 
-WuhooResult
-_WuhooWindowShowX11(WuhooWindow* window)
+/* Blocks until the server has read the staging image of the last blit, like
+ * _WuhooWindowShmWaitX11 this waits for an event already on its way */
+WuhooInternal void
+_WuhooWindowRenderWaitX11(WuhooWindow* window)
 {
+#ifdef WUHOO_XSHM_ENABLE
   WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+  XEvent          xevent;
 
-  XMapWindow(x11_window->display, x11_window->window);
-  XMapRaised(x11_window->display, x11_window->window);
+  while (WuhooTrue == x11_window->render_busy) {
+    XIfEvent(x11_window->display, &xevent, &_WuhooShmCompletionPredicateX11,
+             (XPointer)x11_window);
+    _WuhooWindowShmCompleteX11(window, (XShmCompletionEvent*)&xevent);
+  }
+#else
+  WuhooUnused(window);
+#endif
+}
 
-  XSetLocaleModifiers("");
+/* (Re)creates the ARGB32 staging picture that blits are uploaded to */
+WuhooInternal WuhooResult
+_WuhooWindowRenderStagingCreateX11(WuhooWindow* window, int width, int height)
+{
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+  void*           image_data = WuhooNull;
 
-  XIM xim = XOpenIM(x11_window->display, NULL, NULL, NULL);
-  if (!xim) {
-    // fallback to internal input method
-    XSetLocaleModifiers("@im=none");
-    xim = XOpenIM(x11_window->display, 0, 0, 0);
+  _WuhooWindowRenderStagingDestroyX11(window);
+
+  x11_window->render_pixmap =
+    XCreatePixmap(x11_window->display, x11_window->window, width, height, 32);
+  x11_window->render_frame = XRenderCreatePicture(
+    x11_window->display, x11_window->render_pixmap,
+    XRenderFindStandardFormat(x11_window->display, PictStandardARGB32), 0,
+    WuhooNull);
+
+  if (None == x11_window->render_gc) {
+    x11_window->render_gc =
+      XCreateGC(x11_window->display, x11_window->render_pixmap, 0, WuhooNull);
   }
 
-  // X input context, you can have multiple for text boxes etc, but having a
-  x11_window->ic = XCreateIC(
-    xim, XNInputStyle, XIMPreeditNothing | XIMStatusNothing, XNClientWindow,
-    x11_window->window, XNFocusWindow, x11_window->window, NULL);
+#ifdef WUHOO_XSHM_ENABLE
+  /* A shared segment is not swapped for the server, the upload kernels
+   * write little endian ARGB words */
+  if (WuhooTrue == x11_window->has_shm &&
+      LSBFirst == ImageByteOrder(x11_window->display)) {
+    x11_window->render_image = _WuhooWindowImageCreateShmX11(
+      window, &x11_window->render_shm_info, width, height, 32);
+    if (WuhooNull != x11_window->render_image)
+      return WuhooSuccess;
+  }
+#endif
 
-  XSetICFocus(x11_window->ic);
+  x11_window->render_image =
+    XCreateImage(x11_window->display, x11_window->visual, 32, ZPixmap, 0,
+                 WuhooNull, width, height, 32, 0);
+  if (WuhooNull == x11_window->render_image) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING " : XCreateImage failed";
+  }
 
-  XMoveWindow(x11_window->display, x11_window->window, window->x, window->y);
+  image_data = WuhooMalloc(x11_window->render_image->bytes_per_line * height);
+  if (MAP_FAILED == image_data) {
+    XDestroyImage(x11_window->render_image);
+    x11_window->render_image = WuhooNull;
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : Failed to allocate the staging image";
+  }
+
+  /* The upload kernels write little endian ARGB words, Xlib swaps them for
+   * the server if needed */
+  x11_window->render_image->data       = (char*)image_data;
+  x11_window->render_image->byte_order = LSBFirst;
 
   return WuhooSuccess;
 }
 
+/* Uploads the source region once and lets the server blend and scale it
+ * into the window */
 WuhooInternal WuhooResult
-_WuhooWindowStateX11(WuhooWindow* window)
+_WuhooWindowBlitRenderX11(WuhooWindow* window, WuhooRGBA const* pixels,
+                          WuhooSize src_x, WuhooSize src_y,
+                          WuhooSize src_pitch, WuhooSize src_width,
+                          WuhooSize src_height, WuhooSize x, WuhooSize y,
+                          WuhooSize width, WuhooSize height)
 {
   WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
   WuhooResult     result     = WuhooSuccess;
+  Picture         target     = x11_window->render_window;
 
-  Atom           type;
-  int            format;
-  unsigned long  nItem, bytesAfter;
-  unsigned char* properties = NULL;
-  while (XGetWindowProperty(x11_window->display, x11_window->window,
-                            x11_window->wmState, 0, (~0L) /* LONG_MAX */, False,
-                            AnyPropertyType, &type, &format, &nItem,
-                            &bytesAfter, &properties) != Success ||
-         bytesAfter != 0) {
+  if (0 == src_width || 0 == src_height || 0 == width || 0 == height) {
+    return WuhooSuccess;
   }
 
-  WuhooBoolean max_vertical_resize = WuhooFalse;
-  WuhooBoolean max_horizontal_resize = WuhooFalse;
- 
-  int iItem;
-  for (iItem = 0; iItem < nItem; ++iItem) {
-     max_horizontal_resize = (((unsigned long *)properties)[iItem] == x11_window->wmStateMaxHorz) ? WuhooTrue : max_horizontal_resize;
-     max_vertical_resize = (((unsigned long *)properties)[iItem] == x11_window->wmStateMaxVert) ? WuhooTrue : max_vertical_resize;
+#ifdef WUHOO_XPRESENT_ENABLE
+  /* Keep frames paced, compose into the pixmap that gets presented */
+  if (WuhooTrue == x11_window->has_present) {
+    if (WuhooNull == x11_window->image ||
+        x11_window->image->width != window->cwidth ||
+        x11_window->image->height != window->cheight) {
+      result =
+        _WuhooWindowImageCreateX11(window, window->cwidth, window->cheight);
+      if (WuhooSuccess != result) {
+        return result;
+      }
+    }
+
+    /* Blending reads what the window shows, the pixmap is always updated */
+    Pixmap pixmap =
+      _WuhooWindowPresentAcquireX11(window, WuhooFalse, WuhooFalse);
+    Picture* present =
+      &x11_window->render_present[x11_window->present_index];
+    if (None == *present) {
+      *present = XRenderCreatePicture(
+        x11_window->display, pixmap,
+        XRenderFindVisualFormat(x11_window->display, x11_window->visual), 0,
+        WuhooNull);
+    }
+
+    target = *present;
   }
+#endif
 
-  if ( WuhooTrue == max_horizontal_resize && WuhooTrue == max_vertical_resize ) {
-    window->window_flags |= WUHOO_WINDOW_FLAG_FULL_SCREEN | WUHOO_WINDOW_FLAG_MAXIMIZED;
+  if (WuhooNull == x11_window->render_image ||
+      x11_window->render_image->width != (int)src_width ||
+      x11_window->render_image->height != (int)src_height) {
+    result = _WuhooWindowRenderStagingCreateX11(window, src_width, src_height);
+    if (WuhooSuccess != result) {
+      return result;
+    }
   }
 
-  return result;
+  /* Only blending comes here, so alpha always matters. The upload runs on
+   * the worker pool like any other conversion */
+  WuhooConvertStage upload = { WuhooNull, WuhooNull, WuhooNull, WuhooNull };
+  upload.convert =
+    WuhooConvertSelect(&WuhooConvertRGBAtoPremultipliedBGRA, window->flags);
+
+  XImage* image = x11_window->render_image;
+  _WuhooWindowRenderWaitX11(window);
+  WuhooConvertScaled(window, &upload, image->data, image->bytes_per_line, 4,
+                     pixels, src_x, src_y, src_pitch, src_width, src_height,
+                     src_width, src_height, src_width, 0, src_height);
+
+#ifdef WUHOO_XSHM_ENABLE
+  if (WuhooNull != x11_window->render_shm_info.shmaddr) {
+    XShmPutImage(x11_window->display, x11_window->render_pixmap,
+                 x11_window->render_gc, image, 0, 0, 0, 0, src_width,
+                 src_height, True);
+    x11_window->render_busy = WuhooTrue;
+  } else
+#endif
+  {
+    XPutImage(x11_window->display, x11_window->render_pixmap,
+              x11_window->render_gc, image, 0, 0, 0, 0, src_width,
+              src_height);
+  }
+
+  /* Maps window pixels back to staging pixels */
+  XTransform transform = {
+    { { (XFixed)(((long long)src_width << 16) / width), 0, 0 },
+      { 0, (XFixed)(((long long)src_height << 16) / height), 0 },
+      { 0, 0, (XFixed)(1 << 16) } }
+  };
+  XRenderSetPictureTransform(x11_window->display, x11_window->render_frame,
+                             &transform);
+  XRenderSetPictureFilter(x11_window->display, x11_window->render_frame,
+                          (WUHOO_BLIT_FILTER_BILINEAR == window->blit_filter)
+                            ? FilterBilinear
+                            : FilterNearest,
+                          WuhooNull, 0);
+
+  XRenderComposite(x11_window->display,
+                   (WUHOO_BLIT_BLEND_OVER == window->blit_blend) ? PictOpOver
+                                                                  : PictOpSrc,
+                   x11_window->render_frame, None, target, 0, 0, 0, 0, x, y,
+                   width, height);
+  _WuhooWindowImageFlushX11(window);
+
+  return WuhooSuccess;
 }
+#endif /* WUHOO_XRENDER_ENABLE */
 
-typedef struct
+WuhooResult
+_WuhooWindowBlitX11(WuhooWindow* window, WuhooConvertStage const* stage,
+                    WuhooRGBA* pixels, WuhooSize src_x, WuhooSize src_y,
+                    WuhooSize src_pitch, WuhooSize src_width,
+                    WuhooSize src_height, WuhooSize x, WuhooSize y,
+                    WuhooSize width, WuhooSize height, WuhooBoolean async)
 {
-  unsigned char* data;
-  int            format, count;
-  Atom           type;
-} WuhooPropertyX11;
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+  WuhooResult     result     = WuhooSuccess;
 
-/* Reads property
-   Must call X11_XFree on results
- */
-WuhooInternal void
-_WuhooReadPropertyX11(WuhooPropertyX11* p, Display* disp, Window w, Atom prop)
+#ifdef WUHOO_OPENGL_ENABLE
+  if (WUHOO_FLAG_OPENGL & window->flags) {
+    glXSwapBuffers(x11_window->display, x11_window->window);
+
+    return WuhooSuccess;
+  }
+#endif
+
+  if (WUHOO_WINDOW_FLAG_CLOSED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_RESIZED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_REGION_UPDATED & window->window_flags) {
+    /* If important window states have not been handled yet
+     * don not proceed with blitting because this might
+     * cause inconcistent behaviors. **REVISIT**
+     */
+    return WuhooSuccess;
+  }
+
+  /* The cached geometry is authoritative, the blit never waits on the
+   * server */
+  int valid_width  = x11_window->screen_width - window->x;
+  int valid_height =
+    x11_window->screen_height - x11_window->title_extents - window->y;
+
+  valid_width  = WuhooMini(valid_width, width);
+  valid_height = WuhooMini(valid_height, height);
+
+#ifdef WUHOO_XRENDER_ENABLE
+  /* Only blending needs the server. Filters and the premultiplied pixels of
+   * transparent windows are handled by the stage on the shared image, which
+   * spares a second copy of every pixel */
+  if (WuhooTrue == x11_window->has_render && WuhooNull == stage->source &&
+      WUHOO_BLIT_BLEND_OVER == window->blit_blend) {
+    return _WuhooWindowBlitRenderX11(window, pixels, src_x, src_y, src_pitch,
+                                     src_width, src_height, x, y, width,
+                                     height);
+  }
+#endif
+
+  if (WuhooNull == x11_window->image ||
+      x11_window->image->width != window->cwidth ||
+      x11_window->image->height != window->cheight) {
+    result = _WuhooWindowImageCreateX11(window, window->cwidth, window->cheight);
+    if (WuhooSuccess != result) {
+      return result;
+    }
+  }
+
+  /* The image mirrors the client area */
+  if (WuhooFalse == _WuhooWindowImageClipX11(x11_window->image, x, y,
+                                             &valid_width, &valid_height)) {
+    return WuhooSuccess;
+  }
+
+  if (WuhooFalse == _WuhooWindowImageAcquireX11(window)) {
+    if (WuhooTrue == async) {
+      return (WuhooResult)WUHOO_PLATFORM_API_STRING
+        " : All presentation buffers are in flight";
+    }
+
+    _WuhooWindowShmWaitX11(window);
+    _WuhooWindowImageAcquireX11(window);
+  }
+
+#ifdef WUHOO_XPRESENT_ENABLE
+  /* The pixmap only needs the last frame if this one leaves part of it */
+  WuhooBoolean covered = (0 == x && 0 == y &&
+                          valid_width == x11_window->image->width &&
+                          valid_height == x11_window->image->height);
+  if (None != x11_window->present_pixmaps[0] &&
+      None == _WuhooWindowPresentAcquireX11(window, covered, async)) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : All presentation buffers are in flight";
+  }
+#endif
+
+  /* Shared buffers are always fenced, a synchronous blit only differs in
+   * waiting for a free buffer above instead of failing */
+  int band_rows = _WuhooWindowImageBandRowsX11(window, valid_width, valid_height);
+  int band_y    = 0;
+  for (band_y = 0; band_y < valid_height; band_y += band_rows) {
+    int          rows = WuhooMini(band_rows, valid_height - band_y);
+    WuhooBoolean last = (band_y + rows >= valid_height);
+
+    _WuhooWindowImageConvertX11(window, stage, x11_window->image, pixels,
+                                src_x, src_y, src_pitch, src_width, src_height,
+                                x, y, width, height, valid_width, band_y, rows);
+    _WuhooWindowImagePutX11(window, x, y + band_y, valid_width, rows, last);
+
+    /* Hand the band to the server before converting the next one */
+    if (WuhooFalse == last)
+      XFlush(x11_window->display);
+  }
+  _WuhooWindowImageFlushX11(window);
+
+  return result;
+}
+
+WuhooResult
+_WuhooWindowBlitRectsX11(WuhooWindow* window, WuhooConvertStage const* stage,
+                         WuhooRGBA* pixels, WuhooSize stride,
+                         WuhooRect const* rects, WuhooSize count)
 {
-  unsigned char* ret = NULL;
-  Atom           type;
-  int            fmt;
-  unsigned long  count;
-  unsigned long  bytes_left;
-  int            bytes_fetch = 0;
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+  WuhooResult     result     = WuhooSuccess;
 
-  do {
-    if (ret != 0)
-      XFree(ret);
-    XGetWindowProperty(disp, w, prop, 0, bytes_fetch, False, AnyPropertyType,
-                       &type, &fmt, &count, &bytes_left, &ret);
-    bytes_fetch += bytes_left;
-  } while (bytes_left != 0);
+#ifdef WUHOO_OPENGL_ENABLE
+  if (WUHOO_FLAG_OPENGL & window->flags) {
+    glXSwapBuffers(x11_window->display, x11_window->window);
 
-  p->data   = ret;
-  p->format = fmt;
-  p->count  = count;
-  p->type   = type;
+    return WuhooSuccess;
+  }
+#endif
+
+  if (WUHOO_WINDOW_FLAG_CLOSED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_RESIZED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_REGION_UPDATED & window->window_flags) {
+    return WuhooSuccess;
+  }
+
+  if (WuhooNull == x11_window->image ||
+      x11_window->image->width != window->cwidth ||
+      x11_window->image->height != window->cheight) {
+    result = _WuhooWindowImageCreateX11(window, window->cwidth, window->cheight);
+    if (WuhooSuccess != result) {
+      return result;
+    }
+  }
+
+  if (WuhooFalse == _WuhooWindowImageAcquireX11(window)) {
+    _WuhooWindowShmWaitX11(window);
+    _WuhooWindowImageAcquireX11(window);
+  }
+
+  /* Convert and queue every region, then send them all with one flush.
+   * Requests are handled in order, so the completion of the last upload
+   * retires the buffer like in _WuhooWindowBlitX11 */
+  WuhooSize last =
+    _WuhooWindowImageLastRectX11(x11_window->image, rects, count);
+  WuhooSize index = 0;
+
+#ifdef WUHOO_XPRESENT_ENABLE
+  if (None != x11_window->present_pixmaps[0]) {
+    _WuhooWindowPresentAcquireX11(
+      window, _WuhooWindowImageCoveredX11(x11_window->image, rects, count),
+      WuhooFalse);
+  }
+#endif
+
+  for (index = 0; index < count; index++) {
+    int x      = rects[index].x;
+    int y      = rects[index].y;
+    int width  = rects[index].width;
+    int height = rects[index].height;
+
+    if (WuhooFalse == _WuhooWindowImageClipX11(x11_window->image, x, y, &width,
+                                               &height)) {
+      continue;
+    }
+
+    _WuhooWindowImageConvertX11(window, stage, x11_window->image, pixels, x,
+                                y, stride, width, height, x, y, width, height,
+                                width, 0, height);
+    _WuhooWindowImagePutX11(window, x, y, width, height, index == last);
+  }
+
+  _WuhooWindowImageFlushX11(window);
+
+  return result;
 }
 
-WuhooInternal WuhooKeyCode
-_WuhooKeyTranslateX11(KeySym ksym)
+WuhooResult
+_WuhooWindowFramebufferAcquireX11(WuhooWindow* window,
+                                  WuhooFramebuffer* framebuffer)
 {
-  switch (ksym) {
-      /* Undocumented KyeCode for X11X */
-    case XK_Menu: return WUHOO_VKEY_MENU; break;
-    case XK_comma: return WUHOO_VKEY_COMMA; break;
-    case XK_semicolon: return WUHOO_VKEY_SEMICOLON; break;
-    case XK_backslash: return WUHOO_VKEY_BACK_SLASH; break;
-    case XK_slash: return WUHOO_VKEY_FORWARD_SLASH; break;
-    case XK_quoteright: return WUHOO_VKEY_QUOTE; break;
-    case XK_bracketleft: return WUHOO_VKEY_LEFT_BRACKET; break;
-    case XK_bracketright: return WUHOO_VKEY_RIGHT_BRACKET; break;
-    case XK_equal: return WUHOO_VKEY_EQUALS; break;
-    case XK_minus: return WUHOO_VKEY_MINUS; break;
-    case XK_period: return WUHOO_VKEY_PERIOD; break;
-    case XK_grave: return WUHOO_VKEY_GRAVE; break;
-    case XK_KP_Decimal: return WUHOO_VKEY_KPAD_DECIMAL; break;
-    case XK_KP_Multiply: return WUHOO_VKEY_KPAD_MULITPLY; break;
-    case XK_KP_Add: return WUHOO_VKEY_KPAD_PLUS; break;
-    case XK_Num_Lock: return WUHOO_VKEY_KPAD_NUM_LOCK; break;
-    case XK_KP_Divide: return WUHOO_VKEY_KPAD_DIVIDE; break;
-    case XK_KP_Enter: return WUHOO_VKEY_KPAD_ENTER; break;
-    case XK_KP_Subtract: return WUHOO_VKEY_KPAD_MINUS; break;
-    case XK_KP_0: return WUHOO_VKEY_KPAD_0; break;
-    case XK_KP_1: return WUHOO_VKEY_KPAD_1; break;
-    case XK_KP_2: return WUHOO_VKEY_KPAD_2; break;
-    case XK_KP_3: return WUHOO_VKEY_KPAD_3; break;
-    case XK_KP_4: return WUHOO_VKEY_KPAD_4; break;
-    case XK_KP_5: return WUHOO_VKEY_KPAD_5; break;
-    case XK_KP_6: return WUHOO_VKEY_KPAD_6; break;
-    case XK_KP_7: return WUHOO_VKEY_KPAD_7; break;
-    case XK_KP_8: return WUHOO_VKEY_KPAD_8; break;
-    case XK_KP_9: return WUHOO_VKEY_KPAD_9; break;
-    case XK_0: return WUHOO_VKEY_0; break;
-    case XK_1: return WUHOO_VKEY_1; break;
-    case XK_2: return WUHOO_VKEY_2; break;
-    case XK_3: return WUHOO_VKEY_3; break;
-    case XK_4: return WUHOO_VKEY_4; break;
-    case XK_5: return WUHOO_VKEY_5; break;
-    case XK_6: return WUHOO_VKEY_6; break;
-    case XK_7: return WUHOO_VKEY_7; break;
-    case XK_8: return WUHOO_VKEY_8; break;
-    case XK_9: return WUHOO_VKEY_9; break;
-    case XK_A: return WUHOO_VKEY_A; break;
-    case XK_B: return WUHOO_VKEY_B; break;
-    case XK_C: return WUHOO_VKEY_C; break;
-    case XK_D: return WUHOO_VKEY_D; break;
-    case XK_E: return WUHOO_VKEY_E; break;
-    case XK_F: return WUHOO_VKEY_F; break;
-    case XK_G: return WUHOO_VKEY_G; break;
-    case XK_H: return WUHOO_VKEY_H; break;
-    case XK_I: return WUHOO_VKEY_I; break;
-    case XK_J: return WUHOO_VKEY_J; break;
-    case XK_K: return WUHOO_VKEY_K; break;
-    case XK_L: return WUHOO_VKEY_L; break;
-    case XK_M: return WUHOO_VKEY_M; break;
-    case XK_N: return WUHOO_VKEY_N; break;
-    case XK_O: return WUHOO_VKEY_O; break;
-    case XK_P: return WUHOO_VKEY_P; break;
-    case XK_Q: return WUHOO_VKEY_Q; break;
-    case XK_R: return WUHOO_VKEY_R; break;
-    case XK_S: return WUHOO_VKEY_S; break;
-    case XK_T: return WUHOO_VKEY_T; break;
-    case XK_U: return WUHOO_VKEY_U; break;
-    case XK_V: return WUHOO_VKEY_V; break;
-    case XK_W: return WUHOO_VKEY_W; break;
-    case XK_X: return WUHOO_VKEY_X; break;
-    case XK_Y: return WUHOO_VKEY_Y; break;
-    case XK_Z: return WUHOO_VKEY_Z; break;
-    case XK_Left: return WUHOO_VKEY_LEFT; break;
-    case XK_Right: return WUHOO_VKEY_RIGHT; break;
-    case XK_Up: return WUHOO_VKEY_UP; break;
-    case XK_Down: return WUHOO_VKEY_DOWN; break;
-    case XK_Escape: return WUHOO_VKEY_ESCAPE; break;
-    case XK_Return: return WUHOO_VKEY_ENTER; break;
-    case XK_Tab: return WUHOO_VKEY_TAB; break;
-    case XK_space: return WUHOO_VKEY_SPACE; break;
-    case XK_Delete: return WUHOO_VKEY_DELETE; break;
-    case XK_Shift_R: return WUHOO_VKEY_SHIFT; break;
-    case XK_Shift_L: return WUHOO_VKEY_SHIFT; break;
-    case XK_Alt_L: return WUHOO_VKEY_ALT; break;
-    case XK_Alt_R: return WUHOO_VKEY_ALT; break;
-    case XK_Caps_Lock: return WUHOO_VKEY_CAPS_LOCK; break;
-    case XK_Control_R: return WUHOO_VKEY_CONTROL; break;
-    case XK_Control_L: return WUHOO_VKEY_CONTROL; break;
-    case XK_F1: return WUHOO_VKEY_F1; break;
-    case XK_F2: return WUHOO_VKEY_F2; break;
-    case XK_F3: return WUHOO_VKEY_F3; break;
-    case XK_F4: return WUHOO_VKEY_F4; break;
-    case XK_F5: return WUHOO_VKEY_F5; break;
-    case XK_F6: return WUHOO_VKEY_F6; break;
-    case XK_F7: return WUHOO_VKEY_F7; break;
-    case XK_F8: return WUHOO_VKEY_F8; break;
-    case XK_F9: return WUHOO_VKEY_F9; break;
-    case XK_F10: return WUHOO_VKEY_F10; break;
-    case XK_F11: return WUHOO_VKEY_F11; break;
-    case XK_F12: return WUHOO_VKEY_F12; break;
-    case XK_Insert: return WUHOO_VKEY_INSERT; break;
-    case XK_Home: return WUHOO_VKEY_HOME; break;
-    case XK_Page_Up: return WUHOO_VKEY_PAGE_UP; break;
-    case XK_BackSpace: WUHOO_VKEY_BACKSPACE; break;
-    case XK_End: return WUHOO_VKEY_END; break;
-    case XK_Page_Down: return WUHOO_VKEY_PAGE_DOWN; break;
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+  WuhooResult     result     = WuhooSuccess;
 
-    default: return WUHOO_VKEY_UNKNOWN; break;
+#ifdef WUHOO_OPENGL_ENABLE
+  if (WUHOO_FLAG_OPENGL & window->flags) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : No framebuffer access for OpenGL windows";
   }
+#endif
 
-  return WUHOO_VKEY_UNKNOWN;
-}
+  if (WuhooNull == x11_window->image ||
+      x11_window->image->width != window->cwidth ||
+      x11_window->image->height != window->cheight) {
+    result = _WuhooWindowImageCreateX11(window, window->cwidth, window->cheight);
+    if (WuhooSuccess != result) {
+      return result;
+    }
+  }
 
-/* Find text-uri-list in a list of targets and return it's atom
-   if available, else return None */
-WuhooInternal Atom
-_WuhooPickTextTargetX11(Display* disp, Atom* list, int list_count)
-{
-  Atom  request = None;
-  char* name;
-  int   i;
-  for (i = 0; i < list_count && request == None; i++) {
-    name = XGetAtomName(disp, list[i]);
+  if (WuhooFalse == _WuhooWindowImageAcquireX11(window)) {
+    _WuhooWindowShmWaitX11(window);
+    _WuhooWindowImageAcquireX11(window);
+  }
 
-    if (WuhooTrue == WuhooStringCmp("text/plain;charset=utf-8", name, 100)) {
+  XImage* image = x11_window->image;
 
-      request = list[i];
-    }
-    XFree(name);
-  }
+  framebuffer->pixels                = image->data;
+  framebuffer->pitch                 = image->bytes_per_line;
+  framebuffer->width                 = image->width;
+  framebuffer->height                = image->height;
+  framebuffer->format.bits_per_pixel = image->bits_per_pixel;
+  framebuffer->format.red_mask       = x11_window->visual->red_mask;
+  framebuffer->format.green_mask     = x11_window->visual->green_mask;
+  framebuffer->format.blue_mask      = x11_window->visual->blue_mask;
+  framebuffer->format.msb_first      = (MSBFirst == image->byte_order);
+  framebuffer->format.alpha_mask     = window->convert_format.alpha_mask;
 
-  return request;
+  return WuhooSuccess;
 }
 
-WuhooInternal Atom
-_WuhooPickTextTargetFromThreeX11(Display* disp, Atom a0, Atom a1, Atom a2)
+/* Sends the regions of the image that was handed out, it is not converted
+ * and no other buffer is picked. The last upload is fenced, the next
+ * acquire hands out a buffer the server is done with */
+WuhooResult
+_WuhooWindowFramebufferPresentX11(WuhooWindow* window, WuhooRect const* rects,
+                                  WuhooSize count)
 {
-  int  count = 0;
-  Atom atom[3];
-  if (a0 != None)
-    atom[count++] = a0;
-  if (a1 != None)
-    atom[count++] = a1;
-  if (a2 != None)
-    atom[count++] = a2;
-  return _WuhooPickTextTargetX11(disp, atom, count);
-}
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
 
-WuhooInternal WuhooBoolean
-_WuhooIsXDigit(char c)
-{
-  return ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
-          (c >= 'A' && c <= 'F'));
-}
+  if (WUHOO_WINDOW_FLAG_CLOSED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_RESIZED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_REGION_UPDATED & window->window_flags ||
+      WuhooNull == x11_window->image) {
+    return WuhooSuccess;
+  }
 
-WuhooInternal void
-_WuhooURIDecode(char* dst, const char* src)
-{
-  char a, b;
-  while (*src) {
-    if ((*src == '%') && ((a = src[1]) && (b = src[2])) &&
-        (_WuhooIsXDigit(a) && _WuhooIsXDigit(b))) {
-      if (a >= 'a')
-        a -= 'a' - 'A';
-      if (a >= 'A')
-        a -= ('A' - 10);
-      else
-        a -= '0';
-      if (b >= 'a')
-        b -= 'a' - 'A';
-      if (b >= 'A')
-        b -= ('A' - 10);
-      else
-        b -= '0';
-      *dst++ = 16 * a + b;
-      src += 3;
-    } else if (*src == '+') {
-      *dst++ = ' ';
-      src++;
-    } else {
-      *dst++ = *src++;
+  WuhooSize last =
+    _WuhooWindowImageLastRectX11(x11_window->image, rects, count);
+  WuhooSize index = 0;
+
+#ifdef WUHOO_XPRESENT_ENABLE
+  if (None != x11_window->present_pixmaps[0]) {
+    _WuhooWindowPresentAcquireX11(
+      window, _WuhooWindowImageCoveredX11(x11_window->image, rects, count),
+      WuhooFalse);
+  }
+#endif
+
+  for (index = 0; index < count; index++) {
+    int x      = rects[index].x;
+    int y      = rects[index].y;
+    int width  = rects[index].width;
+    int height = rects[index].height;
+
+    if (WuhooFalse == _WuhooWindowImageClipX11(x11_window->image, x, y, &width,
+                                               &height)) {
+      continue;
     }
+
+    _WuhooWindowImagePutX11(window, x, y, width, height, index == last);
   }
-  *dst++ = '\0';
+
+  _WuhooWindowImageFlushX11(window);
+
+  return WuhooSuccess;
 }
 
-WuhooInternal WuhooResult
-_WuhooWindowDropContentsGetX11(WuhooWindow* window, WuhooEvent* event,
-                               char* buffer, int buffer_size)
+WuhooResult
+_WuhooWindowBlitBlendSetX11(WuhooWindow* window, WuhooBlitBlend blend)
 {
+#ifdef WUHOO_XRENDER_ENABLE
   WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
-  WuhooZeroInit(buffer, buffer_size);
 
-  WuhooPropertyX11 p;
-  _WuhooReadPropertyX11(&p, x11_window->display, x11_window->window,
-                        (Atom)event->data.drop.context);
+  if (WuhooTrue == x11_window->has_render) {
+    /* The staging picture is only needed while blending */
+    if (WUHOO_BLIT_BLEND_NONE == blend)
+      _WuhooWindowRenderStagingDestroyX11(window);
 
-  char* at  = (char*)p.data;
-  char* end = at;
-  while (*end) {
-    end++;
-  }
-  end--;
-  while (*end == 10 || *end == 13) {
-    end--;
+    window->blit_blend = blend;
+    return WuhooSuccess;
   }
+#endif
 
-  end++;
-
-  int   count         = 0;
-  char* memory_offset = buffer;
-  int   index         = 0;
-  for (index = 0; index < event->data.drop.count; index++) {
-    at += sizeof("file://") - 1;
-    while (*at != 10 && *at != 13) {
-      *memory_offset++ = *at++;
-    }
-    *memory_offset++ = '\n';
-    while (*at == 10 || *at == 13) {
-      at++;
-    }
+  if (WUHOO_BLIT_BLEND_NONE != blend) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : Blending is not supported";
   }
 
-  *memory_offset = 0;
-
-  _WuhooURIDecode(buffer, buffer);
-
-  XFree(p.data);
-  XDeleteProperty(x11_window->display, x11_window->window,
-                  (Atom)event->data.drop.context);
+  window->blit_blend = blend;
 
   return WuhooSuccess;
 }
 
-WuhooInternal void
-_WuhooWindowEventGobbleX11(WuhooWindow* window, int event_type)
+WuhooSize
+_WuhooWindowFramesInFlightX11(WuhooWindow* window)
 {
+#ifdef WUHOO_XSHM_ENABLE
   WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
-  XEvent          dummy;
-  while (True == XCheckTypedEvent(x11_window->display, event_type, &dummy)) {
-  }
+
+  _WuhooWindowShmRetireX11(window);
+
+  return x11_window->frames_in_flight;
+#else
+  WuhooUnused(window);
+
+  return 0;
+#endif
 }
 
 WuhooResult
-_WuhooWindowEventNextX11(WuhooWindow* window, WuhooEvent* event)
+_WuhooWindowDestroyX11(WuhooWindow* window)
 {
   WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+  WuhooResult     result     = WuhooSuccess;
 
-  XEvent xevent;
+  _WuhooWindowImageDestroyX11(window);
 
-  if (XPending(x11_window->display) == 0) {
-    return WuhooSuccess;
+#ifdef WUHOO_XRENDER_ENABLE
+  _WuhooWindowRenderStagingDestroyX11(window);
+
+  if (None != x11_window->render_gc) {
+    XFreeGC(x11_window->display, x11_window->render_gc);
+    x11_window->render_gc = None;
   }
 
-  XNextEvent(x11_window->display, &xevent);
-  if (Expose == xevent.type)
-    _WuhooWindowEventGobbleX11(window, Expose);
-  if (MotionNotify == xevent.type)
-    _WuhooWindowEventGobbleX11(window, MotionNotify);
-  if (True == XFilterEvent(&xevent, None)) {
-    XNextEvent(x11_window->display, &xevent);
+  if (None != x11_window->render_window) {
+    XRenderFreePicture(x11_window->display, x11_window->render_window);
+    x11_window->render_window = None;
   }
+#endif
 
-  switch (xevent.type) {
-    case FocusIn: {
-      window->window_flags |= WUHOO_WINDOW_FLAG_FOCUS_GAINED;
-      break;
-    }
-    case FocusOut: {
-      window->window_flags |= WUHOO_WINDOW_FLAG_FOCUS_GAINED;
-      break;
-    }
-    case Expose: {
-      /* https://tronche.com/gui/x/xlib/events/exposure/expose.html */
-      /* Careful with how many expensive "expose" events we trigger */
-      XExposeEvent* xexpose = &xevent.xexpose;
-      window->window_flags |=
-        (xexpose->count < 5) ? WUHOO_WINDOW_FLAG_REGION_UPDATED : 0;
+  if (None != x11_window->gc) {
+    XFreeGC(x11_window->display, x11_window->gc);
+    x11_window->gc = None;
+  }
+
+  if (None != x11_window->window) {
+    XUnmapWindow(x11_window->display, x11_window->window);
+    XDestroyWindow(x11_window->display, x11_window->window);
+    x11_window->window = None;
+  }
+  if (None != x11_window->display) {
+    XCloseDisplay(x11_window->display);
+    x11_window->display = None;
+  }
+
+  return result;
+}
+
+WuhooResult
+_WuhooWindowSetTitleX11(WuhooWindow* window, const char* title)
+{
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+  WuhooResult     result     = WuhooSuccess;
+  XChangeProperty( x11_window->display, x11_window->window,
+                   x11_window->wmName, x11_window->utf8String,
+                   8, PropModeReplace, (unsigned char *) title,
+                   WuhooStringLength(title, WUHOO_MAX_TITLE_LENGTH));
+
+  return result;
+}
+
+WuhooInternal WuhooResult
+_WuhooWindowExtentsX11(WuhooWindow* window)
+{
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+  WuhooResult     result     = WuhooSuccess;
+
+  Display* d;
+  Window   w;
+  int      s;
+
+  d = XOpenDisplay(NULL);
+  if (d == NULL) {
+    return WuhooSuccess;
+  }
+
+  s = DefaultScreen(d);
+  w = XCreateSimpleWindow(d, RootWindow(d, s), 0, 0, 1, 1, 1, BlackPixel(d, s),
+                          WhitePixel(d, s));
+  XSelectInput(d, w, ExposureMask | KeyPressMask);
+  XMapWindow(d, w);
+
+  /* Extended Window Manager Hints */
+  /* https://specifications.freedesktop.org/wm-spec/wm-spec-latest.html#idm140200472552416
+   */
+
+  Atom a, t;
+
+  int            f;
+  unsigned char* data = 0;
+  long*          extents;
+  XEvent         e;
+  unsigned long  n, b;
+
+  a = XInternAtom(d, "_NET_FRAME_EXTENTS", True); /* Property to check */
+
+  /* Window manager doesn't set up the extents immediately */
+  /* Wait until they are set up and there are 4 of them */
+  while (XGetWindowProperty(d, w, a, 0, 4, False, AnyPropertyType, &t, &f, &n,
+                            &b, &data) != Success ||
+         n != 4 || b != 0) {
+    XNextEvent(d, &e);
+  }
+  
+  /* OK got extents */
+  if(WuhooNull != data) {
+    extents = (long*)data;
+    x11_window->title_extents = extents[2];
+    XFree(data);
+  }
+  XCloseDisplay(d);
+
+  return result;
+}
+
+/* Bits a pixel of the given depth takes in images */
+WuhooInternal WuhooSize
+_WuhooPixmapBitsX11(Display* display, int depth)
+{
+  int                  count   = 0;
+  WuhooSize            bits    = 0;
+  XPixmapFormatValues* formats = XListPixmapFormats(display, &count);
+
+  int i = 0;
+  for (i = 0; i < count; i++) {
+    if (formats[i].depth == depth)
+      bits = (WuhooSize)formats[i].bits_per_pixel;
+  }
+
+  if (WuhooNull != formats)
+    XFree(formats);
+
+  return bits;
+}
+
+WuhooResult
+_WuhooWindowCreateX11(WuhooWindow* window, int posx, int posy, WuhooSize width,
+                      WuhooSize height, const char* title, WuhooFlags flags)
+{
+  WuhooWindowX11*      x11_window = (WuhooWindowX11*)WuhooNull;
+  WuhooResult          result     = WuhooSuccess;
+  Colormap             cmap;
+  XSetWindowAttributes swa;
+  XWindowAttributes    gwa;
+  int                  depth;
+
+  x11_window              = (WuhooWindowX11*)&window->memory[0];
+  window->platform_window = x11_window;
+
+  _WuhooWindowExtentsX11(window);
+
+  /* fallback to LC_CTYPE in env */
+  setlocale(LC_CTYPE, "");
+  /* implementation-dependent behavior, on my machine it defaults to
+   * XMODIFIERS in env */
+
+  if (XSetLocaleModifiers("") == NULL) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : XSetLocaleModifiers failed";
+  }
+
+  x11_window->display = XOpenDisplay(WuhooNull);
+
+  if (WuhooNull == x11_window->display) { 
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : XOpenDisplay failed";
+  }
+
+#ifdef WUHOO_XCB_ENABLE
+  x11_window->connection = XGetXCBConnection(x11_window->display);
+#endif
+
+  /* BIG-REQUESTS raises the limit when the server supports it, less the
+   * fixed part of a PutImage request in the library that sends it */
+  long max_request_size = XExtendedMaxRequestSize(x11_window->display);
+  if (0 == max_request_size)
+    max_request_size = XMaxRequestSize(x11_window->display);
+#ifdef WUHOO_XCB_ENABLE
+  x11_window->max_request_bytes =
+    (WuhooSize)max_request_size * 4 - sizeof(xcb_put_image_request_t);
+#else
+  x11_window->max_request_bytes =
+    (WuhooSize)max_request_size * 4 - sizeof(xPutImageReq);
+#endif
+
+  x11_window->root = DefaultRootWindow(x11_window->display);
+  if (0 == x11_window->root) { 
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : DefaultRootWindow failed";
+  }
+
+  /* Channel sizes asked of GLX, the layout of the chosen visual is read
+   * once it is known */
+  x11_window->red_length   = 8;
+  x11_window->green_length = 8;
+  x11_window->blue_length  = 8;
+
+  x11_window->bytes_per_pixel = 32 / 8;
+
+#ifdef WUHOO_OPENGL_ENABLE
+  window->gl_framebuffer.depthBits;
+  window->gl_framebuffer.redBits        = x11_window->red_length;
+  window->gl_framebuffer.greenBits      = x11_window->green_length;
+  window->gl_framebuffer.blueBits       = x11_window->blue_length;
+  window->gl_framebuffer.accumRedBits   = x11_window->red_length;
+  window->gl_framebuffer.accumGreenBits = x11_window->green_length;
+  window->gl_framebuffer.accumBlueBits  = x11_window->blue_length;
+
+  int gl_index = 0;
+
+  GLint gl_attrs[32];
+  gl_attrs[gl_index++] = GLX_RGBA;
+  gl_attrs[gl_index++] = GLX_DEPTH_SIZE;
+  gl_attrs[gl_index++] = window->gl_framebuffer.depthBits;
+  gl_attrs[gl_index++] = GLX_STENCIL_SIZE;
+  gl_attrs[gl_index++] = window->gl_framebuffer.stencilBits;
+  gl_attrs[gl_index++] = GLX_RED_SIZE;
+  gl_attrs[gl_index++] = window->gl_framebuffer.redBits;
+  gl_attrs[gl_index++] = GLX_GREEN_SIZE;
+  gl_attrs[gl_index++] = window->gl_framebuffer.greenBits;
+  gl_attrs[gl_index++] = GLX_BLUE_SIZE;
+  gl_attrs[gl_index++] = window->gl_framebuffer.blueBits;
+  gl_attrs[gl_index++] = GLX_ALPHA_SIZE;
+  gl_attrs[gl_index++] = window->gl_framebuffer.alphaBits;
+  gl_attrs[gl_index++] = GLX_ACCUM_RED_SIZE;
+  gl_attrs[gl_index++] = window->gl_framebuffer.accumRedBits;
+  gl_attrs[gl_index++] = GLX_ACCUM_GREEN_SIZE;
+  gl_attrs[gl_index++] = window->gl_framebuffer.accumGreenBits;
+  gl_attrs[gl_index++] = GLX_ACCUM_BLUE_SIZE;
+  gl_attrs[gl_index++] = window->gl_framebuffer.accumBlueBits;
+  gl_attrs[gl_index++] = GLX_ACCUM_ALPHA_SIZE;
+  gl_attrs[gl_index++] = window->gl_framebuffer.accumAlphaBits;
+  if (WuhooTrue == window->gl_framebuffer.doublebuffer)
+    gl_attrs[gl_index++] = GLX_DOUBLEBUFFER;
+  if (WuhooTrue == window->gl_framebuffer.stereo)
+    gl_attrs[gl_index++] = GLX_STEREO;
+  gl_attrs[gl_index++] = None;
+#endif
+
+  int bytes_per_pixel = x11_window->bytes_per_pixel;
+
+  int screen_num     = DefaultScreen(x11_window->display);
+  x11_window->screen = screen_num;
+
+#ifdef WUHOO_OPENGL_ENABLE
+  XVisualInfo* vi;
+
+  vi    = glXChooseVisual(x11_window->display, 0, gl_attrs);
+  cmap  = XCreateColormap(x11_window->display, x11_window->root, vi->visual,
+                         AllocNone);
+  depth = vi->depth;
+  x11_window->visual = vi->visual;
+#else
+  x11_window->visual = DefaultVisual(x11_window->display, x11_window->screen);
+  cmap               = XCreateColormap(x11_window->display, x11_window->root,
+                         x11_window->visual, AllocNone);
+  depth              = DefaultDepth(x11_window->display, x11_window->screen);
+#endif
+
+#ifdef WUHOO_XRENDER_ENABLE
+  int render_event_base, render_error_base;
+  x11_window->has_render =
+    (True == XRenderQueryExtension(x11_window->display, &render_event_base,
+                                   &render_error_base));
+
+#ifndef WUHOO_OPENGL_ENABLE
+  /* An ARGB visual lets the compositing manager blend the window with
+   * whatever is behind it */
+  XVisualInfo argb_visual_info;
+  if (WuhooTrue == x11_window->has_render &&
+      (WUHOO_FLAG_TRANSPARENT & flags) &&
+      0 != XMatchVisualInfo(x11_window->display, x11_window->screen, 32,
+                            TrueColor, &argb_visual_info)) {
+    XFreeColormap(x11_window->display, cmap);
+    x11_window->visual = argb_visual_info.visual;
+    depth              = argb_visual_info.depth;
+    cmap = XCreateColormap(x11_window->display, x11_window->root,
+                           x11_window->visual, AllocNone);
+  }
+#endif
+
+  if (32 != depth)
+    window->flags &= ~WUHOO_FLAG_TRANSPARENT;
+#endif
+
+  if (WuhooNull == x11_window->visual) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : Failed to create appropriate visual";
+  }
+
+  x11_window->depth = depth;
+
+#ifdef WUHOO_XSHM_ENABLE
+  x11_window->has_shm = (True == XShmQueryExtension(x11_window->display));
+  if (WuhooTrue == x11_window->has_shm)
+    x11_window->shm_completion_type =
+      XShmGetEventBase(x11_window->display) + ShmCompletion;
+#endif
+
+#ifdef WUHOO_XPRESENT_ENABLE
+  if (WUHOO_FLAG_VSYNC & flags) {
+    int event_base, error_base;
+    x11_window->has_present =
+      (True == XPresentQueryExtension(x11_window->display,
+                                      &x11_window->present_opcode, &event_base,
+                                      &error_base));
+  }
+
+  /* Let the application know that no WUHOO_EVT_FRAME will arrive */
+  if (WuhooFalse == x11_window->has_present)
+    window->flags &= ~WUHOO_FLAG_VSYNC;
+#endif
+
+  /* Images of the window use the visual's masks, the pixmap format of its
+   * depth and the byte order of the server */
+  WuhooPixelFormat format;
+  format.bits_per_pixel =
+    _WuhooPixmapBitsX11(x11_window->display, x11_window->depth);
+  format.red_mask   = (WuhooSize)x11_window->visual->red_mask;
+  format.green_mask = (WuhooSize)x11_window->visual->green_mask;
+  format.blue_mask  = (WuhooSize)x11_window->visual->blue_mask;
+  format.msb_first  = (MSBFirst == ImageByteOrder(x11_window->display));
+  format.alpha_mask = 0;
+
+#ifdef WUHOO_XRENDER_ENABLE
+  /* Alpha is kept all the way to the compositing manager, in the bits of
+   * the ARGB visual that no color covers */
+  if (WUHOO_FLAG_TRANSPARENT & window->flags && 32 == format.bits_per_pixel)
+    format.alpha_mask =
+      ~(format.red_mask | format.green_mask | format.blue_mask) & 0xFFFFFFFF;
+#endif
+
+  result = WuhooConvertFormatSelect(window, &format);
+  if (WuhooSuccess != result) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : Visual has an unsupported pixel format";
+  }
+  x11_window->bytes_per_pixel = (int)format.bits_per_pixel / 8;
+
+  XSetWindowAttributes setwinattr;
+  setwinattr.override_redirect   = False;
+  setwinattr.border_pixel   = 0;
+  setwinattr.colormap   = cmap;
+  setwinattr.event_mask = StructureNotifyMask | FocusChangeMask | ExposureMask |
+                          KeyPressMask | KeyReleaseMask | ButtonPressMask |
+                          ButtonReleaseMask | PointerMotionMask;
+
+  /* Get geometry information about root window */
+  Window       root;
+  int          screen_x, screen_y;
+  unsigned int screen_width, screen_height, border_width, root_depth;
+  if (XGetGeometry(x11_window->display, x11_window->root, &root, &screen_x,
+                   &screen_y, &screen_width, &screen_height, &border_width,
+                   &root_depth) == False) {
+  }
+  WuhooRoundTripX11(window, 1);
+  x11_window->screen_width  = screen_width;
+  x11_window->screen_height = screen_height;
+
+  window->x =
+    (WuhooDefaultPosition != posx) ? posx : ((screen_width / 2) - (width / 2));
+  window->y = (WuhooDefaultPosition != posy)
+                ? posy
+                : ((screen_height / 2) - (height / 2));
+
+  window->width  = width;
+  window->height = height;
+  window->height +=
+    (WUHOO_FLAG_CLIENT_REGION & flags) ? x11_window->title_extents : 0;
+
+  window->cwidth = window->width;
+  window->cheight =
+    window->height -
+    ((WUHOO_FLAG_CLIENT_REGION & flags) ? x11_window->title_extents : 0);
+  x11_window->window =
+    XCreateWindow(x11_window->display, x11_window->root, window->x, window->y,
+                  window->cwidth, window->cheight, 0, depth, InputOutput,
+                  x11_window->visual, CWBorderPixel | CWColormap | CWEventMask | CWOverrideRedirect, &setwinattr);
+  
+  if (0 == x11_window->window) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : XCreateWindow failed";
+  }
+
+#ifdef WUHOO_OPENGL_ENABLE
+  x11_window->glc = glXCreateContext(x11_window->display, vi, NULL, GL_TRUE);
+  if (WuhooNull == x11_window->glc) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : glXCreateContext failed";
+  }
+  glXMakeCurrent(x11_window->display, x11_window->window, x11_window->glc);
+#endif
+
+  if (WUHOO_FLAG_TITLED & flags)
+    XSetStandardProperties(x11_window->display, x11_window->window, title, title,
+                           None, NULL, 0, NULL);
+
+  XSelectInput(x11_window->display, x11_window->window,
+               StructureNotifyMask | FocusChangeMask | ExposureMask |
+                 KeyPressMask | KeyReleaseMask | ButtonPressMask |
+                 ButtonReleaseMask | PointerMotionMask);
+  XSetWindowBorder(x11_window->display, x11_window->window, 1);
+
+  /* Root resizes (e.g. RandR) keep the cached screen size current */
+  XSelectInput(x11_window->display, x11_window->root, StructureNotifyMask);
+
+  x11_window->gc = XCreateGC(x11_window->display, x11_window->window, 0, NULL);
+
+#ifdef WUHOO_XRENDER_ENABLE
+  if (WuhooTrue == x11_window->has_render)
+    x11_window->render_window = XRenderCreatePicture(
+      x11_window->display, x11_window->window,
+      XRenderFindVisualFormat(x11_window->display, x11_window->visual), 0,
+      WuhooNull);
+#endif
+
+#ifdef WUHOO_XPRESENT_ENABLE
+  if (WuhooTrue == x11_window->has_present)
+    XPresentSelectInput(x11_window->display, x11_window->window,
+                        PresentCompleteNotifyMask | PresentIdleNotifyMask);
+#endif
+
+  Atom                wmMotifHints = None;
+  WuhooAtomRequestX11 atoms[]      = {
+    { "WM_DELETE_WINDOW", False, &x11_window->wmDeleteMessage },
+    { "_NET_WM_STATE", True, &x11_window->wmState },
+    { "_NET_WM_STATE_MAXIMIZED_HORZ", True, &x11_window->wmStateMaxHorz },
+    { "_NET_WM_STATE_MAXIMIZED_VERT", True, &x11_window->wmStateMaxVert },
+    { "_NET_WM_STATE_HIDDEN", True, &x11_window->wmStateHidden },
+    { "_NET_WM_STATE_FULLSCREEN", True, &x11_window->wmStateFull },
+    { "_NET_WM_NAME", False, &x11_window->wmName },
+    { "UTF8_STRING", False, &x11_window->utf8String },
+    { "_MOTIF_WM_HINTS", True, &wmMotifHints }
+  };
+  _WuhooInternAtomsX11(window, atoms, sizeof(atoms) / sizeof(atoms[0]));
+
+  /* Only needed with WUHOO_FLAG_FILE_DROP */
+  WuhooAtomRequestX11 drop_atoms[] = {
+    { "text/uri-list", False, &x11_window->XA_text_uri_list },
+    { "XdndSelection", False, &x11_window->XA_XdndSelection },
+    { "XdndAware", False, &x11_window->XA_XdndAware },
+    { "XdndEnter", False, &x11_window->XA_XdndEnter },
+    { "XdndLeave", False, &x11_window->XA_XdndLeave },
+    { "XdndTypeList", False, &x11_window->XA_XdndTypeList },
+    { "XdndPosition", False, &x11_window->XA_XdndPosition },
+    { "XdndActionCopy", False, &x11_window->XA_XdndActionCopy },
+    { "XdndStatus", False, &x11_window->XA_XdndStatus },
+    { "XdndDrop", False, &x11_window->XA_XdndDrop },
+    { "XdndFinished", False, &x11_window->XA_XdndFinished }
+  };
+  if (WUHOO_FLAG_FILE_DROP & flags)
+    _WuhooInternAtomsX11(window, drop_atoms,
+                         sizeof(drop_atoms) / sizeof(drop_atoms[0]));
+
+  XSetWMProtocols(x11_window->display, x11_window->window,
+                  &x11_window->wmDeleteMessage, 1);
+
+  if (WUHOO_FLAG_BORDERLESS & window->flags) {
+    if (None != wmMotifHints) {
+      /* Hints used by Motif compliant window managers */
+      struct
+      {
+        unsigned long flags;
+        unsigned long functions;
+        unsigned long decorations;
+        long input_mode;
+        unsigned long status;
+      } MWMHints = {
+        (1L << 1), 0, 0, 0, 0
+      };
+
+      XChangeProperty(x11_window->display, x11_window->window, wmMotifHints, wmMotifHints, 32, PropModeReplace, (unsigned char *) &MWMHints, sizeof(MWMHints) / sizeof(long));
+    } else { 
+      /* set the transient hints instead, if necessary */
+      XSetTransientForHint(x11_window->display, x11_window->window, RootWindow(x11_window->display, x11_window->screen));
+    }
+  }
+  
+  if (!(WUHOO_FLAG_RESIZEABLE & window->flags)) {
+    XSizeHints* size_hints = XAllocSizeHints();
+    size_hints->flags = PMinSize | PMaxSize;
+    size_hints->min_width = size_hints->max_width = window->cwidth;
+    size_hints->min_height = size_hints->max_height = window->cheight;
+    XSetNormalHints(x11_window->display, x11_window->window, size_hints);
+    XFree(size_hints);
+  }
+ 
+  /* Set up useful Atoms */
+  if (WUHOO_FLAG_FILE_DROP & flags) {
+    x11_window->XA_XdndReq = None;
+
+    x11_window->XdndVersion = 4;
+    XChangeProperty(x11_window->display, x11_window->window,
+                    x11_window->XA_XdndAware, XA_ATOM, 32, PropModeReplace,
+                    (unsigned char*)&x11_window->XdndVersion, 1);
+  }
+
+  return result;
+}
+
+WuhooResult
+_WuhooWindowShowX11(WuhooWindow* window)
+{
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+
+  XMapWindow(x11_window->display, x11_window->window);
+  XMapRaised(x11_window->display, x11_window->window);
+
+  XSetLocaleModifiers("");
+
+  XIM xim = XOpenIM(x11_window->display, NULL, NULL, NULL);
+  if (!xim) {
+    // fallback to internal input method
+    XSetLocaleModifiers("@im=none");
+    xim = XOpenIM(x11_window->display, 0, 0, 0);
+  }
+
+  // X input context, you can have multiple for text boxes etc, but having a
+  x11_window->ic = XCreateIC(
+    xim, XNInputStyle, XIMPreeditNothing | XIMStatusNothing, XNClientWindow,
+    x11_window->window, XNFocusWindow, x11_window->window, NULL);
+
+  XSetICFocus(x11_window->ic);
+
+  XMoveWindow(x11_window->display, x11_window->window, window->x, window->y);
+
+  return WuhooSuccess;
+}
+
+WuhooInternal WuhooResult
+_WuhooWindowStateX11(WuhooWindow* window)
+{
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+  WuhooResult     result     = WuhooSuccess;
+
+  Atom           type;
+  int            format;
+  unsigned long  nItem, bytesAfter;
+  unsigned char* properties = NULL;
+  while (XGetWindowProperty(x11_window->display, x11_window->window,
+                            x11_window->wmState, 0, (~0L) /* LONG_MAX */, False,
+                            AnyPropertyType, &type, &format, &nItem,
+                            &bytesAfter, &properties) != Success ||
+         bytesAfter != 0) {
+    WuhooRoundTripX11(window, 1);
+  }
+  WuhooRoundTripX11(window, 1);
+
+  WuhooBoolean max_vertical_resize = WuhooFalse;
+  WuhooBoolean max_horizontal_resize = WuhooFalse;
+ 
+  int iItem;
+  for (iItem = 0; iItem < nItem; ++iItem) {
+     max_horizontal_resize = (((unsigned long *)properties)[iItem] == x11_window->wmStateMaxHorz) ? WuhooTrue : max_horizontal_resize;
+     max_vertical_resize = (((unsigned long *)properties)[iItem] == x11_window->wmStateMaxVert) ? WuhooTrue : max_vertical_resize;
+  }
+
+  if ( WuhooTrue == max_horizontal_resize && WuhooTrue == max_vertical_resize ) {
+    window->window_flags |= WUHOO_WINDOW_FLAG_FULL_SCREEN | WUHOO_WINDOW_FLAG_MAXIMIZED;
+  }
+
+  return result;
+}
+
+typedef struct
+{
+  unsigned char* data;
+  int            format, count;
+  Atom           type;
+} WuhooPropertyX11;
+
+/* Reads property
+   Must call X11_XFree on results
+ */
+WuhooInternal void
+_WuhooReadPropertyX11(WuhooPropertyX11* p, Display* disp, Window w, Atom prop)
+{
+  unsigned char* ret = NULL;
+  Atom           type;
+  int            fmt;
+  unsigned long  count;
+  unsigned long  bytes_left;
+  int            bytes_fetch = 0;
+
+  do {
+    if (ret != 0)
+      XFree(ret);
+    XGetWindowProperty(disp, w, prop, 0, bytes_fetch, False, AnyPropertyType,
+                       &type, &fmt, &count, &bytes_left, &ret);
+    bytes_fetch += bytes_left;
+  } while (bytes_left != 0);
+
+  p->data   = ret;
+  p->format = fmt;
+  p->count  = count;
+  p->type   = type;
+}
+
+WuhooInternal WuhooKeyCode
+_WuhooKeyTranslateX11(KeySym ksym)
+{
+  switch (ksym) {
+      /* Undocumented KyeCode for X11X */
+    case XK_Menu: return WUHOO_VKEY_MENU; break;
+    case XK_comma: return WUHOO_VKEY_COMMA; break;
+    case XK_semicolon: return WUHOO_VKEY_SEMICOLON; break;
+    case XK_backslash: return WUHOO_VKEY_BACK_SLASH; break;
+    case XK_slash: return WUHOO_VKEY_FORWARD_SLASH; break;
+    case XK_quoteright: return WUHOO_VKEY_QUOTE; break;
+    case XK_bracketleft: return WUHOO_VKEY_LEFT_BRACKET; break;
+    case XK_bracketright: return WUHOO_VKEY_RIGHT_BRACKET; break;
+    case XK_equal: return WUHOO_VKEY_EQUALS; break;
+    case XK_minus: return WUHOO_VKEY_MINUS; break;
+    case XK_period: return WUHOO_VKEY_PERIOD; break;
+    case XK_grave: return WUHOO_VKEY_GRAVE; break;
+    case XK_KP_Decimal: return WUHOO_VKEY_KPAD_DECIMAL; break;
+    case XK_KP_Multiply: return WUHOO_VKEY_KPAD_MULITPLY; break;
+    case XK_KP_Add: return WUHOO_VKEY_KPAD_PLUS; break;
+    case XK_Num_Lock: return WUHOO_VKEY_KPAD_NUM_LOCK; break;
+    case XK_KP_Divide: return WUHOO_VKEY_KPAD_DIVIDE; break;
+    case XK_KP_Enter: return WUHOO_VKEY_KPAD_ENTER; break;
+    case XK_KP_Subtract: return WUHOO_VKEY_KPAD_MINUS; break;
+    case XK_KP_0: return WUHOO_VKEY_KPAD_0; break;
+    case XK_KP_1: return WUHOO_VKEY_KPAD_1; break;
+    case XK_KP_2: return WUHOO_VKEY_KPAD_2; break;
+    case XK_KP_3: return WUHOO_VKEY_KPAD_3; break;
+    case XK_KP_4: return WUHOO_VKEY_KPAD_4; break;
+    case XK_KP_5: return WUHOO_VKEY_KPAD_5; break;
+    case XK_KP_6: return WUHOO_VKEY_KPAD_6; break;
+    case XK_KP_7: return WUHOO_VKEY_KPAD_7; break;
+    case XK_KP_8: return WUHOO_VKEY_KPAD_8; break;
+    case XK_KP_9: return WUHOO_VKEY_KPAD_9; break;
+    case XK_0: return WUHOO_VKEY_0; break;
+    case XK_1: return WUHOO_VKEY_1; break;
+    case XK_2: return WUHOO_VKEY_2; break;
+    case XK_3: return WUHOO_VKEY_3; break;
+    case XK_4: return WUHOO_VKEY_4; break;
+    case XK_5: return WUHOO_VKEY_5; break;
+    case XK_6: return WUHOO_VKEY_6; break;
+    case XK_7: return WUHOO_VKEY_7; break;
+    case XK_8: return WUHOO_VKEY_8; break;
+    case XK_9: return WUHOO_VKEY_9; break;
+    case XK_A: return WUHOO_VKEY_A; break;
+    case XK_B: return WUHOO_VKEY_B; break;
+    case XK_C: return WUHOO_VKEY_C; break;
+    case XK_D: return WUHOO_VKEY_D; break;
+    case XK_E: return WUHOO_VKEY_E; break;
+    case XK_F: return WUHOO_VKEY_F; break;
+    case XK_G: return WUHOO_VKEY_G; break;
+    case XK_H: return WUHOO_VKEY_H; break;
+    case XK_I: return WUHOO_VKEY_I; break;
+    case XK_J: return WUHOO_VKEY_J; break;
+    case XK_K: return WUHOO_VKEY_K; break;
+    case XK_L: return WUHOO_VKEY_L; break;
+    case XK_M: return WUHOO_VKEY_M; break;
+    case XK_N: return WUHOO_VKEY_N; break;
+    case XK_O: return WUHOO_VKEY_O; break;
+    case XK_P: return WUHOO_VKEY_P; break;
+    case XK_Q: return WUHOO_VKEY_Q; break;
+    case XK_R: return WUHOO_VKEY_R; break;
+    case XK_S: return WUHOO_VKEY_S; break;
+    case XK_T: return WUHOO_VKEY_T; break;
+    case XK_U: return WUHOO_VKEY_U; break;
+    case XK_V: return WUHOO_VKEY_V; break;
+    case XK_W: return WUHOO_VKEY_W; break;
+    case XK_X: return WUHOO_VKEY_X; break;
+    case XK_Y: return WUHOO_VKEY_Y; break;
+    case XK_Z: return WUHOO_VKEY_Z; break;
+    case XK_Left: return WUHOO_VKEY_LEFT; break;
+    case XK_Right: return WUHOO_VKEY_RIGHT; break;
+    case XK_Up: return WUHOO_VKEY_UP; break;
+    case XK_Down: return WUHOO_VKEY_DOWN; break;
+    case XK_Escape: return WUHOO_VKEY_ESCAPE; break;
+    case XK_Return: return WUHOO_VKEY_ENTER; break;
+    case XK_Tab: return WUHOO_VKEY_TAB; break;
+    case XK_space: return WUHOO_VKEY_SPACE; break;
+    case XK_Delete: return WUHOO_VKEY_DELETE; break;
+    case XK_Shift_R: return WUHOO_VKEY_SHIFT; break;
+    case XK_Shift_L: return WUHOO_VKEY_SHIFT; break;
+    case XK_Alt_L: return WUHOO_VKEY_ALT; break;
+    case XK_Alt_R: return WUHOO_VKEY_ALT; break;
+    case XK_Caps_Lock: return WUHOO_VKEY_CAPS_LOCK; break;
+    case XK_Control_R: return WUHOO_VKEY_CONTROL; break;
+    case XK_Control_L: return WUHOO_VKEY_CONTROL; break;
+    case XK_F1: return WUHOO_VKEY_F1; break;
+    case XK_F2: return WUHOO_VKEY_F2; break;
+    case XK_F3: return WUHOO_VKEY_F3; break;
+    case XK_F4: return WUHOO_VKEY_F4; break;
+    case XK_F5: return WUHOO_VKEY_F5; break;
+    case XK_F6: return WUHOO_VKEY_F6; break;
+    case XK_F7: return WUHOO_VKEY_F7; break;
+    case XK_F8: return WUHOO_VKEY_F8; break;
+    case XK_F9: return WUHOO_VKEY_F9; break;
+    case XK_F10: return WUHOO_VKEY_F10; break;
+    case XK_F11: return WUHOO_VKEY_F11; break;
+    case XK_F12: return WUHOO_VKEY_F12; break;
+    case XK_Insert: return WUHOO_VKEY_INSERT; break;
+    case XK_Home: return WUHOO_VKEY_HOME; break;
+    case XK_Page_Up: return WUHOO_VKEY_PAGE_UP; break;
+    case XK_BackSpace: WUHOO_VKEY_BACKSPACE; break;
+    case XK_End: return WUHOO_VKEY_END; break;
+    case XK_Page_Down: return WUHOO_VKEY_PAGE_DOWN; break;
+
+    default: return WUHOO_VKEY_UNKNOWN; break;
+  }
+
+  return WUHOO_VKEY_UNKNOWN;
+}
+
+/* Find text-uri-list in a list of targets and return it's atom
+   if available, else return None */
+WuhooInternal Atom
+_WuhooPickTextTargetX11(Display* disp, Atom* list, int list_count)
+{
+  Atom  request = None;
+  char* name;
+  int   i;
+  for (i = 0; i < list_count && request == None; i++) {
+    name = XGetAtomName(disp, list[i]);
+
+    if (WuhooTrue == WuhooStringCmp("text/plain;charset=utf-8", name, 100)) {
+
+      request = list[i];
+    }
+    XFree(name);
+  }
+
+  return request;
+}
+
+WuhooInternal Atom
+_WuhooPickTextTargetFromThreeX11(Display* disp, Atom a0, Atom a1, Atom a2)
+{
+  int  count = 0;
+  Atom atom[3];
+  if (a0 != None)
+    atom[count++] = a0;
+  if (a1 != None)
+    atom[count++] = a1;
+  if (a2 != None)
+    atom[count++] = a2;
+  return _WuhooPickTextTargetX11(disp, atom, count);
+}
+
+WuhooInternal WuhooBoolean
+_WuhooIsXDigit(char c)
+{
+  return ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
+          (c >= 'A' && c <= 'F'));
+}
+
+WuhooInternal void
+_WuhooURIDecode(char* dst, const char* src)
+{
+  char a, b;
+  while (*src) {
+    if ((*src == '%') && ((a = src[1]) && (b = src[2])) &&
+        (_WuhooIsXDigit(a) && _WuhooIsXDigit(b))) {
+      if (a >= 'a')
+        a -= 'a' - 'A';
+      if (a >= 'A')
+        a -= ('A' - 10);
+      else
+        a -= '0';
+      if (b >= 'a')
+        b -= 'a' - 'A';
+      if (b >= 'A')
+        b -= ('A' - 10);
+      else
+        b -= '0';
+      *dst++ = 16 * a + b;
+      src += 3;
+    } else if (*src == '+') {
+      *dst++ = ' ';
+      src++;
+    } else {
+      *dst++ = *src++;
+    }
+  }
+  *dst++ = '\0';
+}
+
+WuhooInternal WuhooResult
+_WuhooWindowDropContentsGetX11(WuhooWindow* window, WuhooEvent* event,
+                               char* buffer, int buffer_size)
+{
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+  WuhooZeroInit(buffer, buffer_size);
+
+  WuhooPropertyX11 p;
+  _WuhooReadPropertyX11(&p, x11_window->display, x11_window->window,
+                        (Atom)event->data.drop.context);
+
+  char* at  = (char*)p.data;
+  char* end = at;
+  while (*end) {
+    end++;
+  }
+  end--;
+  while (*end == 10 || *end == 13) {
+    end--;
+  }
+
+  end++;
+
+  int   count         = 0;
+  char* memory_offset = buffer;
+  int   index         = 0;
+  for (index = 0; index < event->data.drop.count; index++) {
+    at += sizeof("file://") - 1;
+    while (*at != 10 && *at != 13) {
+      *memory_offset++ = *at++;
+    }
+    *memory_offset++ = '\n';
+    while (*at == 10 || *at == 13) {
+      at++;
+    }
+  }
+
+  *memory_offset = 0;
+
+  _WuhooURIDecode(buffer, buffer);
+
+  XFree(p.data);
+  XDeleteProperty(x11_window->display, x11_window->window,
+                  (Atom)event->data.drop.context);
+
+  return WuhooSuccess;
+}
+
+WuhooInternal void
+_WuhooWindowEventGobbleX11(WuhooWindow* window, int event_type)
+{
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+  XEvent          dummy;
+  while (True == XCheckTypedEvent(x11_window->display, event_type, &dummy)) {
+  }
+}
+
+WuhooResult
+_WuhooWindowEventNextX11(WuhooWindow* window, WuhooEvent* event)
+{
+  WuhooWindowX11* x11_window = (WuhooWindowX11*)window->platform_window;
+
+  XEvent xevent;
+
+  if (XPending(x11_window->display) == 0) {
+    return WuhooSuccess;
+  }
+
+  XNextEvent(x11_window->display, &xevent);
+  if (Expose == xevent.type)
+    _WuhooWindowEventGobbleX11(window, Expose);
+  if (MotionNotify == xevent.type)
+    _WuhooWindowEventGobbleX11(window, MotionNotify);
+  if (True == XFilterEvent(&xevent, None)) {
+    XNextEvent(x11_window->display, &xevent);
+  }
+
+#ifdef WUHOO_XSHM_ENABLE
+  if (x11_window->shm_completion_type == xevent.type) {
+    _WuhooWindowShmCompleteX11(window, (XShmCompletionEvent*)&xevent);
+  }
+#endif
+
+  switch (xevent.type) {
+#ifdef WUHOO_XPRESENT_ENABLE
+    case GenericEvent: {
+      XGenericEventCookie* cookie = &xevent.xcookie;
+      if (cookie->extension != x11_window->present_opcode ||
+          False == XGetEventData(x11_window->display, cookie))
+        break;
+
+      if (PresentCompleteNotify == cookie->evtype) {
+        XPresentCompleteNotifyEvent* complete =
+          (XPresentCompleteNotifyEvent*)cookie->data;
+        event->type              = WUHOO_EVT_FRAME;
+        event->data.frame.ust    = complete->ust;
+        event->data.frame.msc    = complete->msc;
+        event->data.frame.serial = complete->serial_number;
+      } else if (PresentIdleNotify == cookie->evtype) {
+        _WuhooWindowPresentIdleX11(window,
+                                   (XPresentIdleNotifyEvent*)cookie->data);
+      }
+
+      XFreeEventData(x11_window->display, cookie);
+      break;
+    }
+#endif
+    case FocusIn: {
+      window->window_flags |= WUHOO_WINDOW_FLAG_FOCUS_GAINED;
+      break;
+    }
+    case FocusOut: {
+      window->window_flags |= WUHOO_WINDOW_FLAG_FOCUS_GAINED;
+      break;
+    }
+    case Expose: {
+      /* https://tronche.com/gui/x/xlib/events/exposure/expose.html */
+      /* Careful with how many expensive "expose" events we trigger */
+      XExposeEvent* xexpose = &xevent.xexpose;
+      window->window_flags |=
+        (xexpose->count < 5) ? WUHOO_WINDOW_FLAG_REGION_UPDATED : 0;
+      break;
+    }
+    case ConfigureNotify: {
+      XConfigureEvent* xce = &xevent.xconfigure;
+
+      if (xce->window == x11_window->root) {
+        x11_window->screen_width  = xce->width;
+        x11_window->screen_height = xce->height;
+        break;
+      }
+
+      /* This event type is generated for a variety of
+         happenings, so check whether the window has been
+         resized. */
+
+      if (xce->x != x11_window->prev_x || xce->y != x11_window->prev_y) {
+        x11_window->prev_x = xce->x;     
+        x11_window->prev_y = xce->y;
+
+        int client_width, client_height;
+        _WuhooWindowGeometryGetX11(window, &window->x, &window->y,
+                                   &client_width, &client_height, WuhooNull,
+                                   WuhooNull);
+
+        _WuhooWindowStateX11(window);
+        window->window_flags |= WUHOO_WINDOW_FLAG_MOVED;
+      }
+
+      if (xce->width != window->cwidth || xce->height != window->cheight) {
+        window->cwidth  = xce->width;
+        window->cheight = xce->height;
+
+        window->width  = window->cwidth;
+        window->height = window->cheight + x11_window->title_extents;
+
+        /* Reallocated with the new client size on the next blit */
+        _WuhooWindowImageDestroyX11(window);
+
+        _WuhooWindowStateX11(window);
+        window->window_flags |= WUHOO_WINDOW_FLAG_RESIZED;
+      }
+    } break;
+    case SelectionNotify: {
+      XSelectionEvent* sev = (XSelectionEvent*)&xevent.xselection;
+      if (sev->property == None)
+        break;
+
+      WuhooPropertyX11 p;
+      _WuhooReadPropertyX11(&p, x11_window->display, x11_window->window,
+                            sev->property);
+
+      char* at             = (char*)p.data;
+      int   count          = 0;
+      int   bytes_required = 0;
+      while (*at) {
+        if (*at == 10) {
+          at++;
+          continue;
+        }
+        count += (*at == 13) ? 1 : 0;
+        bytes_required += (*at != 13) ? 1 : 0;
+        at++;
+      }
+
+      event->data.drop.context = (WuhooHandle)sev->property;
+      event->data.drop.size =
+        bytes_required + 1 - (sizeof("file://") - 1) * count + 1;
+      event->data.drop.count = count;
+      event->type            = WUHOO_EVT_DROP;
+
+      XFree(p.data);
+
+    } break;
+    case ClientMessage: {
+      if (xevent.xclient.data.l[0] == x11_window->wmDeleteMessage) {
+        window->window_flags |= WUHOO_WINDOW_FLAG_CLOSED;
+        window->is_alive = WuhooFalse;
+
+        break;
+      } else if (xevent.xclient.message_type == x11_window->XA_XdndDrop) {
+        if (x11_window->XA_XdndReq == None) {
+          /* say again - not interested! */
+          XClientMessageEvent m;
+          /* reply with status */
+          WuhooZeroInit(&m, sizeof(XClientMessageEvent));
+          m.type         = ClientMessage;
+          m.display      = xevent.xclient.display;
+          m.window       = xevent.xclient.data.l[0];
+          m.message_type = x11_window->XA_XdndFinished;
+          m.format       = 32;
+          m.data.l[0]    = x11_window->window;
+          m.data.l[1]    = 0;
+          m.data.l[2]    = None; /* fail! */
+          XSendEvent(x11_window->display, xevent.xclient.data.l[0], False,
+                     NoEventMask, (XEvent*)&m);
+          XFlush(x11_window->display);
+        } else {
+          /* convert */
+          if (x11_window->XdndVersion >= 1) {
+            XConvertSelection(x11_window->display, x11_window->XA_XdndSelection,
+                              x11_window->XA_XdndReq, XA_PRIMARY,
+                              x11_window->window, xevent.xclient.data.l[2]);
+          } else {
+            XConvertSelection(x11_window->display, x11_window->XA_XdndSelection,
+                              x11_window->XA_XdndReq, XA_PRIMARY,
+                              x11_window->window, CurrentTime);
+          }
+        }
+      } else if (xevent.xclient.message_type == x11_window->XA_XdndPosition) {
+
+      } else if (xevent.xclient.message_type == x11_window->XA_XdndEnter) {
+        WuhooBoolean use_list = xevent.xclient.data.l[1] & 1;
+        if (use_list) {
+          WuhooPropertyX11 p;
+          _WuhooReadPropertyX11(&p, x11_window->display,
+                                xevent.xclient.data.l[0],
+                                x11_window->XA_XdndTypeList);
+          /* pick one */
+          x11_window->XA_XdndReq = _WuhooPickTextTargetX11(
+            x11_window->display, (Atom*)p.data, p.count);
+          XFree(p.data);
+        } else {
+          /* pick from list of three */
+          x11_window->XA_XdndReq = _WuhooPickTextTargetFromThreeX11(
+            x11_window->display, xevent.xclient.data.l[2],
+            xevent.xclient.data.l[3], xevent.xclient.data.l[4]);
+        }
+
+        XClientMessageEvent m;
+        /* reply with status */
+        WuhooZeroInit(&m, sizeof(XClientMessageEvent));
+        m.type         = ClientMessage;
+        m.display      = xevent.xclient.display;
+        m.window       = xevent.xclient.data.l[0];
+        m.message_type = x11_window->XA_XdndStatus;
+        m.format       = 32;
+        m.data.l[0]    = x11_window->window;
+        m.data.l[1]    = (x11_window->XA_XdndReq != None);
+        m.data.l[2]    = 0; /* specify an empty rectangle */
+        m.data.l[3]    = 0;
+        m.data.l[4] =
+          x11_window->XA_XdndActionCopy; /* we only accept copying anyway */
+
+        XSendEvent(x11_window->display, xevent.xclient.data.l[0], False,
+                   NoEventMask, (XEvent*)&m);
+        XFlush(x11_window->display);
+      }
+    } break;
+    case MotionNotify: {
+      event->type                  = WUHOO_EVT_MOUSE_MOVE;
+      event->data.mouse_move.x     = xevent.xmotion.x;
+      event->data.mouse_move.y     = xevent.xmotion.y;
+      event->data.mouse_move.state = WUHOO_MSTATE_UNKNOWN;
+
+      if (xevent.xmotion.state & Button1MotionMask)
+        event->data.mouse_move.state = WUHOO_MSTATE_LPRESSED;
+      else if (xevent.xmotion.state & Button2MotionMask)
+        event->data.mouse_move.state = WUHOO_MSTATE_MPRESSED;
+      else if (xevent.xmotion.state & Button3MotionMask)
+        event->data.mouse_move.state = WUHOO_MSTATE_RPRESSED;
+      event->data.mouse_move.mods |=
+        (xevent.xmotion.state & ShiftMask) ? WUHOO_KMOD_SHIFT : 0;
+      event->data.mouse_move.mods |=
+        (xevent.xmotion.state & ControlMask) ? WUHOO_KMOD_CTRL : 0;
+      event->data.mouse_move.mods |=
+        (xevent.xmotion.state & LockMask) ? WUHOO_KMOD_CAPS : 0;
+    } break;
+    case ButtonPress: {
+      if (Button4 == xevent.xbutton.button ||
+          Button5 == xevent.xbutton.button) {
+        event->type = WUHOO_EVT_MOUSE_WHEEL;
+        event->data.mouse_wheel.mods |=
+          (xevent.xbutton.state & ShiftMask) ? WUHOO_KMOD_SHIFT : 0;
+        event->data.mouse_wheel.mods |=
+          (xevent.xbutton.state & ControlMask) ? WUHOO_KMOD_CTRL : 0;
+        event->data.mouse_wheel.mods |=
+          (xevent.xbutton.state & LockMask) ? WUHOO_KMOD_CAPS : 0;
+        event->data.mouse_wheel.x = xevent.xbutton.x;
+        event->data.mouse_wheel.y = xevent.xbutton.y;
+        event->data.mouse_wheel.delta_y =
+          (Button4 == xevent.xbutton.button) ? 1.0f : -1.0f;
+
+        break;
+      }
+
+      event->type                         = WUHOO_EVT_MOUSE_PRESS;
+      event->data.mouse_press.click_count = 1;
+      event->data.mouse_press.mods |=
+        (xevent.xbutton.state & ShiftMask) ? WUHOO_KMOD_SHIFT : 0;
+      event->data.mouse_press.mods |=
+        (xevent.xbutton.state & ControlMask) ? WUHOO_KMOD_CTRL : 0;
+      event->data.mouse_press.mods |=
+        (xevent.xbutton.state & LockMask) ? WUHOO_KMOD_CAPS : 0;
+      if (Button1 == xevent.xbutton.button)
+        event->data.mouse_press.state = WUHOO_MSTATE_LPRESSED;
+      else if (Button2 == xevent.xbutton.button)
+        event->data.mouse_press.state = WUHOO_MSTATE_MPRESSED;
+      else if (Button3 == xevent.xbutton.button)
+        event->data.mouse_press.state = WUHOO_MSTATE_RPRESSED;
+
+    } break;
+    case ButtonRelease: {
+      if (Button4 == xevent.xbutton.button || Button5 == xevent.xbutton.button)
+        break;
+
+      event->type                         = WUHOO_EVT_MOUSE_PRESS;
+      event->data.mouse_press.click_count = 1;
+      if (Button1 == xevent.xbutton.button)
+        event->data.mouse_press.state = WUHOO_MSTATE_LRELEASED;
+      else if (Button2 == xevent.xbutton.button)
+        event->data.mouse_press.state = WUHOO_MSTATE_RRELEASED;
+      else if (Button3 == xevent.xbutton.button)
+        event->data.mouse_press.state = WUHOO_MSTATE_MRELEASED;
+      event->data.mouse_press.mods |=
+        (xevent.xbutton.state & ShiftMask) ? WUHOO_KMOD_SHIFT : 0;
+      event->data.mouse_press.mods |=
+        (xevent.xbutton.state & ControlMask) ? WUHOO_KMOD_CTRL : 0;
+      event->data.mouse_press.mods |=
+        (xevent.xbutton.state & LockMask) ? WUHOO_KMOD_CAPS : 0;
+    } break;
+    case KeyRelease: {
+      KeySym ksym;
+      Status status;
+      char   buff[16];
+
+      /* Override this in order for Xutf8LookupString to work */
+      xevent.xkey.type = KeyPress;
+      size_t c = Xutf8LookupString(x11_window->ic, &xevent.xkey, buff, 16 - 1,
+                                   &ksym, &status);
+
+      buff[c] = 0;
+
+      event->type = WUHOO_EVT_KEY;
+      WuhooStringCopy((char*)event->data.key.character, buff, c);
+      event->data.key.state = WUHOO_KSTATE_UP;
+      event->data.key.code  = _WuhooKeyTranslateX11(ksym);
+      event->data.key.mods |=
+        (xevent.xkey.state & ShiftMask) ? WUHOO_KMOD_SHIFT : 0;
+      event->data.key.mods |=
+        (xevent.xkey.state & ControlMask) ? WUHOO_KMOD_CTRL : 0;
+      event->data.key.mods |=
+        (xevent.xkey.state & LockMask) ? WUHOO_KMOD_CAPS : 0;
+
+      break;
+    }
+    case KeyPress: {
+      KeySym ksym;
+      Status status;
+      char   buff[16];
+
+      size_t c = Xutf8LookupString(x11_window->ic, &xevent.xkey, buff, 16 - 1,
+                                   &ksym, &status);
+
+      buff[c] = 0;
+
+      event->type = WUHOO_EVT_KEY;
+      WuhooStringCopy((char*)event->data.key.character, buff, c);
+      event->data.key.state = WUHOO_KSTATE_DOWN;
+      event->data.key.code  = _WuhooKeyTranslateX11(ksym);
+      event->data.key.mods |=
+        (xevent.xkey.state & ShiftMask) ? WUHOO_KMOD_SHIFT : 0;
+      event->data.key.mods |=
+        (xevent.xkey.state & ControlMask) ? WUHOO_KMOD_CTRL : 0;
+      event->data.key.mods |=
+        (xevent.xkey.state & LockMask) ? WUHOO_KMOD_CAPS : 0;
+
+      break;
+    }
+    default:
+      // XFlush(x11_window->display);
+      break;
+  }
+
+  WuhooWindowFlagsEvent(window, event);
+
+  return WuhooSuccess;
+}
+
+#endif /* WUHOO_X11_ENABLE */
+
+#if defined(WUHOO_WAYLAND_ENABLE) || defined(WUHOO_FBDEV_ENABLE)
+
+#include <linux/input-event-codes.h>
+
+/* Linux input event codes are translated as if a US layout was active,
+ * there is no xkbcommon to interpret the actual keymap */
+typedef struct
+{
+  WuhooKeyCode code;
+  char         character;
+  char         shifted;
+} WuhooKeyEvdev;
+
+static const WuhooKeyEvdev WuhooKeysEvdev[] = {
+  { WUHOO_VKEY_UNKNOWN, 0, 0 },
+  { WUHOO_VKEY_ESCAPE, 27, 27 },
+  { WUHOO_VKEY_1, '1', '!' },
+  { WUHOO_VKEY_2, '2', '@' },
+  { WUHOO_VKEY_3, '3', '#' },
+  { WUHOO_VKEY_4, '4', '$' },
+  { WUHOO_VKEY_5, '5', '%' },
+  { WUHOO_VKEY_6, '6', '^' },
+  { WUHOO_VKEY_7, '7', '&' },
+  { WUHOO_VKEY_8, '8', '*' },
+  { WUHOO_VKEY_9, '9', '(' },
+  { WUHOO_VKEY_0, '0', ')' },
+  { WUHOO_VKEY_MINUS, '-', '_' },
+  { WUHOO_VKEY_EQUALS, '=', '+' },
+  { WUHOO_VKEY_BACKSPACE, 8, 8 },
+  { WUHOO_VKEY_TAB, '\t', '\t' },
+  { WUHOO_VKEY_Q, 'q', 'Q' },
+  { WUHOO_VKEY_W, 'w', 'W' },
+  { WUHOO_VKEY_E, 'e', 'E' },
+  { WUHOO_VKEY_R, 'r', 'R' },
+  { WUHOO_VKEY_T, 't', 'T' },
+  { WUHOO_VKEY_Y, 'y', 'Y' },
+  { WUHOO_VKEY_U, 'u', 'U' },
+  { WUHOO_VKEY_I, 'i', 'I' },
+  { WUHOO_VKEY_O, 'o', 'O' },
+  { WUHOO_VKEY_P, 'p', 'P' },
+  { WUHOO_VKEY_LEFT_BRACKET, '[', '{' },
+  { WUHOO_VKEY_RIGHT_BRACKET, ']', '}' },
+  { WUHOO_VKEY_ENTER, '\r', '\r' },
+  { WUHOO_VKEY_CONTROL, 0, 0 },
+  { WUHOO_VKEY_A, 'a', 'A' },
+  { WUHOO_VKEY_S, 's', 'S' },
+  { WUHOO_VKEY_D, 'd', 'D' },
+  { WUHOO_VKEY_F, 'f', 'F' },
+  { WUHOO_VKEY_G, 'g', 'G' },
+  { WUHOO_VKEY_H, 'h', 'H' },
+  { WUHOO_VKEY_J, 'j', 'J' },
+  { WUHOO_VKEY_K, 'k', 'K' },
+  { WUHOO_VKEY_L, 'l', 'L' },
+  { WUHOO_VKEY_SEMICOLON, ';', ':' },
+  { WUHOO_VKEY_QUOTE, '\'', '"' },
+  { WUHOO_VKEY_GRAVE, '`', '~' },
+  { WUHOO_VKEY_SHIFT, 0, 0 },
+  { WUHOO_VKEY_BACK_SLASH, '\\', '|' },
+  { WUHOO_VKEY_Z, 'z', 'Z' },
+  { WUHOO_VKEY_X, 'x', 'X' },
+  { WUHOO_VKEY_C, 'c', 'C' },
+  { WUHOO_VKEY_V, 'v', 'V' },
+  { WUHOO_VKEY_B, 'b', 'B' },
+  { WUHOO_VKEY_N, 'n', 'N' },
+  { WUHOO_VKEY_M, 'm', 'M' },
+  { WUHOO_VKEY_COMMA, ',', '<' },
+  { WUHOO_VKEY_PERIOD, '.', '>' },
+  { WUHOO_VKEY_FORWARD_SLASH, '/', '?' },
+  { WUHOO_VKEY_SHIFT, 0, 0 },
+  { WUHOO_VKEY_KPAD_MULITPLY, '*', '*' },
+  { WUHOO_VKEY_ALT, 0, 0 },
+  { WUHOO_VKEY_SPACE, ' ', ' ' },
+  { WUHOO_VKEY_CAPS_LOCK, 0, 0 },
+};
+
+WuhooInternal WuhooKeyCode
+_WuhooKeyTranslateEvdev(unsigned int key, WuhooKeyModifiers mods,
+                        WuhooUTF8* character)
+{
+  character[0] = 0;
+
+  if (key < sizeof(WuhooKeysEvdev) / sizeof(WuhooKeysEvdev[0])) {
+    WuhooKeyEvdev const* entry   = &WuhooKeysEvdev[key];
+    WuhooBoolean         shifted = (0 != (mods & WUHOO_KMOD_SHIFT));
+
+    /* Caps lock only affects letters */
+    if (entry->code >= WUHOO_VKEY_A && entry->code <= WUHOO_VKEY_Z &&
+        (mods & WUHOO_KMOD_CAPS)) {
+      shifted = !shifted;
+    }
+
+    character[0] = (WuhooUTF8)(shifted ? entry->shifted : entry->character);
+    character[1] = 0;
+
+    return entry->code;
+  }
+
+  switch (key) {
+    case KEY_F1: return WUHOO_VKEY_F1;
+    case KEY_F2: return WUHOO_VKEY_F2;
+    case KEY_F3: return WUHOO_VKEY_F3;
+    case KEY_F4: return WUHOO_VKEY_F4;
+    case KEY_F5: return WUHOO_VKEY_F5;
+    case KEY_F6: return WUHOO_VKEY_F6;
+    case KEY_F7: return WUHOO_VKEY_F7;
+    case KEY_F8: return WUHOO_VKEY_F8;
+    case KEY_F9: return WUHOO_VKEY_F9;
+    case KEY_F10: return WUHOO_VKEY_F10;
+    case KEY_F11: return WUHOO_VKEY_F11;
+    case KEY_F12: return WUHOO_VKEY_F12;
+    case KEY_NUMLOCK: return WUHOO_VKEY_KPAD_NUM_LOCK;
+    case KEY_KP0: return WUHOO_VKEY_KPAD_0;
+    case KEY_KP1: return WUHOO_VKEY_KPAD_1;
+    case KEY_KP2: return WUHOO_VKEY_KPAD_2;
+    case KEY_KP3: return WUHOO_VKEY_KPAD_3;
+    case KEY_KP4: return WUHOO_VKEY_KPAD_4;
+    case KEY_KP5: return WUHOO_VKEY_KPAD_5;
+    case KEY_KP6: return WUHOO_VKEY_KPAD_6;
+    case KEY_KP7: return WUHOO_VKEY_KPAD_7;
+    case KEY_KP8: return WUHOO_VKEY_KPAD_8;
+    case KEY_KP9: return WUHOO_VKEY_KPAD_9;
+    case KEY_KPMINUS: return WUHOO_VKEY_KPAD_MINUS;
+    case KEY_KPPLUS: return WUHOO_VKEY_KPAD_PLUS;
+    case KEY_KPDOT: return WUHOO_VKEY_KPAD_DECIMAL;
+    case KEY_KPENTER: return WUHOO_VKEY_KPAD_ENTER;
+    case KEY_KPSLASH: return WUHOO_VKEY_KPAD_DIVIDE;
+    case KEY_KPEQUAL: return WUHOO_VKEY_KPAD_EQUALS;
+    case KEY_RIGHTCTRL: return WUHOO_VKEY_CONTROL;
+    case KEY_RIGHTALT: return WUHOO_VKEY_ALT;
+    case KEY_HOME: return WUHOO_VKEY_HOME;
+    case KEY_END: return WUHOO_VKEY_END;
+    case KEY_PAGEUP: return WUHOO_VKEY_PAGE_UP;
+    case KEY_PAGEDOWN: return WUHOO_VKEY_PAGE_DOWN;
+    case KEY_INSERT: return WUHOO_VKEY_INSERT;
+    case KEY_DELETE: return WUHOO_VKEY_DELETE;
+    case KEY_UP: return WUHOO_VKEY_UP;
+    case KEY_DOWN: return WUHOO_VKEY_DOWN;
+    case KEY_LEFT: return WUHOO_VKEY_LEFT;
+    case KEY_RIGHT: return WUHOO_VKEY_RIGHT;
+    case KEY_COMPOSE: return WUHOO_VKEY_MENU;
+    case KEY_SYSRQ: return WUHOO_VKEY_PRINTSCREEN;
+    default: break;
+  }
+
+  return WUHOO_VKEY_UNKNOWN;
+}
+
+#endif
+
+#ifdef WUHOO_WAYLAND_ENABLE
+
+#include <wayland-client.h>
+/* Generated from stable/xdg-shell/xdg-shell.xml of wayland-protocols with
+ * wayland-scanner client-header, the private-code output has to be compiled
+ * into the application as well */
+#include "xdg-shell-client-protocol.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+
+#define WUHOO_WAYLAND_BUFFER_COUNT 2 /* Front and back wl_buffer */
+
+#ifndef WUHOO_WAYLAND_EVENT_COUNT
+#define WUHOO_WAYLAND_EVENT_COUNT 16 /* Input events queued between two WuhooWindowEventNext */
+#endif
+
+#ifndef WUHOO_WAYLAND_FRAME_TIMEOUT
+#define WUHOO_WAYLAND_FRAME_TIMEOUT 100 /* Milliseconds a paced blit waits for a hidden surface */
+#endif
+
+typedef struct
+{
+  struct wl_buffer* buffer;
+  unsigned char*    data;  /* This buffer's slice of the pool */
+  WuhooRect         stale; /* Committed on the other buffer since this one was drawn */
+  WuhooBoolean      busy;  /* Attached and not released by the compositor yet */
+} WuhooBufferWayland;
+
+typedef struct
+{
+  struct wl_display*    display;
+  struct wl_registry*   registry;
+  struct wl_compositor* compositor;
+  struct wl_shm*        shm;
+  struct xdg_wm_base*   wm_base;
+  struct wl_seat*       seat;
+  struct wl_pointer*    pointer;
+  struct wl_keyboard*   keyboard;
+  struct wl_surface*    surface;
+  struct xdg_surface*   xdg_surface;
+  struct xdg_toplevel*  toplevel;
+  struct wl_callback*   frame_callback; /* Pending for the last paced commit */
+
+  WuhooBufferWayland buffers[WUHOO_WAYLAND_BUFFER_COUNT];
+  unsigned char*     pool_data; /* Every buffer, mapped once */
+  WuhooSize          pool_size;
+  WuhooSize          pitch;
+  int                buffer_width;
+  int                buffer_height;
+  int                buffer_index;    /* Last buffer attached to the surface */
+  int                buffer_acquired; /* Drawn into but not committed, or -1 */
+
+  WuhooSize frame_serial;
+  WuhooSize frame_count;
+
+  WuhooEvent events[WUHOO_WAYLAND_EVENT_COUNT]; /* Produced by the listeners */
+  int        event_head;
+  int        event_count;
+
+  int               pointer_x;
+  int               pointer_y;
+  int               buttons; /* WUHOO_MSTATE_*PRESSED of the held buttons */
+  WuhooKeyModifiers mods;
+
+  int          configure_width; /* Suggested by the last toplevel configure */
+  int          configure_height;
+  WuhooBoolean configured;
+} WuhooWindowWayland;
+
+/* Fails to compile if the Wayland state outgrows WuhooWindow::memory */
+typedef char WuhooWindowWaylandSizeCheck
+  [(sizeof(WuhooWindowWayland) <= WUHOO_PLATFORM_MEMORY_SIZE) ? 1 : -1];
+
+/* Appends an event to the queue drained by WuhooWindowEventNext, dropping the
+ * oldest one when it is full. Consecutive motion events are merged */
+WuhooInternal WuhooEvent*
+_WuhooWindowEventPushWayland(WuhooWindow* window, WuhooEventType type)
+{
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+  WuhooEvent*         event     = (WuhooEvent*)WuhooNull;
+
+  if (wl_window->event_count > 0) {
+    int last = (wl_window->event_head + wl_window->event_count - 1) %
+               WUHOO_WAYLAND_EVENT_COUNT;
+    event = &wl_window->events[last];
+    if (WUHOO_EVT_MOUSE_MOVE == type && type == event->type) {
+      WuhooZeroInit(event, sizeof(*event));
+      event->type = type;
+
+      return event;
+    }
+  }
+
+  if (WUHOO_WAYLAND_EVENT_COUNT == wl_window->event_count) {
+    wl_window->event_head =
+      (wl_window->event_head + 1) % WUHOO_WAYLAND_EVENT_COUNT;
+    wl_window->event_count--;
+  }
+
+  event = &wl_window->events[(wl_window->event_head + wl_window->event_count) %
+                             WUHOO_WAYLAND_EVENT_COUNT];
+  wl_window->event_count++;
+
+  WuhooZeroInit(event, sizeof(*event));
+  event->type = type;
+
+  return event;
+}
+
+/* WuhooStringCmp accepts prefixes, global names have to match exactly */
+WuhooInternal WuhooBoolean
+_WuhooInterfaceMatchWayland(const char* name, const struct wl_interface* interface)
+{
+  const char* expected = interface->name;
+
+  while ('\0' != *name && *name == *expected) {
+    name++;
+    expected++;
+  }
+
+  return (*name == *expected);
+}
+
+/* The buffer is shared with the compositor through an anonymous file */
+WuhooInternal int
+_WuhooShmFileCreateWayland(WuhooSize size)
+{
+  /* memfd_create is only declared with _GNU_SOURCE */
+  int fd = (int)syscall(SYS_memfd_create, WUHOO_STRING, 1u /* MFD_CLOEXEC */);
+  int ret;
+
+  if (fd < 0) {
+    return -1;
+  }
+
+  do {
+    ret = ftruncate(fd, (off_t)size);
+  } while (ret < 0 && EINTR == errno);
+
+  if (ret < 0) {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+WuhooInternal void
+_WuhooBufferReleaseWayland(void* data, struct wl_buffer* buffer)
+{
+  WuhooBufferWayland* wl_buffer = (WuhooBufferWayland*)data;
+
+  WuhooUnused(buffer);
+
+  wl_buffer->busy = WuhooFalse;
+}
+
+static const struct wl_buffer_listener WuhooBufferListenerWayland = {
+  _WuhooBufferReleaseWayland
+};
+
+WuhooInternal void
+_WuhooWindowBuffersDestroyWayland(WuhooWindow* window)
+{
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+  int                 index     = 0;
+
+  for (index = 0; index < WUHOO_WAYLAND_BUFFER_COUNT; index++) {
+    WuhooBufferWayland* buffer = &wl_window->buffers[index];
+
+    if (WuhooNull != buffer->buffer) {
+      wl_buffer_destroy(buffer->buffer);
+    }
+
+    WuhooZeroInit(buffer, sizeof(*buffer));
+  }
+
+  if (WuhooNull != wl_window->pool_data) {
+    munmap(wl_window->pool_data, wl_window->pool_size);
+    wl_window->pool_data = (unsigned char*)WuhooNull;
+  }
+
+  wl_window->pool_size       = 0;
+  wl_window->buffer_width    = 0;
+  wl_window->buffer_height   = 0;
+  wl_window->buffer_index    = 0;
+  wl_window->buffer_acquired = -1;
+}
+
+/* Both buffers are carved out of a single pool that is mapped once */
+WuhooInternal WuhooResult
+_WuhooWindowBuffersCreateWayland(WuhooWindow* window, int width, int height)
+{
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+  struct wl_shm_pool* pool      = (struct wl_shm_pool*)WuhooNull;
+  int                 index     = 0;
+  int                 fd        = -1;
+
+  _WuhooWindowBuffersDestroyWayland(window);
+
+  if (width <= 0 || height <= 0) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING " : Invalid buffer size";
+  }
+
+  WuhooSize pitch       = (WuhooSize)width * 4;
+  WuhooSize buffer_size = pitch * height;
+  WuhooSize pool_size   = buffer_size * WUHOO_WAYLAND_BUFFER_COUNT;
+
+  fd = _WuhooShmFileCreateWayland(pool_size);
+  if (fd < 0) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING " : memfd_create failed";
+  }
+
+  void* pool_data =
+    mmap(WuhooNull, pool_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (MAP_FAILED == pool_data) {
+    close(fd);
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING " : mmap failed";
+  }
+
+  pool = wl_shm_create_pool(wl_window->shm, fd, (int32_t)pool_size);
+
+  for (index = 0; index < WUHOO_WAYLAND_BUFFER_COUNT; index++) {
+    WuhooBufferWayland* buffer = &wl_window->buffers[index];
+
+    /* XRGB8888 is B, G, R, X in memory, the same as WuhooConvertRGBAtoBGRA */
+    buffer->buffer = wl_shm_pool_create_buffer(
+      pool, (int32_t)(index * buffer_size), width, height, (int32_t)pitch,
+      WL_SHM_FORMAT_XRGB8888);
+    buffer->data = (unsigned char*)pool_data + index * buffer_size;
+    wl_buffer_add_listener(buffer->buffer, &WuhooBufferListenerWayland, buffer);
+  }
+
+  /* The buffers keep the pool's memory alive */
+  wl_shm_pool_destroy(pool);
+  close(fd);
+
+  wl_window->pool_data     = (unsigned char*)pool_data;
+  wl_window->pool_size     = pool_size;
+  wl_window->pitch         = pitch;
+  wl_window->buffer_width  = width;
+  wl_window->buffer_height = height;
+
+  return WuhooSuccess;
+}
+
+/* Dispatches whatever the compositor sent, waiting at most timeout
+ * milliseconds for it. Returns WuhooFalse if nothing arrived */
+WuhooInternal WuhooBoolean
+_WuhooWindowWaitWayland(WuhooWindow* window, int timeout)
+{
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+  struct wl_display*  display   = wl_window->display;
+  struct pollfd       fd;
+
+  while (0 != wl_display_prepare_read(display)) {
+    wl_display_dispatch_pending(display);
+  }
+
+  wl_display_flush(display);
+
+  fd.fd      = wl_display_get_fd(display);
+  fd.events  = POLLIN;
+  fd.revents = 0;
+
+  if (poll(&fd, 1, timeout) <= 0) {
+    wl_display_cancel_read(display);
+    return WuhooFalse;
+  }
+
+  if (wl_display_read_events(display) < 0) {
+    return WuhooFalse;
+  }
+
+  wl_display_dispatch_pending(display);
+
+  return WuhooTrue;
+}
+
+/* Picks a buffer the compositor is done with and brings it up to date with
+ * the last commit, the index is kept until the next commit. Returns -1 if
+ * async is set and both buffers are in flight */
+WuhooInternal int
+_WuhooWindowBufferAcquireWayland(WuhooWindow* window, WuhooBoolean async)
+{
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+  int                 index     = -1;
+  int                 offset    = 0;
+
+  if (wl_window->buffer_acquired >= 0) {
+    return wl_window->buffer_acquired;
+  }
+
+  while (index < 0) {
+    /* Prefer the buffer that is not on screen */
+    for (offset = 1; offset <= WUHOO_WAYLAND_BUFFER_COUNT; offset++) {
+      int candidate =
+        (wl_window->buffer_index + offset) % WUHOO_WAYLAND_BUFFER_COUNT;
+      if (WuhooFalse == wl_window->buffers[candidate].busy) {
+        index = candidate;
+        break;
+      }
+    }
+
+    if (index >= 0)
       break;
+
+    if (WuhooTrue == async ||
+        WuhooFalse == _WuhooWindowWaitWayland(window, -1)) {
+      return -1;
+    }
+  }
+
+  WuhooBufferWayland* buffer = &wl_window->buffers[index];
+  WuhooRect           stale  = buffer->stale;
+
+  /* Copy what changed since this buffer was last on screen */
+  if (index != wl_window->buffer_index && stale.width > 0 &&
+      stale.height > 0) {
+    WuhooBufferWayland* front = &wl_window->buffers[wl_window->buffer_index];
+    WuhooSize           row   = 0;
+    WuhooSize           offset_bytes =
+      stale.y * wl_window->pitch + stale.x * 4;
+
+    for (row = 0; row < stale.height; row++) {
+      WuhooCopy(buffer->data + offset_bytes, front->data + offset_bytes,
+                stale.width * 4);
+      offset_bytes += wl_window->pitch;
+    }
+  }
+
+  WuhooZeroInit(&buffer->stale, sizeof(buffer->stale));
+  wl_window->buffer_acquired = index;
+
+  return index;
+}
+
+WuhooInternal void
+_WuhooFrameDoneWayland(void* data, struct wl_callback* callback,
+                       uint32_t time)
+{
+  WuhooWindow*        window    = (WuhooWindow*)data;
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+
+  wl_callback_destroy(callback);
+  wl_window->frame_callback = (struct wl_callback*)WuhooNull;
+  wl_window->frame_count++;
+
+  /* There is no retrace counter, msc counts the frames that were shown */
+  WuhooEvent* event = _WuhooWindowEventPushWayland(window, WUHOO_EVT_FRAME);
+  event->data.frame.ust    = (unsigned long long)time * 1000;
+  event->data.frame.msc    = wl_window->frame_count;
+  event->data.frame.serial = wl_window->frame_serial;
+}
+
+static const struct wl_callback_listener WuhooFrameListenerWayland = {
+  _WuhooFrameDoneWayland
+};
+
+/* Attaches the acquired buffer and damages the rects in buffer coordinates,
+ * clipped to the buffer since they may predate a resize */
+WuhooInternal void
+_WuhooWindowBufferCommitWayland(WuhooWindow* window, WuhooRect const* rects,
+                                WuhooSize count)
+{
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+  int                 index     = wl_window->buffer_acquired;
+  int                 other     = 0;
+  WuhooSize           rect      = 0;
+  int                 x0 = wl_window->buffer_width, y0 = wl_window->buffer_height;
+  int                 x1 = 0, y1 = 0;
+
+  wl_surface_attach(wl_window->surface, wl_window->buffers[index].buffer, 0,
+                    0);
+
+  for (rect = 0; rect < count; rect++) {
+    if (rects[rect].x >= (WuhooSize)wl_window->buffer_width ||
+        rects[rect].y >= (WuhooSize)wl_window->buffer_height ||
+        0 == rects[rect].width || 0 == rects[rect].height)
+      continue;
+
+    int x      = (int)rects[rect].x;
+    int y      = (int)rects[rect].y;
+    int width  = WuhooMini(rects[rect].width, wl_window->buffer_width - x);
+    int height = WuhooMini(rects[rect].height, wl_window->buffer_height - y);
+
+    wl_surface_damage_buffer(wl_window->surface, x, y, width, height);
+
+    x0 = WuhooMini(x0, x);
+    y0 = WuhooMini(y0, y);
+    x1 = WuhooMaxi(x1, x + width);
+    y1 = WuhooMaxi(y1, y + height);
+  }
+
+  /* Every other buffer misses this update now */
+  for (other = 0; x1 > x0 && other < WUHOO_WAYLAND_BUFFER_COUNT; other++) {
+    WuhooRect* stale = &wl_window->buffers[other].stale;
+
+    if (other == index)
+      continue;
+
+    if (stale->width > 0 && stale->height > 0) {
+      int sx1 = stale->x + stale->width;
+      int sy1 = stale->y + stale->height;
+      stale->x      = WuhooMini(stale->x, x0);
+      stale->y      = WuhooMini(stale->y, y0);
+      stale->width  = WuhooMaxi(sx1, x1) - stale->x;
+      stale->height = WuhooMaxi(sy1, y1) - stale->y;
+    } else {
+      stale->x      = x0;
+      stale->y      = y0;
+      stale->width  = x1 - x0;
+      stale->height = y1 - y0;
+    }
+  }
+
+  if (WUHOO_FLAG_VSYNC & window->flags) {
+    wl_window->frame_callback = wl_surface_frame(wl_window->surface);
+    wl_callback_add_listener(wl_window->frame_callback,
+                             &WuhooFrameListenerWayland, window);
+    wl_window->frame_serial++;
+  }
+
+  wl_surface_commit(wl_window->surface);
+
+  wl_window->buffers[index].busy = WuhooTrue;
+  wl_window->buffer_index        = index;
+  wl_window->buffer_acquired     = -1;
+
+  wl_display_flush(wl_window->display);
+}
+
+/* Paced windows draw at most one frame per frame callback. Hidden surfaces
+ * get no callbacks, so the wait gives up after WUHOO_WAYLAND_FRAME_TIMEOUT */
+WuhooInternal WuhooBoolean
+_WuhooWindowFrameWaitWayland(WuhooWindow* window, WuhooBoolean async)
+{
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+
+  while (WuhooNull != wl_window->frame_callback) {
+    if (WuhooTrue == async) {
+      return WuhooFalse;
+    }
+
+    if (WuhooFalse ==
+        _WuhooWindowWaitWayland(window, WUHOO_WAYLAND_FRAME_TIMEOUT)) {
+      wl_callback_destroy(wl_window->frame_callback);
+      wl_window->frame_callback = (struct wl_callback*)WuhooNull;
+    }
+  }
+
+  return WuhooTrue;
+}
+
+WuhooInternal WuhooResult
+_WuhooWindowBuffersValidateWayland(WuhooWindow* window)
+{
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+
+  if (wl_window->buffer_width == window->cwidth &&
+      wl_window->buffer_height == window->cheight) {
+    return WuhooSuccess;
+  }
+
+  return _WuhooWindowBuffersCreateWayland(window, window->cwidth,
+                                          window->cheight);
+}
+
+WuhooResult
+_WuhooWindowBlitWayland(WuhooWindow* window, WuhooConvertStage const* stage,
+                        WuhooRGBA* pixels, WuhooSize src_x, WuhooSize src_y,
+                        WuhooSize src_pitch, WuhooSize src_width,
+                        WuhooSize src_height, WuhooSize x, WuhooSize y,
+                        WuhooSize width, WuhooSize height, WuhooBoolean async)
+{
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+  WuhooResult         result    = WuhooSuccess;
+
+  if (WUHOO_WINDOW_FLAG_CLOSED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_RESIZED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_REGION_UPDATED & window->window_flags) {
+    return WuhooSuccess;
+  }
+
+  result = _WuhooWindowBuffersValidateWayland(window);
+  if (WuhooSuccess != result) {
+    return result;
+  }
+
+  if ((int)x >= window->cwidth || (int)y >= window->cheight) {
+    return WuhooSuccess;
+  }
+
+  int valid_width  = WuhooMini(width, window->cwidth - x);
+  int valid_height = WuhooMini(height, window->cheight - y);
+
+  if (WuhooFalse == _WuhooWindowFrameWaitWayland(window, async)) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : The previous frame is still in flight";
+  }
+
+  int index = _WuhooWindowBufferAcquireWayland(window, async);
+  if (index < 0) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : All presentation buffers are in flight";
+  }
+
+  unsigned char* dst =
+    wl_window->buffers[index].data + y * wl_window->pitch + x * 4;
+
+  WuhooConvertScaled(window, stage, dst, wl_window->pitch, 4, pixels, src_x,
+                     src_y, src_pitch, src_width, src_height, width, height,
+                     valid_width, 0, valid_height);
+
+  WuhooRect damage = { x, y, (WuhooSize)valid_width, (WuhooSize)valid_height };
+  _WuhooWindowBufferCommitWayland(window, &damage, 1);
+
+  return result;
+}
+
+WuhooResult
+_WuhooWindowBlitRectsWayland(WuhooWindow* window,
+                             WuhooConvertStage const* stage,
+                             WuhooRGBA* pixels, WuhooSize stride,
+                             WuhooRect const* rects, WuhooSize count)
+{
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+  WuhooResult         result    = WuhooSuccess;
+  WuhooSize           index     = 0;
+
+  if (WUHOO_WINDOW_FLAG_CLOSED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_RESIZED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_REGION_UPDATED & window->window_flags) {
+    return WuhooSuccess;
+  }
+
+  result = _WuhooWindowBuffersValidateWayland(window);
+  if (WuhooSuccess != result) {
+    return result;
+  }
+
+  _WuhooWindowFrameWaitWayland(window, WuhooFalse);
+
+  int buffer = _WuhooWindowBufferAcquireWayland(window, WuhooFalse);
+  if (buffer < 0) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : wl_display_dispatch failed";
+  }
+
+  /* Every region is damaged on the same commit */
+  for (index = 0; index < count; index++) {
+    int x      = rects[index].x;
+    int y      = rects[index].y;
+    int width  = rects[index].width;
+    int height = rects[index].height;
+
+    if (x >= window->cwidth || y >= window->cheight) {
+      continue;
+    }
+
+    width  = WuhooMini(width, window->cwidth - x);
+    height = WuhooMini(height, window->cheight - y);
+
+    unsigned char* dst =
+      wl_window->buffers[buffer].data + y * wl_window->pitch + x * 4;
+
+    WuhooConvertScaled(window, stage, dst, wl_window->pitch, 4, pixels, x, y,
+                       stride, width, height, width, height, width, 0, height);
+  }
+
+  _WuhooWindowBufferCommitWayland(window, rects, count);
+
+  return result;
+}
+
+WuhooResult
+_WuhooWindowFramebufferAcquireWayland(WuhooWindow* window,
+                                      WuhooFramebuffer* framebuffer)
+{
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+  WuhooResult         result    = WuhooSuccess;
+
+  result = _WuhooWindowBuffersValidateWayland(window);
+  if (WuhooSuccess != result) {
+    return result;
+  }
+
+  _WuhooWindowFrameWaitWayland(window, WuhooFalse);
+
+  int index = _WuhooWindowBufferAcquireWayland(window, WuhooFalse);
+  if (index < 0) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : wl_display_dispatch failed";
+  }
+
+  framebuffer->pixels                = wl_window->buffers[index].data;
+  framebuffer->pitch                 = wl_window->pitch;
+  framebuffer->width                 = wl_window->buffer_width;
+  framebuffer->height                = wl_window->buffer_height;
+  framebuffer->format.bits_per_pixel = 32;
+  framebuffer->format.red_mask       = 0x00FF0000;
+  framebuffer->format.green_mask     = 0x0000FF00;
+  framebuffer->format.blue_mask      = 0x000000FF;
+  framebuffer->format.msb_first      = WuhooFalse;
+  framebuffer->format.alpha_mask     = 0;
+
+  return WuhooSuccess;
+}
+
+/* Commits the buffer that was handed out with the regions as damage */
+WuhooResult
+_WuhooWindowFramebufferPresentWayland(WuhooWindow* window,
+                                      WuhooRect const* rects, WuhooSize count)
+{
+  if (WUHOO_WINDOW_FLAG_CLOSED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_RESIZED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_REGION_UPDATED & window->window_flags) {
+    return WuhooSuccess;
+  }
+
+  /* Returns the acquired buffer, or one brought up to date if there is none */
+  if (_WuhooWindowBufferAcquireWayland(window, WuhooFalse) < 0) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : wl_display_dispatch failed";
+  }
+
+  _WuhooWindowBufferCommitWayland(window, rects, count);
+
+  return WuhooSuccess;
+}
+
+WuhooSize
+_WuhooWindowFramesInFlightWayland(WuhooWindow* window)
+{
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+  WuhooSize           count     = 0;
+  int                 index     = 0;
+
+  /* Pick up buffer releases that already arrived */
+  _WuhooWindowWaitWayland(window, 0);
+
+  for (index = 0; index < WUHOO_WAYLAND_BUFFER_COUNT; index++) {
+    count += (WuhooTrue == wl_window->buffers[index].busy);
+  }
+
+  return count;
+}
+
+WuhooInternal void
+_WuhooKeyboardKeymapWayland(void* data, struct wl_keyboard* keyboard,
+                            uint32_t format, int32_t fd, uint32_t size)
+{
+  WuhooUnused(data);
+  WuhooUnused(keyboard);
+  WuhooUnused(format);
+  WuhooUnused(size);
+
+  close(fd);
+}
+
+WuhooInternal void
+_WuhooKeyboardEnterWayland(void* data, struct wl_keyboard* keyboard,
+                           uint32_t serial, struct wl_surface* surface,
+                           struct wl_array* keys)
+{
+  WuhooWindow* window = (WuhooWindow*)data;
+
+  WuhooUnused(keyboard);
+  WuhooUnused(serial);
+  WuhooUnused(surface);
+  WuhooUnused(keys);
+
+  window->window_flags |= WUHOO_WINDOW_FLAG_FOCUS_GAINED;
+}
+
+WuhooInternal void
+_WuhooKeyboardLeaveWayland(void* data, struct wl_keyboard* keyboard,
+                           uint32_t serial, struct wl_surface* surface)
+{
+  WuhooWindow* window = (WuhooWindow*)data;
+
+  WuhooUnused(keyboard);
+  WuhooUnused(serial);
+  WuhooUnused(surface);
+
+  window->window_flags |= WUHOO_WINDOW_FLAG_FOCUS_LOST;
+}
+
+WuhooInternal void
+_WuhooKeyboardKeyWayland(void* data, struct wl_keyboard* keyboard,
+                         uint32_t serial, uint32_t time, uint32_t key,
+                         uint32_t state)
+{
+  WuhooWindow*        window    = (WuhooWindow*)data;
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+  WuhooEvent*         event     = _WuhooWindowEventPushWayland(window, WUHOO_EVT_KEY);
+
+  WuhooUnused(keyboard);
+  WuhooUnused(serial);
+  WuhooUnused(time);
+
+  event->data.key.state = (WL_KEYBOARD_KEY_STATE_PRESSED == state)
+                            ? WUHOO_KSTATE_DOWN
+                            : WUHOO_KSTATE_UP;
+  event->data.key.mods  = wl_window->mods;
+  event->data.key.code =
+    _WuhooKeyTranslateEvdev(key, wl_window->mods, event->data.key.character);
+}
+
+/* The masks are interpreted with the modifier order of the default xkb
+ * keymaps: Shift, Lock, Control, Mod1 */
+WuhooInternal void
+_WuhooKeyboardModifiersWayland(void* data, struct wl_keyboard* keyboard,
+                               uint32_t serial, uint32_t mods_depressed,
+                               uint32_t mods_latched, uint32_t mods_locked,
+                               uint32_t group)
+{
+  WuhooWindow*        window    = (WuhooWindow*)data;
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+  uint32_t            mask      = mods_depressed | mods_latched | mods_locked;
+
+  WuhooUnused(keyboard);
+  WuhooUnused(serial);
+  WuhooUnused(group);
+
+  wl_window->mods = 0;
+  wl_window->mods |= (mask & (1u << 0)) ? WUHOO_KMOD_SHIFT : 0;
+  wl_window->mods |= (mask & (1u << 1)) ? WUHOO_KMOD_CAPS : 0;
+  wl_window->mods |= (mask & (1u << 2)) ? WUHOO_KMOD_CTRL : 0;
+  wl_window->mods |= (mask & (1u << 3)) ? WUHOO_KMOD_ALT : 0;
+}
+
+WuhooInternal void
+_WuhooKeyboardRepeatInfoWayland(void* data, struct wl_keyboard* keyboard,
+                                int32_t rate, int32_t delay)
+{
+  WuhooUnused(data);
+  WuhooUnused(keyboard);
+  WuhooUnused(rate);
+  WuhooUnused(delay);
+}
+
+static const struct wl_keyboard_listener WuhooKeyboardListenerWayland = {
+  _WuhooKeyboardKeymapWayland, _WuhooKeyboardEnterWayland,
+  _WuhooKeyboardLeaveWayland,  _WuhooKeyboardKeyWayland,
+  _WuhooKeyboardModifiersWayland, _WuhooKeyboardRepeatInfoWayland
+};
+
+WuhooInternal WuhooMouseState
+_WuhooPointerStateWayland(WuhooWindowWayland* wl_window)
+{
+  if (wl_window->buttons & (1 << WUHOO_MSTATE_LPRESSED))
+    return WUHOO_MSTATE_LPRESSED;
+  if (wl_window->buttons & (1 << WUHOO_MSTATE_MPRESSED))
+    return WUHOO_MSTATE_MPRESSED;
+  if (wl_window->buttons & (1 << WUHOO_MSTATE_RPRESSED))
+    return WUHOO_MSTATE_RPRESSED;
+
+  return WUHOO_MSTATE_UNKNOWN;
+}
+
+WuhooInternal void
+_WuhooPointerEnterWayland(void* data, struct wl_pointer* pointer,
+                          uint32_t serial, struct wl_surface* surface,
+                          wl_fixed_t x, wl_fixed_t y)
+{
+  WuhooWindow*        window    = (WuhooWindow*)data;
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+
+  WuhooUnused(pointer);
+  WuhooUnused(serial);
+  WuhooUnused(surface);
+
+  wl_window->pointer_x = wl_fixed_to_int(x);
+  wl_window->pointer_y = wl_fixed_to_int(y);
+}
+
+WuhooInternal void
+_WuhooPointerLeaveWayland(void* data, struct wl_pointer* pointer,
+                          uint32_t serial, struct wl_surface* surface)
+{
+  WuhooWindow*        window    = (WuhooWindow*)data;
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+
+  WuhooUnused(pointer);
+  WuhooUnused(serial);
+  WuhooUnused(surface);
+
+  /* Releases outside of the surface are not reported */
+  wl_window->buttons = 0;
+}
+
+WuhooInternal void
+_WuhooPointerMotionWayland(void* data, struct wl_pointer* pointer,
+                           uint32_t time, wl_fixed_t x, wl_fixed_t y)
+{
+  WuhooWindow*        window    = (WuhooWindow*)data;
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+  WuhooEvent*         event =
+    _WuhooWindowEventPushWayland(window, WUHOO_EVT_MOUSE_MOVE);
+
+  WuhooUnused(pointer);
+  WuhooUnused(time);
+
+  wl_window->pointer_x = wl_fixed_to_int(x);
+  wl_window->pointer_y = wl_fixed_to_int(y);
+
+  event->data.mouse_move.x     = wl_window->pointer_x;
+  event->data.mouse_move.y     = wl_window->pointer_y;
+  event->data.mouse_move.mods  = wl_window->mods;
+  event->data.mouse_move.state = _WuhooPointerStateWayland(wl_window);
+}
+
+WuhooInternal void
+_WuhooPointerButtonWayland(void* data, struct wl_pointer* pointer,
+                           uint32_t serial, uint32_t time, uint32_t button,
+                           uint32_t state)
+{
+  WuhooWindow*        window    = (WuhooWindow*)data;
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+  WuhooBoolean        pressed   = (WL_POINTER_BUTTON_STATE_PRESSED == state);
+  WuhooMouseState     mstate    = WUHOO_MSTATE_UNKNOWN;
+
+  WuhooUnused(pointer);
+  WuhooUnused(serial);
+  WuhooUnused(time);
+
+  if (BTN_LEFT == button)
+    mstate = pressed ? WUHOO_MSTATE_LPRESSED : WUHOO_MSTATE_LRELEASED;
+  else if (BTN_MIDDLE == button)
+    mstate = pressed ? WUHOO_MSTATE_MPRESSED : WUHOO_MSTATE_MRELEASED;
+  else if (BTN_RIGHT == button)
+    mstate = pressed ? WUHOO_MSTATE_RPRESSED : WUHOO_MSTATE_RRELEASED;
+  else
+    return;
+
+  /* Released states follow their pressed counterpart */
+  if (pressed)
+    wl_window->buttons |= (1 << mstate);
+  else
+    wl_window->buttons &= ~(1 << (mstate - 1));
+
+  WuhooEvent* event =
+    _WuhooWindowEventPushWayland(window, WUHOO_EVT_MOUSE_PRESS);
+  event->data.mouse_press.click_count = 1;
+  event->data.mouse_press.state       = mstate;
+  event->data.mouse_press.mods        = wl_window->mods;
+  event->data.mouse_press.x           = wl_window->pointer_x;
+  event->data.mouse_press.y           = wl_window->pointer_y;
+}
+
+WuhooInternal void
+_WuhooPointerAxisWayland(void* data, struct wl_pointer* pointer,
+                         uint32_t time, uint32_t axis, wl_fixed_t value)
+{
+  WuhooWindow*        window    = (WuhooWindow*)data;
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+  WuhooEvent*         event =
+    _WuhooWindowEventPushWayland(window, WUHOO_EVT_MOUSE_WHEEL);
+
+  WuhooUnused(pointer);
+  WuhooUnused(time);
+
+  /* Positive values scroll down, X11 reports those as negative deltas */
+  float delta = (value < 0) ? 1.0f : -1.0f;
+
+  event->data.mouse_wheel.mods = wl_window->mods;
+  event->data.mouse_wheel.x    = wl_window->pointer_x;
+  event->data.mouse_wheel.y    = wl_window->pointer_y;
+  if (WL_POINTER_AXIS_VERTICAL_SCROLL == axis)
+    event->data.mouse_wheel.delta_y = delta;
+  else
+    event->data.mouse_wheel.delta_x = delta;
+}
+
+static const struct wl_pointer_listener WuhooPointerListenerWayland = {
+  _WuhooPointerEnterWayland, _WuhooPointerLeaveWayland,
+  _WuhooPointerMotionWayland, _WuhooPointerButtonWayland,
+  _WuhooPointerAxisWayland
+};
+
+WuhooInternal void
+_WuhooSeatCapabilitiesWayland(void* data, struct wl_seat* seat,
+                              uint32_t capabilities)
+{
+  WuhooWindow*        window    = (WuhooWindow*)data;
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+  WuhooBoolean has_pointer  = (0 != (WL_SEAT_CAPABILITY_POINTER & capabilities));
+  WuhooBoolean has_keyboard = (0 != (WL_SEAT_CAPABILITY_KEYBOARD & capabilities));
+
+  if (has_pointer && WuhooNull == wl_window->pointer) {
+    wl_window->pointer = wl_seat_get_pointer(seat);
+    wl_pointer_add_listener(wl_window->pointer, &WuhooPointerListenerWayland,
+                            window);
+  } else if (!has_pointer && WuhooNull != wl_window->pointer) {
+    wl_pointer_destroy(wl_window->pointer);
+    wl_window->pointer = (struct wl_pointer*)WuhooNull;
+  }
+
+  if (has_keyboard && WuhooNull == wl_window->keyboard) {
+    wl_window->keyboard = wl_seat_get_keyboard(seat);
+    wl_keyboard_add_listener(wl_window->keyboard,
+                             &WuhooKeyboardListenerWayland, window);
+  } else if (!has_keyboard && WuhooNull != wl_window->keyboard) {
+    wl_keyboard_destroy(wl_window->keyboard);
+    wl_window->keyboard = (struct wl_keyboard*)WuhooNull;
+  }
+}
+
+WuhooInternal void
+_WuhooSeatNameWayland(void* data, struct wl_seat* seat, const char* name)
+{
+  WuhooUnused(data);
+  WuhooUnused(seat);
+  WuhooUnused(name);
+}
+
+static const struct wl_seat_listener WuhooSeatListenerWayland = {
+  _WuhooSeatCapabilitiesWayland, _WuhooSeatNameWayland
+};
+
+WuhooInternal void
+_WuhooWmBasePingWayland(void* data, struct xdg_wm_base* wm_base,
+                        uint32_t serial)
+{
+  WuhooUnused(data);
+
+  xdg_wm_base_pong(wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener WuhooWmBaseListenerWayland = {
+  _WuhooWmBasePingWayland
+};
+
+/* Applies the size of the last toplevel configure, a zero size leaves the
+ * choice to the client */
+WuhooInternal void
+_WuhooXdgSurfaceConfigureWayland(void* data, struct xdg_surface* xdg_surface,
+                                 uint32_t serial)
+{
+  WuhooWindow*        window    = (WuhooWindow*)data;
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+  int                 width     = wl_window->configure_width;
+  int                 height    = wl_window->configure_height;
+
+  xdg_surface_ack_configure(xdg_surface, serial);
+
+  if (width > 0 && height > 0 &&
+      (width != window->cwidth || height != window->cheight)) {
+    window->cwidth  = width;
+    window->cheight = height;
+    window->width   = width;
+    window->height  = height;
+
+    /* The first configure only settles the initial size */
+    if (WuhooTrue == wl_window->configured) {
+      window->window_flags |=
+        WUHOO_WINDOW_FLAG_RESIZED | WUHOO_WINDOW_FLAG_REGION_UPDATED;
+    }
+  }
+
+  wl_window->configured = WuhooTrue;
+}
+
+static const struct xdg_surface_listener WuhooXdgSurfaceListenerWayland = {
+  _WuhooXdgSurfaceConfigureWayland
+};
+
+WuhooInternal void
+_WuhooToplevelConfigureWayland(void* data, struct xdg_toplevel* toplevel,
+                               int32_t width, int32_t height,
+                               struct wl_array* states)
+{
+  WuhooWindow*        window    = (WuhooWindow*)data;
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+  uint32_t*           state     = (uint32_t*)states->data;
+  WuhooSize           count     = states->size / sizeof(*state);
+  WuhooSize           index     = 0;
+
+  WuhooUnused(toplevel);
+
+  wl_window->configure_width  = width;
+  wl_window->configure_height = height;
+
+  for (index = 0; index < count; index++) {
+    if (XDG_TOPLEVEL_STATE_MAXIMIZED == state[index])
+      window->window_flags |= WUHOO_WINDOW_FLAG_MAXIMIZED;
+    else if (XDG_TOPLEVEL_STATE_FULLSCREEN == state[index])
+      window->window_flags |= WUHOO_WINDOW_FLAG_FULL_SCREEN;
+  }
+}
+
+WuhooInternal void
+_WuhooToplevelCloseWayland(void* data, struct xdg_toplevel* toplevel)
+{
+  WuhooWindow* window = (WuhooWindow*)data;
+
+  WuhooUnused(toplevel);
+
+  window->window_flags |= WUHOO_WINDOW_FLAG_CLOSED;
+}
+
+static const struct xdg_toplevel_listener WuhooToplevelListenerWayland = {
+  _WuhooToplevelConfigureWayland, _WuhooToplevelCloseWayland
+};
+
+WuhooInternal void
+_WuhooRegistryGlobalWayland(void* data, struct wl_registry* registry,
+                            uint32_t name, const char* interface,
+                            uint32_t version)
+{
+  WuhooWindow*        window    = (WuhooWindow*)data;
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+
+  /* wl_surface.damage_buffer needs version 4 of the compositor */
+  if (_WuhooInterfaceMatchWayland(interface, &wl_compositor_interface) &&
+      version >= 4) {
+    wl_window->compositor = (struct wl_compositor*)wl_registry_bind(
+      registry, name, &wl_compositor_interface, 4);
+  } else if (_WuhooInterfaceMatchWayland(interface, &wl_shm_interface)) {
+    wl_window->shm =
+      (struct wl_shm*)wl_registry_bind(registry, name, &wl_shm_interface, 1);
+  } else if (_WuhooInterfaceMatchWayland(interface, &xdg_wm_base_interface)) {
+    wl_window->wm_base = (struct xdg_wm_base*)wl_registry_bind(
+      registry, name, &xdg_wm_base_interface, 1);
+    xdg_wm_base_add_listener(wl_window->wm_base, &WuhooWmBaseListenerWayland,
+                             window);
+  } else if (_WuhooInterfaceMatchWayland(interface, &wl_seat_interface) &&
+             WuhooNull == wl_window->seat) {
+    /* Newer versions add pointer and keyboard events we do not listen to */
+    wl_window->seat = (struct wl_seat*)wl_registry_bind(
+      registry, name, &wl_seat_interface, WuhooMini(version, 4));
+    wl_seat_add_listener(wl_window->seat, &WuhooSeatListenerWayland, window);
+  }
+}
+
+WuhooInternal void
+_WuhooRegistryGlobalRemoveWayland(void* data, struct wl_registry* registry,
+                                  uint32_t name)
+{
+  WuhooUnused(data);
+  WuhooUnused(registry);
+  WuhooUnused(name);
+}
+
+static const struct wl_registry_listener WuhooRegistryListenerWayland = {
+  _WuhooRegistryGlobalWayland, _WuhooRegistryGlobalRemoveWayland
+};
+
+WuhooResult
+_WuhooWindowCreateWayland(WuhooWindow* window, int posx, int posy,
+                          WuhooSize width, WuhooSize height, const char* title,
+                          WuhooFlags flags)
+{
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)WuhooNull;
+
+  WuhooUnused(posx);
+  WuhooUnused(posy);
+
+  wl_window               = (WuhooWindowWayland*)&window->memory[0];
+  window->platform_window = wl_window;
+  window->cwidth          = width;
+  window->cheight         = height;
+
+  wl_window->buffer_acquired = -1;
+
+  /* Buffers are created as WL_SHM_FORMAT_XRGB8888, BGRX in memory */
+  WuhooPixelFormat format = { 32, 0x00FF0000, 0x0000FF00, 0x000000FF,
+                              WuhooFalse, 0 };
+  WuhooConvertFormatSelect(window, &format);
+
+#ifdef WUHOO_OPENGL_ENABLE
+  if (WUHOO_FLAG_OPENGL & flags) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : OpenGL windows are not supported";
+  }
+#endif
+
+  wl_window->display = wl_display_connect(WuhooNull);
+
+  if (WuhooNull == wl_window->display) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : wl_display_connect failed";
+  }
+
+  wl_window->registry = wl_display_get_registry(wl_window->display);
+  wl_registry_add_listener(wl_window->registry, &WuhooRegistryListenerWayland,
+                           window);
+
+  /* The first round trip binds the globals, the second one receives the
+   * seat capabilities */
+  wl_display_roundtrip(wl_window->display);
+
+  if (WuhooNull == wl_window->compositor || WuhooNull == wl_window->shm ||
+      WuhooNull == wl_window->wm_base) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : wl_compositor 4, wl_shm and xdg_wm_base are required";
+  }
+
+  wl_display_roundtrip(wl_window->display);
+
+  wl_window->surface = wl_compositor_create_surface(wl_window->compositor);
+  wl_window->xdg_surface =
+    xdg_wm_base_get_xdg_surface(wl_window->wm_base, wl_window->surface);
+  xdg_surface_add_listener(wl_window->xdg_surface,
+                           &WuhooXdgSurfaceListenerWayland, window);
+  wl_window->toplevel = xdg_surface_get_toplevel(wl_window->xdg_surface);
+  xdg_toplevel_add_listener(wl_window->toplevel,
+                            &WuhooToplevelListenerWayland, window);
+
+  xdg_toplevel_set_app_id(wl_window->toplevel, WUHOO_STRING);
+  if (WuhooNull != title && (WUHOO_FLAG_TITLED & flags)) {
+    xdg_toplevel_set_title(wl_window->toplevel, title);
+  }
+
+  if (!(WUHOO_FLAG_RESIZEABLE & flags)) {
+    xdg_toplevel_set_min_size(wl_window->toplevel, width, height);
+    xdg_toplevel_set_max_size(wl_window->toplevel, width, height);
+  }
+
+  /* An empty commit asks for the initial configure */
+  wl_surface_commit(wl_window->surface);
+
+  while (WuhooFalse == wl_window->configured) {
+    if (wl_display_dispatch(wl_window->display) < 0) {
+      return (WuhooResult)WUHOO_PLATFORM_API_STRING
+        " : wl_display_dispatch failed";
+    }
+  }
+
+  return _WuhooWindowBuffersCreateWayland(window, window->cwidth,
+                                          window->cheight);
+}
+
+/* xdg-shell maps the surface along with its first buffer */
+WuhooResult
+_WuhooWindowShowWayland(WuhooWindow* window)
+{
+  WuhooRect client_region = { 0, 0, (WuhooSize)window->cwidth,
+                              (WuhooSize)window->cheight };
+
+  if (_WuhooWindowBufferAcquireWayland(window, WuhooFalse) < 0) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : wl_display_dispatch failed";
+  }
+
+  _WuhooWindowBufferCommitWayland(window, &client_region, 1);
+
+  /* Expose equivalent, the client draws the first frame */
+  window->window_flags |= WUHOO_WINDOW_FLAG_REGION_UPDATED;
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+_WuhooWindowDestroyWayland(WuhooWindow* window)
+{
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+
+  if (WuhooNull == wl_window || WuhooNull == wl_window->display) {
+    return WuhooSuccess;
+  }
+
+  _WuhooWindowBuffersDestroyWayland(window);
+
+  if (WuhooNull != wl_window->frame_callback)
+    wl_callback_destroy(wl_window->frame_callback);
+  if (WuhooNull != wl_window->toplevel)
+    xdg_toplevel_destroy(wl_window->toplevel);
+  if (WuhooNull != wl_window->xdg_surface)
+    xdg_surface_destroy(wl_window->xdg_surface);
+  if (WuhooNull != wl_window->surface)
+    wl_surface_destroy(wl_window->surface);
+  if (WuhooNull != wl_window->pointer)
+    wl_pointer_destroy(wl_window->pointer);
+  if (WuhooNull != wl_window->keyboard)
+    wl_keyboard_destroy(wl_window->keyboard);
+  if (WuhooNull != wl_window->seat)
+    wl_seat_destroy(wl_window->seat);
+  if (WuhooNull != wl_window->wm_base)
+    xdg_wm_base_destroy(wl_window->wm_base);
+  if (WuhooNull != wl_window->shm)
+    wl_shm_destroy(wl_window->shm);
+  if (WuhooNull != wl_window->compositor)
+    wl_compositor_destroy(wl_window->compositor);
+  if (WuhooNull != wl_window->registry)
+    wl_registry_destroy(wl_window->registry);
+
+  wl_display_disconnect(wl_window->display);
+  WuhooZeroInit(wl_window, sizeof(*wl_window));
+
+  return WuhooSuccess;
+}
+
+/* Surfaces have no global position on Wayland, the requested one is kept */
+WuhooResult
+_WuhooWindowRegionGetWayland(WuhooWindow* window, int* posx, int* posy,
+                             WuhooSize* width, WuhooSize* height)
+{
+  *posx   = window->x;
+  *posy   = window->y;
+  *width  = window->cwidth;
+  *height = window->cheight;
+
+  return WuhooSuccess;
+}
+
+/* The client picks the size of a floating toplevel, the new size is reported
+ * like a resize by the compositor */
+WuhooResult
+_WuhooWindowRegionSetWayland(WuhooWindow* window, int posx, int posy,
+                             WuhooSize width, WuhooSize height)
+{
+  window->x       = posx;
+  window->y       = posy;
+  window->width   = width;
+  window->height  = height;
+  window->cwidth  = width;
+  window->cheight = height;
+
+  window->window_flags |=
+    WUHOO_WINDOW_FLAG_RESIZED | WUHOO_WINDOW_FLAG_REGION_UPDATED;
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+_WuhooWindowSetTitleWayland(WuhooWindow* window, const char* title)
+{
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+
+  xdg_toplevel_set_title(wl_window->toplevel, title);
+  wl_display_flush(wl_window->display);
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+_WuhooWindowEventNextWayland(WuhooWindow* window, WuhooEvent* event)
+{
+  WuhooWindowWayland* wl_window = (WuhooWindowWayland*)window->platform_window;
+
+  _WuhooWindowWaitWayland(window, 0);
+
+  if (WuhooTrue == WuhooWindowFlagsEvent(window, event)) {
+    return WuhooSuccess;
+  }
+
+  if (wl_window->event_count > 0) {
+    *event = wl_window->events[wl_window->event_head];
+    wl_window->event_head =
+      (wl_window->event_head + 1) % WUHOO_WAYLAND_EVENT_COUNT;
+    wl_window->event_count--;
+  }
+
+  return WuhooSuccess;
+}
+
+#endif /* WUHOO_WAYLAND_ENABLE */
+
+#ifdef WUHOO_FBDEV_ENABLE
+
+#include <linux/fb.h>
+#include <linux/input.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h> /* getenv */
+#include <time.h>
+
+#ifndef WUHOO_FBDEV_DEVICE
+#define WUHOO_FBDEV_DEVICE "/dev/fb0" /* Unless WuhooWindowCreate data or $WUHOO_FBDEV_DEVICE name another one */
+#endif
+
+#ifndef WUHOO_FBDEV_INPUT_COUNT
+#define WUHOO_FBDEV_INPUT_COUNT 8 /* /dev/input/event0 to event7 are read */
+#endif
+
+typedef struct
+{
+  int          fd;
+  int          x_min; /* Range of ABS_X and ABS_Y on touch screens and tablets */
+  int          x_max;
+  int          y_min;
+  int          y_max;
+  WuhooBoolean absolute;
+} WuhooInputFbdev;
+
+typedef struct
+{
+  unsigned char* memory; /* The whole mapping */
+  unsigned char* pixels; /* First visible pixel */
+  WuhooSize      memory_size;
+  WuhooSize      pitch;
+  int            fd;
+  int            fb_width; /* Visible resolution */
+  int            fb_height;
+  int            bytes_per_pixel;
+  int            red_offset, red_length;
+  int            green_offset, green_length;
+  int            blue_offset, blue_length;
+  WuhooBoolean   is_device; /* WuhooFalse for a regular file or memfd */
+
+  WuhooInputFbdev inputs[WUHOO_FBDEV_INPUT_COUNT];
+  int             input_count;
+  int             input_next; /* Device read first, so none starves the others */
+
+  int               pointer_x; /* Framebuffer coordinates */
+  int               pointer_y;
+  int               buttons; /* WUHOO_MSTATE_*PRESSED of the held buttons */
+  WuhooBoolean      motion_pending; /* Relative motion until the next SYN_REPORT */
+  WuhooKeyModifiers mods;
+
+  WuhooSize          frame_serial;
+  unsigned long long frame_ust;
+  WuhooBoolean       frame_pending;
+} WuhooWindowFbdev;
+
+/* Fails to compile if the fbdev state outgrows WuhooWindow::memory */
+typedef char WuhooWindowFbdevSizeCheck
+  [(sizeof(WuhooWindowFbdev) <= WUHOO_PLATFORM_MEMORY_SIZE) ? 1 : -1];
+
+/* Opens the event devices that are readable, others are skipped */
+WuhooInternal void
+_WuhooWindowInputOpenFbdev(WuhooWindow* window)
+{
+  WuhooWindowFbdev* fb_window = (WuhooWindowFbdev*)window->platform_window;
+  char              path[32]  = "/dev/input/event";
+  WuhooSize         prefix    = sizeof("/dev/input/event") - 1;
+  int               index     = 0;
+
+  for (index = 0; index < WUHOO_FBDEV_INPUT_COUNT; index++) {
+    WuhooInputFbdev*    input = &fb_window->inputs[fb_window->input_count];
+    struct input_absinfo absinfo;
+
+    /* WUHOO_FBDEV_INPUT_COUNT stays below 100 */
+    if (index < 10) {
+      path[prefix]     = (char)('0' + index);
+      path[prefix + 1] = '\0';
+    } else {
+      path[prefix]     = (char)('0' + index / 10);
+      path[prefix + 1] = (char)('0' + index % 10);
+      path[prefix + 2] = '\0';
+    }
+
+    input->fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (input->fd < 0) {
+      continue;
+    }
+
+    if (0 == ioctl(input->fd, EVIOCGABS(ABS_X), &absinfo) &&
+        absinfo.maximum > absinfo.minimum) {
+      input->x_min = absinfo.minimum;
+      input->x_max = absinfo.maximum;
+
+      if (0 == ioctl(input->fd, EVIOCGABS(ABS_Y), &absinfo) &&
+          absinfo.maximum > absinfo.minimum) {
+        input->y_min    = absinfo.minimum;
+        input->y_max    = absinfo.maximum;
+        input->absolute = WuhooTrue;
+      }
+    }
+
+    fb_window->input_count++;
+  }
+}
+
+WuhooInternal WuhooResult
+_WuhooWindowMapFbdev(WuhooWindow* window, const char* path, WuhooSize width,
+                     WuhooSize height)
+{
+  WuhooWindowFbdev*        fb_window = (WuhooWindowFbdev*)window->platform_window;
+  struct fb_var_screeninfo vinfo;
+  struct fb_fix_screeninfo finfo;
+  struct stat              file_info;
+  WuhooSize                offset = 0;
+
+  fb_window->fd = open(path, O_RDWR | O_CLOEXEC);
+  if (fb_window->fd < 0) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING " : open failed";
+  }
+
+  if (0 == ioctl(fb_window->fd, FBIOGET_VSCREENINFO, &vinfo) &&
+      0 == ioctl(fb_window->fd, FBIOGET_FSCREENINFO, &finfo)) {
+    fb_window->is_device       = WuhooTrue;
+    fb_window->fb_width        = vinfo.xres;
+    fb_window->fb_height       = vinfo.yres;
+    fb_window->pitch           = finfo.line_length;
+    fb_window->memory_size     = finfo.smem_len;
+    fb_window->bytes_per_pixel = vinfo.bits_per_pixel / 8;
+    fb_window->red_offset      = vinfo.red.offset;
+    fb_window->red_length      = vinfo.red.length;
+    fb_window->green_offset    = vinfo.green.offset;
+    fb_window->green_length    = vinfo.green.length;
+    fb_window->blue_offset     = vinfo.blue.offset;
+    fb_window->blue_length     = vinfo.blue.length;
+
+    /* The visible area may be panned inside the virtual resolution */
+    offset = vinfo.yoffset * finfo.line_length +
+             vinfo.xoffset * fb_window->bytes_per_pixel;
+  } else if (0 == fstat(fb_window->fd, &file_info) &&
+             S_ISREG(file_info.st_mode)) {
+    /* A stand-in framebuffer, the size of the window in XRGB8888 */
+    fb_window->fb_width        = width;
+    fb_window->fb_height       = height;
+    fb_window->pitch           = width * 4;
+    fb_window->memory_size     = width * height * 4;
+    fb_window->bytes_per_pixel = 4;
+    fb_window->red_offset      = 16;
+    fb_window->red_length      = 8;
+    fb_window->green_offset    = 8;
+    fb_window->green_length    = 8;
+    fb_window->blue_offset     = 0;
+    fb_window->blue_length     = 8;
+
+    if ((WuhooSize)file_info.st_size < fb_window->memory_size &&
+        0 != ftruncate(fb_window->fd, (off_t)fb_window->memory_size)) {
+      return (WuhooResult)WUHOO_PLATFORM_API_STRING " : ftruncate failed";
+    }
+  } else {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : Neither a framebuffer device nor a regular file";
+  }
+
+  if (2 != fb_window->bytes_per_pixel && 4 != fb_window->bytes_per_pixel) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : Only 16 and 32 bit framebuffers are supported";
+  }
+
+  void* memory = mmap(WuhooNull, fb_window->memory_size,
+                      PROT_READ | PROT_WRITE, MAP_SHARED, fb_window->fd, 0);
+  if (MAP_FAILED == memory) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING " : mmap failed";
+  }
+
+  fb_window->memory = (unsigned char*)memory;
+  fb_window->pixels = fb_window->memory + offset;
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+_WuhooWindowCreateFbdev(WuhooWindow* window, int posx, int posy,
+                        WuhooSize width, WuhooSize height, const char* title,
+                        WuhooFlags flags, const void* data)
+{
+  WuhooWindowFbdev* fb_window = (WuhooWindowFbdev*)WuhooNull;
+  WuhooResult       result    = WuhooSuccess;
+  const char*       path      = (const char*)data;
+
+  WuhooUnused(title);
+  WuhooUnused(flags);
+
+  fb_window               = (WuhooWindowFbdev*)&window->memory[0];
+  window->platform_window = fb_window;
+  fb_window->fd           = -1;
+
+#ifdef WUHOO_OPENGL_ENABLE
+  if (WUHOO_FLAG_OPENGL & flags) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : OpenGL windows are not supported";
+  }
+#endif
+
+  if (WuhooNull == path)
+    path = getenv("WUHOO_FBDEV_DEVICE");
+  if (WuhooNull == path)
+    path = WUHOO_FBDEV_DEVICE;
+
+  result = _WuhooWindowMapFbdev(window, path, width, height);
+  if (WuhooSuccess != result) {
+    return result;
+  }
+
+  /* The client area is the part of the window that fits the screen */
+  window->x       = (WuhooDefaultPosition == posx) ? 0 : posx;
+  window->y       = (WuhooDefaultPosition == posy) ? 0 : posy;
+  window->x       = WuhooMaxi(0, WuhooMini(window->x, fb_window->fb_width - 1));
+  window->y       = WuhooMaxi(0, WuhooMini(window->y, fb_window->fb_height - 1));
+  window->cwidth  = WuhooMini(width, fb_window->fb_width - window->x);
+  window->cheight = WuhooMini(height, fb_window->fb_height - window->y);
+
+  WuhooPixelFormat format;
+  format.bits_per_pixel = fb_window->bytes_per_pixel * 8;
+  format.red_mask =
+    ((1u << fb_window->red_length) - 1) << fb_window->red_offset;
+  format.green_mask =
+    ((1u << fb_window->green_length) - 1) << fb_window->green_offset;
+  format.blue_mask =
+    ((1u << fb_window->blue_length) - 1) << fb_window->blue_offset;
+  format.msb_first  = WuhooFalse;
+  format.alpha_mask = 0;
+
+  result = WuhooConvertFormatSelect(window, &format);
+  if (WuhooSuccess != result) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : Unsupported framebuffer pixel format";
+  }
+
+  /* Files and drivers without vblank interrupts can not pace anything */
+  if (WUHOO_FLAG_VSYNC & window->flags) {
+    __u32 crtc = 0;
+    if (WuhooFalse == fb_window->is_device ||
+        0 != ioctl(fb_window->fd, FBIO_WAITFORVSYNC, &crtc))
+      window->flags &= ~WUHOO_FLAG_VSYNC;
+  }
+
+  fb_window->pointer_x = window->x + window->cwidth / 2;
+  fb_window->pointer_y = window->y + window->cheight / 2;
+
+  _WuhooWindowInputOpenFbdev(window);
+
+  return WuhooSuccess;
+}
+
+/* There is nothing to map, the first frame is requested like after an Expose */
+WuhooResult
+_WuhooWindowShowFbdev(WuhooWindow* window)
+{
+  window->window_flags |= WUHOO_WINDOW_FLAG_REGION_UPDATED;
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+_WuhooWindowDestroyFbdev(WuhooWindow* window)
+{
+  WuhooWindowFbdev* fb_window = (WuhooWindowFbdev*)window->platform_window;
+  int               index     = 0;
+
+  if (WuhooNull == fb_window) {
+    return WuhooSuccess;
+  }
+
+  for (index = 0; index < fb_window->input_count; index++) {
+    close(fb_window->inputs[index].fd);
+  }
+
+  if (WuhooNull != fb_window->memory) {
+    munmap(fb_window->memory, fb_window->memory_size);
+  }
+
+  if (fb_window->fd >= 0) {
+    close(fb_window->fd);
+  }
+
+  WuhooZeroInit(fb_window, sizeof(*fb_window));
+  fb_window->fd = -1;
+
+  return WuhooSuccess;
+}
+
+/* Blits are visible right away, paced windows wait for the vertical blank
+ * first and report it as a WUHOO_EVT_FRAME */
+WuhooInternal void
+_WuhooWindowVsyncFbdev(WuhooWindow* window)
+{
+  WuhooWindowFbdev* fb_window = (WuhooWindowFbdev*)window->platform_window;
+  struct timespec   now;
+  __u32             crtc = 0;
+
+  if (!(WUHOO_FLAG_VSYNC & window->flags)) {
+    return;
+  }
+
+  ioctl(fb_window->fd, FBIO_WAITFORVSYNC, &crtc);
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  fb_window->frame_serial++;
+  fb_window->frame_ust =
+    (unsigned long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+  fb_window->frame_pending = WuhooTrue;
+}
+
+WuhooResult
+_WuhooWindowBlitFbdev(WuhooWindow* window, WuhooConvertStage const* stage,
+                      WuhooRGBA* pixels, WuhooSize src_x, WuhooSize src_y,
+                      WuhooSize src_pitch, WuhooSize src_width,
+                      WuhooSize src_height, WuhooSize x, WuhooSize y,
+                      WuhooSize width, WuhooSize height)
+{
+  WuhooWindowFbdev* fb_window = (WuhooWindowFbdev*)window->platform_window;
+
+  if (WUHOO_WINDOW_FLAG_CLOSED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_RESIZED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_REGION_UPDATED & window->window_flags) {
+    return WuhooSuccess;
+  }
+
+  if ((int)x >= window->cwidth || (int)y >= window->cheight) {
+    return WuhooSuccess;
+  }
+
+  int valid_width  = WuhooMini(width, window->cwidth - x);
+  int valid_height = WuhooMini(height, window->cheight - y);
+  int bpp          = fb_window->bytes_per_pixel;
+
+  unsigned char* dst = fb_window->pixels +
+                       (window->y + y) * fb_window->pitch +
+                       (window->x + x) * bpp;
+
+  _WuhooWindowVsyncFbdev(window);
+
+  WuhooConvertScaled(window, stage, dst, fb_window->pitch, bpp, pixels, src_x,
+                     src_y, src_pitch, src_width, src_height, width, height,
+                     valid_width, 0, valid_height);
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+_WuhooWindowBlitRectsFbdev(WuhooWindow* window,
+                           WuhooConvertStage const* stage, WuhooRGBA* pixels,
+                           WuhooSize stride, WuhooRect const* rects,
+                           WuhooSize count)
+{
+  WuhooWindowFbdev* fb_window = (WuhooWindowFbdev*)window->platform_window;
+  WuhooSize         index     = 0;
+  int               bpp       = fb_window->bytes_per_pixel;
+
+  if (WUHOO_WINDOW_FLAG_CLOSED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_RESIZED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_REGION_UPDATED & window->window_flags) {
+    return WuhooSuccess;
+  }
+
+  _WuhooWindowVsyncFbdev(window);
+
+  for (index = 0; index < count; index++) {
+    int x      = rects[index].x;
+    int y      = rects[index].y;
+    int width  = rects[index].width;
+    int height = rects[index].height;
+
+    if (x >= window->cwidth || y >= window->cheight) {
+      continue;
+    }
+
+    width  = WuhooMini(width, window->cwidth - x);
+    height = WuhooMini(height, window->cheight - y);
+
+    unsigned char* dst = fb_window->pixels +
+                         (window->y + y) * fb_window->pitch +
+                         (window->x + x) * bpp;
+
+    WuhooConvertScaled(window, stage, dst, fb_window->pitch, bpp, pixels, x, y,
+                       stride, width, height, width, height, width, 0, height);
+  }
+
+  return WuhooSuccess;
+}
+
+/* The framebuffer is on screen, writes show up without a release */
+WuhooResult
+_WuhooWindowFramebufferAcquireFbdev(WuhooWindow* window,
+                                    WuhooFramebuffer* framebuffer)
+{
+  WuhooWindowFbdev* fb_window = (WuhooWindowFbdev*)window->platform_window;
+
+  framebuffer->pixels = fb_window->pixels + window->y * fb_window->pitch +
+                        window->x * fb_window->bytes_per_pixel;
+  framebuffer->pitch  = fb_window->pitch;
+  framebuffer->width  = window->cwidth;
+  framebuffer->height = window->cheight;
+  framebuffer->format = window->convert_format;
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+_WuhooWindowRegionGetFbdev(WuhooWindow* window, int* posx, int* posy,
+                           WuhooSize* width, WuhooSize* height)
+{
+  *posx   = window->x;
+  *posy   = window->y;
+  *width  = window->cwidth;
+  *height = window->cheight;
+
+  return WuhooSuccess;
+}
+
+/* Moves the client area inside the screen, clipped like at creation */
+WuhooResult
+_WuhooWindowRegionSetFbdev(WuhooWindow* window, int posx, int posy,
+                           WuhooSize width, WuhooSize height)
+{
+  WuhooWindowFbdev* fb_window = (WuhooWindowFbdev*)window->platform_window;
+
+  window->x       = WuhooMaxi(0, WuhooMini(posx, fb_window->fb_width - 1));
+  window->y       = WuhooMaxi(0, WuhooMini(posy, fb_window->fb_height - 1));
+  window->width   = width;
+  window->height  = height;
+  window->cwidth  = WuhooMini(width, fb_window->fb_width - window->x);
+  window->cheight = WuhooMini(height, fb_window->fb_height - window->y);
+
+  window->window_flags |=
+    WUHOO_WINDOW_FLAG_RESIZED | WUHOO_WINDOW_FLAG_REGION_UPDATED;
+
+  return WuhooSuccess;
+}
+
+WuhooInternal WuhooMouseState
+_WuhooPointerStateFbdev(WuhooWindowFbdev* fb_window)
+{
+  if (fb_window->buttons & (1 << WUHOO_MSTATE_LPRESSED))
+    return WUHOO_MSTATE_LPRESSED;
+  if (fb_window->buttons & (1 << WUHOO_MSTATE_MPRESSED))
+    return WUHOO_MSTATE_MPRESSED;
+  if (fb_window->buttons & (1 << WUHOO_MSTATE_RPRESSED))
+    return WUHOO_MSTATE_RPRESSED;
+
+  return WUHOO_MSTATE_UNKNOWN;
+}
+
+/* There is no compositor keeping track of modifiers */
+WuhooInternal void
+_WuhooKeyModifiersFbdev(WuhooWindowFbdev* fb_window, unsigned int code,
+                        int value)
+{
+  WuhooKeyModifiers mod = 0;
+
+  switch (code) {
+    case KEY_LEFTSHIFT: mod = WUHOO_KMOD_LSHIFT; break;
+    case KEY_RIGHTSHIFT: mod = WUHOO_KMOD_RSHIFT; break;
+    case KEY_LEFTCTRL: mod = WUHOO_KMOD_LCTRL; break;
+    case KEY_RIGHTCTRL: mod = WUHOO_KMOD_RCTRL; break;
+    case KEY_LEFTALT: mod = WUHOO_KMOD_LALT; break;
+    case KEY_RIGHTALT: mod = WUHOO_KMOD_RALT; break;
+    case KEY_CAPSLOCK:
+      if (1 == value)
+        fb_window->mods ^= WUHOO_KMOD_CAPS;
+      return;
+    default: return;
+  }
+
+  if (0 == value)
+    fb_window->mods &= ~mod;
+  else
+    fb_window->mods |= mod;
+}
+
+/* Returns WuhooTrue when input completes a Wuhoo event */
+WuhooInternal WuhooBoolean
+_WuhooWindowInputTranslateFbdev(WuhooWindow* window, WuhooInputFbdev* device,
+                                struct input_event const* input,
+                                WuhooEvent* event)
+{
+  WuhooWindowFbdev* fb_window = (WuhooWindowFbdev*)window->platform_window;
+  int               max_x     = fb_window->fb_width - 1;
+  int               max_y     = fb_window->fb_height - 1;
+
+  switch (input->type) {
+    case EV_KEY: {
+      WuhooMouseState mstate  = WUHOO_MSTATE_UNKNOWN;
+      WuhooBoolean    pressed = (0 != input->value);
+
+      if (BTN_LEFT == input->code || BTN_TOUCH == input->code)
+        mstate = pressed ? WUHOO_MSTATE_LPRESSED : WUHOO_MSTATE_LRELEASED;
+      else if (BTN_MIDDLE == input->code)
+        mstate = pressed ? WUHOO_MSTATE_MPRESSED : WUHOO_MSTATE_MRELEASED;
+      else if (BTN_RIGHT == input->code)
+        mstate = pressed ? WUHOO_MSTATE_RPRESSED : WUHOO_MSTATE_RRELEASED;
+
+      if (WUHOO_MSTATE_UNKNOWN != mstate) {
+        /* Buttons do not repeat */
+        if (2 == input->value)
+          return WuhooFalse;
+
+        /* Released states follow their pressed counterpart */
+        if (pressed)
+          fb_window->buttons |= (1 << mstate);
+        else
+          fb_window->buttons &= ~(1 << (mstate - 1));
+
+        event->type                         = WUHOO_EVT_MOUSE_PRESS;
+        event->data.mouse_press.click_count = 1;
+        event->data.mouse_press.state       = mstate;
+        event->data.mouse_press.mods        = fb_window->mods;
+        event->data.mouse_press.x = fb_window->pointer_x - window->x;
+        event->data.mouse_press.y = fb_window->pointer_y - window->y;
+
+        return WuhooTrue;
+      }
+
+      if (input->code >= BTN_MISC)
+        return WuhooFalse;
+
+      _WuhooKeyModifiersFbdev(fb_window, input->code, input->value);
+
+      event->type           = WUHOO_EVT_KEY;
+      event->data.key.state = pressed ? WUHOO_KSTATE_DOWN : WUHOO_KSTATE_UP;
+      event->data.key.mods  = fb_window->mods;
+      event->data.key.code  = _WuhooKeyTranslateEvdev(
+        input->code, fb_window->mods, event->data.key.character);
+
+      return WuhooTrue;
+    }
+    case EV_REL: {
+      if (REL_X == input->code) {
+        fb_window->pointer_x =
+          WuhooMaxi(0, WuhooMini(fb_window->pointer_x + input->value, max_x));
+        fb_window->motion_pending = WuhooTrue;
+      } else if (REL_Y == input->code) {
+        fb_window->pointer_y =
+          WuhooMaxi(0, WuhooMini(fb_window->pointer_y + input->value, max_y));
+        fb_window->motion_pending = WuhooTrue;
+      } else if (REL_WHEEL == input->code || REL_HWHEEL == input->code) {
+        /* Positive values scroll up, like Button4 on X11 */
+        float delta = (input->value > 0) ? 1.0f : -1.0f;
+
+        event->type                  = WUHOO_EVT_MOUSE_WHEEL;
+        event->data.mouse_wheel.mods = fb_window->mods;
+        event->data.mouse_wheel.x    = fb_window->pointer_x - window->x;
+        event->data.mouse_wheel.y    = fb_window->pointer_y - window->y;
+        if (REL_WHEEL == input->code)
+          event->data.mouse_wheel.delta_y = delta;
+        else
+          event->data.mouse_wheel.delta_x = delta;
+
+        return WuhooTrue;
+      }
+    } break;
+    case EV_ABS: {
+      /* Absolute devices cover the whole screen */
+      if (ABS_X == input->code && WuhooTrue == device->absolute) {
+        fb_window->pointer_x = (int)((long long)(input->value - device->x_min) *
+                                     max_x / (device->x_max - device->x_min));
+        fb_window->motion_pending = WuhooTrue;
+      } else if (ABS_Y == input->code && WuhooTrue == device->absolute) {
+        fb_window->pointer_y = (int)((long long)(input->value - device->y_min) *
+                                     max_y / (device->y_max - device->y_min));
+        fb_window->motion_pending = WuhooTrue;
+      }
+    } break;
+    case EV_SYN: {
+      if (SYN_REPORT != input->code || WuhooFalse == fb_window->motion_pending)
+        break;
+
+      fb_window->motion_pending = WuhooFalse;
+
+      event->type                  = WUHOO_EVT_MOUSE_MOVE;
+      event->data.mouse_move.x     = fb_window->pointer_x - window->x;
+      event->data.mouse_move.y     = fb_window->pointer_y - window->y;
+      event->data.mouse_move.mods  = fb_window->mods;
+      event->data.mouse_move.state = _WuhooPointerStateFbdev(fb_window);
+
+      return WuhooTrue;
+    }
+    default: break;
+  }
+
+  return WuhooFalse;
+}
+
+WuhooResult
+_WuhooWindowEventNextFbdev(WuhooWindow* window, WuhooEvent* event)
+{
+  WuhooWindowFbdev* fb_window = (WuhooWindowFbdev*)window->platform_window;
+  int               checked   = 0;
+
+  if (WuhooTrue == WuhooWindowFlagsEvent(window, event)) {
+    return WuhooSuccess;
+  }
+
+  if (WuhooTrue == fb_window->frame_pending) {
+    fb_window->frame_pending = WuhooFalse;
+
+    event->type              = WUHOO_EVT_FRAME;
+    event->data.frame.ust    = fb_window->frame_ust;
+    event->data.frame.msc    = fb_window->frame_serial;
+    event->data.frame.serial = fb_window->frame_serial;
+
+    return WuhooSuccess;
+  }
+
+  for (checked = 0; checked < fb_window->input_count; checked++) {
+    int                index  = fb_window->input_next;
+    WuhooInputFbdev*   device = &fb_window->inputs[index];
+    struct input_event input;
+
+    while (sizeof(input) == read(device->fd, &input, sizeof(input))) {
+      if (WuhooTrue ==
+          _WuhooWindowInputTranslateFbdev(window, device, &input, event)) {
+        fb_window->input_next = (index + 1) % fb_window->input_count;
+        return WuhooSuccess;
+      }
+    }
+
+    fb_window->input_next = (index + 1) % fb_window->input_count;
+  }
+
+  return WuhooSuccess;
+}
+
+#endif /* WUHOO_FBDEV_ENABLE */
+
+#ifdef WUHOO_HEADLESS_ENABLE
+
+#include <stdlib.h> /* malloc */
+
+#ifndef WUHOO_HEADLESS_EVENT_COUNT
+#define WUHOO_HEADLESS_EVENT_COUNT 1024 /* Events WuhooWindowEventInject can queue */
+#endif
+
+typedef struct
+{
+  unsigned char*   pixels; /* The surface blits are converted into */
+  WuhooSize        pitch;
+  WuhooPixelFormat format;
+
+  WuhooEvent* events; /* Injected, drained by WuhooWindowEventNext */
+  int         event_head;
+  int         event_count;
+} WuhooWindowHeadless;
+
+/* Fails to compile if the headless state outgrows WuhooWindow::memory */
+typedef char WuhooWindowHeadlessSizeCheck
+  [(sizeof(WuhooWindowHeadless) <= WUHOO_PLATFORM_MEMORY_SIZE) ? 1 : -1];
+
+/* (Re)allocates the surface for the current client size, its contents are
+ * undefined afterwards like those of a freshly mapped window */
+WuhooInternal WuhooResult
+_WuhooWindowSurfaceAllocHeadless(WuhooWindow* window)
+{
+  WuhooWindowHeadless* hl_window =
+    (WuhooWindowHeadless*)window->platform_window;
+  WuhooSize bpp    = hl_window->format.bits_per_pixel / 8;
+  WuhooSize width  = WuhooMaxi(window->cwidth, 1);
+  WuhooSize height = WuhooMaxi(window->cheight, 1);
+
+  /* Rows stay 4 byte aligned, like XImage scanlines */
+  hl_window->pitch = ((width * bpp + 3) / 4) * 4;
+
+  void* pixels = realloc(hl_window->pixels, hl_window->pitch * height);
+  if (WuhooNull == pixels) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : Failed to allocate the surface";
+  }
+
+  hl_window->pixels = (unsigned char*)pixels;
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+_WuhooWindowCreateHeadless(WuhooWindow* window, int posx, int posy,
+                           WuhooSize width, WuhooSize height,
+                           const char* title, WuhooFlags flags,
+                           const void* data)
+{
+  WuhooWindowHeadless*    hl_window = (WuhooWindowHeadless*)WuhooNull;
+  WuhooPixelFormat const* format    = (WuhooPixelFormat const*)data;
+
+  WuhooUnused(title);
+
+  hl_window               = (WuhooWindowHeadless*)&window->memory[0];
+  window->platform_window = hl_window;
+
+#ifdef WUHOO_OPENGL_ENABLE
+  if (WUHOO_FLAG_OPENGL & flags) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : OpenGL windows are not supported";
+  }
+#else
+  WuhooUnused(flags);
+#endif
+
+  if (WuhooNull == format) {
+    /* The layout of the common 24 bit X11 TrueColor visual */
+    hl_window->format.bits_per_pixel = 32;
+    hl_window->format.red_mask       = 0x00FF0000;
+    hl_window->format.green_mask     = 0x0000FF00;
+    hl_window->format.blue_mask      = 0x000000FF;
+    hl_window->format.msb_first      = WuhooFalse;
+    hl_window->format.alpha_mask     = 0;
+  } else {
+    hl_window->format = *format;
+  }
+
+  if (WuhooSuccess != WuhooConvertFormatSelect(window, &hl_window->format)) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : Unsupported pixel format";
+  }
+
+  window->x       = (WuhooDefaultPosition == posx) ? 0 : posx;
+  window->y       = (WuhooDefaultPosition == posy) ? 0 : posy;
+  window->cwidth  = width;
+  window->cheight = height;
+
+  hl_window->events =
+    (WuhooEvent*)malloc(WUHOO_HEADLESS_EVENT_COUNT * sizeof(WuhooEvent));
+  if (WuhooNull == hl_window->events) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : Failed to allocate the event queue";
+  }
+
+  return _WuhooWindowSurfaceAllocHeadless(window);
+}
+
+/* Nothing to map, the first frame is requested like after an Expose */
+WuhooResult
+_WuhooWindowShowHeadless(WuhooWindow* window)
+{
+  window->window_flags |= WUHOO_WINDOW_FLAG_REGION_UPDATED;
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+_WuhooWindowDestroyHeadless(WuhooWindow* window)
+{
+  WuhooWindowHeadless* hl_window =
+    (WuhooWindowHeadless*)window->platform_window;
+
+  if (WuhooNull == hl_window) {
+    return WuhooSuccess;
+  }
+
+  free(hl_window->pixels);
+  free(hl_window->events);
+
+  WuhooZeroInit(hl_window, sizeof(*hl_window));
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+_WuhooWindowBlitHeadless(WuhooWindow* window, WuhooConvertStage const* stage,
+                         WuhooRGBA* pixels, WuhooSize src_x, WuhooSize src_y,
+                         WuhooSize src_pitch, WuhooSize src_width,
+                         WuhooSize src_height, WuhooSize x, WuhooSize y,
+                         WuhooSize width, WuhooSize height)
+{
+  WuhooWindowHeadless* hl_window =
+    (WuhooWindowHeadless*)window->platform_window;
+  WuhooSize bpp = hl_window->format.bits_per_pixel / 8;
+
+  /* Same rules as the windowed backends, blits wait for pending window
+   * events to be handled */
+  if (WUHOO_WINDOW_FLAG_CLOSED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_RESIZED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_REGION_UPDATED & window->window_flags) {
+    return WuhooSuccess;
+  }
+
+  if ((int)x >= window->cwidth || (int)y >= window->cheight) {
+    return WuhooSuccess;
+  }
+
+  int valid_width  = WuhooMini(width, window->cwidth - x);
+  int valid_height = WuhooMini(height, window->cheight - y);
+
+  unsigned char* dst = hl_window->pixels + y * hl_window->pitch + x * bpp;
+
+  WuhooConvertScaled(window, stage, dst, hl_window->pitch, bpp, pixels, src_x,
+                     src_y, src_pitch, src_width, src_height, width, height,
+                     valid_width, 0, valid_height);
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+_WuhooWindowBlitRectsHeadless(WuhooWindow* window,
+                              WuhooConvertStage const* stage,
+                              WuhooRGBA* pixels, WuhooSize stride,
+                              WuhooRect const* rects, WuhooSize count)
+{
+  WuhooWindowHeadless* hl_window =
+    (WuhooWindowHeadless*)window->platform_window;
+  WuhooSize index = 0;
+  WuhooSize bpp   = hl_window->format.bits_per_pixel / 8;
+
+  if (WUHOO_WINDOW_FLAG_CLOSED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_RESIZED & window->window_flags ||
+      WUHOO_WINDOW_FLAG_REGION_UPDATED & window->window_flags) {
+    return WuhooSuccess;
+  }
+
+  for (index = 0; index < count; index++) {
+    int x      = rects[index].x;
+    int y      = rects[index].y;
+    int width  = rects[index].width;
+    int height = rects[index].height;
+
+    if (x >= window->cwidth || y >= window->cheight) {
+      continue;
+    }
+
+    width  = WuhooMini(width, window->cwidth - x);
+    height = WuhooMini(height, window->cheight - y);
+
+    unsigned char* dst = hl_window->pixels + y * hl_window->pitch + x * bpp;
+
+    WuhooConvertScaled(window, stage, dst, hl_window->pitch, bpp, pixels, x, y,
+                       stride, width, height, width, height, width, 0, height);
+  }
+
+  return WuhooSuccess;
+}
+
+/* The surface is what gets checked, writes land in it without a release */
+WuhooResult
+_WuhooWindowFramebufferAcquireHeadless(WuhooWindow* window,
+                                       WuhooFramebuffer* framebuffer)
+{
+  WuhooWindowHeadless* hl_window =
+    (WuhooWindowHeadless*)window->platform_window;
+
+  framebuffer->pixels = hl_window->pixels;
+  framebuffer->pitch  = hl_window->pitch;
+  framebuffer->width  = window->cwidth;
+  framebuffer->height = window->cheight;
+  framebuffer->format = hl_window->format;
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+_WuhooWindowRegionGetHeadless(WuhooWindow* window, int* posx, int* posy,
+                              WuhooSize* width, WuhooSize* height)
+{
+  *posx   = window->x;
+  *posy   = window->y;
+  *width  = window->cwidth;
+  *height = window->cheight;
+
+  return WuhooSuccess;
+}
+
+/* Resizes right away and reports it like a window manager would */
+WuhooResult
+_WuhooWindowRegionSetHeadless(WuhooWindow* window, int posx, int posy,
+                              WuhooSize width, WuhooSize height)
+{
+  window->x       = posx;
+  window->y       = posy;
+  window->width   = width;
+  window->height  = height;
+  window->cwidth  = width;
+  window->cheight = height;
+
+  window->window_flags |=
+    WUHOO_WINDOW_FLAG_RESIZED | WUHOO_WINDOW_FLAG_REGION_UPDATED;
+
+  return _WuhooWindowSurfaceAllocHeadless(window);
+}
+
+WuhooResult
+_WuhooWindowEventInjectHeadless(WuhooWindow* window, WuhooEvent const* event)
+{
+  WuhooWindowHeadless* hl_window =
+    (WuhooWindowHeadless*)window->platform_window;
+
+  if (WUHOO_HEADLESS_EVENT_COUNT == hl_window->event_count) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING " : Event queue is full";
+  }
+
+  hl_window->events[(hl_window->event_head + hl_window->event_count) %
+                    WUHOO_HEADLESS_EVENT_COUNT] = *event;
+  hl_window->event_count++;
+
+  return WuhooSuccess;
+}
+
+/* Window state changes come first, like on the other backends, then the
+ * injected events in order. Never blocks */
+WuhooResult
+_WuhooWindowEventNextHeadless(WuhooWindow* window, WuhooEvent* event)
+{
+  WuhooWindowHeadless* hl_window =
+    (WuhooWindowHeadless*)window->platform_window;
+
+  if (WuhooTrue == WuhooWindowFlagsEvent(window, event)) {
+    return WuhooSuccess;
+  }
+
+  if (0 == hl_window->event_count) {
+    return WuhooSuccess;
+  }
+
+  *event = hl_window->events[hl_window->event_head];
+  hl_window->event_head =
+    (hl_window->event_head + 1) % WUHOO_HEADLESS_EVENT_COUNT;
+  hl_window->event_count--;
+
+  return WuhooSuccess;
+}
+
+#endif /* WUHOO_HEADLESS_ENABLE */
+
+#if defined(WUHOO_RECORDER_ENABLE) || defined(WUHOO_EXPORT_ENABLE)
+
+/* The backends drop blits until pending window events are handled, copies
+ * of what the window shows skip them as well */
+WuhooInternal WuhooBoolean
+WuhooBlitReachesWindow(WuhooWindow* window)
+{
+  return !(WUHOO_WINDOW_FLAG_CLOSED & window->window_flags ||
+           WUHOO_WINDOW_FLAG_RESIZED & window->window_flags ||
+           WUHOO_WINDOW_FLAG_REGION_UPDATED & window->window_flags);
+}
+
+/* Brings an RGBA copy of the client area up to date with a blit, through
+ * the same resampling the window uses but without the conversion to the
+ * native format */
+WuhooInternal void
+WuhooCaptureRGBA(WuhooWindow* window, WuhooRGBA* canvas,
+                 WuhooSize canvas_width, WuhooSize canvas_height,
+                 WuhooRGBA const* pixels, WuhooSize src_x, WuhooSize src_y,
+                 WuhooSize src_pitch, WuhooSize src_width,
+                 WuhooSize src_height, WuhooSize x, WuhooSize y,
+                 WuhooSize width, WuhooSize height)
+{
+  WuhooConvertStage stage = WuhooConvertStageWindow(window);
+
+  if (x >= canvas_width || y >= canvas_height) {
+    return;
+  }
+
+  stage.convert = WuhooConvertRGBAtoRGBA;
+  WuhooConvertScaled(window, &stage, canvas + x + y * canvas_width,
+                     canvas_width * sizeof(*canvas), sizeof(*canvas), pixels,
+                     src_x, src_y, src_pitch, src_width, src_height, width,
+                     height, WuhooMini(width, canvas_width - x), 0,
+                     WuhooMini(height, canvas_height - y));
+}
+
+#endif
+
+#if defined(WUHOO_RECORDER_ENABLE) || defined(WUHOO_THREADS_ENABLE)
+
+#ifdef _WIN32
+typedef HANDLE WuhooThread;
+#define WuhooAtomicLoad(pointer) InterlockedCompareExchange((volatile LONG*)(pointer), 0, 0)
+#define WuhooAtomicStore(pointer, value) InterlockedExchange((volatile LONG*)(pointer), (LONG)(value))
+#else
+#include <pthread.h>
+#include <time.h>
+typedef pthread_t WuhooThread;
+#define WuhooAtomicLoad(pointer) __atomic_load_n((pointer), __ATOMIC_ACQUIRE)
+#define WuhooAtomicStore(pointer, value) __atomic_store_n((pointer), (value), __ATOMIC_RELEASE)
+#endif
+
+#endif
+
+#ifdef WUHOO_RECORDER_ENABLE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WUHOO_RECORDER_FRAME_COUNT
+#define WUHOO_RECORDER_FRAME_COUNT 8 /* Frames the ring holds before blits start dropping them */
+#endif
+
+/* Single producer, single consumer. The render thread owns write_index and
+ * dropped, the recording thread read_index and the rest of the counters */
+typedef struct
+{
+  WuhooRGBA*        canvas; /* What the window shows, updated by every blit */
+  WuhooRGBA*        frames; /* WUHOO_RECORDER_FRAME_COUNT copies of canvas */
+  unsigned char*    planes; /* Y4M conversion of the frame being written */
+  WuhooSize         width;
+  WuhooSize         height;
+  WuhooRecordFormat format;
+  FILE*             file;
+  WuhooThread       thread;
+
+  volatile WuhooSize write_index;
+  volatile WuhooSize read_index;
+  volatile WuhooSize dropped;
+  volatile WuhooSize written;
+  volatile WuhooSize write_failed;
+  volatile WuhooSize running;
+} WuhooRecorder;
+
+/* Full range BT.601 like JPEG, chroma is the average of each 2x2 block */
+WuhooInternal void
+WuhooRecorderConvertY4M(WuhooRecorder* recorder, WuhooRGBA const* frame)
+{
+  WuhooSize      width        = recorder->width;
+  WuhooSize      height       = recorder->height;
+  WuhooSize      chroma_width = (width + 1) / 2;
+  unsigned char* y_plane      = recorder->planes;
+  unsigned char* u_plane      = y_plane + width * height;
+  unsigned char* v_plane      = u_plane + chroma_width * ((height + 1) / 2);
+  WuhooSize      i = 0, j = 0;
+
+  for (j = 0; j < height; j++) {
+    WuhooRGBA const* row = frame + j * width;
+    for (i = 0; i < width; i++) {
+      y_plane[i + j * width] =
+        (unsigned char)((77 * row[i].r + 150 * row[i].g + 29 * row[i].b) >> 8);
+    }
+  }
+
+  for (j = 0; j < height; j += 2) {
+    WuhooRGBA const* row  = frame + j * width;
+    WuhooRGBA const* next = (j + 1 < height) ? row + width : row;
+    for (i = 0; i < width; i += 2) {
+      WuhooSize right = (i + 1 < width) ? i + 1 : i;
+      int       r = (row[i].r + row[right].r + next[i].r + next[right].r) >> 2;
+      int       g = (row[i].g + row[right].g + next[i].g + next[right].g) >> 2;
+      int       b = (row[i].b + row[right].b + next[i].b + next[right].b) >> 2;
+      WuhooSize index = i / 2 + (j / 2) * chroma_width;
+
+      u_plane[index] = (unsigned char)(((-43 * r - 85 * g + 128 * b) >> 8) + 128);
+      v_plane[index] = (unsigned char)(((128 * r - 107 * g - 21 * b) >> 8) + 128);
+    }
+  }
+}
+
+WuhooInternal WuhooBoolean
+WuhooRecorderWrite(WuhooRecorder* recorder, WuhooRGBA const* frame)
+{
+  WuhooSize size = recorder->width * recorder->height;
+
+  if (WUHOO_RECORD_RGBA == recorder->format) {
+    return size == fwrite(frame, sizeof(*frame), size, recorder->file);
+  }
+
+  size += 2 * ((recorder->width + 1) / 2) * ((recorder->height + 1) / 2);
+  WuhooRecorderConvertY4M(recorder, frame);
+
+  return 0 <= fputs("FRAME\n", recorder->file) &&
+         size == fwrite(recorder->planes, 1, size, recorder->file);
+}
+
+/* Nothing to wake the thread with without blocking the render loop, so it
+ * polls while the ring is empty */
+WuhooInternal void
+WuhooRecorderIdle(void)
+{
+#ifdef _WIN32
+  Sleep(1);
+#else
+  struct timespec duration = { 0, 1000000 };
+  nanosleep(&duration, WuhooNull);
+#endif
+}
+
+WuhooInternal void
+WuhooRecorderLoop(WuhooRecorder* recorder)
+{
+  WuhooSize frame_size = recorder->width * recorder->height;
+
+  for (;;) {
+    WuhooSize read_index = recorder->read_index;
+
+    if (read_index == WuhooAtomicLoad(&recorder->write_index)) {
+      /* Stop only once everything captured so far is on disk */
+      if (0 == WuhooAtomicLoad(&recorder->running) &&
+          read_index == WuhooAtomicLoad(&recorder->write_index))
+        break;
+
+      WuhooRecorderIdle();
+      continue;
+    }
+
+    WuhooRGBA const* frame =
+      recorder->frames + (read_index % WUHOO_RECORDER_FRAME_COUNT) * frame_size;
+
+    if (WuhooRecorderWrite(recorder, frame))
+      WuhooAtomicStore(&recorder->written, recorder->written + 1);
+    else
+      WuhooAtomicStore(&recorder->write_failed, recorder->write_failed + 1);
+
+    WuhooAtomicStore(&recorder->read_index, read_index + 1);
+  }
+
+  fflush(recorder->file);
+}
+
+#ifdef _WIN32
+WuhooInternal DWORD WINAPI
+WuhooRecorderThread(LPVOID parameter)
+{
+  WuhooRecorderLoop((WuhooRecorder*)parameter);
+  return 0;
+}
+#else
+WuhooInternal void*
+WuhooRecorderThread(void* parameter)
+{
+  WuhooRecorderLoop((WuhooRecorder*)parameter);
+  return WuhooNull;
+}
+#endif
+
+WuhooInternal void
+WuhooRecorderFree(WuhooRecorder* recorder)
+{
+  if (WuhooNull != recorder->file)
+    fclose(recorder->file);
+
+  free(recorder->canvas);
+  free(recorder->frames);
+  free(recorder->planes);
+  free(recorder);
+}
+
+/* Called on the render thread after every blit, never waits for the disk */
+WuhooInternal void
+WuhooRecorderPublish(WuhooWindow* window)
+{
+  WuhooRecorder* recorder    = (WuhooRecorder*)window->recorder;
+  WuhooSize      write_index = recorder->write_index;
+  WuhooSize      frame_size  = recorder->width * recorder->height;
+
+  if (write_index - WuhooAtomicLoad(&recorder->read_index) >=
+      WUHOO_RECORDER_FRAME_COUNT) {
+    WuhooAtomicStore(&recorder->dropped, recorder->dropped + 1);
+    return;
+  }
+
+  memcpy(recorder->frames +
+           (write_index % WUHOO_RECORDER_FRAME_COUNT) * frame_size,
+         recorder->canvas, frame_size * sizeof(*recorder->canvas));
+
+  WuhooAtomicStore(&recorder->write_index, write_index + 1);
+}
+
+WuhooInternal void
+WuhooRecorderCapture(WuhooWindow* window, WuhooRGBA const* pixels,
+                     WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                     WuhooSize src_width, WuhooSize src_height, WuhooSize x,
+                     WuhooSize y, WuhooSize width, WuhooSize height)
+{
+  WuhooRecorder* recorder = (WuhooRecorder*)window->recorder;
+
+  WuhooCaptureRGBA(window, recorder->canvas, recorder->width, recorder->height,
+                   pixels, src_x, src_y, src_pitch, src_width, src_height, x,
+                   y, width, height);
+}
+
+WuhooResult
+WuhooWindowRecordStart(WuhooWindow* window, const char* path,
+                       WuhooRecordFormat format, WuhooSize fps)
+{
+  WuhooRecorder* recorder = (WuhooRecorder*)WuhooNull;
+  WuhooSize      size     = 0;
+  WuhooBoolean   started  = WuhooFalse;
+
+  if (WuhooNull != window->recorder) {
+    return (WuhooResult) "A recording is already running";
+  }
+
+  if (WuhooNull == path || format >= WUHOO_RECORD_MAX) {
+    return (WuhooResult) "invalid recording passed.";
+  }
+
+  if (window->cwidth <= 0 || window->cheight <= 0) {
+    return (WuhooResult) "Nothing to record, the client area is empty";
+  }
+
+  recorder = (WuhooRecorder*)calloc(1, sizeof(*recorder));
+  if (WuhooNull == recorder) {
+    return (WuhooResult) "Failed to allocate the recorder";
+  }
+
+  recorder->width  = window->cwidth;
+  recorder->height = window->cheight;
+  recorder->format = format;
+  size             = recorder->width * recorder->height;
+
+  recorder->canvas = (WuhooRGBA*)calloc(size, sizeof(WuhooRGBA));
+  recorder->frames =
+    (WuhooRGBA*)malloc(WUHOO_RECORDER_FRAME_COUNT * size * sizeof(WuhooRGBA));
+  if (WUHOO_RECORD_Y4M == format) {
+    recorder->planes = (unsigned char*)malloc(
+      size + 2 * ((recorder->width + 1) / 2) * ((recorder->height + 1) / 2));
+  }
+
+  if (WuhooNull == recorder->canvas || WuhooNull == recorder->frames ||
+      (WUHOO_RECORD_Y4M == format && WuhooNull == recorder->planes)) {
+    WuhooRecorderFree(recorder);
+    return (WuhooResult) "Failed to allocate the recording buffers";
+  }
+
+  recorder->file = fopen(path, "wb");
+  if (WuhooNull == recorder->file) {
+    WuhooRecorderFree(recorder);
+    return (WuhooResult) "Failed to open the recording file";
+  }
+
+  if (WUHOO_RECORD_Y4M == format &&
+      0 > fprintf(recorder->file, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n",
+                  recorder->width, recorder->height, fps ? fps : 60)) {
+    WuhooRecorderFree(recorder);
+    return (WuhooResult) "Failed to write the recording header";
+  }
+
+  recorder->running = 1;
+
+#ifdef _WIN32
+  recorder->thread =
+    CreateThread(WuhooNull, 0, WuhooRecorderThread, recorder, 0, WuhooNull);
+  started = (WuhooNull != recorder->thread);
+#else
+  started = (0 == pthread_create(&recorder->thread, WuhooNull,
+                                 WuhooRecorderThread, recorder));
+#endif
+
+  if (WuhooFalse == started) {
+    WuhooRecorderFree(recorder);
+    return (WuhooResult) "Failed to start the recording thread";
+  }
+
+  window->recorder = recorder;
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+WuhooWindowRecordStatsGet(WuhooWindow* window, WuhooRecordStats* stats)
+{
+  WuhooRecorder* recorder = (WuhooRecorder*)window->recorder;
+
+  if (WuhooNull == stats) {
+    return (WuhooResult) "invalid stats passed.";
+  }
+
+  if (WuhooNull == recorder) {
+    return (WuhooResult) "No recording is running";
+  }
+
+  stats->captured     = recorder->write_index;
+  stats->dropped      = recorder->dropped;
+  stats->written      = WuhooAtomicLoad(&recorder->written);
+  stats->write_failed = WuhooAtomicLoad(&recorder->write_failed);
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+WuhooWindowRecordStop(WuhooWindow* window, WuhooRecordStats* stats)
+{
+  WuhooRecorder* recorder = (WuhooRecorder*)window->recorder;
+
+  if (WuhooNull == recorder) {
+    return (WuhooResult) "No recording is running";
+  }
+
+  WuhooAtomicStore(&recorder->running, 0);
+
+#ifdef _WIN32
+  WaitForSingleObject(recorder->thread, INFINITE);
+  CloseHandle(recorder->thread);
+#else
+  pthread_join(recorder->thread, WuhooNull);
+#endif
+
+  if (WuhooNull != stats) {
+    WuhooWindowRecordStatsGet(window, stats);
+  }
+
+  window->recorder = WuhooNull;
+
+  /* fclose flushes, a failure there means the tail of the file is lost */
+  FILE* file     = recorder->file;
+  recorder->file = WuhooNull;
+  WuhooRecorderFree(recorder);
+
+  if (0 != fclose(file)) {
+    return (WuhooResult) "Failed to finish the recording file";
+  }
+
+  return WuhooSuccess;
+}
+
+#endif /* WUHOO_RECORDER_ENABLE */
+
+#ifdef WUHOO_EXPORT_ENABLE
+
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct
+{
+  int                fd;
+  WuhooExportHeader* header; /* The whole file is mapped from here */
+  WuhooSize          size;
+  unsigned int       frame; /* Being written, published once the blit is done */
+} WuhooExporter;
+
+WuhooInternal WuhooRGBA*
+WuhooExportPixels(WuhooExportHeader* header, unsigned int frame)
+{
+  return (WuhooRGBA*)((unsigned char*)header + header->pixel_offset +
+                      (frame % header->slot_count) * header->slot_size);
+}
+
+/* Claims the slot of the next frame and returns its pixels. Blits that do
+ * not cover the client area start from a copy of the previous frame */
+WuhooInternal WuhooRGBA*
+WuhooExportBegin(WuhooWindow* window, WuhooBoolean covered)
+{
+  WuhooExporter*     exporter = (WuhooExporter*)window->exporter;
+  WuhooExportHeader* header   = exporter->header;
+  WuhooRGBA*         pixels   = (WuhooRGBA*)WuhooNull;
+
+  exporter->frame = header->frame + 1;
+  /* 0 never names a frame, it marks the slot as torn for readers */
+  if (0 == exporter->frame)
+    exporter->frame = 1;
+
+  pixels = WuhooExportPixels(header, exporter->frame);
+  __atomic_store_n(&header->slots[exporter->frame % header->slot_count].sequence,
+                   0, __ATOMIC_RELEASE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+  if (WuhooFalse == covered && header->frame > 0) {
+    memcpy(pixels, WuhooExportPixels(header, header->frame),
+           header->pitch * header->height);
+  }
+
+  return pixels;
+}
+
+WuhooInternal void
+WuhooExportPublish(WuhooWindow* window)
+{
+  WuhooExporter*     exporter = (WuhooExporter*)window->exporter;
+  WuhooExportHeader* header   = exporter->header;
+  WuhooExportSlot*   slot = &header->slots[exporter->frame % header->slot_count];
+  struct timespec    now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  slot->ust = (unsigned long long)now.tv_sec * 1000000000ull + now.tv_nsec;
+
+  __atomic_store_n(&slot->sequence, exporter->frame, __ATOMIC_RELEASE);
+  __atomic_store_n(&header->frame, exporter->frame, __ATOMIC_RELEASE);
+
+  /* Shared futex, the readers live in other processes */
+  syscall(SYS_futex, &header->frame, FUTEX_WAKE, 0x7fffffff, WuhooNull,
+          WuhooNull, 0);
+}
+
+WuhooResult
+WuhooWindowExportStart(WuhooWindow* window, WuhooSize slot_count, int* fd)
+{
+  WuhooExporter*     exporter = (WuhooExporter*)WuhooNull;
+  WuhooExportHeader* header   = (WuhooExportHeader*)WuhooNull;
+  long               page     = sysconf(_SC_PAGESIZE);
+  WuhooSize          pitch    = window->cwidth * sizeof(WuhooRGBA);
+  WuhooSize          offset   = 0;
+  WuhooSize          slot_size = 0;
+
+  if (WuhooNull != window->exporter) {
+    return (WuhooResult) "An export is already running";
+  }
+
+  if (WuhooNull == fd || slot_count < 2 ||
+      slot_count > WUHOO_EXPORT_MAX_SLOTS) {
+    return (WuhooResult) "invalid export passed.";
+  }
+
+  if (window->cwidth <= 0 || window->cheight <= 0) {
+    return (WuhooResult) "Nothing to export, the client area is empty";
+  }
+
+  /* Pages of their own for the header and every slot, so readers can map
+   * them separately */
+  offset    = ((sizeof(WuhooExportHeader) + page - 1) / page) * page;
+  slot_size = ((pitch * window->cheight + page - 1) / page) * page;
+
+  exporter = (WuhooExporter*)calloc(1, sizeof(*exporter));
+  if (WuhooNull == exporter) {
+    return (WuhooResult) "Failed to allocate the exporter";
+  }
+
+  exporter->size = offset + slot_count * slot_size;
+
+  /* memfd_create is only declared with _GNU_SOURCE */
+  exporter->fd =
+    (int)syscall(SYS_memfd_create, WUHOO_STRING, 1u /* MFD_CLOEXEC */);
+  if (exporter->fd < 0) {
+    free(exporter);
+    return (WuhooResult) "memfd_create failed";
+  }
+
+  if (0 != ftruncate(exporter->fd, exporter->size)) {
+    close(exporter->fd);
+    free(exporter);
+    return (WuhooResult) "ftruncate failed";
+  }
+
+  void* memory = mmap(WuhooNull, exporter->size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, exporter->fd, 0);
+  if (MAP_FAILED == memory) {
+    close(exporter->fd);
+    free(exporter);
+    return (WuhooResult) "mmap failed";
+  }
+
+  /* ftruncate zero fills, so every slot sequence starts out torn */
+  header               = (WuhooExportHeader*)memory;
+  header->version      = WUHOO_EXPORT_VERSION;
+  header->width        = window->cwidth;
+  header->height       = window->cheight;
+  header->pitch        = pitch;
+  header->slot_count   = slot_count;
+  header->slot_size    = slot_size;
+  header->pixel_offset = offset;
+  /* Readers check the magic last */
+  __atomic_store_n(&header->magic, WUHOO_EXPORT_MAGIC, __ATOMIC_RELEASE);
+
+  exporter->header = header;
+  window->exporter = exporter;
+  *fd              = exporter->fd;
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+WuhooWindowExportStop(WuhooWindow* window)
+{
+  WuhooExporter* exporter = (WuhooExporter*)window->exporter;
+
+  if (WuhooNull == exporter) {
+    return (WuhooResult) "No export is running";
+  }
+
+  __atomic_store_n(&exporter->header->closed, 1, __ATOMIC_RELEASE);
+  /* Readers sleep on the frame word */
+  syscall(SYS_futex, &exporter->header->frame, FUTEX_WAKE, 0x7fffffff,
+          WuhooNull, WuhooNull, 0);
+
+  munmap(exporter->header, exporter->size);
+  close(exporter->fd);
+  free(exporter);
+
+  window->exporter = WuhooNull;
+
+  return WuhooSuccess;
+}
+
+#endif /* WUHOO_EXPORT_ENABLE */
+
+
+WuhooResult
+WuhooWindowInit(WuhooWindow* window)
+{
+  WuhooZeroInit(window, sizeof(*window));
+
+  /* Blits crop unless a filter is asked for, like they always did */
+  window->blit_filter = WUHOO_BLIT_FILTER_NONE;
+
+#ifdef WUHOO_OPENGL_ENABLE
+  window->gl_framebuffer.version.major  = 4;
+  window->gl_framebuffer.version.minor  = 0;
+  window->gl_framebuffer.redBits        = 3;
+  window->gl_framebuffer.greenBits      = 3;
+  window->gl_framebuffer.blueBits       = 2;
+  window->gl_framebuffer.alphaBits      = 0;
+  window->gl_framebuffer.depthBits      = 16;
+  window->gl_framebuffer.stencilBits    = 0;
+  window->gl_framebuffer.accumRedBits   = 0;
+  window->gl_framebuffer.accumGreenBits = 0;
+  window->gl_framebuffer.accumBlueBits  = 0;
+  window->gl_framebuffer.accumAlphaBits = 0;
+  window->gl_framebuffer.auxBuffers     = 0;
+  window->gl_framebuffer.stereo         = WuhooFalse;
+  window->gl_framebuffer.samples        = 0;
+  window->gl_framebuffer.sRGB           = WuhooFalse;
+  window->gl_framebuffer.doublebuffer   = WuhooTrue;
+  window->gl_framebuffer.transparent    = WuhooFalse;
+#endif
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+WuhooWindowDestroy(WuhooWindow* window)
+{
+  WuhooResult result = WuhooSuccess;
+
+#ifdef WUHOO_RECORDER_ENABLE
+  if (WuhooNull != window->recorder)
+    WuhooWindowRecordStop(window, (WuhooRecordStats*)WuhooNull);
+#endif
+
+#ifdef WUHOO_EXPORT_ENABLE
+  if (WuhooNull != window->exporter)
+    WuhooWindowExportStop(window);
+#endif
+
+#ifdef _WIN32
+  result = _WuhooWindowDestroyWin32(window);
+#endif
+
+#ifdef __APPLE__
+  result = _WuhooWindowDestroyCocoa(window);
+#endif
+
+#ifdef WUHOO_X11_ENABLE
+  result = _WuhooWindowDestroyX11(window);
+#endif
+
+#ifdef WUHOO_WAYLAND_ENABLE
+  result = _WuhooWindowDestroyWayland(window);
+#endif
+
+#ifdef WUHOO_FBDEV_ENABLE
+  result = _WuhooWindowDestroyFbdev(window);
+#endif
+
+#ifdef WUHOO_HEADLESS_ENABLE
+  result = _WuhooWindowDestroyHeadless(window);
+#endif
+
+#ifdef WUHOO_THREADS_ENABLE
+  /* Only windows that were created count for the conversion pool */
+  if (WuhooTrue == window->is_initialized) {
+    window->is_initialized = WuhooFalse;
+    WuhooConvertPoolRelease();
+  }
+#endif
+
+  return result;
+}
+WuhooResult
+WuhooWindowCreate(WuhooWindow* window, int posx, int posy, WuhooSize width,
+                  WuhooSize height, const char* title, WuhooFlags flags,
+                  const void* data)
+{
+  WuhooResult result = WuhooSuccess;
+
+  window->width  = width;
+  window->height = height;
+  window->flags  = flags;
+  window->x      = posx;
+  window->y      = posy;
+
+#if !defined(WUHOO_XPRESENT_ENABLE) && !defined(WUHOO_WAYLAND_ENABLE) &&  \
+  !defined(WUHOO_FBDEV_ENABLE)
+  /* Presentation is not paced on this backend */
+  window->flags &= ~WUHOO_FLAG_VSYNC;
+#endif
+
+#ifndef WUHOO_XRENDER_ENABLE
+  /* Nothing would keep the alpha channel */
+  window->flags &= ~WUHOO_FLAG_TRANSPARENT;
+#endif
+
+#ifdef _WIN32
+  result =
+    _WuhooWindowCreateWin32(window, posx, posy, width, height, title, flags);
+#endif
+
+#ifdef __APPLE__
+  result =
+    _WuhooWindowCreateCocoa(window, posx, posy, width, height, title, flags);
+#endif
+
+#ifdef WUHOO_X11_ENABLE
+  result =
+    _WuhooWindowCreateX11(window, posx, posy, width, height, title, flags);
+#endif
+
+#ifdef WUHOO_WAYLAND_ENABLE
+  result =
+    _WuhooWindowCreateWayland(window, posx, posy, width, height, title, flags);
+#endif
+
+#ifdef WUHOO_FBDEV_ENABLE
+  result = _WuhooWindowCreateFbdev(window, posx, posy, width, height, title,
+                                   flags, data);
+#endif
+
+#ifdef WUHOO_HEADLESS_ENABLE
+  result = _WuhooWindowCreateHeadless(window, posx, posy, width, height, title,
+                                      flags, data);
+#endif
+
+  if (WuhooSuccess == result)
+    window->convert_rgba =
+      WuhooConvertSelect(window->convert_rgba, window->flags);
+
+  window->is_initialized = (WuhooSuccess == result);
+  window->is_alive       = (WuhooSuccess == result);
+
+#ifdef WUHOO_THREADS_ENABLE
+  if (WuhooSuccess == result)
+    WuhooConvertPoolRetain();
+#endif
+
+  return result;
+}
+WuhooResult
+WuhooWindowEventNext(WuhooWindow* window, WuhooEvent* event)
+{
+  WuhooZeroInit(event, sizeof(*event));
+
+#ifdef _WIN32
+  return _WuhooWindowEventNextWin32(window, event);
+#endif
+#ifdef __APPLE__
+  return _WuhooWindowEventNextCocoa(window, event);
+#endif
+#ifdef WUHOO_X11_ENABLE
+  return _WuhooWindowEventNextX11(window, event);
+#endif
+#ifdef WUHOO_WAYLAND_ENABLE
+  return _WuhooWindowEventNextWayland(window, event);
+#endif
+#ifdef WUHOO_FBDEV_ENABLE
+  return _WuhooWindowEventNextFbdev(window, event);
+#endif
+#ifdef WUHOO_HEADLESS_ENABLE
+  return _WuhooWindowEventNextHeadless(window, event);
+#endif
+}
+
+#ifdef WUHOO_HEADLESS_ENABLE
+WuhooResult
+WuhooWindowEventInject(WuhooWindow* window, WuhooEvent const* event)
+{
+  if (WuhooNull == event) {
+    return (WuhooResult) "invalid event passed.";
+  }
+
+  return _WuhooWindowEventInjectHeadless(window, event);
+}
+#endif
+
+WuhooResult
+WuhooWindowShow(WuhooWindow* window)
+{
+#ifdef _WIN32
+  return _WuhooWindowShowWin32(window);
+#endif
+#ifdef __APPLE__
+  return _WuhooWindowShowCocoa(window);
+#endif
+#ifdef WUHOO_X11_ENABLE
+  return _WuhooWindowShowX11(window);
+#endif
+#ifdef WUHOO_WAYLAND_ENABLE
+  return _WuhooWindowShowWayland(window);
+#endif
+#ifdef WUHOO_FBDEV_ENABLE
+  return _WuhooWindowShowFbdev(window);
+#endif
+#ifdef WUHOO_HEADLESS_ENABLE
+  return _WuhooWindowShowHeadless(window);
+#endif
+}
+WuhooResult
+WuhooWindowRegionSet(WuhooWindow* window, int posx, int posy, WuhooSize width,
+                     WuhooSize height)
+{
+
+  if (!(WUHOO_FLAG_RESIZEABLE & window->flags)) {
+    return (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : WUHOO_FLAG_RESIZEABLE is not set for this window";
+  }
+
+  /* Stick to lower left origin for everyone */
+#ifdef __APPLE__
+  return _WuhooWindowRegionSetCocoa(window, posx, posy, width, height);
+#endif
+
+#ifdef _WIN32
+  return _WuhooWindowRegionSetWin32(window, posx, posy, width, height);
+#endif
+
+#ifdef WUHOO_X11_ENABLE
+  return _WuhooWindowRegionSetX11(window, posx, posy, width, height);
+#endif
+
+#ifdef WUHOO_WAYLAND_ENABLE
+  return _WuhooWindowRegionSetWayland(window, posx, posy, width, height);
+#endif
+
+#ifdef WUHOO_FBDEV_ENABLE
+  return _WuhooWindowRegionSetFbdev(window, posx, posy, width, height);
+#endif
+
+#ifdef WUHOO_HEADLESS_ENABLE
+  return _WuhooWindowRegionSetHeadless(window, posx, posy, width, height);
+#endif
+}
+WuhooResult
+WuhooWindowRegionGet(WuhooWindow* window, int* posx, int* posy,
+                     WuhooSize* width, WuhooSize* height)
+{
+#ifdef __APPLE__
+  return _WuhooWindowRegionGetCocoa(window, posx, posy, width, height);
+#endif
+
+#ifdef _WIN32
+  return _WuhooWindowRegionGetWin32(window, posx, posy, width, height);
+#endif
+
+#ifdef WUHOO_X11_ENABLE
+  return _WuhooWindowRegionGetX11(window, posx, posy, width, height);
+#endif
+
+#ifdef WUHOO_WAYLAND_ENABLE
+  return _WuhooWindowRegionGetWayland(window, posx, posy, width, height);
+#endif
+
+#ifdef WUHOO_FBDEV_ENABLE
+  return _WuhooWindowRegionGetFbdev(window, posx, posy, width, height);
+#endif
+
+#ifdef WUHOO_HEADLESS_ENABLE
+  return _WuhooWindowRegionGetHeadless(window, posx, posy, width, height);
+#endif
+}
+WuhooResult
+WuhooWindowClientRegionGet(WuhooWindow* window, int* posx, int* posy,
+                           WuhooSize* width, WuhooSize* height)
+{
+#ifdef __APPLE__
+  return _WuhooWindowClientRegionGetCocoa(window, posx, posy, width, height);
+#endif
+
+#ifdef _WIN32
+  return _WuhooWindowClientRegionGetWin32(window, posx, posy, width, height);
+#endif
+
+#ifdef WUHOO_X11_ENABLE
+  return _WuhooWindowClientRegionGetX11(window, posx, posy, width, height);
+#endif
+
+#ifdef WUHOO_WAYLAND_ENABLE
+  return _WuhooWindowRegionGetWayland(window, posx, posy, width, height);
+#endif
+
+#ifdef WUHOO_FBDEV_ENABLE
+  return _WuhooWindowRegionGetFbdev(window, posx, posy, width, height);
+#endif
+
+#ifdef WUHOO_HEADLESS_ENABLE
+  return _WuhooWindowRegionGetHeadless(window, posx, posy, width, height);
+#endif
+
+  return WuhooSuccess;
+}
+WuhooResult
+WuhooWindowClientRegionSet(WuhooWindow* window, int posx, int posy,
+                           WuhooSize width, WuhooSize height)
+{
+#ifdef __APPLE__
+  return _WuhooWindowClientRegionSetCocoa(window, posx, posy, width, height);
+#endif
+
+#ifdef _WIN32
+  return _WuhooWindowClientRegionSetWin32(window, posx, posy, width, height);
+#endif
+
+#ifdef WUHOO_X11_ENABLE
+  return _WuhooWindowClientRegionSetX11(window, posx, posy, width, height);
+#endif
+
+#ifdef WUHOO_WAYLAND_ENABLE
+  return _WuhooWindowRegionSetWayland(window, posx, posy, width, height);
+#endif
+
+#ifdef WUHOO_FBDEV_ENABLE
+  return _WuhooWindowRegionSetFbdev(window, posx, posy, width, height);
+#endif
+
+#ifdef WUHOO_HEADLESS_ENABLE
+  return _WuhooWindowRegionSetHeadless(window, posx, posy, width, height);
+#endif
+
+  return WuhooSuccess;
+}
+WuhooResult
+WuhooWindowSetTitle(WuhooWindow* window, const char* title)
+{
+  WuhooResult result = WuhooSuccess;
+
+  if (WuhooNull == title)
+    return (WuhooResult) "Invalid title";
+
+  if ( !(WUHOO_FLAG_TITLED & window->flags) )
+    return (WuhooResult) "WUHOO_FLAG_TITLED is not set";
+
+#ifdef __APPLE__
+  result = _WuhooWindowSetTitleCocoa(window, title);
+#endif
+
+#ifdef _WIN32
+  result = _WuhooWindowSetTitleWin32(window, title);
+#endif
+
+#ifdef WUHOO_X11_ENABLE
+  result = _WuhooWindowSetTitleX11(window, title);
+#endif
+
+#ifdef WUHOO_WAYLAND_ENABLE
+  result = _WuhooWindowSetTitleWayland(window, title);
+#endif
+
+  return result;
+}
+
+WuhooResult
+WuhooWindowDropContentsGet(WuhooWindow* window, WuhooEvent* event, char* buffer,
+                           WuhooSize buffer_size)
+{
+  WuhooResult result = WuhooSuccess;
+
+  if (WuhooNull == buffer) {
+	  return (WuhooResult)"invalid buffer passed.";
+  }
+
+  if (buffer_size < event->data.drop.size) {
+	  return (WuhooResult)"invalid buffer size.";
+  }
+
+#ifdef __APPLE__
+  result = _WuhooWindowDropContentsGetCocoa(window, event, buffer, buffer_size);
+#endif
+
+#ifdef _WIN32
+  result = _WuhooWindowDropContentsGetWin32(window, event, buffer, buffer_size);
+#endif
+
+#ifdef WUHOO_X11_ENABLE
+  result = _WuhooWindowDropContentsGetX11(window, event, buffer, buffer_size);
+#endif
+
+#ifdef WUHOO_WAYLAND_ENABLE
+  result = (WuhooResult)WUHOO_PLATFORM_API_STRING
+    " : File drop is not supported";
+#endif
+
+#ifdef WUHOO_FBDEV_ENABLE
+  result = (WuhooResult)WUHOO_PLATFORM_API_STRING
+    " : File drop is not supported";
+#endif
+
+#ifdef WUHOO_HEADLESS_ENABLE
+  result = (WuhooResult)WUHOO_PLATFORM_API_STRING
+    " : File drop is not supported";
+#endif
+
+  return result;
+}
+
+/* Hands a region to the backend with the conversion it goes through.
+ * pixels is what a stage without a source converts, region_width x
+ * region_height of it at (src_x, src_y) is stretched to the destination */
+WuhooInternal WuhooResult
+WuhooBlitStage(WuhooWindow* window, WuhooConvertStage const* stage,
+               WuhooRGBA* pixels, WuhooSize src_x, WuhooSize src_y,
+               WuhooSize src_pitch, WuhooSize region_width,
+               WuhooSize region_height, WuhooSize dst_x, WuhooSize dst_y,
+               WuhooSize dst_width, WuhooSize dst_height, WuhooBoolean async)
+{
+  WuhooResult result = WuhooSuccess;
+
+  /* Cocoa and Win32 are done with pixels on return, async makes no difference */
+#ifdef __APPLE__
+  WuhooUnused(stage);
+  WuhooUnused(async);
+  result = _WuhooWindowBlitCocoa(window, pixels, src_x, src_y, src_pitch,
+                                 region_width, region_height, dst_x, dst_y,
+                                 dst_width, dst_height);
+#endif
+
+#ifdef _WIN32
+  WuhooUnused(async);
+  result = _WuhooWindowBlitWin32(window, stage, pixels, src_x, src_y,
+                                 src_pitch, region_width, region_height, dst_x,
+                                 dst_y, dst_width, dst_height);
+#endif
+
+#ifdef WUHOO_X11_ENABLE
+  result = _WuhooWindowBlitX11(window, stage, pixels, src_x, src_y, src_pitch,
+                               region_width, region_height, dst_x, dst_y,
+                               dst_width, dst_height, async);
+#endif
+
+#ifdef WUHOO_WAYLAND_ENABLE
+  result = _WuhooWindowBlitWayland(window, stage, pixels, src_x, src_y,
+                                   src_pitch, region_width, region_height,
+                                   dst_x, dst_y, dst_width, dst_height, async);
+#endif
+
+#ifdef WUHOO_FBDEV_ENABLE
+  WuhooUnused(async);
+  result = _WuhooWindowBlitFbdev(window, stage, pixels, src_x, src_y,
+                                 src_pitch, region_width, region_height, dst_x,
+                                 dst_y, dst_width, dst_height);
+#endif
+
+#ifdef WUHOO_HEADLESS_ENABLE
+  WuhooUnused(async);
+  result = _WuhooWindowBlitHeadless(window, stage, pixels, src_x, src_y,
+                                    src_pitch, region_width, region_height,
+                                    dst_x, dst_y, dst_width, dst_height);
+#endif
+
+  return result;
+}
+
+/* Shared by WuhooWindowBlit and WuhooWindowBlitAsync */
+WuhooInternal WuhooResult
+WuhooBlitDispatch(WuhooWindow* window, WuhooRGBA* pixels, WuhooSize src_x,
+                  WuhooSize src_y, WuhooSize src_width, WuhooSize src_height,
+                  WuhooSize dst_x, WuhooSize dst_y, WuhooSize dst_width,
+                  WuhooSize dst_height, WuhooBoolean async)
+{
+  WuhooResult       result = WuhooSuccess;
+  WuhooConvertStage stage  = WuhooConvertStageWindow(window);
+
+  if (src_x >= src_width || src_y >= src_height) {
+    return WuhooSuccess;
+  }
+
+  /* pixels is a src_width x src_height image, present the part of it
+   * that starts at (src_x, src_y) without copying it first */
+  WuhooSize region_width  = src_width - src_x;
+  WuhooSize region_height = src_height - src_y;
+
+  if (WUHOO_BLIT_FILTER_NONE == window->blit_filter) {
+    region_width  = WuhooMini(region_width, dst_width);
+    region_height = WuhooMini(region_height, dst_height);
+    dst_width     = region_width;
+    dst_height    = region_height;
+  }
+
+  result = WuhooBlitStage(window, &stage, pixels, src_x, src_y, src_width,
+                          region_width, region_height, dst_x, dst_y,
+                          dst_width, dst_height, async);
+
+#ifdef WUHOO_RECORDER_ENABLE
+  if (WuhooSuccess == result && WuhooNull != window->recorder &&
+      WuhooBlitReachesWindow(window)) {
+    WuhooRecorderCapture(window, pixels, src_x, src_y, src_width, region_width,
+                         region_height, dst_x, dst_y, dst_width, dst_height);
+    WuhooRecorderPublish(window);
+  }
+#endif
+
+#ifdef WUHOO_EXPORT_ENABLE
+  if (WuhooSuccess == result && WuhooNull != window->exporter &&
+      WuhooBlitReachesWindow(window)) {
+    WuhooExportHeader* header  = ((WuhooExporter*)window->exporter)->header;
+    WuhooBoolean       covered = (0 == dst_x && 0 == dst_y &&
+                            dst_width >= header->width &&
+                            dst_height >= header->height);
+
+    WuhooCaptureRGBA(window, WuhooExportBegin(window, covered), header->width,
+                     header->height, pixels, src_x, src_y, src_width,
+                     region_width, region_height, dst_x, dst_y, dst_width,
+                     dst_height);
+    WuhooExportPublish(window);
+  }
+#endif
+
+  return result;
+}
+
+WuhooResult
+WuhooWindowBlit(WuhooWindow* window, WuhooRGBA* pixels, WuhooSize src_x,
+                WuhooSize src_y, WuhooSize src_width, WuhooSize src_height,
+                WuhooSize dst_x, WuhooSize dst_y, WuhooSize dst_width,
+                WuhooSize dst_height)
+{
+  return WuhooBlitDispatch(window, pixels, src_x, src_y, src_width, src_height,
+                           dst_x, dst_y, dst_width, dst_height, WuhooFalse);
+}
+
+WuhooResult
+WuhooWindowBlitAsync(WuhooWindow* window, WuhooRGBA* pixels, WuhooSize src_x,
+                     WuhooSize src_y, WuhooSize src_width,
+                     WuhooSize src_height, WuhooSize dst_x, WuhooSize dst_y,
+                     WuhooSize dst_width, WuhooSize dst_height)
+{
+  return WuhooBlitDispatch(window, pixels, src_x, src_y, src_width, src_height,
+                           dst_x, dst_y, dst_width, dst_height, WuhooTrue);
+}
+
+WuhooResult
+WuhooWindowFramesInFlightGet(WuhooWindow* window, WuhooSize* count)
+{
+  *count = 0;
+
+#if defined(WUHOO_X11_ENABLE)
+  *count = _WuhooWindowFramesInFlightX11(window);
+#elif defined(WUHOO_WAYLAND_ENABLE)
+  *count = _WuhooWindowFramesInFlightWayland(window);
+#else
+  WuhooUnused(window);
+#endif
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+WuhooWindowRoundTripsGet(WuhooWindow* window, WuhooSize* count)
+{
+  *count = 0;
+
+#if defined(WUHOO_X11_ENABLE)
+  *count = ((WuhooWindowX11*)window->platform_window)->round_trips;
+#else
+  WuhooUnused(window);
+#endif
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+WuhooWindowBlitRects(WuhooWindow* window, WuhooRGBA* pixels, WuhooSize stride,
+                     WuhooRect const* rects, WuhooSize count)
+{
+  WuhooResult                        result = WuhooSuccess;
+  WuhooMaybeUnused WuhooConvertStage stage  = WuhooConvertStageWindow(window);
+
+  if (WuhooNull == pixels || (WuhooNull == rects && count > 0)) {
+    return (WuhooResult) "invalid buffer passed.";
+  }
+
+#ifdef __APPLE__
+  /* No partial presentation on Cocoa yet, present the whole frame */
+  WuhooUnused(rects);
+  WuhooUnused(count);
+  result = _WuhooWindowBlitCocoa(window, pixels, 0, 0, stride, window->cwidth,
+                                 window->cheight, 0, 0, window->cwidth,
+                                 window->cheight);
+#endif
+
+#ifdef _WIN32
+  result = _WuhooWindowBlitRectsWin32(window, &stage, pixels, stride, rects,
+                                      count);
+#endif
+
+#ifdef WUHOO_X11_ENABLE
+  result = _WuhooWindowBlitRectsX11(window, &stage, pixels, stride, rects,
+                                    count);
+#endif
+
+#ifdef WUHOO_WAYLAND_ENABLE
+  result = _WuhooWindowBlitRectsWayland(window, &stage, pixels, stride, rects,
+                                        count);
+#endif
+
+#ifdef WUHOO_FBDEV_ENABLE
+  result = _WuhooWindowBlitRectsFbdev(window, &stage, pixels, stride, rects,
+                                      count);
+#endif
+
+#ifdef WUHOO_HEADLESS_ENABLE
+  result = _WuhooWindowBlitRectsHeadless(window, &stage, pixels, stride, rects,
+                                         count);
+#endif
+
+#ifdef WUHOO_RECORDER_ENABLE
+  if (WuhooSuccess == result && WuhooNull != window->recorder &&
+      WuhooBlitReachesWindow(window)) {
+    WuhooSize index = 0;
+    for (index = 0; index < count; index++) {
+      WuhooRecorderCapture(window, pixels, rects[index].x, rects[index].y,
+                           stride, rects[index].width, rects[index].height,
+                           rects[index].x, rects[index].y, rects[index].width,
+                           rects[index].height);
+    }
+    WuhooRecorderPublish(window);
+  }
+#endif
+
+#ifdef WUHOO_EXPORT_ENABLE
+  if (WuhooSuccess == result && WuhooNull != window->exporter &&
+      WuhooBlitReachesWindow(window)) {
+    WuhooExportHeader* header  = ((WuhooExporter*)window->exporter)->header;
+    WuhooBoolean       covered = (1 == count && 0 == rects[0].x &&
+                            0 == rects[0].y &&
+                            rects[0].width >= header->width &&
+                            rects[0].height >= header->height);
+    WuhooRGBA*         slot    = WuhooExportBegin(window, covered);
+    WuhooSize          index   = 0;
+
+    for (index = 0; index < count; index++) {
+      WuhooCaptureRGBA(window, slot, header->width, header->height, pixels,
+                       rects[index].x, rects[index].y, stride,
+                       rects[index].width, rects[index].height,
+                       rects[index].x, rects[index].y, rects[index].width,
+                       rects[index].height);
+    }
+    WuhooExportPublish(window);
+  }
+#endif
+
+  return result;
+}
+
+WuhooResult
+WuhooWindowFramebufferAcquire(WuhooWindow* window, WuhooFramebuffer* framebuffer)
+{
+  WuhooResult result = WuhooSuccess;
+
+  if (WuhooNull == framebuffer) {
+    return (WuhooResult) "invalid buffer passed.";
+  }
+
+#ifdef __APPLE__
+  result = (WuhooResult)WUHOO_PLATFORM_API_STRING
+    " : Framebuffer access is not supported";
+#endif
+
+#ifdef _WIN32
+  result = _WuhooWindowFramebufferAcquireWin32(window, framebuffer);
+#endif
+
+#ifdef WUHOO_X11_ENABLE
+  result = _WuhooWindowFramebufferAcquireX11(window, framebuffer);
+#endif
+
+#ifdef WUHOO_WAYLAND_ENABLE
+  result = _WuhooWindowFramebufferAcquireWayland(window, framebuffer);
+#endif
+
+#ifdef WUHOO_FBDEV_ENABLE
+  result = _WuhooWindowFramebufferAcquireFbdev(window, framebuffer);
+#endif
+
+#ifdef WUHOO_HEADLESS_ENABLE
+  result = _WuhooWindowFramebufferAcquireHeadless(window, framebuffer);
+#endif
+
+  return result;
+}
+
+WuhooResult
+WuhooWindowFramebufferRelease(WuhooWindow* window, WuhooRect const* rects,
+                              WuhooSize count)
+{
+  WuhooResult result        = WuhooSuccess;
+  WuhooRect   client_region = { 0, 0, (WuhooSize)window->cwidth,
+                              (WuhooSize)window->cheight };
+
+  if (WuhooNull == rects) {
+    rects = &client_region;
+    count = 1;
+  }
+
+  /* The pixels are native already, the backends only present them */
+#ifdef _WIN32
+  result = _WuhooWindowFramebufferPresentWin32(window, rects, count);
+#endif
+
+#ifdef WUHOO_X11_ENABLE
+  result = _WuhooWindowFramebufferPresentX11(window, rects, count);
+#endif
+
+#ifdef WUHOO_WAYLAND_ENABLE
+  result = _WuhooWindowFramebufferPresentWayland(window, rects, count);
+#endif
+
+  /* The framebuffer device and the headless surface are what is shown */
+#if defined(WUHOO_FBDEV_ENABLE) || defined(WUHOO_HEADLESS_ENABLE)
+  WuhooUnused(rects);
+  WuhooUnused(count);
+#endif
+
+  return result;
+}
+
+WuhooResult
+WuhooWindowPixelFormatGet(WuhooWindow* window, WuhooPixelFormat* format)
+{
+  if (WuhooNull == format) {
+    return (WuhooResult) "invalid buffer passed.";
+  }
+
+  /* Left empty by backends whose OpenGL windows have no pixel buffer */
+  if (0 == window->convert_format.bits_per_pixel) {
+    return (WuhooResult) "unsupported pixel format.";
+  }
+
+  *format = window->convert_format;
+
+  return WuhooSuccess;
+}
+
+WuhooResult
+WuhooWindowConvertNative(WuhooWindow* window, void* dst, WuhooSize dst_pitch,
+                         WuhooRGBA const* src, WuhooSize src_pitch,
+                         WuhooSize width, WuhooSize height)
+{
+  if (WuhooNull == dst || WuhooNull == src) {
+    return (WuhooResult) "invalid buffer passed.";
+  }
+
+  if (0 == window->convert_format.bits_per_pixel) {
+    return (WuhooResult) "unsupported pixel format.";
+  }
+
+#ifdef __APPLE__
+  /* Quartz reads the RGBA pixels in place */
+  return WuhooConvertRGBAtoRGBA(dst, dst_pitch, src, 0, 0, src_pitch, width,
+                                height);
+#else
+  WuhooConvertStage stage = WuhooConvertStageWindow(window);
+
+  return WuhooConvertStageRGBA(&stage, dst, dst_pitch, src, 0, 0, src_pitch,
+                               width, height);
+#endif
+}
+
+WuhooResult
+WuhooWindowBlitNative(WuhooWindow* window, void const* pixels, WuhooSize src_x,
+                      WuhooSize src_y, WuhooSize src_width,
+                      WuhooSize src_height, WuhooSize dst_x, WuhooSize dst_y,
+                      WuhooSize dst_width, WuhooSize dst_height)
+{
+  WuhooConvertStage stage = WuhooConvertStageWindow(window);
+  WuhooSize         bytes = window->convert_format.bits_per_pixel / 8;
+
+  if (WuhooNull == pixels) {
+    return (WuhooResult) "invalid buffer passed.";
+  }
+
+  if (bytes < 1 || bytes > 4) {
+    return (WuhooResult) "unsupported pixel format.";
+  }
+
+  if (src_x >= src_width || src_y >= src_height) {
+    return WuhooSuccess;
+  }
+
+  /* Resampling needs RGBA, native pixels are presented one to one */
+  WuhooSize region_width  = WuhooMini(src_width - src_x, dst_width);
+  WuhooSize region_height = WuhooMini(src_height - src_y, dst_height);
+
+#ifdef __APPLE__
+  /* Quartz reads the RGBA pixels in place, native pixels are just that */
+  return WuhooBlitStage(window, &stage, (WuhooRGBA*)pixels, src_x, src_y,
+                        src_width, region_width, region_height, dst_x, dst_y,
+                        region_width, region_height, WuhooFalse);
+#else
+  /* The regular path presents them with a copy as the source of the
+   * conversion stage, the backends only hand pixels over to it */
+  stage.source  = WuhooConvertNative;
+  stage.context = pixels;
+
+  return WuhooBlitStage(window, &stage, WuhooNull, src_x, src_y, src_width,
+                        region_width, region_height, dst_x, dst_y,
+                        region_width, region_height, WuhooFalse);
+#endif
+}
+
+WuhooResult
+WuhooWindowBlitBlendSet(WuhooWindow* window, WuhooBlitBlend blend)
+{
+  WuhooResult result = WuhooSuccess;
+
+  if (blend >= WUHOO_BLIT_BLEND_MAX) {
+    return (WuhooResult) "invalid blend mode passed.";
+  }
+
+#ifdef WUHOO_X11_ENABLE
+  result = _WuhooWindowBlitBlendSetX11(window, blend);
+#else
+  if (WUHOO_BLIT_BLEND_NONE != blend) {
+    result = (WuhooResult)WUHOO_PLATFORM_API_STRING
+      " : Blending is not supported";
+  }
+#endif
+
+  return result;
+}
+
+WuhooResult
+WuhooWindowBlitFilterSet(WuhooWindow* window, WuhooBlitFilter filter)
+{
+  if (filter >= WUHOO_BLIT_FILTER_MAX) {
+    return (WuhooResult) "invalid filter passed.";
+  }
+
+  window->blit_filter = filter;
+
+  return WuhooSuccess;
+}
+
+WuhooInternal void
+WuhooCopy(void* const to, void const* const from, WuhooSize count)
+{
+  unsigned char* const       char_view_to   = (unsigned char* const)to;
+  unsigned char const* const char_view_from = (unsigned char const* const)from;
+  while (--count)
+    char_view_to[count] = char_view_from[count];
+  char_view_to[count] = char_view_from[count];
+}
+
+/* Color conversion kernels */
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBANoOp(void* dst, WuhooSize dst_pitch, WuhooRGBA const* const src,
+                     WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                     WuhooSize width, WuhooSize height)
+{
+
+  return WuhooSuccess;
+}
+
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoRGBA(void* dst, WuhooSize dst_pitch,
+                       WuhooRGBA const* const src, WuhooSize src_x,
+                       WuhooSize src_y, WuhooSize src_pitch, WuhooSize width,
+                       WuhooSize height)
+{
+  WuhooByte*       dst_row = (WuhooByte*)dst;
+  WuhooRGBA const* src_row = src + src_x + src_y * src_pitch;
+
+  WuhooSize j = 0;
+  for (j = 0; j < height; j++) {
+    WuhooCopy(dst_row, src_row, width * sizeof(*src));
+    dst_row += dst_pitch;
+    src_row += src_pitch;
+  }
+
+  return WuhooSuccess;
+}
+
+/* The source of WuhooWindowBlitNative, the context holds pixels in the
+ * stage's format and src_pitch counts them instead of WuhooRGBA */
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertNative(WuhooConvertStage const* stage, void* dst,
+                   WuhooSize dst_pitch, WuhooSize src_x, WuhooSize src_y,
+                   WuhooSize src_pitch, WuhooSize width, WuhooSize height)
+{
+  WuhooSize        bytes   = stage->format->bits_per_pixel / 8;
+  WuhooByte*       dst_row = (WuhooByte*)dst;
+  WuhooByte const* src_row =
+    (WuhooByte const*)stage->context + (src_x + src_y * src_pitch) * bytes;
+  WuhooSize i = 0, j = 0;
+
+  for (j = 0; j < height; j++) {
+    for (i = 0; i < width * bytes; i++)
+      dst_row[i] = src_row[i];
+    dst_row += dst_pitch;
+    src_row += src_pitch * bytes;
+  }
+
+  return WuhooSuccess;
+}
+
+/* Swaps red and blue of count pixels, alpha is kept or cleared depending on
+ * alpha_mask. The SIMD rows below leave the last few pixels to it */
+typedef void (*WuhooSwizzleRow)(WuhooRGBA* dst, WuhooRGBA const* src,
+                                WuhooSize count, unsigned char alpha_mask);
+
+WuhooInternal void
+WuhooSwizzleRowScalar(WuhooRGBA* dst, WuhooRGBA const* src, WuhooSize count,
+                      unsigned char alpha_mask)
+{
+  WuhooSize i = 0;
+  for (i = 0; i < count; i++) {
+    dst[i].r = src[i].b;
+    dst[i].g = src[i].g;
+    dst[i].b = src[i].r;
+    dst[i].a = src[i].a & alpha_mask;
+  }
+}
+
+WuhooInternal WuhooResult
+WuhooSwizzle(void* dst, WuhooSize dst_pitch, WuhooRGBA const* const src,
+             WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+             WuhooSize width, WuhooSize height, WuhooSwizzleRow row,
+             unsigned char alpha_mask)
+{
+  WuhooByte*       dst_row = (WuhooByte*)dst;
+  WuhooRGBA const* src_row = src + src_x + src_y * src_pitch;
+
+  WuhooSize j = 0;
+  for (j = 0; j < height; j++) {
+    row((WuhooRGBA*)dst_row, src_row, width, alpha_mask);
+    dst_row += dst_pitch;
+    src_row += src_pitch;
+  }
+
+  return WuhooSuccess;
+}
+
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoRGB(void* dst, WuhooSize dst_pitch, WuhooRGBA const* const src,
+                      WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                      WuhooSize width, WuhooSize height)
+{
+  return WuhooSwizzle(dst, dst_pitch, src, src_x, src_y, src_pitch, width,
+                      height, WuhooSwizzleRowScalar, 0x00);
+}
+
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoBGRA(void* dst, WuhooSize dst_pitch,
+                       WuhooRGBA const* const src, WuhooSize src_x,
+                       WuhooSize src_y, WuhooSize src_pitch, WuhooSize width,
+                       WuhooSize height)
+{
+  return WuhooSwizzle(dst, dst_pitch, src, src_x, src_y, src_pitch, width,
+                      height, WuhooSwizzleRowScalar, 0xFF);
+}
+
+/* Packs count pixels to R5G6B5 by truncation after adding bias, which holds
+ * the per channel offsets of 16 pixels laid out like WuhooRGBA. The offsets
+ * repeat every 4 pixels, so the SIMD rows load them once and the scalar row
+ * can finish any multiple of 4 where they stopped */
+typedef void (*WuhooPackRow)(WuhooR5G6B5* dst, WuhooRGBA const* src,
+                             WuhooSize count, unsigned char const* bias);
+
+WuhooInternal void
+WuhooPackRowScalar(WuhooR5G6B5* dst, WuhooRGBA const* src, WuhooSize count,
+                   unsigned char const* bias)
+{
+  WuhooSize i = 0;
+  for (i = 0; i < count; i++) {
+    unsigned char const* offset = bias + 4 * (i & 3);
+    unsigned int         r      = src[i].r + offset[0];
+    unsigned int         g      = src[i].g + offset[1];
+    unsigned int         b      = src[i].b + offset[2];
+
+    r = (r > 255) ? 255 : r;
+    g = (g > 255) ? 255 : g;
+    b = (b > 255) ? 255 : b;
+
+    dst[i] = (WuhooR5G6B5)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+  }
+}
+
+/* Rows are dithered with a 4x4 Bayer matrix anchored at the source origin,
+ * its thresholds are scaled to the 3 and 2 bits each channel loses */
+WuhooInternal WuhooResult
+WuhooPack(void* dst, WuhooSize dst_pitch, WuhooRGBA const* const src,
+          WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+          WuhooSize width, WuhooSize height, WuhooPackRow row,
+          WuhooBoolean dither)
+{
+  static unsigned char const bayer[4][4] = { { 0, 8, 2, 10 },
+                                             { 12, 4, 14, 6 },
+                                             { 3, 11, 1, 9 },
+                                             { 15, 7, 13, 5 } };
+
+  WuhooByte*       dst_row = (WuhooByte*)dst;
+  WuhooRGBA const* src_row = src + src_x + src_y * src_pitch;
+  unsigned char    bias[64] = { 0 };
+
+  WuhooSize i = 0, j = 0;
+  for (j = 0; j < height; j++) {
+    if (dither) {
+      for (i = 0; i < 16; i++) {
+        unsigned char threshold = bayer[(src_y + j) & 3][(src_x + i) & 3];
+        bias[4 * i + 0]         = threshold >> 1;
+        bias[4 * i + 1]         = threshold >> 2;
+        bias[4 * i + 2]         = threshold >> 1;
+      }
     }
-    case ConfigureNotify: {
-      XConfigureEvent* xce = &xevent.xconfigure;
 
-      /* This event type is generated for a variety of
-         happenings, so check whether the window has been
-         resized. */
+    row((WuhooR5G6B5*)dst_row, src_row, width, bias);
+    dst_row += dst_pitch;
+    src_row += src_pitch;
+  }
 
-      if (xce->x != x11_window->prev_x || xce->y != x11_window->prev_y) {
-        x11_window->prev_x = xce->x;     
-        x11_window->prev_y = xce->y;
+  return WuhooSuccess;
+}
+
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoR5G6B5(void* dst, WuhooSize dst_pitch,
+                         WuhooRGBA const* const src, WuhooSize src_x,
+                         WuhooSize src_y, WuhooSize src_pitch, WuhooSize width,
+                         WuhooSize height)
+{
+  return WuhooPack(dst, dst_pitch, src, src_x, src_y, src_pitch, width, height,
+                   WuhooPackRowScalar, WuhooFalse);
+}
+
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoR5G6B5Dither(void* dst, WuhooSize dst_pitch,
+                               WuhooRGBA const* const src, WuhooSize src_x,
+                               WuhooSize src_y, WuhooSize src_pitch,
+                               WuhooSize width, WuhooSize height)
+{
+  return WuhooPack(dst, dst_pitch, src, src_x, src_y, src_pitch, width, height,
+                   WuhooPackRowScalar, WuhooTrue);
+}
+
+/* Exact rounding of c * a / 255 */
+#define WuhooPremultiply(c, a)                                                 \
+  ((((c) * (a) + 128) + (((c) * (a) + 128) >> 8)) >> 8)
+
+/* Bytes are stored B, G, R, A with the color channels scaled by alpha, which
+ * is what XRender expects from an ARGB32 picture */
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoPremultipliedBGRA(void* dst, WuhooSize dst_pitch,
+                                    WuhooRGBA const* const src,
+                                    WuhooSize src_x, WuhooSize src_y,
+                                    WuhooSize src_pitch, WuhooSize width,
+                                    WuhooSize height)
+{
+  WuhooByte*       dst_row = (WuhooByte*)dst;
+  WuhooRGBA const* src_row = src + src_x + src_y * src_pitch;
+
+  WuhooSize i = 0, j = 0;
+  for (j = 0; j < height; j++) {
+    WuhooRGBA* bgra_dst = (WuhooRGBA*)dst_row;
+    for (i = 0; i < width; i++) {
+      unsigned int a = src_row[i].a;
+      bgra_dst[i].r  = (unsigned char)WuhooPremultiply(src_row[i].b, a);
+      bgra_dst[i].g  = (unsigned char)WuhooPremultiply(src_row[i].g, a);
+      bgra_dst[i].b  = (unsigned char)WuhooPremultiply(src_row[i].r, a);
+      bgra_dst[i].a  = (unsigned char)a;
+    }
+    dst_row += dst_pitch;
+    src_row += src_pitch;
+  }
+
+  return WuhooSuccess;
+}
+
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoR5G5B5(void* dst, WuhooSize dst_pitch,
+                         WuhooRGBA const* const src, WuhooSize src_x,
+                         WuhooSize src_y, WuhooSize src_pitch, WuhooSize width,
+                         WuhooSize height)
+{
+  WuhooByte*       dst_row = (WuhooByte*)dst;
+  WuhooRGBA const* src_row = src + src_x + src_y * src_pitch;
+
+  WuhooSize i = 0, j = 0;
+  for (j = 0; j < height; j++) {
+    WuhooR5G5B5* pixels = (WuhooR5G5B5*)dst_row;
+    for (i = 0; i < width; i++) {
+      pixels[i] = (WuhooR5G5B5)(((src_row[i].r >> 3) << 10) |
+                                ((src_row[i].g >> 3) << 5) |
+                                (src_row[i].b >> 3));
+    }
+    dst_row += dst_pitch;
+    src_row += src_pitch;
+  }
+
+  return WuhooSuccess;
+}
+
+/* 24 bit pixels, named after the channel order from the most significant
+ * byte like the 16 bit ones, so R8G8B8 is stored B, G, R */
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoR8G8B8(void* dst, WuhooSize dst_pitch,
+                         WuhooRGBA const* const src, WuhooSize src_x,
+                         WuhooSize src_y, WuhooSize src_pitch, WuhooSize width,
+                         WuhooSize height)
+{
+  WuhooByte*       dst_row = (WuhooByte*)dst;
+  WuhooRGBA const* src_row = src + src_x + src_y * src_pitch;
+
+  WuhooSize i = 0, j = 0;
+  for (j = 0; j < height; j++) {
+    WuhooByte* bytes = dst_row;
+    for (i = 0; i < width; i++) {
+      bytes[0] = src_row[i].b;
+      bytes[1] = src_row[i].g;
+      bytes[2] = src_row[i].r;
+      bytes += 3;
+    }
+    dst_row += dst_pitch;
+    src_row += src_pitch;
+  }
+
+  return WuhooSuccess;
+}
+
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoB8G8R8(void* dst, WuhooSize dst_pitch,
+                         WuhooRGBA const* const src, WuhooSize src_x,
+                         WuhooSize src_y, WuhooSize src_pitch, WuhooSize width,
+                         WuhooSize height)
+{
+  WuhooByte*       dst_row = (WuhooByte*)dst;
+  WuhooRGBA const* src_row = src + src_x + src_y * src_pitch;
+
+  WuhooSize i = 0, j = 0;
+  for (j = 0; j < height; j++) {
+    WuhooByte* bytes = dst_row;
+    for (i = 0; i < width; i++) {
+      bytes[0] = src_row[i].r;
+      bytes[1] = src_row[i].g;
+      bytes[2] = src_row[i].b;
+      bytes += 3;
+    }
+    dst_row += dst_pitch;
+    src_row += src_pitch;
+  }
+
+  return WuhooSuccess;
+}
+
+/* The 30 bit depth of X11, channels are widened by repeating their top bits
+ * so that 255 becomes 1023 */
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoR10G10B10(void* dst, WuhooSize dst_pitch,
+                            WuhooRGBA const* const src, WuhooSize src_x,
+                            WuhooSize src_y, WuhooSize src_pitch,
+                            WuhooSize width, WuhooSize height)
+{
+#define WuhooWiden10(c) ((unsigned int)((c) << 2) | ((c) >> 6))
+  WuhooByte*       dst_row = (WuhooByte*)dst;
+  WuhooRGBA const* src_row = src + src_x + src_y * src_pitch;
+
+  WuhooSize i = 0, j = 0;
+  for (j = 0; j < height; j++) {
+    unsigned int* pixels = (unsigned int*)dst_row;
+    for (i = 0; i < width; i++) {
+      pixels[i] = (WuhooWiden10(src_row[i].r) << 20) |
+                  (WuhooWiden10(src_row[i].g) << 10) |
+                  WuhooWiden10(src_row[i].b);
+    }
+    dst_row += dst_pitch;
+    src_row += src_pitch;
+  }
+#undef WuhooWiden10
+
+  return WuhooSuccess;
+}
+
+/* Position and width of the bits a mask selects */
+WuhooInternal void
+WuhooMaskBits(WuhooSize mask, unsigned int* offset, unsigned int* length)
+{
+  *offset = 0;
+  *length = 0;
+  while (0 != mask && 0 == (mask & 1)) {
+    mask >>= 1;
+    (*offset)++;
+  }
+  while (0 != (mask & 1)) {
+    mask >>= 1;
+    (*length)++;
+  }
+}
+
+/* Any TrueColor layout of 8 to 32 bits, stored in either byte order. Each
+ * channel goes through a small table of shifts built from the masks once per
+ * call, so this is the slowest kernel and only used when no other fits */
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoFormat(WuhooPixelFormat const* format, void* dst,
+                         WuhooSize dst_pitch, WuhooRGBA const* const src,
+                         WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                         WuhooSize width, WuhooSize height)
+{
+  WuhooByte*       dst_row = (WuhooByte*)dst;
+  WuhooRGBA const* src_row = src + src_x + src_y * src_pitch;
+  WuhooSize        bytes   = format->bits_per_pixel / 8;
+  WuhooSize        masks[4];
+  /* Right shift narrowing the channel, left shift widening it, then the
+   * shift that puts it in place */
+  unsigned int shifts[4][3];
+  /* Alpha is the fourth channel, the colors are premultiplied with it */
+  WuhooSize channel_count = (0 != format->alpha_mask) ? 4 : 3;
+
+  WuhooSize i = 0, j = 0, k = 0;
+
+  masks[0] = format->red_mask;
+  masks[1] = format->green_mask;
+  masks[2] = format->blue_mask;
+  masks[3] = format->alpha_mask;
+  for (k = 0; k < channel_count; k++) {
+    unsigned int offset, length;
+    WuhooMaskBits(masks[k], &offset, &length);
+    length       = WuhooMini(length, 16);
+    shifts[k][0] = (length < 8) ? 8 - length : 0;
+    shifts[k][1] = (length > 8) ? length - 8 : 0;
+    shifts[k][2] = offset;
+  }
+
+  for (j = 0; j < height; j++) {
+    WuhooByte* pixel = dst_row;
+    for (i = 0; i < width; i++) {
+      unsigned int  a           = src_row[i].a;
+      unsigned char channels[4] = { src_row[i].r, src_row[i].g, src_row[i].b,
+                                    (unsigned char)a };
+      unsigned int  value       = 0;
+
+      if (4 == channel_count) {
+        for (k = 0; k < 3; k++)
+          channels[k] = (unsigned char)WuhooPremultiply(channels[k], a);
+      }
+
+      for (k = 0; k < channel_count; k++) {
+        unsigned int c = channels[k] >> shifts[k][0];
+        /* Repeats the top bits into the ones 8 bits can not fill */
+        unsigned int widened = c << shifts[k][1];
+        if (0 != shifts[k][1])
+          widened |= c >> (8 - shifts[k][1]);
+        value |= widened << shifts[k][2];
+      }
+
+      for (k = 0; k < bytes; k++) {
+        unsigned int byte = format->msb_first ? (bytes - 1 - k) : k;
+        pixel[byte]       = (WuhooByte)(value >> (8 * k));
+      }
+      pixel += bytes;
+    }
+    dst_row += dst_pitch;
+    src_row += src_pitch;
+  }
+
+  return WuhooSuccess;
+}
+
+/* Vectorized swizzles. Loads and stores are unaligned, so rows may start
+ * anywhere in the destination, and the pixels that do not fill a whole
+ * vector are finished by WuhooSwizzleRowScalar */
+#ifdef WUHOO_X86
+WuhooTarget("ssse3") WuhooInternal void
+WuhooSwizzleRowSSSE3(WuhooRGBA* dst, WuhooRGBA const* src, WuhooSize count,
+                     unsigned char alpha_mask)
+{
+  /* Index -128 makes pshufb write a zero */
+  char const    a     = alpha_mask ? 3 : -128;
+  __m128i const order = _mm_setr_epi8(2, 1, 0, a, 6, 5, 4, (char)(a + 4), 10, 9,
+                                      8, (char)(a + 8), 14, 13, 12,
+                                      (char)(a + 12));
+  WuhooSize i = 0;
+
+  for (i = 0; i + 4 <= count; i += 4) {
+    __m128i pixels = _mm_loadu_si128((__m128i const*)&src[i]);
+    _mm_storeu_si128((__m128i*)&dst[i], _mm_shuffle_epi8(pixels, order));
+  }
+
+  WuhooSwizzleRowScalar(dst + i, src + i, count - i, alpha_mask);
+}
+
+WuhooTarget("avx2") WuhooInternal void
+WuhooSwizzleRowAVX2(WuhooRGBA* dst, WuhooRGBA const* src, WuhooSize count,
+                    unsigned char alpha_mask)
+{
+  /* vpshufb shuffles each 128 bit lane on its own, the pattern repeats */
+  char const    a     = alpha_mask ? 3 : -128;
+  __m256i const order = _mm256_setr_epi8(
+    2, 1, 0, a, 6, 5, 4, (char)(a + 4), 10, 9, 8, (char)(a + 8), 14, 13, 12,
+    (char)(a + 12), 2, 1, 0, a, 6, 5, 4, (char)(a + 4), 10, 9, 8,
+    (char)(a + 8), 14, 13, 12, (char)(a + 12));
+  WuhooSize i = 0;
+
+  for (i = 0; i + 8 <= count; i += 8) {
+    __m256i pixels = _mm256_loadu_si256((__m256i const*)&src[i]);
+    _mm256_storeu_si256((__m256i*)&dst[i], _mm256_shuffle_epi8(pixels, order));
+  }
+
+  WuhooSwizzleRowScalar(dst + i, src + i, count - i, alpha_mask);
+}
+
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoBGRASSSE3(void* dst, WuhooSize dst_pitch,
+                            WuhooRGBA const* const src, WuhooSize src_x,
+                            WuhooSize src_y, WuhooSize src_pitch,
+                            WuhooSize width, WuhooSize height)
+{
+  return WuhooSwizzle(dst, dst_pitch, src, src_x, src_y, src_pitch, width,
+                      height, WuhooSwizzleRowSSSE3, 0xFF);
+}
+
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoRGBSSSE3(void* dst, WuhooSize dst_pitch,
+                           WuhooRGBA const* const src, WuhooSize src_x,
+                           WuhooSize src_y, WuhooSize src_pitch,
+                           WuhooSize width, WuhooSize height)
+{
+  return WuhooSwizzle(dst, dst_pitch, src, src_x, src_y, src_pitch, width,
+                      height, WuhooSwizzleRowSSSE3, 0x00);
+}
+
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoBGRAAVX2(void* dst, WuhooSize dst_pitch,
+                           WuhooRGBA const* const src, WuhooSize src_x,
+                           WuhooSize src_y, WuhooSize src_pitch,
+                           WuhooSize width, WuhooSize height)
+{
+  return WuhooSwizzle(dst, dst_pitch, src, src_x, src_y, src_pitch, width,
+                      height, WuhooSwizzleRowAVX2, 0xFF);
+}
+
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoRGBAVX2(void* dst, WuhooSize dst_pitch,
+                          WuhooRGBA const* const src, WuhooSize src_x,
+                          WuhooSize src_y, WuhooSize src_pitch,
+                          WuhooSize width, WuhooSize height)
+{
+  return WuhooSwizzle(dst, dst_pitch, src, src_x, src_y, src_pitch, width,
+                      height, WuhooSwizzleRowAVX2, 0x00);
+}
+
+/* The channels are masked and shifted into place inside each 32 bit pixel,
+ * sign extended so the signed pack keeps all 16 bits */
+#define WuhooPackSSE2(pixels)                                                  \
+  _mm_srai_epi32(                                                              \
+    _mm_slli_epi32(                                                            \
+      _mm_or_si128(                                                            \
+        _mm_or_si128(                                                          \
+          _mm_slli_epi32(_mm_and_si128(pixels, _mm_set1_epi32(0xF8)), 8),      \
+          _mm_srli_epi32(_mm_and_si128(pixels, _mm_set1_epi32(0xFC00)), 5)),   \
+        _mm_srli_epi32(_mm_and_si128(pixels, _mm_set1_epi32(0xF80000)), 19)),  \
+      16),                                                                     \
+    16)
+
+WuhooTarget("sse2") WuhooInternal void
+WuhooPackRowSSE2(WuhooR5G6B5* dst, WuhooRGBA const* src, WuhooSize count,
+                 unsigned char const* bias)
+{
+  __m128i const offsets = _mm_loadu_si128((__m128i const*)bias);
+  WuhooSize     i       = 0;
+
+  for (i = 0; i + 8 <= count; i += 8) {
+    __m128i low  = _mm_adds_epu8(
+      _mm_loadu_si128((__m128i const*)&src[i]), offsets);
+    __m128i high = _mm_adds_epu8(
+      _mm_loadu_si128((__m128i const*)&src[i + 4]), offsets);
+    _mm_storeu_si128((__m128i*)&dst[i],
+                     _mm_packs_epi32(WuhooPackSSE2(low), WuhooPackSSE2(high)));
+  }
+
+  WuhooPackRowScalar(dst + i, src + i, count - i, bias);
+}
+
+#undef WuhooPackSSE2
+
+#define WuhooPackAVX2(pixels)                                                  \
+  _mm256_srai_epi32(                                                           \
+    _mm256_slli_epi32(                                                         \
+      _mm256_or_si256(                                                         \
+        _mm256_or_si256(                                                       \
+          _mm256_slli_epi32(                                                   \
+            _mm256_and_si256(pixels, _mm256_set1_epi32(0xF8)), 8),             \
+          _mm256_srli_epi32(                                                   \
+            _mm256_and_si256(pixels, _mm256_set1_epi32(0xFC00)), 5)),          \
+        _mm256_srli_epi32(                                                     \
+          _mm256_and_si256(pixels, _mm256_set1_epi32(0xF80000)), 19)),         \
+      16),                                                                     \
+    16)
+
+WuhooTarget("avx2") WuhooInternal void
+WuhooPackRowAVX2(WuhooR5G6B5* dst, WuhooRGBA const* src, WuhooSize count,
+                 unsigned char const* bias)
+{
+  __m256i const offsets = _mm256_loadu_si256((__m256i const*)bias);
+  WuhooSize     i       = 0;
+
+  for (i = 0; i + 16 <= count; i += 16) {
+    __m256i low  = _mm256_adds_epu8(
+      _mm256_loadu_si256((__m256i const*)&src[i]), offsets);
+    __m256i high = _mm256_adds_epu8(
+      _mm256_loadu_si256((__m256i const*)&src[i + 8]), offsets);
+    /* The pack interleaves the 128 bit lanes of its inputs, undo it */
+    __m256i packed =
+      _mm256_packs_epi32(WuhooPackAVX2(low), WuhooPackAVX2(high));
+    _mm256_storeu_si256((__m256i*)&dst[i],
+                        _mm256_permute4x64_epi64(packed, 0xD8));
+  }
+
+  WuhooPackRowScalar(dst + i, src + i, count - i, bias);
+}
+
+#undef WuhooPackAVX2
+
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoR5G6B5SSE2(void* dst, WuhooSize dst_pitch,
+                             WuhooRGBA const* const src, WuhooSize src_x,
+                             WuhooSize src_y, WuhooSize src_pitch,
+                             WuhooSize width, WuhooSize height)
+{
+  return WuhooPack(dst, dst_pitch, src, src_x, src_y, src_pitch, width, height,
+                   WuhooPackRowSSE2, WuhooFalse);
+}
+
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoR5G6B5DitherSSE2(void* dst, WuhooSize dst_pitch,
+                                   WuhooRGBA const* const src,
+                                   WuhooSize src_x, WuhooSize src_y,
+                                   WuhooSize src_pitch, WuhooSize width,
+                                   WuhooSize height)
+{
+  return WuhooPack(dst, dst_pitch, src, src_x, src_y, src_pitch, width, height,
+                   WuhooPackRowSSE2, WuhooTrue);
+}
+
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoR5G6B5AVX2(void* dst, WuhooSize dst_pitch,
+                             WuhooRGBA const* const src, WuhooSize src_x,
+                             WuhooSize src_y, WuhooSize src_pitch,
+                             WuhooSize width, WuhooSize height)
+{
+  return WuhooPack(dst, dst_pitch, src, src_x, src_y, src_pitch, width, height,
+                   WuhooPackRowAVX2, WuhooFalse);
+}
+
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoR5G6B5DitherAVX2(void* dst, WuhooSize dst_pitch,
+                                   WuhooRGBA const* const src,
+                                   WuhooSize src_x, WuhooSize src_y,
+                                   WuhooSize src_pitch, WuhooSize width,
+                                   WuhooSize height)
+{
+  return WuhooPack(dst, dst_pitch, src, src_x, src_y, src_pitch, width, height,
+                   WuhooPackRowAVX2, WuhooTrue);
+}
+#endif
+
+#ifdef WUHOO_NEON
+/* The deinterleaving loads put each channel in a register of its own, which
+ * makes the swizzle a matter of storing them in another order */
+WuhooInternal void
+WuhooSwizzleRowNEON(WuhooRGBA* dst, WuhooRGBA const* src, WuhooSize count,
+                    unsigned char alpha_mask)
+{
+  WuhooSize i = 0;
+
+  for (i = 0; i + 16 <= count; i += 16) {
+    uint8x16x4_t pixels = vld4q_u8((uint8_t const*)&src[i]);
+    uint8x16_t   red    = pixels.val[0];
+    pixels.val[0]       = pixels.val[2];
+    pixels.val[2]       = red;
+    pixels.val[3]       = vandq_u8(pixels.val[3], vdupq_n_u8(alpha_mask));
+    vst4q_u8((uint8_t*)&dst[i], pixels);
+  }
+
+  WuhooSwizzleRowScalar(dst + i, src + i, count - i, alpha_mask);
+}
+
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoBGRANEON(void* dst, WuhooSize dst_pitch,
+                           WuhooRGBA const* const src, WuhooSize src_x,
+                           WuhooSize src_y, WuhooSize src_pitch,
+                           WuhooSize width, WuhooSize height)
+{
+  return WuhooSwizzle(dst, dst_pitch, src, src_x, src_y, src_pitch, width,
+                      height, WuhooSwizzleRowNEON, 0xFF);
+}
+
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoRGBNEON(void* dst, WuhooSize dst_pitch,
+                          WuhooRGBA const* const src, WuhooSize src_x,
+                          WuhooSize src_y, WuhooSize src_pitch,
+                          WuhooSize width, WuhooSize height)
+{
+  return WuhooSwizzle(dst, dst_pitch, src, src_x, src_y, src_pitch, width,
+                      height, WuhooSwizzleRowNEON, 0x00);
+}
+
+/* Each channel is widened to the top of a 16 bit lane and shifted into the
+ * pixel below the bits already inserted */
+WuhooInternal void
+WuhooPackRowNEON(WuhooR5G6B5* dst, WuhooRGBA const* src, WuhooSize count,
+                 unsigned char const* bias)
+{
+  uint8x16x4_t const offsets = vld4q_u8((uint8_t const*)bias);
+  WuhooSize          i       = 0;
+
+  for (i = 0; i + 16 <= count; i += 16) {
+    uint8x16x4_t pixels = vld4q_u8((uint8_t const*)&src[i]);
+    uint8x16_t   r      = vqaddq_u8(pixels.val[0], offsets.val[0]);
+    uint8x16_t   g      = vqaddq_u8(pixels.val[1], offsets.val[1]);
+    uint8x16_t   b      = vqaddq_u8(pixels.val[2], offsets.val[2]);
+
+    uint16x8_t low = vshll_n_u8(vget_low_u8(r), 8);
+    low = vsriq_n_u16(low, vshll_n_u8(vget_low_u8(g), 8), 5);
+    low = vsriq_n_u16(low, vshll_n_u8(vget_low_u8(b), 8), 11);
+
+    uint16x8_t high = vshll_n_u8(vget_high_u8(r), 8);
+    high = vsriq_n_u16(high, vshll_n_u8(vget_high_u8(g), 8), 5);
+    high = vsriq_n_u16(high, vshll_n_u8(vget_high_u8(b), 8), 11);
+
+    vst1q_u16((uint16_t*)&dst[i], low);
+    vst1q_u16((uint16_t*)&dst[i + 8], high);
+  }
+
+  WuhooPackRowScalar(dst + i, src + i, count - i, bias);
+}
+
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoR5G6B5NEON(void* dst, WuhooSize dst_pitch,
+                             WuhooRGBA const* const src, WuhooSize src_x,
+                             WuhooSize src_y, WuhooSize src_pitch,
+                             WuhooSize width, WuhooSize height)
+{
+  return WuhooPack(dst, dst_pitch, src, src_x, src_y, src_pitch, width, height,
+                   WuhooPackRowNEON, WuhooFalse);
+}
+
+WuhooMaybeUnused WuhooInternal WuhooResult
+WuhooConvertRGBAtoR5G6B5DitherNEON(void* dst, WuhooSize dst_pitch,
+                                   WuhooRGBA const* const src,
+                                   WuhooSize src_x, WuhooSize src_y,
+                                   WuhooSize src_pitch, WuhooSize width,
+                                   WuhooSize height)
+{
+  return WuhooPack(dst, dst_pitch, src, src_x, src_y, src_pitch, width, height,
+                   WuhooPackRowNEON, WuhooTrue);
+}
+#endif
+
+/* Queried once, the answer does not change while the process runs */
+WuhooInternal unsigned int
+WuhooCpuFeatures(void)
+{
+  static int          queried  = 0;
+  static unsigned int features = 0;
+
+  if (queried)
+    return features;
+
+#if defined(WUHOO_X86) && defined(_MSC_VER) && !defined(__clang__)
+  {
+    int info[4];
+    int max_leaf = 0;
+
+    __cpuid(info, 0);
+    max_leaf = info[0];
+
+    __cpuid(info, 1);
+    if (info[3] & (1 << 26))
+      features |= WUHOO_CPU_SSE2;
+    if (info[2] & (1 << 9))
+      features |= WUHOO_CPU_SSSE3;
+
+    /* AVX2 also needs the OS to save the upper halves of the registers */
+    if (max_leaf >= 7 && (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+        6 == (_xgetbv(0) & 6)) {
+      __cpuidex(info, 7, 0);
+      if (info[1] & (1 << 5))
+        features |= WUHOO_CPU_AVX2;
+    }
+  }
+#elif defined(WUHOO_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2"))
+    features |= WUHOO_CPU_SSE2;
+  if (__builtin_cpu_supports("ssse3"))
+    features |= WUHOO_CPU_SSSE3;
+  if (__builtin_cpu_supports("avx2"))
+    features |= WUHOO_CPU_AVX2;
+#elif defined(WUHOO_NEON)
+  /* Part of the baseline the header was compiled for */
+  features |= WUHOO_CPU_NEON;
+#endif
+
+  queried = 1;
+
+  return features;
+}
+
+/* Trades a scalar kernel picked by a backend for the fastest variant of it
+ * this CPU can run, dithering if the window asked for it. Called once per
+ * window, when it is created */
+WuhooInternal WuhooConvertRGBA
+WuhooConvertSelect(WuhooConvertRGBA kernel, WuhooFlags flags)
+{
+  unsigned int features = WuhooCpuFeatures();
+
+  if (WuhooConvertRGBAtoR5G6B5 == kernel && (WUHOO_FLAG_DITHER & flags))
+    kernel = WuhooConvertRGBAtoR5G6B5Dither;
+
+#ifdef WUHOO_X86
+  if (WuhooConvertRGBAtoBGRA == kernel) {
+    if (features & WUHOO_CPU_AVX2)
+      return WuhooConvertRGBAtoBGRAAVX2;
+    if (features & WUHOO_CPU_SSSE3)
+      return WuhooConvertRGBAtoBGRASSSE3;
+  } else if (WuhooConvertRGBAtoRGB == kernel) {
+    if (features & WUHOO_CPU_AVX2)
+      return WuhooConvertRGBAtoRGBAVX2;
+    if (features & WUHOO_CPU_SSSE3)
+      return WuhooConvertRGBAtoRGBSSSE3;
+  } else if (WuhooConvertRGBAtoR5G6B5 == kernel) {
+    if (features & WUHOO_CPU_AVX2)
+      return WuhooConvertRGBAtoR5G6B5AVX2;
+    if (features & WUHOO_CPU_SSE2)
+      return WuhooConvertRGBAtoR5G6B5SSE2;
+  } else if (WuhooConvertRGBAtoR5G6B5Dither == kernel) {
+    if (features & WUHOO_CPU_AVX2)
+      return WuhooConvertRGBAtoR5G6B5DitherAVX2;
+    if (features & WUHOO_CPU_SSE2)
+      return WuhooConvertRGBAtoR5G6B5DitherSSE2;
+  }
+#endif
+
+#ifdef WUHOO_NEON
+  if (WuhooConvertRGBAtoBGRA == kernel && (features & WUHOO_CPU_NEON))
+    return WuhooConvertRGBAtoBGRANEON;
+  if (WuhooConvertRGBAtoRGB == kernel && (features & WUHOO_CPU_NEON))
+    return WuhooConvertRGBAtoRGBNEON;
+  if (WuhooConvertRGBAtoR5G6B5 == kernel && (features & WUHOO_CPU_NEON))
+    return WuhooConvertRGBAtoR5G6B5NEON;
+  if (WuhooConvertRGBAtoR5G6B5Dither == kernel && (features & WUHOO_CPU_NEON))
+    return WuhooConvertRGBAtoR5G6B5DitherNEON;
+#endif
+
+  WuhooUnused(features);
+
+  return kernel;
+}
+
+/* Compositing. Each channel is src * a + background * (255 - a) over 255,
+ * rounded, with a in place of the source channel for alpha itself so the
+ * coverages add up. t = x + 128; (t + (t >> 8)) >> 8 divides exactly for
+ * every x up to 255 * 255 and fits 16 bits, the vectors keep it there */
+typedef void (*WuhooBlendRow)(WuhooRGBA* dst, WuhooRGBA const* src,
+                              WuhooRGBA const* background, WuhooSize count);
+
+#define WuhooDivide255(x)                                                      \
+  ((((x) + 128) + (((x) + 128) >> 8)) >> 8)
+
+WuhooInternal void
+WuhooBlendRowScalar(WuhooRGBA* dst, WuhooRGBA const* src,
+                    WuhooRGBA const* background, WuhooSize count)
+{
+  WuhooSize i = 0;
+
+  for (i = 0; i < count; i++) {
+    unsigned int a       = src[i].a;
+    unsigned int inverse = 255 - a;
+    WuhooRGBA    s       = src[i];
+    WuhooRGBA    b       = background[i];
+
+    dst[i].r = (WuhooByte)WuhooDivide255(s.r * a + b.r * inverse);
+    dst[i].g = (WuhooByte)WuhooDivide255(s.g * a + b.g * inverse);
+    dst[i].b = (WuhooByte)WuhooDivide255(s.b * a + b.b * inverse);
+    dst[i].a = (WuhooByte)WuhooDivide255(255 * a + b.a * inverse);
+  }
+}
+
+#undef WuhooDivide255
+
+#ifdef WUHOO_X86
+/* Two pixels widened to 16 bit lanes. The alpha lanes of src become 255
+ * before the multiply, the shuffles copy each alpha across its pixel */
+WuhooTarget("sse2") WuhooInternal __m128i
+WuhooBlendLanesSSE2(__m128i s, __m128i b)
+{
+  __m128i const full   = _mm_set1_epi16(255);
+  __m128i const opaque = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+  __m128i const alpha  = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xFF), 0xFF);
+  __m128i       sum    = _mm_add_epi16(
+    _mm_mullo_epi16(_mm_or_si128(s, opaque), alpha),
+    _mm_mullo_epi16(b, _mm_sub_epi16(full, alpha)));
+
+  sum = _mm_add_epi16(sum, _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(sum, _mm_srli_epi16(sum, 8)), 8);
+}
+
+WuhooTarget("sse2") WuhooInternal void
+WuhooBlendRowSSE2(WuhooRGBA* dst, WuhooRGBA const* src,
+                  WuhooRGBA const* background, WuhooSize count)
+{
+  __m128i const zero = _mm_setzero_si128();
+  WuhooSize     i    = 0;
+
+  for (i = 0; i + 4 <= count; i += 4) {
+    __m128i s = _mm_loadu_si128((__m128i const*)&src[i]);
+    __m128i b = _mm_loadu_si128((__m128i const*)&background[i]);
+    __m128i low =
+      WuhooBlendLanesSSE2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(b, zero));
+    __m128i high =
+      WuhooBlendLanesSSE2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(b, zero));
+    _mm_storeu_si128((__m128i*)&dst[i], _mm_packus_epi16(low, high));
+  }
 
-        int               x, y;
-        Window            child;
-        XWindowAttributes xwa;
-        XTranslateCoordinates(x11_window->display, x11_window->window,
-                              x11_window->root, 0, 0, &x, &y, &child);
-        XGetWindowAttributes(x11_window->display, x11_window->window, &xwa);
+  WuhooBlendRowScalar(dst + i, src + i, background + i, count - i);
+}
 
-        window->x = x - xwa.x;
-        window->y = y - xwa.y;
+/* Unpacks, shuffles and packs all stay within 128 bit lanes, so the pixels
+ * come back in the order they were loaded */
+WuhooTarget("avx2") WuhooInternal __m256i
+WuhooBlendLanesAVX2(__m256i s, __m256i b)
+{
+  __m256i const full   = _mm256_set1_epi16(255);
+  __m256i const opaque = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0,
+                                           255, 0, 0, 0, 255);
+  __m256i const alpha =
+    _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, 0xFF), 0xFF);
+  __m256i sum = _mm256_add_epi16(
+    _mm256_mullo_epi16(_mm256_or_si256(s, opaque), alpha),
+    _mm256_mullo_epi16(b, _mm256_sub_epi16(full, alpha)));
+
+  sum = _mm256_add_epi16(sum, _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_srli_epi16(sum, 8)),
+                           8);
+}
 
-        _WuhooWindowStateX11(window);
-        window->window_flags |= WUHOO_WINDOW_FLAG_MOVED;
-      }
+WuhooTarget("avx2") WuhooInternal void
+WuhooBlendRowAVX2(WuhooRGBA* dst, WuhooRGBA const* src,
+                  WuhooRGBA const* background, WuhooSize count)
+{
+  __m256i const zero = _mm256_setzero_si256();
+  WuhooSize     i    = 0;
+
+  for (i = 0; i + 8 <= count; i += 8) {
+    __m256i s    = _mm256_loadu_si256((__m256i const*)&src[i]);
+    __m256i b    = _mm256_loadu_si256((__m256i const*)&background[i]);
+    __m256i low  = WuhooBlendLanesAVX2(_mm256_unpacklo_epi8(s, zero),
+                                      _mm256_unpacklo_epi8(b, zero));
+    __m256i high = WuhooBlendLanesAVX2(_mm256_unpackhi_epi8(s, zero),
+                                       _mm256_unpackhi_epi8(b, zero));
+    _mm256_storeu_si256((__m256i*)&dst[i], _mm256_packus_epi16(low, high));
+  }
 
-      if (xce->width != window->cwidth || xce->height != window->cheight) {
+  WuhooBlendRowScalar(dst + i, src + i, background + i, count - i);
+}
+#endif
 
-        int               x, y;
-        Window            child;
-        XWindowAttributes xwa;
-        XTranslateCoordinates(x11_window->display, x11_window->window,
-                              x11_window->root, 0, 0, &x, &y, &child);
-        XGetWindowAttributes(x11_window->display, x11_window->window, &xwa);
+#ifdef WUHOO_NEON
+/* vraddhn adds 128 and the rounded x >> 8 to x and keeps the top byte, the
+ * same division as the scalar rows in two instructions */
+WuhooInternal uint8x16_t
+WuhooBlendChannelNEON(uint8x16_t channel, uint8x16_t alpha, uint8x16_t under)
+{
+  uint8x16_t const inverse = vmvnq_u8(alpha);
+  uint16x8_t       low     = vmlal_u8(
+    vmull_u8(vget_low_u8(channel), vget_low_u8(alpha)), vget_low_u8(under),
+    vget_low_u8(inverse));
+  uint16x8_t high = vmlal_u8(
+    vmull_u8(vget_high_u8(channel), vget_high_u8(alpha)),
+    vget_high_u8(under), vget_high_u8(inverse));
+
+  return vcombine_u8(vraddhn_u16(low, vrshrq_n_u16(low, 8)),
+                     vraddhn_u16(high, vrshrq_n_u16(high, 8)));
+}
 
-        window->cwidth  = xce->width;
-        window->cheight = xce->height;
+WuhooInternal void
+WuhooBlendRowNEON(WuhooRGBA* dst, WuhooRGBA const* src,
+                  WuhooRGBA const* background, WuhooSize count)
+{
+  WuhooSize i = 0;
 
-        window->width  = window->cwidth;
-        window->height = window->cheight + x11_window->title_extents;
+  for (i = 0; i + 16 <= count; i += 16) {
+    uint8x16x4_t s     = vld4q_u8((uint8_t const*)&src[i]);
+    uint8x16x4_t b     = vld4q_u8((uint8_t const*)&background[i]);
+    uint8x16_t   alpha = s.val[3];
+    uint8x16x4_t blended;
+
+    blended.val[0] = WuhooBlendChannelNEON(s.val[0], alpha, b.val[0]);
+    blended.val[1] = WuhooBlendChannelNEON(s.val[1], alpha, b.val[1]);
+    blended.val[2] = WuhooBlendChannelNEON(s.val[2], alpha, b.val[2]);
+    blended.val[3] = WuhooBlendChannelNEON(vdupq_n_u8(255), alpha, b.val[3]);
+    vst4q_u8((uint8_t*)&dst[i], blended);
+  }
 
-        _WuhooWindowStateX11(window);
-        window->window_flags |= WUHOO_WINDOW_FLAG_RESIZED;
-      }
-    } break;
-    case SelectionNotify: {
-      XSelectionEvent* sev = (XSelectionEvent*)&xevent.xselection;
-      if (sev->property == None)
-        break;
+  WuhooBlendRowScalar(dst + i, src + i, background + i, count - i);
+}
+#endif
 
-      WuhooPropertyX11 p;
-      _WuhooReadPropertyX11(&p, x11_window->display, x11_window->window,
-                            sev->property);
+/* Picked on every call, WuhooCpuFeatures answers from its cache */
+WuhooInternal WuhooBlendRow
+WuhooBlendSelect(void)
+{
+  unsigned int features = WuhooCpuFeatures();
 
-      char* at             = (char*)p.data;
-      int   count          = 0;
-      int   bytes_required = 0;
-      while (*at) {
-        if (*at == 10) {
-          at++;
-          continue;
-        }
-        count += (*at == 13) ? 1 : 0;
-        bytes_required += (*at != 13) ? 1 : 0;
-        at++;
-      }
+#ifdef WUHOO_X86
+  if (features & WUHOO_CPU_AVX2)
+    return WuhooBlendRowAVX2;
+  if (features & WUHOO_CPU_SSE2)
+    return WuhooBlendRowSSE2;
+#endif
+#ifdef WUHOO_NEON
+  if (features & WUHOO_CPU_NEON)
+    return WuhooBlendRowNEON;
+#endif
 
-      event->data.drop.context = (WuhooHandle)sev->property;
-      event->data.drop.size =
-        bytes_required + 1 - (sizeof("file://") - 1) * count + 1;
-      event->data.drop.count = count;
-      event->type            = WUHOO_EVT_DROP;
+  WuhooUnused(features);
 
-      XFree(p.data);
+  return WuhooBlendRowScalar;
+}
 
-    } break;
-    case ClientMessage: {
-      if (xevent.xclient.data.l[0] == x11_window->wmDeleteMessage) {
-        window->window_flags |= WUHOO_WINDOW_FLAG_CLOSED;
-        window->is_alive = WuhooFalse;
+WuhooResult
+WuhooBlendOver(WuhooRGBA* dst, WuhooSize dst_stride, WuhooRGBA const* src,
+               WuhooSize src_stride, WuhooRGBA const* background,
+               WuhooSize background_stride, WuhooSize width, WuhooSize height)
+{
+  WuhooBlendRow row = WuhooBlendSelect();
+  WuhooSize     y   = 0;
 
-        break;
-      } else if (xevent.xclient.message_type == x11_window->XA_XdndDrop) {
-        if (x11_window->XA_XdndReq == None) {
-          /* say again - not interested! */
-          XClientMessageEvent m;
-          /* reply with status */
-          WuhooZeroInit(&m, sizeof(XClientMessageEvent));
-          m.type         = ClientMessage;
-          m.display      = xevent.xclient.display;
-          m.window       = xevent.xclient.data.l[0];
-          m.message_type = x11_window->XA_XdndFinished;
-          m.format       = 32;
-          m.data.l[0]    = x11_window->window;
-          m.data.l[1]    = 0;
-          m.data.l[2]    = None; /* fail! */
-          XSendEvent(x11_window->display, xevent.xclient.data.l[0], False,
-                     NoEventMask, (XEvent*)&m);
-          XFlush(x11_window->display);
-        } else {
-          /* convert */
-          if (x11_window->XdndVersion >= 1) {
-            XConvertSelection(x11_window->display, x11_window->XA_XdndSelection,
-                              x11_window->XA_XdndReq, XA_PRIMARY,
-                              x11_window->window, xevent.xclient.data.l[2]);
-          } else {
-            XConvertSelection(x11_window->display, x11_window->XA_XdndSelection,
-                              x11_window->XA_XdndReq, XA_PRIMARY,
-                              x11_window->window, CurrentTime);
-          }
-        }
-      } else if (xevent.xclient.message_type == x11_window->XA_XdndPosition) {
+  if (WuhooNull == dst || WuhooNull == src || WuhooNull == background)
+    return (WuhooResult) "invalid buffer passed.";
 
-      } else if (xevent.xclient.message_type == x11_window->XA_XdndEnter) {
-        WuhooBoolean use_list = xevent.xclient.data.l[1] & 1;
-        if (use_list) {
-          WuhooPropertyX11 p;
-          _WuhooReadPropertyX11(&p, x11_window->display,
-                                xevent.xclient.data.l[0],
-                                x11_window->XA_XdndTypeList);
-          /* pick one */
-          x11_window->XA_XdndReq = _WuhooPickTextTargetX11(
-            x11_window->display, (Atom*)p.data, p.count);
-          XFree(p.data);
-        } else {
-          /* pick from list of three */
-          x11_window->XA_XdndReq = _WuhooPickTextTargetFromThreeX11(
-            x11_window->display, xevent.xclient.data.l[2],
-            xevent.xclient.data.l[3], xevent.xclient.data.l[4]);
-        }
+  for (y = 0; y < height; y++)
+    row(dst + y * dst_stride, src + y * src_stride,
+        background + y * background_stride, width);
 
-        XClientMessageEvent m;
-        /* reply with status */
-        WuhooZeroInit(&m, sizeof(XClientMessageEvent));
-        m.type         = ClientMessage;
-        m.display      = xevent.xclient.display;
-        m.window       = xevent.xclient.data.l[0];
-        m.message_type = x11_window->XA_XdndStatus;
-        m.format       = 32;
-        m.data.l[0]    = x11_window->window;
-        m.data.l[1]    = (x11_window->XA_XdndReq != None);
-        m.data.l[2]    = 0; /* specify an empty rectangle */
-        m.data.l[3]    = 0;
-        m.data.l[4] =
-          x11_window->XA_XdndActionCopy; /* we only accept copying anyway */
+  return WuhooSuccess;
+}
 
-        XSendEvent(x11_window->display, xevent.xclient.data.l[0], False,
-                   NoEventMask, (XEvent*)&m);
-        XFlush(x11_window->display);
-      }
-    } break;
-    case MotionNotify: {
-      event->type                  = WUHOO_EVT_MOUSE_MOVE;
-      event->data.mouse_move.x     = xevent.xmotion.x;
-      event->data.mouse_move.y     = xevent.xmotion.y;
-      event->data.mouse_move.state = WUHOO_MSTATE_UNKNOWN;
+/* One run of a single color per cell the pixels cross, starting column
+ * pixels into a cell of color1 if odd is set and color0 otherwise */
+WuhooInternal void
+WuhooBlendPatternFill(WuhooRGBA* pixels, WuhooSize count, WuhooSize column,
+                      WuhooSize odd, WuhooSize cell_size, WuhooRGBA color0,
+                      WuhooRGBA color1)
+{
+  WuhooSize k = 0;
 
-      if (xevent.xmotion.state & Button1MotionMask)
-        event->data.mouse_move.state = WUHOO_MSTATE_LPRESSED;
-      else if (xevent.xmotion.state & Button2MotionMask)
-        event->data.mouse_move.state = WUHOO_MSTATE_MPRESSED;
-      else if (xevent.xmotion.state & Button3MotionMask)
-        event->data.mouse_move.state = WUHOO_MSTATE_RPRESSED;
-      event->data.mouse_move.mods |=
-        (xevent.xmotion.state & ShiftMask) ? WUHOO_KMOD_SHIFT : 0;
-      event->data.mouse_move.mods |=
-        (xevent.xmotion.state & ControlMask) ? WUHOO_KMOD_CTRL : 0;
-      event->data.mouse_move.mods |=
-        (xevent.xmotion.state & LockMask) ? WUHOO_KMOD_CAPS : 0;
-    } break;
-    case ButtonPress: {
-      if (Button4 == xevent.xbutton.button ||
-          Button5 == xevent.xbutton.button) {
-        event->type = WUHOO_EVT_MOUSE_WHEEL;
-        event->data.mouse_wheel.mods |=
-          (xevent.xbutton.state & ShiftMask) ? WUHOO_KMOD_SHIFT : 0;
-        event->data.mouse_wheel.mods |=
-          (xevent.xbutton.state & ControlMask) ? WUHOO_KMOD_CTRL : 0;
-        event->data.mouse_wheel.mods |=
-          (xevent.xbutton.state & LockMask) ? WUHOO_KMOD_CAPS : 0;
-        event->data.mouse_wheel.x = xevent.xbutton.x;
-        event->data.mouse_wheel.y = xevent.xbutton.y;
-        event->data.mouse_wheel.delta_y =
-          (Button4 == xevent.xbutton.button) ? 1.0f : -1.0f;
+  for (k = 0; k < count; column = 0, odd ^= 1) {
+    WuhooRGBA color = odd ? color1 : color0;
+    WuhooSize end   = WuhooMini((int)(k + cell_size - column), (int)count);
+    while (k < end)
+      pixels[k++] = color;
+  }
+}
 
-        break;
-      }
+WuhooResult
+WuhooBlendOverPattern(WuhooRGBA* dst, WuhooSize dst_stride,
+                      WuhooRGBA const* src, WuhooSize src_stride,
+                      WuhooSize width, WuhooSize height, WuhooRGBA color0,
+                      WuhooRGBA color1, WuhooSize cell_size)
+{
+  WuhooBlendRow row = WuhooBlendSelect();
+  WuhooRGBA     chunks[2][WUHOO_SCALE_CHUNK_SIZE];
+  WuhooSize     period = 0;
+  WuhooSize     x = 0, y = 0;
+
+  if (WuhooNull == dst || WuhooNull == src)
+    return (WuhooResult) "invalid buffer passed.";
+
+  /* A solid color is a checkerboard of one cell */
+  if (0 == cell_size)
+    cell_size = width + 1;
+
+  /* Chunks as long as a whole number of cell pairs all look alike, only the
+   * one for even and the one for odd rows of cells are drawn */
+  if (2 * cell_size <= WUHOO_SCALE_CHUNK_SIZE) {
+    period = WUHOO_SCALE_CHUNK_SIZE - WUHOO_SCALE_CHUNK_SIZE % (2 * cell_size);
+    WuhooBlendPatternFill(chunks[0], period, 0, 0, cell_size, color0, color1);
+    WuhooBlendPatternFill(chunks[1], period, 0, 1, cell_size, color0, color1);
+  }
 
-      event->type                         = WUHOO_EVT_MOUSE_PRESS;
-      event->data.mouse_press.click_count = 1;
-      event->data.mouse_press.mods |=
-        (xevent.xbutton.state & ShiftMask) ? WUHOO_KMOD_SHIFT : 0;
-      event->data.mouse_press.mods |=
-        (xevent.xbutton.state & ControlMask) ? WUHOO_KMOD_CTRL : 0;
-      event->data.mouse_press.mods |=
-        (xevent.xbutton.state & LockMask) ? WUHOO_KMOD_CAPS : 0;
-      if (Button1 == xevent.xbutton.button)
-        event->data.mouse_press.state = WUHOO_MSTATE_LPRESSED;
-      else if (Button2 == xevent.xbutton.button)
-        event->data.mouse_press.state = WUHOO_MSTATE_MPRESSED;
-      else if (Button3 == xevent.xbutton.button)
-        event->data.mouse_press.state = WUHOO_MSTATE_RPRESSED;
+  for (y = 0; y < height; y++) {
+    WuhooSize odd = (y / cell_size) & 1;
 
-    } break;
-    case ButtonRelease: {
-      if (Button4 == xevent.xbutton.button || Button5 == xevent.xbutton.button)
-        break;
+    for (x = 0; x < width && 0 != period; x += period) {
+      row(dst + x + y * dst_stride, src + x + y * src_stride, chunks[odd],
+          WuhooMini((int)(width - x), (int)period));
+    }
 
-      event->type                         = WUHOO_EVT_MOUSE_PRESS;
-      event->data.mouse_press.click_count = 1;
-      if (Button1 == xevent.xbutton.button)
-        event->data.mouse_press.state = WUHOO_MSTATE_LRELEASED;
-      else if (Button2 == xevent.xbutton.button)
-        event->data.mouse_press.state = WUHOO_MSTATE_RRELEASED;
-      else if (Button3 == xevent.xbutton.button)
-        event->data.mouse_press.state = WUHOO_MSTATE_MRELEASED;
-      event->data.mouse_press.mods |=
-        (xevent.xbutton.state & ShiftMask) ? WUHOO_KMOD_SHIFT : 0;
-      event->data.mouse_press.mods |=
-        (xevent.xbutton.state & ControlMask) ? WUHOO_KMOD_CTRL : 0;
-      event->data.mouse_press.mods |=
-        (xevent.xbutton.state & LockMask) ? WUHOO_KMOD_CAPS : 0;
-    } break;
-    case KeyRelease: {
-      KeySym ksym;
-      Status status;
-      char   buff[16];
+    for (x = 0; x < width && 0 == period; x += WUHOO_SCALE_CHUNK_SIZE) {
+      WuhooSize count = WuhooMini((int)(width - x), WUHOO_SCALE_CHUNK_SIZE);
+      WuhooBlendPatternFill(chunks[0], count, x % cell_size,
+                            ((x / cell_size) & 1) ^ odd, cell_size, color0,
+                            color1);
+      row(dst + x + y * dst_stride, src + x + y * src_stride, chunks[0], count);
+    }
+  }
 
-      /* Override this in order for Xutf8LookupString to work */
-      xevent.xkey.type = KeyPress;
-      size_t c = Xutf8LookupString(x11_window->ic, &xevent.xkey, buff, 16 - 1,
-                                   &ksym, &status);
+  return WuhooSuccess;
+}
 
-      buff[c] = 0;
+/* Float blits. Exposure and tonemapping are done on every channel, then the
+ * square root of the result indexes a table of encoded values. sRGB and
+ * gamma curves grow like a root near black, which this spreads over the
+ * table evenly enough that 4096 entries are within a step of exact */
+#define WUHOO_FLOAT_TABLE_SIZE 4096
 
-      event->type = WUHOO_EVT_KEY;
-      WuhooStringCopy((char*)event->data.key.character, buff, c);
-      event->data.key.state = WUHOO_KSTATE_UP;
-      event->data.key.code  = _WuhooKeyTranslateX11(ksym);
-      event->data.key.mods |=
-        (xevent.xkey.state & ShiftMask) ? WUHOO_KMOD_SHIFT : 0;
-      event->data.key.mods |=
-        (xevent.xkey.state & ControlMask) ? WUHOO_KMOD_CTRL : 0;
-      event->data.key.mods |=
-        (xevent.xkey.state & LockMask) ? WUHOO_KMOD_CAPS : 0;
+/* The context of the stage WuhooWindowBlitFloat hands to the backends */
+typedef struct
+{
+  float const* pixels;
+  WuhooSize    channels;
+  float        exposure;
+  WuhooTonemap tonemap;
+  WuhooByte    encoded[WUHOO_FLOAT_TABLE_SIZE];
+} WuhooFloatSource;
 
-      break;
-    }
-    case KeyPress: {
-      KeySym ksym;
-      Status status;
-      char   buff[16];
+typedef void (*WuhooFloatRow)(unsigned short* index, float const* src,
+                              WuhooSize count, float exposure,
+                              WuhooTonemap tonemap);
 
-      size_t c = Xutf8LookupString(x11_window->ic, &xevent.xkey, buff, 16 - 1,
-                                   &ksym, &status);
+WuhooInternal void
+WuhooFloatRowScalar(unsigned short* index, float const* src, WuhooSize count,
+                    float exposure, WuhooTonemap tonemap)
+{
+  WuhooSize i = 0;
 
-      buff[c] = 0;
+  for (i = 0; i < count; i++) {
+    float v = src[i] * exposure;
 
-      event->type = WUHOO_EVT_KEY;
-      WuhooStringCopy((char*)event->data.key.character, buff, c);
-      event->data.key.state = WUHOO_KSTATE_DOWN;
-      event->data.key.code  = _WuhooKeyTranslateX11(ksym);
-      event->data.key.mods |=
-        (xevent.xkey.state & ShiftMask) ? WUHOO_KMOD_SHIFT : 0;
-      event->data.key.mods |=
-        (xevent.xkey.state & ControlMask) ? WUHOO_KMOD_CTRL : 0;
-      event->data.key.mods |=
-        (xevent.xkey.state & LockMask) ? WUHOO_KMOD_CAPS : 0;
+    /* NaNs fail the comparison and become black */
+    v = (v > 0.0f) ? v : 0.0f;
+    if (WUHOO_TONEMAP_REINHARD == tonemap)
+      v = v / (1.0f + v);
+    else if (WUHOO_TONEMAP_ACES == tonemap)
+      v = (v * (2.51f * v + 0.03f)) / (v * (2.43f * v + 0.59f) + 0.14f);
+    v = (v < 1.0f) ? v : 1.0f;
+
+    index[i] =
+      (unsigned short)(sqrtf(v) * (WUHOO_FLOAT_TABLE_SIZE - 1) + 0.5f);
+  }
+}
 
-      break;
-    }
-    default:
-      // XFlush(x11_window->display);
-      break;
+#ifdef WUHOO_X86
+WuhooTarget("sse2") WuhooInternal __m128i
+WuhooFloatIndexSSE2(__m128 v, WuhooTonemap tonemap)
+{
+  __m128 const one = _mm_set1_ps(1.0f);
+
+  /* maxps returns its second operand for NaNs */
+  v = _mm_max_ps(v, _mm_setzero_ps());
+  if (WUHOO_TONEMAP_REINHARD == tonemap) {
+    v = _mm_div_ps(v, _mm_add_ps(one, v));
+  } else if (WUHOO_TONEMAP_ACES == tonemap) {
+    v = _mm_div_ps(
+      _mm_mul_ps(v, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.51f), v),
+                               _mm_set1_ps(0.03f))),
+      _mm_add_ps(_mm_mul_ps(v, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.43f), v),
+                                          _mm_set1_ps(0.59f))),
+                 _mm_set1_ps(0.14f)));
   }
+  v = _mm_min_ps(v, one);
 
-  if (window->window_flags & WUHOO_WINDOW_FLAG_CLOSED) {
-    event->type              = WUHOO_EVT_WINDOW;
-    event->data.window.state = WUHOO_WSTATE_CLOSED;
+  return _mm_cvtps_epi32(_mm_mul_ps(
+    _mm_sqrt_ps(v), _mm_set1_ps((float)(WUHOO_FLOAT_TABLE_SIZE - 1))));
+}
 
-    return WuhooSuccess;
-  } else if (window->window_flags & WUHOO_WINDOW_FLAG_RESIZED) {
-    event->type              = WUHOO_EVT_WINDOW;
-    event->data.window.state = WUHOO_WSTATE_RESIZED;
-    event->data.window.data1 = window->cwidth;
-    event->data.window.data2 = window->cheight;
-    event->data.window.flags = WUHOO_WINDOW_FLAG_RESIZED;
-    event->data.window.flags |= (window->window_flags & WUHOO_WINDOW_FLAG_MAXIMIZED) ? WUHOO_WINDOW_FLAG_MAXIMIZED : 0;
-    event->data.window.flags |= (window->window_flags & WUHOO_WINDOW_FLAG_FULL_SCREEN) ? WUHOO_WINDOW_FLAG_FULL_SCREEN : 0;
-    event->data.window.flags |= (window->window_flags & WUHOO_WINDOW_FLAG_MINIMIZED) ? WUHOO_WINDOW_FLAG_MINIMIZED : 0;
+WuhooTarget("sse2") WuhooInternal void
+WuhooFloatRowSSE2(unsigned short* index, float const* src, WuhooSize count,
+                  float exposure, WuhooTonemap tonemap)
+{
+  __m128 const scale = _mm_set1_ps(exposure);
+  WuhooSize    i     = 0;
+
+  for (i = 0; i + 8 <= count; i += 8) {
+    __m128i low  = WuhooFloatIndexSSE2(
+      _mm_mul_ps(_mm_loadu_ps(&src[i]), scale), tonemap);
+    __m128i high = WuhooFloatIndexSSE2(
+      _mm_mul_ps(_mm_loadu_ps(&src[i + 4]), scale), tonemap);
+    /* Indices fit in 12 bits, the signed pack leaves them alone */
+    _mm_storeu_si128((__m128i*)&index[i], _mm_packs_epi32(low, high));
+  }
 
-    window->window_flags &= ~WUHOO_WINDOW_FLAG_RESIZED;
-    window->window_flags &= ~WUHOO_WINDOW_FLAG_MAXIMIZED;
-    window->window_flags &= ~WUHOO_WINDOW_FLAG_MINIMIZED;
-    window->window_flags &= ~WUHOO_WINDOW_FLAG_FULL_SCREEN;
+  WuhooFloatRowScalar(index + i, src + i, count - i, exposure, tonemap);
+}
+#endif
 
-    return WuhooSuccess;
-  } else if (window->window_flags & WUHOO_WINDOW_FLAG_MOVED) {
-    event->type              = WUHOO_EVT_WINDOW;
-    event->data.window.state = WUHOO_WSTATE_MOVED;
-    event->data.window.data1 = window->x;
-    event->data.window.data2 = window->y;
-    window->window_flags &= ~WUHOO_WINDOW_FLAG_MOVED;
+/* Division and square roots of vectors are AArch64 only */
+#if defined(WUHOO_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+#define WUHOO_FLOAT_NEON
 
-    return WuhooSuccess;
-  } else if (window->window_flags & WUHOO_WINDOW_FLAG_FOCUS_LOST) {
-    event->type              = WUHOO_EVT_WINDOW;
-    event->data.window.state = WUHOO_WSTATE_UNFOCUSED;
-    event->data.window.data1 = window->cwidth;
-    event->data.window.data2 = window->cheight;
-    window->window_flags &= ~WUHOO_WINDOW_FLAG_FOCUS_LOST;
+WuhooInternal uint32x4_t
+WuhooFloatIndexNEON(float32x4_t v, WuhooTonemap tonemap)
+{
+  float32x4_t const zero = vdupq_n_f32(0.0f);
+  float32x4_t const one  = vdupq_n_f32(1.0f);
+
+  /* NaNs fail the comparison and become black */
+  v = vbslq_f32(vcgtq_f32(v, zero), v, zero);
+  if (WUHOO_TONEMAP_REINHARD == tonemap) {
+    v = vdivq_f32(v, vaddq_f32(one, v));
+  } else if (WUHOO_TONEMAP_ACES == tonemap) {
+    v = vdivq_f32(
+      vmulq_f32(v, vmlaq_n_f32(vdupq_n_f32(0.03f), v, 2.51f)),
+      vmlaq_f32(vdupq_n_f32(0.14f), v,
+                vmlaq_n_f32(vdupq_n_f32(0.59f), v, 2.43f)));
+  }
+  v = vminq_f32(v, one);
 
-    return WuhooSuccess;
-  } else if (window->window_flags & WUHOO_WINDOW_FLAG_FOCUS_GAINED) {
-    event->type              = WUHOO_EVT_WINDOW;
-    event->data.window.state = WUHOO_WSTATE_FOCUSED;
-    event->data.window.data1 = window->cwidth;
-    event->data.window.data2 = window->cheight;
-    window->window_flags &= ~WUHOO_WINDOW_FLAG_FOCUS_GAINED;
+  return vcvtnq_u32_f32(
+    vmulq_n_f32(vsqrtq_f32(v), (float)(WUHOO_FLOAT_TABLE_SIZE - 1)));
+}
 
-    return WuhooSuccess;
-  } else if (window->window_flags & WUHOO_WINDOW_FLAG_REGION_UPDATED) {
-    event->type              = WUHOO_EVT_WINDOW;
-    event->data.window.state = WUHOO_WSTATE_INVALIDATED;
-    event->data.window.data1 = window->cwidth;
-    event->data.window.data2 = window->cheight;
-    window->window_flags &= ~WUHOO_WINDOW_FLAG_REGION_UPDATED;
+WuhooInternal void
+WuhooFloatRowNEON(unsigned short* index, float const* src, WuhooSize count,
+                  float exposure, WuhooTonemap tonemap)
+{
+  WuhooSize i = 0;
 
-    return WuhooSuccess;
+  for (i = 0; i + 8 <= count; i += 8) {
+    uint32x4_t low =
+      WuhooFloatIndexNEON(vmulq_n_f32(vld1q_f32(&src[i]), exposure), tonemap);
+    uint32x4_t high = WuhooFloatIndexNEON(
+      vmulq_n_f32(vld1q_f32(&src[i + 4]), exposure), tonemap);
+    vst1q_u16(&index[i], vcombine_u16(vmovn_u32(low), vmovn_u32(high)));
   }
 
-  return WuhooSuccess;
+  WuhooFloatRowScalar(index + i, src + i, count - i, exposure, tonemap);
 }
+#endif
 
-#endif /* WUHOO_X11_ENABLE */
-
-WuhooResult
-WuhooWindowInit(WuhooWindow* window)
+WuhooInternal WuhooFloatRow
+WuhooFloatSelect(void)
 {
-  WuhooZeroInit(window, sizeof(*window));
+  unsigned int features = WuhooCpuFeatures();
 
-#ifdef WUHOO_OPENGL_ENABLE
-  window->gl_framebuffer.version.major  = 4;
-  window->gl_framebuffer.version.minor  = 0;
-  window->gl_framebuffer.redBits        = 3;
-  window->gl_framebuffer.greenBits      = 3;
-  window->gl_framebuffer.blueBits       = 2;
-  window->gl_framebuffer.alphaBits      = 0;
-  window->gl_framebuffer.depthBits      = 16;
-  window->gl_framebuffer.stencilBits    = 0;
-  window->gl_framebuffer.accumRedBits   = 0;
-  window->gl_framebuffer.accumGreenBits = 0;
-  window->gl_framebuffer.accumBlueBits  = 0;
-  window->gl_framebuffer.accumAlphaBits = 0;
-  window->gl_framebuffer.auxBuffers     = 0;
-  window->gl_framebuffer.stereo         = WuhooFalse;
-  window->gl_framebuffer.samples        = 0;
-  window->gl_framebuffer.sRGB           = WuhooFalse;
-  window->gl_framebuffer.doublebuffer   = WuhooTrue;
-  window->gl_framebuffer.transparent    = WuhooFalse;
+#ifdef WUHOO_X86
+  if (features & WUHOO_CPU_SSE2)
+    return WuhooFloatRowSSE2;
+#endif
+#ifdef WUHOO_FLOAT_NEON
+  if (features & WUHOO_CPU_NEON)
+    return WuhooFloatRowNEON;
 #endif
 
+  WuhooUnused(features);
+
+  return WuhooFloatRowScalar;
+}
+
+/* The source of WuhooWindowBlitFloat, the coordinates are in the pixels of
+ * the WuhooFloatSource context. Chunks of them are encoded to RGBA and handed
+ * to the stage's kernel while in cache */
+WuhooInternal WuhooResult
+WuhooConvertFloat(WuhooConvertStage const* stage, void* dst,
+                  WuhooSize dst_pitch, WuhooSize src_x, WuhooSize src_y,
+                  WuhooSize src_pitch, WuhooSize width, WuhooSize height)
+{
+  WuhooFloatSource const* source   = (WuhooFloatSource const*)stage->context;
+  WuhooFloatRow           row      = WuhooFloatSelect();
+  WuhooSize               channels = source->channels;
+  WuhooSize               bytes    = stage->format->bits_per_pixel / 8;
+  WuhooRGBA               chunk[WUHOO_SCALE_CHUNK_SIZE];
+  unsigned short          index[4 * WUHOO_SCALE_CHUNK_SIZE];
+  WuhooSize               i = 0, j = 0, k = 0, count = 0;
+
+  for (j = 0; j < height; j++) {
+    float const* src_row =
+      source->pixels + (src_x + (src_y + j) * src_pitch) * channels;
+    WuhooByte* dst_row = (WuhooByte*)dst + j * dst_pitch;
+
+    for (i = 0; i < width; i += count) {
+      float const* pixels = src_row + i * channels;
+      count = WuhooMini((int)(width - i), WUHOO_SCALE_CHUNK_SIZE);
+
+      row(index, pixels, count * channels, source->exposure, source->tonemap);
+      for (k = 0; k < count; k++) {
+        unsigned short const* at = &index[k * channels];
+        chunk[k].r               = source->encoded[at[0]];
+        chunk[k].g               = source->encoded[at[1]];
+        chunk[k].b               = source->encoded[at[2]];
+        chunk[k].a               = 255;
+      }
+
+      /* Alpha is coverage, it is neither exposed nor encoded */
+      for (k = 0; k < count && 4 == channels; k++) {
+        float a    = pixels[k * 4 + 3];
+        a          = (a > 0.0f) ? ((a < 1.0f) ? a : 1.0f) : 0.0f;
+        chunk[k].a = (WuhooByte)(a * 255.0f + 0.5f);
+      }
+
+      /* As when scaling, the row index only tells a dithering kernel
+       * where it is */
+      WuhooConvertStageRGBA(stage, dst_row + i * bytes, dst_pitch, chunk, 0,
+                            src_y + j, 0, count, 1);
+    }
+  }
+
   return WuhooSuccess;
 }
 
 WuhooResult
-WuhooWindowDestroy(WuhooWindow* window)
+WuhooWindowBlitFloat(WuhooWindow* window, float const* pixels,
+                     WuhooFloatFormat const* format, WuhooSize src_x,
+                     WuhooSize src_y, WuhooSize src_width,
+                     WuhooSize src_height, WuhooSize dst_x, WuhooSize dst_y,
+                     WuhooSize dst_width, WuhooSize dst_height)
 {
-  WuhooResult result = WuhooSuccess;
+  WuhooConvertStage stage = WuhooConvertStageWindow(window);
+  WuhooFloatSource  source;
+  WuhooSize         k = 0;
 
-#ifdef _WIN32
-  result = _WuhooWindowDestroyWin32(window);
-#endif
+  if (WuhooNull == pixels) {
+    return (WuhooResult) "invalid buffer passed.";
+  }
+
+  if (WuhooNull == format || (3 != format->channels && 4 != format->channels) ||
+      format->tonemap >= WUHOO_TONEMAP_MAX || !(format->exposure >= 0.0f) ||
+      !(format->gamma >= 0.0f)) {
+    return (WuhooResult) "invalid float format passed.";
+  }
 
 #ifdef __APPLE__
-  result = _WuhooWindowDestroyCocoa(window);
+  return (WuhooResult)WUHOO_PLATFORM_API_STRING
+    " : Float blits are not supported";
 #endif
 
-#ifdef WUHOO_X11_ENABLE
-  result = _WuhooWindowDestroyX11(window);
-#endif
+  if (0 == window->convert_format.bits_per_pixel) {
+    return (WuhooResult) "unsupported pixel format.";
+  }
 
-  return result;
+  if (src_x >= src_width || src_y >= src_height) {
+    return WuhooSuccess;
+  }
+
+  source.pixels   = pixels;
+  source.channels = format->channels;
+  source.exposure = format->exposure;
+  source.tonemap  = format->tonemap;
+
+  for (k = 0; k < WUHOO_FLOAT_TABLE_SIZE; k++) {
+    float s = (float)k / (WUHOO_FLOAT_TABLE_SIZE - 1);
+    float v = s * s;
+    float e = 0.0f;
+
+    if (format->gamma > 0.0f)
+      e = powf(v, 1.0f / format->gamma);
+    else if (v <= 0.0031308f)
+      e = 12.92f * v;
+    else
+      e = 1.055f * powf(v, 1.0f / 2.4f) - 0.055f;
+
+    source.encoded[k] = (WuhooByte)(e * 255.0f + 0.5f);
+  }
+
+  /* Float pixels are presented one to one like native ones */
+  WuhooSize region_width  = WuhooMini(src_width - src_x, dst_width);
+  WuhooSize region_height = WuhooMini(src_height - src_y, dst_height);
+
+  /* Encoding is the source of the conversion stage, the backends run it in
+   * place of converting pixels */
+  stage.source  = WuhooConvertFloat;
+  stage.context = &source;
+
+  return WuhooBlitStage(window, &stage, WuhooNull, src_x, src_y, src_width,
+                        region_width, region_height, dst_x, dst_y,
+                        region_width, region_height, WuhooFalse);
 }
-WuhooResult
-WuhooWindowCreate(WuhooWindow* window, int posx, int posy, WuhooSize width,
-                  WuhooSize height, const char* title, WuhooFlags flags,
-                  const void* data)
+
+/* YUV blits. Luma and chroma are turned into RGB with 13 bit fixed point
+ * coefficients, which are exact in 32 bits on every path so the vectors
+ * match the scalar row bit for bit. Chroma is shared by 2x2 pixels */
+typedef struct
 {
-  WuhooResult result = WuhooSuccess;
+  short y_offset;
+  short y;   /* Luma scale */
+  short v_r; /* Chroma terms of each channel, g subtracts its own */
+  short u_g;
+  short v_g;
+  short u_b;
+} WuhooYUVCoefficients;
+
+/* [matrix][full_range] */
+static WuhooYUVCoefficients const
+  wuhoo_yuv_coefficients[WUHOO_YUV_MATRIX_MAX][2] = {
+    { { 16, 9539, 13075, 3209, 6660, 16525 },
+      { 0, 8192, 11485, 2819, 5850, 14516 } },
+    { { 16, 9539, 14686, 1747, 4366, 17305 },
+      { 0, 8192, 12901, 1535, 3835, 15201 } }
+  };
 
-  window->width  = width;
-  window->height = height;
-  window->flags  = flags;
-  window->x      = posx;
-  window->y      = posy;
+/* Converts count pixels of a row starting at x, the chroma of pixel x is
+ * u_row[(x / 2) * uv_step] and v_row[(x / 2) * uv_step] */
+typedef void (*WuhooYUVRow)(WuhooRGBA* dst, WuhooByte const* y_row,
+                            WuhooByte const* u_row, WuhooByte const* v_row,
+                            WuhooSize uv_step, WuhooSize x, WuhooSize count,
+                            WuhooYUVCoefficients const* k);
 
-#ifdef _WIN32
-  result =
-    _WuhooWindowCreateWin32(window, posx, posy, width, height, title, flags);
-#endif
+WuhooInternal WuhooByte
+WuhooYUVClamp(int value)
+{
+  value = (value + 4096) >> 13;
+  return (WuhooByte)((value < 0) ? 0 : ((value > 255) ? 255 : value));
+}
 
-#ifdef __APPLE__
-  result =
-    _WuhooWindowCreateCocoa(window, posx, posy, width, height, title, flags);
-#endif
+WuhooInternal void
+WuhooYUVRowScalar(WuhooRGBA* dst, WuhooByte const* y_row,
+                  WuhooByte const* u_row, WuhooByte const* v_row,
+                  WuhooSize uv_step, WuhooSize x, WuhooSize count,
+                  WuhooYUVCoefficients const* k)
+{
+  WuhooSize i = 0;
 
-#ifdef WUHOO_X11_ENABLE
-  result =
-    _WuhooWindowCreateX11(window, posx, posy, width, height, title, flags);
-#endif
+  for (i = 0; i < count; i++) {
+    WuhooSize c    = ((x + i) >> 1) * uv_step;
+    int       luma = (y_row[x + i] - k->y_offset) * k->y;
+    int       u    = u_row[c] - 128;
+    int       v    = v_row[c] - 128;
 
-  window->is_initialized = (WuhooSuccess == result);
-  window->is_alive       = (WuhooSuccess == result);
+    dst[i].r = WuhooYUVClamp(luma + k->v_r * v);
+    dst[i].g = WuhooYUVClamp(luma - k->u_g * u - k->v_g * v);
+    dst[i].b = WuhooYUVClamp(luma + k->u_b * u);
+    dst[i].a = 255;
+  }
+}
 
-  return result;
+#ifdef WUHOO_X86
+/* Sums of the products of (a, b) pairs with (ka, kb), rounded and packed
+ * to 8 bits */
+WuhooTarget("sse2") WuhooInternal __m128i
+WuhooYUVChannelSSE2(__m128i a, __m128i b, __m128i c, __m128i d, int ka,
+                    int kb, int kc, int kd)
+{
+  __m128i const round = _mm_set1_epi32(4096);
+  __m128i const kab   = _mm_set1_epi32(
+    (int)(((unsigned int)kb << 16) | ((unsigned int)ka & 0xFFFF)));
+  __m128i const kcd   = _mm_set1_epi32(
+    (int)(((unsigned int)kd << 16) | ((unsigned int)kc & 0xFFFF)));
+
+  __m128i low  = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a, b), kab),
+                               _mm_madd_epi16(_mm_unpacklo_epi16(c, d), kcd));
+  __m128i high = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a, b), kab),
+                               _mm_madd_epi16(_mm_unpackhi_epi16(c, d), kcd));
+  low          = _mm_srai_epi32(_mm_add_epi32(low, round), 13);
+  high         = _mm_srai_epi32(_mm_add_epi32(high, round), 13);
+
+  __m128i value = _mm_packs_epi32(low, high);
+  return _mm_packus_epi16(value, value);
 }
-WuhooResult
-WuhooWindowEventNext(WuhooWindow* window, WuhooEvent* event)
+
+WuhooTarget("sse2") WuhooInternal void
+WuhooYUVRowSSE2(WuhooRGBA* dst, WuhooByte const* y_row,
+                WuhooByte const* u_row, WuhooByte const* v_row,
+                WuhooSize uv_step, WuhooSize x, WuhooSize count,
+                WuhooYUVCoefficients const* k)
 {
-  WuhooZeroInit(event, sizeof(*event));
+  __m128i const zero   = _mm_setzero_si128();
+  __m128i const offset = _mm_set1_epi16(k->y_offset);
+  __m128i const bias   = _mm_set1_epi16(128);
+  __m128i const opaque = _mm_set1_epi8(-1);
+  __m128i const low    = _mm_set1_epi16(0xFF);
+  WuhooSize     i      = 0;
+
+  /* Vectors start at even pixels, where a chroma sample does */
+  if (x & 1) {
+    WuhooYUVRowScalar(dst, y_row, u_row, v_row, uv_step, x, 1, k);
+    i = 1;
+  }
 
-#ifdef _WIN32
-  return _WuhooWindowEventNextWin32(window, event);
-#endif
-#ifdef __APPLE__
-  return _WuhooWindowEventNextCocoa(window, event);
-#endif
-#ifdef WUHOO_X11_ENABLE
-  return _WuhooWindowEventNextX11(window, event);
+  for (; i + 8 <= count; i += 8) {
+    WuhooSize        at     = x + i;
+    WuhooByte const* chroma = u_row + (at >> 1) * uv_step;
+    __m128i          u, v;
+
+    __m128i luma = _mm_sub_epi16(
+      _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i const*)&y_row[at]), zero),
+      offset);
+
+    if (1 == uv_step) {
+      WuhooByte const* v_at = v_row + (at >> 1);
+      u = _mm_unpacklo_epi8(
+        _mm_cvtsi32_si128((int)(chroma[0] | (chroma[1] << 8) |
+                                (chroma[2] << 16) |
+                                ((unsigned int)chroma[3] << 24))),
+        zero);
+      v = _mm_unpacklo_epi8(
+        _mm_cvtsi32_si128((int)(v_at[0] | (v_at[1] << 8) | (v_at[2] << 16) |
+                                ((unsigned int)v_at[3] << 24))),
+        zero);
+    } else {
+      /* Interleaved pairs read as 16 bit lanes are U | V << 8 */
+      __m128i pairs = _mm_loadl_epi64((__m128i const*)chroma);
+      u             = _mm_and_si128(pairs, low);
+      v             = _mm_srli_epi16(pairs, 8);
+    }
+
+    /* Every chroma sample covers two pixels */
+    u = _mm_sub_epi16(_mm_unpacklo_epi16(u, u), bias);
+    v = _mm_sub_epi16(_mm_unpacklo_epi16(v, v), bias);
+
+    __m128i r = WuhooYUVChannelSSE2(luma, v, zero, zero, k->y, k->v_r, 0, 0);
+    __m128i g =
+      WuhooYUVChannelSSE2(luma, u, v, zero, k->y, -k->u_g, -k->v_g, 0);
+    __m128i b = WuhooYUVChannelSSE2(luma, u, zero, zero, k->y, k->u_b, 0, 0);
+
+    __m128i rg = _mm_unpacklo_epi8(r, g);
+    __m128i ba = _mm_unpacklo_epi8(b, opaque);
+    _mm_storeu_si128((__m128i*)&dst[i], _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128((__m128i*)&dst[i + 4], _mm_unpackhi_epi16(rg, ba));
+  }
+
+  WuhooYUVRowScalar(dst + i, y_row, u_row, v_row, uv_step, x + i, count - i,
+                    k);
+}
 #endif
+
+#ifdef WUHOO_NEON
+WuhooInternal uint8x8_t
+WuhooYUVChannelNEON(int32x4_t low, int32x4_t high)
+{
+  /* Rounds, clamps negative values to 0 and large ones to 255 */
+  return vqmovn_u16(vcombine_u16(vqrshrun_n_s32(low, 13),
+                                 vqrshrun_n_s32(high, 13)));
 }
 
-WuhooResult
-WuhooWindowShow(WuhooWindow* window)
+WuhooInternal void
+WuhooYUVPixelsNEON(WuhooRGBA* dst, uint8x8_t y8, uint8x8_t u8, uint8x8_t v8,
+                   WuhooYUVCoefficients const* k)
 {
-#ifdef _WIN32
-  return _WuhooWindowShowWin32(window);
-#endif
-#ifdef __APPLE__
-  return _WuhooWindowShowCocoa(window);
-#endif
-#ifdef WUHOO_X11_ENABLE
-  return _WuhooWindowShowX11(window);
-#endif
+  int16x8_t luma =
+    vreinterpretq_s16_u16(vsubl_u8(y8, vdup_n_u8((uint8_t)k->y_offset)));
+  int16x8_t u = vreinterpretq_s16_u16(vsubl_u8(u8, vdup_n_u8(128)));
+  int16x8_t v = vreinterpretq_s16_u16(vsubl_u8(v8, vdup_n_u8(128)));
+
+  int32x4_t y_low  = vmull_n_s16(vget_low_s16(luma), k->y);
+  int32x4_t y_high = vmull_n_s16(vget_high_s16(luma), k->y);
+
+  uint8x8x4_t pixels;
+  pixels.val[0] =
+    WuhooYUVChannelNEON(vmlal_n_s16(y_low, vget_low_s16(v), k->v_r),
+                        vmlal_n_s16(y_high, vget_high_s16(v), k->v_r));
+  pixels.val[1] = WuhooYUVChannelNEON(
+    vmlsl_n_s16(vmlsl_n_s16(y_low, vget_low_s16(u), k->u_g),
+                vget_low_s16(v), k->v_g),
+    vmlsl_n_s16(vmlsl_n_s16(y_high, vget_high_s16(u), k->u_g),
+                vget_high_s16(v), k->v_g));
+  pixels.val[2] =
+    WuhooYUVChannelNEON(vmlal_n_s16(y_low, vget_low_s16(u), k->u_b),
+                        vmlal_n_s16(y_high, vget_high_s16(u), k->u_b));
+  pixels.val[3] = vdup_n_u8(255);
+
+  vst4_u8((uint8_t*)dst, pixels);
 }
-WuhooResult
-WuhooWindowRegionSet(WuhooWindow* window, int posx, int posy, WuhooSize width,
-                     WuhooSize height)
+
+WuhooInternal void
+WuhooYUVRowNEON(WuhooRGBA* dst, WuhooByte const* y_row,
+                WuhooByte const* u_row, WuhooByte const* v_row,
+                WuhooSize uv_step, WuhooSize x, WuhooSize count,
+                WuhooYUVCoefficients const* k)
 {
+  WuhooSize i = 0;
 
-  if (!(WUHOO_FLAG_RESIZEABLE & window->flags)) {
-    return (WuhooResult)WUHOO_PLATFORM_API_STRING
-      " : WUHOO_FLAG_RESIZEABLE is not set for this window";
+  /* Vectors start at even pixels, where a chroma sample does */
+  if (x & 1) {
+    WuhooYUVRowScalar(dst, y_row, u_row, v_row, uv_step, x, 1, k);
+    i = 1;
   }
 
-  /* Stick to lower left origin for everyone */
-#ifdef __APPLE__
-  return _WuhooWindowRegionSetCocoa(window, posx, posy, width, height);
-#endif
+  /* 16 pixels share 8 chroma samples */
+  for (; i + 16 <= count; i += 16) {
+    WuhooSize  at   = x + i;
+    uint8x16_t luma = vld1q_u8(&y_row[at]);
+    uint8x8x2_t u, v;
+
+    if (1 == uv_step) {
+      uint8x8_t u8 = vld1_u8(&u_row[at >> 1]);
+      uint8x8_t v8 = vld1_u8(&v_row[at >> 1]);
+      u            = vzip_u8(u8, u8);
+      v            = vzip_u8(v8, v8);
+    } else {
+      uint8x8x2_t pairs = vld2_u8(&u_row[at]);
+      u                 = vzip_u8(pairs.val[0], pairs.val[0]);
+      v                 = vzip_u8(pairs.val[1], pairs.val[1]);
+    }
 
-#ifdef _WIN32
-  return _WuhooWindowRegionSetWin32(window, posx, posy, width, height);
+    WuhooYUVPixelsNEON(dst + i, vget_low_u8(luma), u.val[0], v.val[0], k);
+    WuhooYUVPixelsNEON(dst + i + 8, vget_high_u8(luma), u.val[1], v.val[1],
+                       k);
+  }
+
+  WuhooYUVRowScalar(dst + i, y_row, u_row, v_row, uv_step, x + i, count - i,
+                    k);
+}
 #endif
 
-#ifdef WUHOO_X11_ENABLE
-  return _WuhooWindowRegionSetX11(window, posx, posy, width, height);
+WuhooInternal WuhooYUVRow
+WuhooYUVSelect(void)
+{
+  unsigned int features = WuhooCpuFeatures();
+
+#ifdef WUHOO_X86
+  if (features & WUHOO_CPU_SSE2)
+    return WuhooYUVRowSSE2;
+#endif
+#ifdef WUHOO_NEON
+  if (features & WUHOO_CPU_NEON)
+    return WuhooYUVRowNEON;
 #endif
+
+  WuhooUnused(features);
+
+  return WuhooYUVRowScalar;
 }
-WuhooResult
-WuhooWindowRegionGet(WuhooWindow* window, int* posx, int* posy,
-                     WuhooSize* width, WuhooSize* height)
+
+/* Source pixels converted at once for resampling, shrinking a frame by more
+ * than this over the chunk size converts fewer destination pixels at a time
+ */
+#define WUHOO_YUV_LINE_SIZE (4 * WUHOO_SCALE_CHUNK_SIZE)
+
+/* The context of the stage WuhooWindowBlitYUV hands to the backends */
+typedef struct
 {
-#ifdef __APPLE__
-  return _WuhooWindowRegionGetCocoa(window, posx, posy, width, height);
-#endif
+  WuhooYUVFrame const*        frame;
+  WuhooYUVCoefficients const* coefficients;
+  WuhooBlitFilter             filter;
+  WuhooBoolean                scaled;
+  WuhooFixed                  step_x, step_y; /* Like WuhooConvertScaledRows */
+  WuhooFixed                  max_x, max_y;
+} WuhooYUVSource;
+
+/* Converts count pixels of frame row y starting at x */
+WuhooInternal void
+WuhooYUVSourceRow(WuhooYUVSource const* source, WuhooYUVRow row,
+                  WuhooRGBA* dst, WuhooSize x, WuhooSize y, WuhooSize count)
+{
+  WuhooYUVFrame const* frame   = source->frame;
+  WuhooByte const*     y_row   = frame->planes[0] + y * frame->pitches[0];
+  WuhooByte const*     u_row   = frame->planes[1] + (y >> 1) * frame->pitches[1];
+  WuhooByte const*     v_row   = u_row + 1;
+  WuhooSize            uv_step = 2;
+
+  if (WUHOO_YUV_I420 == frame->layout) {
+    v_row   = frame->planes[2] + (y >> 1) * frame->pitches[2];
+    uv_step = 1;
+  }
 
-#ifdef _WIN32
-  return _WuhooWindowRegionGetWin32(window, posx, posy, width, height);
-#endif
+  row(dst, y_row, u_row, v_row, uv_step, x, count, source->coefficients);
+}
 
-#ifdef WUHOO_X11_ENABLE
-  return _WuhooWindowRegionGetX11(window, posx, posy, width, height);
-#endif
+/* The source of WuhooWindowBlitYUV, the coordinates are in the destination
+ * region. The frame rows under each chunk are converted to RGBA and resampled
+ * by the filters of WuhooConvertScaledRows, then handed to the stage's kernel
+ * while in cache */
+WuhooInternal WuhooResult
+WuhooConvertYUV(WuhooConvertStage const* stage, void* dst,
+                WuhooSize dst_pitch, WuhooSize src_x, WuhooSize src_y,
+                WuhooSize src_pitch, WuhooSize width, WuhooSize height)
+{
+  WuhooYUVSource const* source = (WuhooYUVSource const*)stage->context;
+  WuhooYUVFrame const*  frame  = source->frame;
+  WuhooYUVRow           row    = WuhooYUVSelect();
+  WuhooSize             bytes  = stage->format->bits_per_pixel / 8;
+  WuhooRGBA             chunk[WUHOO_SCALE_CHUNK_SIZE];
+  WuhooRGBA             line0[WUHOO_YUV_LINE_SIZE];
+  WuhooRGBA             line1[WUHOO_YUV_LINE_SIZE];
+  WuhooSize             i = 0, j = 0, count = 0;
+
+  /* Destination pixels whose source span fits the lines */
+  int limit = (int)(((unsigned long long)(WUHOO_YUV_LINE_SIZE - 2) << 16) /
+                    (unsigned long long)source->step_x);
+  limit     = WuhooMini(WuhooMaxi(limit, 1), WUHOO_SCALE_CHUNK_SIZE);
+
+  WuhooUnused(src_pitch);
+
+  for (j = 0; j < height; j++) {
+    WuhooSize  y       = src_y + j;
+    WuhooByte* dst_row = (WuhooByte*)dst + j * dst_pitch;
+
+    for (i = 0; i < width; i += count) {
+      WuhooSize x = src_x + i;
+
+      if (WuhooFalse == source->scaled) {
+        count = WuhooMini((int)(width - i), WUHOO_SCALE_CHUNK_SIZE);
+        WuhooYUVSourceRow(source, row, chunk, x, y, count);
+      } else if (WUHOO_BLIT_FILTER_BILINEAR == source->filter) {
+        count  = WuhooMini((int)(width - i), limit);
+        WuhooFixed fy =
+          source->step_y / 2 - 0x8000 + (WuhooFixed)y * source->step_y;
+        fy = (fy < 0) ? 0 : ((fy > source->max_y) ? source->max_y : fy);
+        WuhooFixed fx =
+          source->step_x / 2 - 0x8000 + (WuhooFixed)x * source->step_x;
+        WuhooFixed f0 =
+          (fx < 0) ? 0 : ((fx > source->max_x) ? source->max_x : fx);
+        WuhooFixed f1 = fx + (WuhooFixed)(count - 1) * source->step_x;
+        f1 = (f1 < 0) ? 0 : ((f1 > source->max_x) ? source->max_x : f1);
+
+        /* The right neighbour of the last pixel is part of the span */
+        int first = (int)(f0 >> 16);
+        int span  = WuhooMini((int)(f1 >> 16) + 2, (int)frame->width) - first;
+        int y0    = (int)(fy >> 16);
+        int y1    = y0 + (fy < source->max_y);
+
+        WuhooYUVSourceRow(source, row, line0, first, y0, span);
+        WuhooYUVSourceRow(source, row, line1, first, y1, span);
+        WuhooResampleRowBilinear(chunk, line0, line1, (int)((fy >> 9) & 0x7f),
+                                 fx - ((WuhooFixed)first << 16),
+                                 source->step_x,
+                                 source->max_x - ((WuhooFixed)first << 16),
+                                 count);
+      } else {
+        count  = WuhooMini((int)(width - i), limit);
+        WuhooFixed fy = source->step_y / 2 + (WuhooFixed)y * source->step_y;
+        WuhooFixed fx = source->step_x / 2 + (WuhooFixed)x * source->step_x;
+
+        int first = (int)(fx >> 16);
+        int span =
+          (int)((fx + (WuhooFixed)(count - 1) * source->step_x) >> 16) -
+          first + 1;
+
+        WuhooYUVSourceRow(source, row, line0, first, (int)(fy >> 16), span);
+        WuhooResampleRowNearest(chunk, line0, fx - ((WuhooFixed)first << 16),
+                                source->step_x, count);
+      }
+
+      /* As when scaling, the row index only tells a dithering kernel
+       * where it is */
+      WuhooConvertStageRGBA(stage, dst_row + i * bytes, dst_pitch, chunk, 0, y,
+                            0, count, 1);
+    }
+  }
+
+  return WuhooSuccess;
 }
+
 WuhooResult
-WuhooWindowClientRegionGet(WuhooWindow* window, int* posx, int* posy,
-                           WuhooSize* width, WuhooSize* height)
+WuhooWindowBlitYUV(WuhooWindow* window, WuhooYUVFrame const* frame,
+                   WuhooSize dst_x, WuhooSize dst_y, WuhooSize dst_width,
+                   WuhooSize dst_height)
 {
+  WuhooConvertStage stage = WuhooConvertStageWindow(window);
+  WuhooYUVSource    source;
+
+  if (WuhooNull == frame || WuhooNull == frame->planes[0] ||
+      WuhooNull == frame->planes[1] ||
+      (WUHOO_YUV_I420 == frame->layout && WuhooNull == frame->planes[2])) {
+    return (WuhooResult) "invalid buffer passed.";
+  }
+
+  if (frame->layout >= WUHOO_YUV_LAYOUT_MAX ||
+      frame->matrix >= WUHOO_YUV_MATRIX_MAX) {
+    return (WuhooResult) "invalid YUV frame passed.";
+  }
+
 #ifdef __APPLE__
-  return _WuhooWindowClientRegionGetCocoa(window, posx, posy, width, height);
+  return (WuhooResult)WUHOO_PLATFORM_API_STRING
+    " : YUV blits are not supported";
 #endif
 
-#ifdef _WIN32
-  return _WuhooWindowClientRegionGetWin32(window, posx, posy, width, height);
-#endif
+  if (0 == window->convert_format.bits_per_pixel) {
+    return (WuhooResult) "unsupported pixel format.";
+  }
 
-#ifdef WUHOO_X11_ENABLE
-  return _WuhooWindowClientRegionGetX11(window, posx, posy, width, height);
-#endif
+  if (0 == frame->width || 0 == frame->height || 0 == dst_width ||
+      0 == dst_height) {
+    return WuhooSuccess;
+  }
+
+  /* Without a filter the frame is cropped to the destination */
+  if (WUHOO_BLIT_FILTER_NONE == window->blit_filter) {
+    dst_width  = WuhooMini(dst_width, frame->width);
+    dst_height = WuhooMini(dst_height, frame->height);
+  }
+
+  source.frame = frame;
+  source.coefficients =
+    &wuhoo_yuv_coefficients[frame->matrix][frame->full_range ? 1 : 0];
+  source.filter = window->blit_filter;
+  source.scaled = (WUHOO_BLIT_FILTER_NONE != window->blit_filter) &&
+                  (frame->width != dst_width || frame->height != dst_height);
+  source.step_x =
+    (WuhooFixed)(((unsigned long long)frame->width << 16) / dst_width);
+  source.step_y =
+    (WuhooFixed)(((unsigned long long)frame->height << 16) / dst_height);
+  source.step_x = (source.step_x < 1) ? 1 : source.step_x;
+  source.step_y = (source.step_y < 1) ? 1 : source.step_y;
+  source.max_x  = (WuhooFixed)(frame->width - 1) << 16;
+  source.max_y  = (WuhooFixed)(frame->height - 1) << 16;
+
+  /* Conversion is the source of the stage like with float pixels, the
+   * backends see an unscaled blit of the destination region */
+  stage.source  = WuhooConvertYUV;
+  stage.context = &source;
+
+  return WuhooBlitStage(window, &stage, WuhooNull, 0, 0, dst_width,
+                        dst_width, dst_height, dst_x, dst_y, dst_width,
+                        dst_height, WuhooFalse);
+}
+
+/* Picks the kernel for a backend's pixel layout. Layouts without one of
+ * their own leave convert_rgba empty and run WuhooConvertRGBAtoFormat */
+WuhooInternal WuhooResult
+WuhooConvertFormatSelect(WuhooWindow* window, WuhooPixelFormat const* format)
+{
+  WuhooSize    bits  = format->bits_per_pixel;
+  WuhooSize    bytes = bits / 8;
+  WuhooSize    masks[4];
+  unsigned int offsets[4], lengths[4];
+  int          byte_index[4];
+  WuhooBoolean byte_aligned  = WuhooTrue;
+  int          channel_count = (0 != format->alpha_mask) ? 4 : 3;
+  int          k             = 0;
+
+  masks[0] = format->red_mask;
+  masks[1] = format->green_mask;
+  masks[2] = format->blue_mask;
+  masks[3] = format->alpha_mask;
+
+  if ((8 != bits && 16 != bits && 24 != bits && 32 != bits) ||
+      0 != (masks[0] & masks[1]) || 0 != (masks[0] & masks[2]) ||
+      0 != (masks[1] & masks[2]) ||
+      0 != (masks[3] & (masks[0] | masks[1] | masks[2])))
+    return (WuhooResult) "unsupported pixel format.";
+
+  for (k = 0; k < channel_count; k++) {
+    WuhooMaskBits(masks[k], &offsets[k], &lengths[k]);
+    if (0 == lengths[k] || offsets[k] + lengths[k] > bits ||
+        (masks[k] >> offsets[k]) != ((WuhooSize)1 << lengths[k]) - 1)
+      return (WuhooResult) "unsupported pixel format.";
+
+    /* Where the channel is in memory, if it fills a byte of its own */
+    byte_aligned = byte_aligned && 8 == lengths[k] && 0 == offsets[k] % 8;
+    byte_index[k] = (int)(format->msb_first ? bytes - 1 - offsets[k] / 8
+                                            : offsets[k] / 8);
+  }
+
+  window->convert_format = *format;
+  window->convert_rgba   = WuhooNull;
+
+  if (4 == channel_count) {
+    /* Premultiplied, other layouts than XRender's are left to the generic
+     * kernel as well */
+    if (byte_aligned && 32 == bits && 2 == byte_index[0] &&
+        1 == byte_index[1] && 0 == byte_index[2] && 3 == byte_index[3])
+      window->convert_rgba = &WuhooConvertRGBAtoPremultipliedBGRA;
+  } else if (byte_aligned && 32 == bits && 2 == byte_index[0] &&
+             1 == byte_index[1] && 0 == byte_index[2]) {
+    window->convert_rgba = &WuhooConvertRGBAtoBGRA;
+  } else if (byte_aligned && 32 == bits && 0 == byte_index[0] &&
+             1 == byte_index[1] && 2 == byte_index[2]) {
+    window->convert_rgba = &WuhooConvertRGBAtoRGBA;
+  } else if (byte_aligned && 24 == bits && 2 == byte_index[0] &&
+             1 == byte_index[1] && 0 == byte_index[2]) {
+    window->convert_rgba = &WuhooConvertRGBAtoR8G8B8;
+  } else if (byte_aligned && 24 == bits && 0 == byte_index[0] &&
+             1 == byte_index[1] && 2 == byte_index[2]) {
+    window->convert_rgba = &WuhooConvertRGBAtoB8G8R8;
+  } else if (WuhooFalse != format->msb_first) {
+    /* Left to the generic kernel */
+  } else if (16 == bits && 0xF800 == masks[0] && 0x07E0 == masks[1] &&
+             0x001F == masks[2]) {
+    window->convert_rgba = &WuhooConvertRGBAtoR5G6B5;
+  } else if (16 == bits && 0x7C00 == masks[0] && 0x03E0 == masks[1] &&
+             0x001F == masks[2]) {
+    window->convert_rgba = &WuhooConvertRGBAtoR5G5B5;
+  } else if (32 == bits && 0x3FF00000 == masks[0] && 0x000FFC00 == masks[1] &&
+             0x000003FF == masks[2]) {
+    window->convert_rgba = &WuhooConvertRGBAtoR10G10B10;
+  }
 
   return WuhooSuccess;
 }
-WuhooResult
-WuhooWindowClientRegionSet(WuhooWindow* window, int posx, int posy,
-                           WuhooSize width, WuhooSize height)
+
+/* The stage of a regular blit, RGBA pixels through the window's kernel */
+WuhooInternal WuhooConvertStage
+WuhooConvertStageWindow(WuhooWindow* window)
 {
-#ifdef __APPLE__
-  return _WuhooWindowClientRegionSetCocoa(window, posx, posy, width, height);
-#endif
+  WuhooConvertStage stage;
 
-#ifdef _WIN32
-  return _WuhooWindowClientRegionSetWin32(window, posx, posy, width, height);
-#endif
+  stage.convert = window->convert_rgba;
+  stage.format  = &window->convert_format;
+  stage.source  = WuhooNull;
+  stage.context = WuhooNull;
 
-#ifdef WUHOO_X11_ENABLE
-  return _WuhooWindowClientRegionSetX11(window, posx, posy, width, height);
-#endif
+  return stage;
+}
 
-  return WuhooSuccess;
+/* Runs the stage's kernel on RGBA pixels, or the generic one when it has
+ * none. Sources that are not RGBA end up here once they are */
+WuhooInternal WuhooResult
+WuhooConvertStageRGBA(WuhooConvertStage const* stage, void* dst,
+                      WuhooSize dst_pitch, WuhooRGBA const* const src,
+                      WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                      WuhooSize width, WuhooSize height)
+{
+  if (WuhooNull == stage->convert)
+    return WuhooConvertRGBAtoFormat(stage->format, dst, dst_pitch, src, src_x,
+                                    src_y, src_pitch, width, height);
+
+  return stage->convert(dst, dst_pitch, src, src_x, src_y, src_pitch, width,
+                        height);
 }
-WuhooResult
-WuhooWindowSetTitle(WuhooWindow* window, const char* title)
+
+/* Converts an unscaled region, src is ignored by stages with a source */
+WuhooInternal WuhooResult
+WuhooConvertStageRun(WuhooConvertStage const* stage, void* dst,
+                     WuhooSize dst_pitch, WuhooRGBA const* const src,
+                     WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                     WuhooSize width, WuhooSize height)
 {
-  WuhooResult result = WuhooSuccess;
+  if (WuhooNull != stage->source)
+    return stage->source(stage, dst, dst_pitch, src_x, src_y, src_pitch,
+                         width, height);
 
-  if (WuhooNull == title)
-    return (WuhooResult) "Invalid title";
+  return WuhooConvertStageRGBA(stage, dst, dst_pitch, src, src_x, src_y,
+                               src_pitch, width, height);
+}
 
-  if ( !(WUHOO_FLAG_TITLED & window->flags) )
-    return (WuhooResult) "WUHOO_FLAG_TITLED is not set";
+/* Resampling */
+WuhooInternal int
+WuhooPixelBits(WuhooRGBA const* pixel)
+{
+  union
+  {
+    WuhooRGBA rgba;
+    int       bits;
+  } view;
+  view.rgba = *pixel;
+  return view.bits;
+}
 
-#ifdef __APPLE__
-  result = _WuhooWindowSetTitleCocoa(window, title);
-#endif
+/* 7 bit weights keep the intermediate products of the SIMD paths in 16 bits */
+#define WuhooLerp7(a, b, w) ((((a) * (128 - (w))) + ((b) * (w)) + 64) >> 7)
 
-#ifdef _WIN32
-  result = _WuhooWindowSetTitleWin32(window, title);
-#endif
+WuhooInternal void
+WuhooResampleRowNearest(WuhooRGBA* dst, WuhooRGBA const* src_row,
+                        WuhooFixed fx, WuhooFixed step, WuhooSize count)
+{
+  WuhooSize i = 0;
+  for (i = 0; i < count; i++) {
+    dst[i] = src_row[fx >> 16];
+    fx += step;
+  }
+}
 
-#ifdef WUHOO_X11_ENABLE
-  result = _WuhooWindowSetTitleX11(window, title);
+/* fx is the 16.16 source position of the first pixel, rows 0 and 1 are
+ * blended with the 7 bit weight wy
+ */
+WuhooInternal void
+WuhooResampleRowBilinear(WuhooRGBA* dst, WuhooRGBA const* row0,
+                         WuhooRGBA const* row1, int wy, WuhooFixed fx,
+                         WuhooFixed step, WuhooFixed fx_max, WuhooSize count)
+{
+  WuhooSize i = 0;
+
+#if defined(WUHOO_SSE2)
+  __m128i const zero  = _mm_setzero_si128();
+  __m128i const round = _mm_set1_epi16(64);
+  __m128i const full  = _mm_set1_epi16(128);
+  __m128i const wy1   = _mm_set1_epi16((short)wy);
+  __m128i const wy0   = _mm_sub_epi16(full, wy1);
+
+  /* Two destination pixels per iteration */
+  for (; i + 2 <= count; i += 2) {
+    WuhooFixed fa = (fx < 0) ? 0 : ((fx > fx_max) ? fx_max : fx);
+    fx += step;
+    WuhooFixed fb = (fx < 0) ? 0 : ((fx > fx_max) ? fx_max : fx);
+    fx += step;
+
+    int xa = (int)(fa >> 16), xa1 = xa + (fa < fx_max);
+    int xb = (int)(fb >> 16), xb1 = xb + (fb < fx_max);
+
+    /* [left, right] neighbours widened to 16 bits */
+    __m128i ta = _mm_unpacklo_epi8(
+      _mm_unpacklo_epi32(_mm_cvtsi32_si128(WuhooPixelBits(&row0[xa])),
+                         _mm_cvtsi32_si128(WuhooPixelBits(&row0[xa1]))),
+      zero);
+    __m128i ba = _mm_unpacklo_epi8(
+      _mm_unpacklo_epi32(_mm_cvtsi32_si128(WuhooPixelBits(&row1[xa])),
+                         _mm_cvtsi32_si128(WuhooPixelBits(&row1[xa1]))),
+      zero);
+    __m128i tb = _mm_unpacklo_epi8(
+      _mm_unpacklo_epi32(_mm_cvtsi32_si128(WuhooPixelBits(&row0[xb])),
+                         _mm_cvtsi32_si128(WuhooPixelBits(&row0[xb1]))),
+      zero);
+    __m128i bb = _mm_unpacklo_epi8(
+      _mm_unpacklo_epi32(_mm_cvtsi32_si128(WuhooPixelBits(&row1[xb])),
+                         _mm_cvtsi32_si128(WuhooPixelBits(&row1[xb1]))),
+      zero);
+
+    __m128i va = _mm_srli_epi16(
+      _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(ta, wy0),
+                                  _mm_mullo_epi16(ba, wy1)),
+                    round),
+      7);
+    __m128i vb = _mm_srli_epi16(
+      _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(tb, wy0),
+                                  _mm_mullo_epi16(bb, wy1)),
+                    round),
+      7);
+
+    __m128i left  = _mm_unpacklo_epi64(va, vb);
+    __m128i right = _mm_unpackhi_epi64(va, vb);
+    __m128i wx1   = _mm_unpacklo_epi64(_mm_set1_epi16((short)((fa >> 9) & 0x7f)),
+                                     _mm_set1_epi16((short)((fb >> 9) & 0x7f)));
+    __m128i wx0   = _mm_sub_epi16(full, wx1);
+
+    __m128i out = _mm_srli_epi16(
+      _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(left, wx0),
+                                  _mm_mullo_epi16(right, wx1)),
+                    round),
+      7);
+
+    _mm_storel_epi64((__m128i*)&dst[i], _mm_packus_epi16(out, out));
+  }
+#elif defined(WUHOO_NEON)
+  uint8x8_t const wy1 = vdup_n_u8((uint8_t)wy);
+  uint8x8_t const wy0 = vdup_n_u8((uint8_t)(128 - wy));
+
+  for (; i < count; i++) {
+    WuhooFixed f  = (fx < 0) ? 0 : ((fx > fx_max) ? fx_max : fx);
+    int        x0 = (int)(f >> 16), x1 = x0 + (f < fx_max);
+    int        wx = (int)((f >> 9) & 0x7f);
+    fx += step;
+
+    /* [left, right] neighbours of both rows */
+    uint8x8_t t = vreinterpret_u8_u32(
+      vset_lane_u32((uint32_t)WuhooPixelBits(&row0[x1]),
+                    vdup_n_u32((uint32_t)WuhooPixelBits(&row0[x0])), 1));
+    uint8x8_t b = vreinterpret_u8_u32(
+      vset_lane_u32((uint32_t)WuhooPixelBits(&row1[x1]),
+                    vdup_n_u32((uint32_t)WuhooPixelBits(&row1[x0])), 1));
+    uint8x8_t v = vrshrn_n_u16(vmlal_u8(vmull_u8(t, wy0), b, wy1), 7);
+
+    uint8x8_t w = vreinterpret_u8_u32(
+      vset_lane_u32((uint32_t)wx * 0x01010101u,
+                    vdup_n_u32((uint32_t)(128 - wx) * 0x01010101u), 1));
+    uint16x8_t m = vmull_u8(v, w);
+    uint16x4_t h = vadd_u16(vget_low_u16(m), vget_high_u16(m));
+    uint8x8_t  o = vrshrn_n_u16(vcombine_u16(h, h), 7);
+
+    vst1_lane_u32((uint32_t*)&dst[i], vreinterpret_u32_u8(o), 0);
+  }
 #endif
 
-  return result;
+  for (; i < count; i++) {
+    WuhooFixed f  = (fx < 0) ? 0 : ((fx > fx_max) ? fx_max : fx);
+    int        x0 = (int)(f >> 16), x1 = x0 + (f < fx_max);
+    int        wx = (int)((f >> 9) & 0x7f);
+    fx += step;
+
+    int l, r;
+    l = WuhooLerp7(row0[x0].r, row1[x0].r, wy);
+    r = WuhooLerp7(row0[x1].r, row1[x1].r, wy);
+    dst[i].r = (unsigned char)WuhooLerp7(l, r, wx);
+    l = WuhooLerp7(row0[x0].g, row1[x0].g, wy);
+    r = WuhooLerp7(row0[x1].g, row1[x1].g, wy);
+    dst[i].g = (unsigned char)WuhooLerp7(l, r, wx);
+    l = WuhooLerp7(row0[x0].b, row1[x0].b, wy);
+    r = WuhooLerp7(row0[x1].b, row1[x1].b, wy);
+    dst[i].b = (unsigned char)WuhooLerp7(l, r, wx);
+    l = WuhooLerp7(row0[x0].a, row1[x0].a, wy);
+    r = WuhooLerp7(row0[x1].a, row1[x1].a, wy);
+    dst[i].a = (unsigned char)WuhooLerp7(l, r, wx);
+  }
 }
 
-WuhooResult
-WuhooWindowDropContentsGet(WuhooWindow* window, WuhooEvent* event, char* buffer,
-                           WuhooSize buffer_size)
+/* Converts the src_width x src_height region of src at (src_x, src_y)
+ * stretched to dst_width x dst_height. Only the clip_width x clip_height
+ * block at the top left of the destination is written. Each destination row
+ * is resampled in small chunks that are handed to the stage's kernel while
+ * they are still in cache, so the frame is produced in a single pass. Stages
+ * with a source of their own are only run unscaled.
+ */
+WuhooInternal WuhooResult
+WuhooConvertScaledRows(WuhooWindow* window, WuhooConvertStage const* stage,
+                       void* dst, WuhooSize dst_pitch,
+                       WuhooSize dst_bytes_per_pixel, WuhooRGBA const* src,
+                       WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                       WuhooSize src_width, WuhooSize src_height,
+                       WuhooSize dst_width, WuhooSize dst_height,
+                       WuhooSize clip_width, WuhooSize band_y,
+                       WuhooSize band_height)
 {
-  WuhooResult result = WuhooSuccess;
+  if (src_width == dst_width && src_height == dst_height) {
+    return WuhooConvertStageRun(stage, (WuhooByte*)dst + band_y * dst_pitch,
+                                dst_pitch, src, src_x, src_y + band_y,
+                                src_pitch, clip_width, band_height);
+  }
 
-  if (WuhooNull == buffer) {
-	  return (WuhooResult)"invalid buffer passed.";
+  if (0 == src_width || 0 == src_height || 0 == dst_width ||
+      0 == dst_height) {
+    return WuhooSuccess;
   }
 
-  if (buffer_size < event->data.drop.size) {
-	  return (WuhooResult)"invalid buffer size.";
+  WuhooRGBA        chunk[WUHOO_SCALE_CHUNK_SIZE];
+  WuhooRGBA const* region  = src + src_x + src_y * src_pitch;
+  WuhooByte*       dst_row = (WuhooByte*)dst + band_y * dst_pitch;
+
+  /* 16.16 fixed point source positions of the destination pixel centers */
+  WuhooFixed step_x = (WuhooFixed)(((unsigned long long)src_width << 16) / dst_width);
+  WuhooFixed step_y = (WuhooFixed)(((unsigned long long)src_height << 16) / dst_height);
+  WuhooFixed max_x  = (WuhooFixed)(src_width - 1) << 16;
+  WuhooFixed max_y  = (WuhooFixed)(src_height - 1) << 16;
+
+  WuhooSize i = 0, j = 0, count = 0;
+  for (j = band_y; j < band_y + band_height; j++) {
+    for (i = 0; i < clip_width; i += count) {
+      count = WuhooMini(clip_width - i, WUHOO_SCALE_CHUNK_SIZE);
+
+      if (WUHOO_BLIT_FILTER_BILINEAR == window->blit_filter) {
+        WuhooFixed fy = step_y / 2 - 0x8000 + (WuhooFixed)j * step_y;
+        fy            = (fy < 0) ? 0 : ((fy > max_y) ? max_y : fy);
+        WuhooSize y0  = (WuhooSize)(fy >> 16);
+        WuhooSize y1  = y0 + (fy < max_y);
+
+        WuhooResampleRowBilinear(chunk, region + y0 * src_pitch,
+                                 region + y1 * src_pitch,
+                                 (int)((fy >> 9) & 0x7f),
+                                 step_x / 2 - 0x8000 + (WuhooFixed)i * step_x,
+                                 step_x, max_x, count);
+      } else {
+        WuhooFixed fy = step_y / 2 + (WuhooFixed)j * step_y;
+
+        WuhooResampleRowNearest(chunk, region + (fy >> 16) * src_pitch,
+                                step_x / 2 + (WuhooFixed)i * step_x, step_x,
+                                count);
+      }
+
+      /* With no pitch the row index only tells a dithering kernel where it
+       * is, chunks start at multiples of 4 so the columns already line up */
+      WuhooConvertStageRGBA(stage, dst_row + i * dst_bytes_per_pixel,
+                            dst_pitch, chunk, 0, j, 0, count, 1);
+    }
+    dst_row += dst_pitch;
   }
 
-#ifdef __APPLE__
-  result = _WuhooWindowDropContentsGetCocoa(window, event, buffer, buffer_size);
+  return WuhooSuccess;
+}
+
+#ifdef WUHOO_THREADS_ENABLE
+
+#ifndef WUHOO_CONVERT_THREADS
+#define WUHOO_CONVERT_THREADS 0 /* Threads converting a large blit, the calling one included. 0 uses one per CPU */
+#endif
+#ifndef WUHOO_CONVERT_THREADS_MAX
+#define WUHOO_CONVERT_THREADS_MAX 16 /* Upper bound of the pool, conversion is bound by memory long before */
 #endif
+#ifndef WUHOO_CONVERT_THRESHOLD
+#define WUHOO_CONVERT_THRESHOLD (512 * 1024) /* Pixels a blit needs to be split between threads */
+#endif
+#define WUHOO_CONVERT_BAND_MIN 16 /* Fewest rows handed to one thread */
 
+/* One conversion split in row bands, each band the arguments of
+ * WuhooConvertScaledRows */
+typedef struct
+{
+  WuhooWindow*             window;
+  WuhooConvertStage const* stage;
+  void*                    dst;
+  WuhooSize                dst_pitch;
+  WuhooSize                dst_bytes_per_pixel;
+  WuhooRGBA const*         src;
+  WuhooSize                src_x, src_y, src_pitch;
+  WuhooSize                src_width, src_height;
+  WuhooSize                dst_width, dst_height;
+  WuhooSize                clip_width, band_y, band_height;
+  WuhooSize                band_count;
+} WuhooConvertJob;
+
+/* Owned by the library and shared by all windows. The threads are started
+ * by the first large blit and wait for work until the last window is
+ * destroyed, which joins them. One conversion runs on the pool at a time,
+ * others run on their own thread */
+typedef struct
+{
 #ifdef _WIN32
-  result = _WuhooWindowDropContentsGetWin32(window, event, buffer, buffer_size);
+  SRWLOCK            lock;
+  CONDITION_VARIABLE work;
+  CONDITION_VARIABLE done;
+#else
+  pthread_mutex_t lock;
+  pthread_cond_t  work;
+  pthread_cond_t  done;
 #endif
+  WuhooConvertJob job;
+  WuhooSize       next_band; /* Next band of job nobody took yet */
+  WuhooSize       pending;   /* Bands of job not converted yet */
+  unsigned int    generation;
+  WuhooSize       thread_count; /* Including the thread that blits */
+  WuhooBoolean    started;
+  WuhooBoolean    busy;
+  WuhooBoolean    stopping;     /* Tells the threads to return */
+  WuhooSize       window_count; /* Windows that were created and not destroyed */
+  WuhooThread     threads[WUHOO_CONVERT_THREADS_MAX]; /* From 1, 0 blits */
+} WuhooConvertPool;
+
+/* Every member after the synchronization objects, spelled out so that
+ * -Wextra does not flag the static initializers */
+#define WUHOO_CONVERT_POOL_IDLE                                               \
+  { WuhooNull, WuhooNull, WuhooNull, 0, 0, WuhooNull, 0, 0, 0, 0, 0, 0, 0, 0, \
+    0, 0, 0 },                                                                \
+    0, 0, 0, 0, WuhooFalse, WuhooFalse, WuhooFalse, 0, { 0 }
 
-#ifdef WUHOO_X11_ENABLE
-  result = _WuhooWindowDropContentsGetX11(window, event, buffer, buffer_size);
+#ifdef _WIN32
+static WuhooConvertPool wuhoo_convert_pool = { SRWLOCK_INIT,
+                                               CONDITION_VARIABLE_INIT,
+                                               CONDITION_VARIABLE_INIT,
+                                               WUHOO_CONVERT_POOL_IDLE };
+#define WuhooPoolLock(pool) AcquireSRWLockExclusive(&(pool)->lock)
+#define WuhooPoolUnlock(pool) ReleaseSRWLockExclusive(&(pool)->lock)
+#define WuhooPoolWait(pool, condition)                                       \
+  SleepConditionVariableSRW(&(pool)->condition, &(pool)->lock, INFINITE, 0)
+#define WuhooPoolWakeAll(pool, condition)                                    \
+  WakeAllConditionVariable(&(pool)->condition)
+#else
+#include <unistd.h> /* sysconf */
+static WuhooConvertPool wuhoo_convert_pool = { PTHREAD_MUTEX_INITIALIZER,
+                                               PTHREAD_COND_INITIALIZER,
+                                               PTHREAD_COND_INITIALIZER,
+                                               WUHOO_CONVERT_POOL_IDLE };
+#define WuhooPoolLock(pool) pthread_mutex_lock(&(pool)->lock)
+#define WuhooPoolUnlock(pool) pthread_mutex_unlock(&(pool)->lock)
+#define WuhooPoolWait(pool, condition)                                       \
+  pthread_cond_wait(&(pool)->condition, &(pool)->lock)
+#define WuhooPoolWakeAll(pool, condition)                                    \
+  pthread_cond_broadcast(&(pool)->condition)
 #endif
 
-  return result;
+/* Takes bands of the current job until none is left, called with the lock
+ * held and returns with it held */
+WuhooInternal void
+WuhooConvertPoolDrain(WuhooConvertPool* pool)
+{
+  while (pool->next_band < pool->job.band_count) {
+    WuhooConvertJob const* job   = &pool->job;
+    WuhooSize              band  = pool->next_band++;
+    WuhooSize              first = job->band_height * band / job->band_count;
+    WuhooSize              last =
+      job->band_height * (band + 1) / job->band_count;
+
+    WuhooPoolUnlock(pool);
+    WuhooConvertScaledRows(job->window, job->stage, job->dst, job->dst_pitch,
+                           job->dst_bytes_per_pixel, job->src, job->src_x,
+                           job->src_y, job->src_pitch, job->src_width,
+                           job->src_height, job->dst_width, job->dst_height,
+                           job->clip_width, job->band_y + first, last - first);
+    WuhooPoolLock(pool);
+
+    if (0 == --pool->pending)
+      WuhooPoolWakeAll(pool, done);
+  }
 }
 
-WuhooResult
-WuhooWindowBlit(WuhooWindow* window, WuhooRGBA* pixels, WuhooSize src_x,
-                WuhooSize src_y, WuhooSize src_width, WuhooSize src_height,
-                WuhooSize dst_x, WuhooSize dst_y, WuhooSize dst_width,
-                WuhooSize dst_height)
+#ifdef _WIN32
+WuhooInternal DWORD WINAPI
+WuhooConvertPoolThread(LPVOID parameter)
+#else
+WuhooInternal void*
+WuhooConvertPoolThread(void* parameter)
+#endif
 {
-  WuhooResult result = WuhooSuccess;
+  WuhooConvertPool* pool       = (WuhooConvertPool*)parameter;
+  unsigned int      generation = 0;
+
+  WuhooPoolLock(pool);
+  generation = pool->generation;
+  for (;;) {
+    while (generation == pool->generation && WuhooFalse == pool->stopping)
+      WuhooPoolWait(pool, work);
+    if (WuhooTrue == pool->stopping)
+      break;
+    generation = pool->generation;
+    WuhooConvertPoolDrain(pool);
+  }
+  WuhooPoolUnlock(pool);
 
-#ifdef __APPLE__
-  result =
-    _WuhooWindowBlitCocoa(window, pixels, dst_x, dst_y, dst_width, dst_height);
+#ifdef _WIN32
+  return 0;
+#else
+  return WuhooNull;
 #endif
+}
+
+/* Called with the lock held */
+WuhooInternal void
+WuhooConvertPoolStart(WuhooConvertPool* pool)
+{
+  long count = WUHOO_CONVERT_THREADS;
+  long i     = 0;
 
+  pool->started = WuhooTrue;
+
+  if (0 >= count) {
 #ifdef _WIN32
-  result =
-    _WuhooWindowBlitWin32(window, pixels, dst_x, dst_y, dst_width, dst_height);
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    count = (long)info.dwNumberOfProcessors;
+#else
+    count = sysconf(_SC_NPROCESSORS_ONLN);
 #endif
+  }
+  count = (count < 1) ? 1 : count;
+  count = (count > WUHOO_CONVERT_THREADS_MAX) ? WUHOO_CONVERT_THREADS_MAX : count;
 
-#ifdef WUHOO_X11_ENABLE
-  result =
-    _WuhooWindowBlitX11(window, pixels, dst_x, dst_y, dst_width, dst_height);
+  /* A thread that fails to start leaves the pool one thread smaller */
+  pool->thread_count = 1;
+  for (i = 1; i < count; i++) {
+    WuhooThread thread;
+#ifdef _WIN32
+    thread = CreateThread(WuhooNull, 0, WuhooConvertPoolThread, pool, 0,
+                          WuhooNull);
+    if (WuhooNull == thread)
+      break;
+#else
+    if (0 != pthread_create(&thread, WuhooNull, WuhooConvertPoolThread, pool))
+      break;
 #endif
-
-  return result;
+    pool->threads[pool->thread_count++] = thread;
+  }
 }
 
+/* Called without the lock. Joins the threads, the next large blit starts
+ * them again */
 WuhooInternal void
-WuhooCopy(void* const to, void const* const from, WuhooSize count)
+WuhooConvertPoolStop(WuhooConvertPool* pool)
 {
-  unsigned char* const       char_view_to   = (unsigned char* const)to;
-  unsigned char const* const char_view_from = (unsigned char const* const)from;
-  while (--count)
-    char_view_to[count] = char_view_from[count];
-  char_view_to[count] = char_view_from[count];
+  WuhooSize i = 0;
+
+  WuhooPoolLock(pool);
+  pool->stopping = WuhooTrue;
+  WuhooPoolWakeAll(pool, work);
+  WuhooPoolUnlock(pool);
+
+  for (i = 1; i < pool->thread_count; i++) {
+#ifdef _WIN32
+    WaitForSingleObject(pool->threads[i], INFINITE);
+    CloseHandle(pool->threads[i]);
+#else
+    pthread_join(pool->threads[i], WuhooNull);
+#endif
+  }
+
+  WuhooPoolLock(pool);
+  pool->stopping     = WuhooFalse;
+  pool->started      = WuhooFalse;
+  pool->thread_count = 0;
+  WuhooPoolUnlock(pool);
 }
 
-/* Color conversion kernels */
-WuhooMaybeUnused WuhooInternal WuhooResult
-WuhooConvertRGBANoOp(void* dst, WuhooRGBA const* const src, WuhooSize x,
-                     WuhooSize y, WuhooSize width, WuhooSize height,
-                     WuhooSize src_width, WuhooSize src_height)
+/* Counts a window that was created */
+WuhooInternal void
+WuhooConvertPoolRetain(void)
 {
+  WuhooConvertPool* pool = &wuhoo_convert_pool;
 
-  return WuhooSuccess;
+  WuhooPoolLock(pool);
+  pool->window_count++;
+  WuhooPoolUnlock(pool);
 }
 
-WuhooMaybeUnused WuhooInternal WuhooResult
-WuhooConvertRGBAtoRGBA(void* dst, WuhooRGBA const* const src, WuhooSize x,
-                       WuhooSize y, WuhooSize width, WuhooSize height,
-                       WuhooSize src_width, WuhooSize src_height)
+/* Forgets a destroyed window, the last one stops the threads so that none
+ * outlives the windows, e.g. in a library that gets unloaded */
+WuhooInternal void
+WuhooConvertPoolRelease(void)
 {
+  WuhooConvertPool* pool = &wuhoo_convert_pool;
+  WuhooBoolean      stop = WuhooFalse;
 
-  WuhooCopy(dst, src, width * height * sizeof(*src));
+  WuhooPoolLock(pool);
+  if (0 != pool->window_count)
+    pool->window_count--;
+  stop = (0 == pool->window_count && WuhooTrue == pool->started);
+  WuhooPoolUnlock(pool);
 
-  return WuhooSuccess;
+  if (WuhooTrue == stop)
+    WuhooConvertPoolStop(pool);
 }
 
-WuhooMaybeUnused WuhooInternal WuhooResult
-WuhooConvertRGBAtoRGB(void* dst, WuhooRGBA const* const src, WuhooSize x,
-                      WuhooSize y, WuhooSize width, WuhooSize height,
-                      WuhooSize src_width, WuhooSize src_height)
+/* Splits a large conversion in row bands for the pool, the calling thread
+ * converting bands too. Returns WuhooFalse when the conversion is better
+ * done by the caller alone */
+WuhooInternal WuhooBoolean
+WuhooConvertParallel(WuhooConvertJob const* job)
 {
-  WuhooResult result   = WuhooSuccess;
-  WuhooRGBA*  rgba_dst = (WuhooRGBA*)dst;
+  WuhooConvertPool* pool = &wuhoo_convert_pool;
 
-  WuhooSize i = 0;
-  for (i = 0; i < width * height; i++) {
-    rgba_dst[i].r = src[i].b;
-    rgba_dst[i].g = src[i].g;
-    rgba_dst[i].b = src[i].r;
-    rgba_dst[i].a = 0;
+  if (job->clip_width * job->band_height < WUHOO_CONVERT_THRESHOLD ||
+      job->band_height < 2 * WUHOO_CONVERT_BAND_MIN)
+    return WuhooFalse;
+
+  WuhooPoolLock(pool);
+  if (WuhooFalse == pool->started)
+    WuhooConvertPoolStart(pool);
+
+  if (WuhooTrue == pool->busy || 1 >= pool->thread_count) {
+    WuhooPoolUnlock(pool);
+    return WuhooFalse;
   }
 
-  return result;
-}
+  pool->busy           = WuhooTrue;
+  pool->job            = *job;
+  pool->job.band_count = WuhooMini(pool->thread_count,
+                                   job->band_height / WUHOO_CONVERT_BAND_MIN);
+  pool->next_band      = 0;
+  pool->pending        = pool->job.band_count;
+  pool->generation++;
+  WuhooPoolWakeAll(pool, work);
 
-WuhooMaybeUnused WuhooInternal WuhooResult
-WuhooConvertRGBAtoBGRA(void* dst, WuhooRGBA const* const src, WuhooSize x,
-                       WuhooSize y, WuhooSize width, WuhooSize height,
-                       WuhooSize src_width, WuhooSize src_height)
-{
-  WuhooResult result   = WuhooSuccess;
-  WuhooRGBA*  rgba_dst = (WuhooRGBA*)dst;
+  WuhooConvertPoolDrain(pool);
+  while (0 != pool->pending)
+    WuhooPoolWait(pool, done);
 
-  WuhooSize i = 0;
-  for (i = 0; i < width * height; i++) {
-    rgba_dst[i].r = src[i].b;
-    rgba_dst[i].g = src[i].g;
-    rgba_dst[i].b = src[i].r;
-    rgba_dst[i].a = src[i].a;
-  }
+  pool->busy = WuhooFalse;
+  WuhooPoolUnlock(pool);
 
-  return result;
+  return WuhooTrue;
 }
 
+#endif /* WUHOO_THREADS_ENABLE */
+
+/* Converts rows band_y to band_y + band_height of the destination, see
+ * WuhooConvertScaledRows. With WUHOO_THREADS_ENABLE large blits are spread
+ * over the conversion pool */
 WuhooMaybeUnused WuhooInternal WuhooResult
-WuhooConvertRGBAtoR5G6B5(void* dst, WuhooRGBA const* const src, WuhooSize dst_x,
-                         WuhooSize dst_y, WuhooSize dst_width,
-                         WuhooSize dst_height, WuhooSize src_width,
-                         WuhooSize src_height)
+WuhooConvertScaled(WuhooWindow* window, WuhooConvertStage const* stage,
+                   void* dst, WuhooSize dst_pitch,
+                   WuhooSize dst_bytes_per_pixel, WuhooRGBA const* src,
+                   WuhooSize src_x, WuhooSize src_y, WuhooSize src_pitch,
+                   WuhooSize src_width, WuhooSize src_height,
+                   WuhooSize dst_width, WuhooSize dst_height,
+                   WuhooSize clip_width, WuhooSize band_y,
+                   WuhooSize band_height)
 {
-  WuhooResult result = WuhooSuccess;
-
-  /* https://stackoverflow.com/questions/42388721/x11-graphics-rendering-improvement
-   */
-  /* Why do we need to go off by one */
-  WuhooSize i = 0, j = 0;
-  for (i = 0; i < dst_width; ++i) {
-    for (j = 0; j < dst_height; ++j) {
-      WuhooSize pixel_index          = i + j * src_width;
-      WuhooSize pixel_index_relative = i + j * (dst_width + (dst_width & 1));
-
-      unsigned short out =
-        (unsigned char)(((float)src[pixel_index].r / 255.0f) * 31.0f);
-      unsigned short outg =
-        (unsigned char)(((float)src[pixel_index].g / 255.0f) * 63.0f);
-
-      unsigned short pixel_val = (out << 11) | (outg << 5) | (out << 0);
-
-      ((unsigned short*)dst)[pixel_index_relative] = pixel_val;
-      //((unsigned char*)dst)[2 * pixel_index + 0] = (unsigned char)(pixel_val &
-      // 0x00FF);
-      //((unsigned char*)dst)[2 * pixel_index + 1] = (unsigned char)((pixel_val
-      //>> 8) & 0x00FF);
-    }
-  }
+#ifdef WUHOO_THREADS_ENABLE
+  WuhooConvertJob job;
+  job.window              = window;
+  job.stage               = stage;
+  job.dst                 = dst;
+  job.dst_pitch           = dst_pitch;
+  job.dst_bytes_per_pixel = dst_bytes_per_pixel;
+  job.src                 = src;
+  job.src_x               = src_x;
+  job.src_y               = src_y;
+  job.src_pitch           = src_pitch;
+  job.src_width           = src_width;
+  job.src_height          = src_height;
+  job.dst_width           = dst_width;
+  job.dst_height          = dst_height;
+  job.clip_width          = clip_width;
+  job.band_y              = band_y;
+  job.band_height         = band_height;
+  job.band_count          = 0;
+
+  if (WuhooTrue == WuhooConvertParallel(&job))
+    return WuhooSuccess;
+#endif
 
-  return result;
+  return WuhooConvertScaledRows(window, stage, dst, dst_pitch,
+                                dst_bytes_per_pixel, src, src_x, src_y,
+                                src_pitch, src_width, src_height, dst_width,
+                                dst_height, clip_width, band_y, band_height);
 }
 
 /* Helpers and utilities */
@@ -5619,6 +13578,69 @@ WuhooStringCmp(const char* to, const char* from, WuhooSize max_count)
   return WuhooTrue;
 }
 
+/* Turns the pending window state flags into a WuhooEventWindow, most
+ * important first. Returns WuhooFalse if no flag was pending */
+WuhooMaybeUnused WuhooInternal WuhooBoolean
+WuhooWindowFlagsEvent(WuhooWindow* window, WuhooEvent* event)
+{
+  if (window->window_flags & WUHOO_WINDOW_FLAG_CLOSED) {
+    event->type              = WUHOO_EVT_WINDOW;
+    event->data.window.state = WUHOO_WSTATE_CLOSED;
+
+    return WuhooTrue;
+  } else if (window->window_flags & WUHOO_WINDOW_FLAG_RESIZED) {
+    event->type              = WUHOO_EVT_WINDOW;
+    event->data.window.state = WUHOO_WSTATE_RESIZED;
+    event->data.window.data1 = window->cwidth;
+    event->data.window.data2 = window->cheight;
+    event->data.window.flags = WUHOO_WINDOW_FLAG_RESIZED;
+    event->data.window.flags |= (window->window_flags & WUHOO_WINDOW_FLAG_MAXIMIZED) ? WUHOO_WINDOW_FLAG_MAXIMIZED : 0;
+    event->data.window.flags |= (window->window_flags & WUHOO_WINDOW_FLAG_FULL_SCREEN) ? WUHOO_WINDOW_FLAG_FULL_SCREEN : 0;
+    event->data.window.flags |= (window->window_flags & WUHOO_WINDOW_FLAG_MINIMIZED) ? WUHOO_WINDOW_FLAG_MINIMIZED : 0;
+
+    window->window_flags &= ~WUHOO_WINDOW_FLAG_RESIZED;
+    window->window_flags &= ~WUHOO_WINDOW_FLAG_MAXIMIZED;
+    window->window_flags &= ~WUHOO_WINDOW_FLAG_MINIMIZED;
+    window->window_flags &= ~WUHOO_WINDOW_FLAG_FULL_SCREEN;
+
+    return WuhooTrue;
+  } else if (window->window_flags & WUHOO_WINDOW_FLAG_MOVED) {
+    event->type              = WUHOO_EVT_WINDOW;
+    event->data.window.state = WUHOO_WSTATE_MOVED;
+    event->data.window.data1 = window->x;
+    event->data.window.data2 = window->y;
+    window->window_flags &= ~WUHOO_WINDOW_FLAG_MOVED;
+
+    return WuhooTrue;
+  } else if (window->window_flags & WUHOO_WINDOW_FLAG_FOCUS_LOST) {
+    event->type              = WUHOO_EVT_WINDOW;
+    event->data.window.state = WUHOO_WSTATE_UNFOCUSED;
+    event->data.window.data1 = window->cwidth;
+    event->data.window.data2 = window->cheight;
+    window->window_flags &= ~WUHOO_WINDOW_FLAG_FOCUS_LOST;
+
+    return WuhooTrue;
+  } else if (window->window_flags & WUHOO_WINDOW_FLAG_FOCUS_GAINED) {
+    event->type              = WUHOO_EVT_WINDOW;
+    event->data.window.state = WUHOO_WSTATE_FOCUSED;
+    event->data.window.data1 = window->cwidth;
+    event->data.window.data2 = window->cheight;
+    window->window_flags &= ~WUHOO_WINDOW_FLAG_FOCUS_GAINED;
+
+    return WuhooTrue;
+  } else if (window->window_flags & WUHOO_WINDOW_FLAG_REGION_UPDATED) {
+    event->type              = WUHOO_EVT_WINDOW;
+    event->data.window.state = WUHOO_WSTATE_INVALIDATED;
+    event->data.window.data1 = window->cwidth;
+    event->data.window.data2 = window->cheight;
+    window->window_flags &= ~WUHOO_WINDOW_FLAG_REGION_UPDATED;
+
+    return WuhooTrue;
+  }
+
+  return WuhooFalse;
+}
+
 WuhooMaybeUnused WuhooInternal int
 WuhooMini(int a, int b)
 {